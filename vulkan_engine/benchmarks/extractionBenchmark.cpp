@@ -0,0 +1,177 @@
+#include "graphic_data_types.h"
+#include "sceneGeometry.h"
+
+#include <iostream>
+#include <format>
+#include <chrono>
+#include <stack>
+#include <vector>
+#include <unordered_map>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+
+/*
+	Times the Render System's geometry gathering (scenegeometry::gather, which RenderSystem::extract_render_data runs) on a synthetic Scene of about a million unique vertices,
+	against the walk from before Primitives were read by reference, which copied every Node's Primitives on the way even when its Mesh was shared with Nodes already gathered
+*/
+namespace {
+	constexpr uint32_t NODE_COUNT = 1000;
+	constexpr uint32_t MESH_COUNT = 100; //Shared between the Nodes, so each Mesh is drawn by NODE_COUNT / MESH_COUNT Nodes
+	constexpr uint32_t GRID_SIZE = 100; //Vertices per side of each Primitive's grid, so MESH_COUNT * GRID_SIZE^2 unique vertices in all
+	constexpr int RUNS = 10;
+
+	struct ExtractedGeometry {
+		std::vector<glm::vec3> positions;
+		std::vector<RenderShader::VertexAttributes> attributes;
+		std::vector<uint32_t> indices;
+		std::unordered_map<uint32_t, scenegeometry::GeometryRange> registry;
+		std::vector<scenegeometry::InstanceBatch> batches;
+
+		void clear() {
+			positions.clear();
+			attributes.clear();
+			indices.clear();
+			registry.clear();
+			batches.clear();
+		}
+	};
+
+	std::shared_ptr<Mesh> make_grid_mesh(std::mt19937& rng) {
+		std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+
+		Mesh::Primitive primitive;
+		primitive.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		primitive.vertices.colors.resize(1);
+		primitive.vertices.uvs.resize(1);
+		for (uint32_t y = 0; y < GRID_SIZE; y++) {
+			for (uint32_t x = 0; x < GRID_SIZE; x++) {
+				primitive.vertices.positions.push_back(glm::vec3(static_cast<float>(x), value(rng), static_cast<float>(y)));
+				primitive.vertices.normals.push_back(glm::vec3(0.0f, 1.0f, 0.0f));
+				primitive.vertices.tangents.push_back(glm::vec4(1.0f, 0.0f, 0.0f, 1.0f));
+				primitive.vertices.colors[0].push_back(glm::vec3(value(rng), value(rng), value(rng)));
+				primitive.vertices.uvs[0].push_back(glm::vec2(static_cast<float>(x) / GRID_SIZE, static_cast<float>(y) / GRID_SIZE));
+			}
+		}
+		for (uint32_t y = 0; y + 1 < GRID_SIZE; y++) {
+			for (uint32_t x = 0; x + 1 < GRID_SIZE; x++) {
+				uint32_t corner = y * GRID_SIZE + x;
+				primitive.indices.insert(primitive.indices.end(), { corner, corner + 1, corner + GRID_SIZE, corner + 1, corner + GRID_SIZE + 1, corner + GRID_SIZE });
+			}
+		}
+
+		std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+		mesh->primitives.push_back(std::move(primitive));
+		return mesh;
+	}
+
+	//The Nodes share MESH_COUNT Meshes, and a third of them are children of earlier Nodes
+	Scene make_scene() {
+		std::mt19937 rng(8);
+		std::vector<std::shared_ptr<Mesh>> meshes;
+		for (uint32_t i = 0; i < MESH_COUNT; i++) {
+			meshes.push_back(make_grid_mesh(rng));
+		}
+
+		Scene scene;
+		std::vector<std::shared_ptr<Node>> nodes;
+		for (uint32_t i = 0; i < NODE_COUNT; i++) {
+			std::shared_ptr<Node> node = std::make_shared<Node>();
+			node->mesh = meshes[rng() % meshes.size()];
+			if (i > 0 && i % 3 == 0) {
+				node->parent_node = nodes[rng() % nodes.size()];
+				node->parent_node.lock()->child_nodes.push_back(node);
+			}
+			else {
+				scene.root_nodes.push_back(node);
+			}
+			nodes.push_back(node);
+		}
+		return scene;
+	}
+
+	//Before: Nodes, children and Primitives were copied by value on the way, so every Node drawing a shared Mesh copied its geometry again before finding it already registered
+	void extract_by_value(const Scene& scene, ExtractedGeometry& geometry) {
+		geometry.clear();
+		uint32_t index_cursor = 0;
+		int32_t vertex_cursor = 0;
+
+		std::stack<std::shared_ptr<Node>> dfs_node_stack;
+		for (auto root_node : scene.root_nodes) {
+			dfs_node_stack.push(root_node);
+		}
+		while (!dfs_node_stack.empty()) {
+			std::shared_ptr<Node> node = dfs_node_stack.top();
+			dfs_node_stack.pop();
+
+			for (std::shared_ptr<Node> child_node : node->child_nodes) {
+				dfs_node_stack.push(child_node);
+			}
+
+			if (node->mesh != nullptr) {
+				std::shared_ptr<Mesh>& currentMesh = node->mesh;
+				for (size_t primitive_index = 0; primitive_index < currentMesh->primitives.size(); primitive_index++) {
+					Mesh::Primitive primitive = currentMesh->primitives[primitive_index];
+
+					auto [geometry_it, first_use] = geometry.registry.try_emplace(primitive.getID());
+					if (first_use) {
+						geometry_it->second = { .firstIndex = index_cursor, .indexCount = static_cast<uint32_t>(primitive.index_count()), .vertexOffset = vertex_cursor, .batchIndex = static_cast<uint32_t>(geometry.batches.size()) };
+						geometry.batches.push_back({ .primitive_id = primitive.getID() });
+						index_cursor += static_cast<uint32_t>(primitive.index_count());
+						vertex_cursor += static_cast<int32_t>(primitive.vertex_count());
+
+						geometry.positions.insert(geometry.positions.end(), primitive.vertices.positions.begin(), primitive.vertices.positions.end());
+						primitive.append_vertex_attributes(geometry.attributes);
+						geometry.indices.insert(geometry.indices.end(), primitive.indices.begin(), primitive.indices.end());
+					}
+
+					geometry.batches[geometry_it->second.batchIndex].model_matrix_ids.push_back(node->getID());
+				}
+			}
+		}
+	}
+
+	//After: the Render System's own gathering, of the vertices and indices only as there are no meshlets here
+	void extract_by_reference(const Scene& scene, ExtractedGeometry& geometry) {
+		geometry.positions.clear();
+		geometry.attributes.clear();
+		geometry.indices.clear();
+
+		scenegeometry::gather(scene, { .positions = &geometry.positions, .attributes = &geometry.attributes, .indices = &geometry.indices }, geometry.registry, geometry.batches);
+	}
+
+	//Fastest of RUNS extractions into the same output, as the Render System reuses its extraction buffers. Returns ms per extraction
+	template<typename Extraction>
+	double time_extraction(const Scene& scene, ExtractedGeometry& geometry, Extraction extraction) {
+		double bestMilliseconds = 0.0;
+		for (int run = 0; run < RUNS; run++) {
+			auto start = std::chrono::steady_clock::now();
+			extraction(scene, geometry);
+			double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			bestMilliseconds = run == 0 ? milliseconds : std::min(bestMilliseconds, milliseconds);
+		}
+		return bestMilliseconds;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	Scene scene = make_scene();
+
+	ExtractedGeometry byValue;
+	ExtractedGeometry byReference;
+	double byValueCost = time_extraction(scene, byValue, extract_by_value);
+	double byReferenceCost = time_extraction(scene, byReference, extract_by_reference);
+
+	bool sameBatches = byValue.batches.size() == byReference.batches.size() && std::equal(byValue.batches.begin(), byValue.batches.end(), byReference.batches.begin(),
+		[](const scenegeometry::InstanceBatch& a, const scenegeometry::InstanceBatch& b) { return a.primitive_id == b.primitive_id && a.model_matrix_ids == b.model_matrix_ids; });
+	if (byValue.positions != byReference.positions || byValue.indices != byReference.indices || !sameBatches) {
+		std::cerr << "The extractions disagree" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::cout << std::format("{} vertices in {} Primitives drawn by {} Nodes, fastest of {} runs", byReference.positions.size(), byReference.batches.size(), NODE_COUNT, RUNS) << std::endl;
+	std::cout << std::format("By value:     {:.3f} ms per extraction", byValueCost) << std::endl;
+	std::cout << std::format("By reference: {:.3f} ms per extraction", byReferenceCost) << std::endl;
+	std::cout << std::format("Speedup:      {:.2f}x", byValueCost / byReferenceCost) << std::endl;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,204 @@
+/*
+	Binary cache of a loaded scene file. Holds everything the loader produces in the layout the GPU consumes (vertex positions,
+	RenderShader::VertexAttributes, indices and pre-mipped RGBA8 pixels) so a cached file can be memory mapped and handed
+	straight to staging without parsing or per-vertex conversion.
+
+	Layout: Header | record tables | string bytes | data blob. All record indices are local to the baked file and -1 means none.
+*/
+#pragma once
+
+#include "glm.hpp"
+#include "vulkan/vulkan.h"
+#include "shader_types.h"
+#include "mappedFile.h"
+
+#include <vector>
+#include <string>
+#include <span>
+#include <optional>
+#include <filesystem>
+
+namespace Baked {
+	constexpr char MAGIC[8] = "VKEBAKE";
+	constexpr uint32_t VERSION = 5;
+
+	struct Section {
+		uint64_t offset; //From the start of the file
+		uint64_t count; //Records, or bytes for the string and data sections
+	};
+
+	struct String {
+		uint64_t offset; //Into the string section
+		uint32_t length;
+	};
+
+	struct Sampler {
+		int32_t magFilter;
+		int32_t minFilter;
+		int32_t mipmapMode;
+	};
+
+	//Levels are tightly packed one after another starting from level 0. Levels past levelCount are generated on the GPU when loaded
+	struct Image {
+		String name;
+		uint32_t width;
+		uint32_t height;
+		uint32_t levelCount;
+		int32_t format;
+		uint64_t dataOffset; //Into the data section
+		uint64_t dataSize;
+	};
+
+	struct Texture {
+		String name;
+		int32_t image_index;
+		int32_t sampler_index;
+	};
+
+	struct Material {
+		String name;
+
+		int32_t normal_texture;
+		int32_t normal_coord_index;
+		float normal_scale;
+
+		int32_t occlusion_texture;
+		int32_t occlusion_coord_index;
+		float occlusion_strength;
+
+		int32_t emission_texture;
+		int32_t emission_coord_index;
+		float emission_Factor[3];
+
+		int32_t baseColor_texture;
+		int32_t baseColor_coord_index;
+		float baseColor_Factor[4];
+
+		int32_t metal_rough_texture;
+		int32_t metal_rough_coord_index;
+		float metallic_Factor;
+		float roughness_Factor;
+
+		uint32_t double_sided;
+	};
+
+	struct Primitive {
+		int32_t topology;
+		int32_t material_index;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint64_t positionsOffset; //Into the data section. vertexCount glm::vec3
+		uint64_t attributesOffset; //vertexCount RenderShader::VertexAttributes
+		uint64_t indicesOffset; //indexCount uint32_t
+		float bounds_min[3]; //Local space Axis-Aligned Bounding Box
+		float bounds_max[3];
+	};
+
+	struct Mesh {
+		String name;
+		uint32_t firstPrimitive;
+		uint32_t primitiveCount;
+	};
+
+	//Nodes of a Scene are stored with every parent before its children
+	struct Node {
+		String name;
+		int32_t mesh_index;
+		int32_t parent_index; //Relative to the Scene's first Node
+		float local_transform[16];
+	};
+
+	struct Scene {
+		String name;
+		uint32_t firstNode;
+		uint32_t nodeCount;
+	};
+
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t attributeStride; //sizeof(RenderShader::VertexAttributes) when baked. A changed shader layout invalidates the file
+		uint64_t sourceHash;
+		int32_t defaultScene;
+		uint32_t padding;
+
+		Section samplers;
+		Section images;
+		Section textures;
+		Section materials;
+		Section primitives;
+		Section meshes;
+		Section nodes;
+		Section scenes;
+		Section strings;
+		Section data;
+	};
+
+	//Hash of a scene file's content and the size and write time of the resource files next to it
+	uint64_t hash_source(const std::filesystem::path& sourcePath);
+
+	//Levels in a full mip chain down to 1x1. Matches the level count of a mipmapped VulkanContext::create_image
+	uint32_t full_mip_count(uint32_t width, uint32_t height);
+
+	//Where the cache of a scene file lives
+	std::filesystem::path cache_path(const std::filesystem::path& sourcePath);
+}
+
+//Collects the records of a scene as it's loaded and writes them out as a baked file
+class BakedSceneWriter {
+public:
+	std::vector<Baked::Sampler> samplers;
+	std::vector<Baked::Image> images;
+	std::vector<Baked::Texture> textures;
+	std::vector<Baked::Material> materials;
+	std::vector<Baked::Primitive> primitives;
+	std::vector<Baked::Mesh> meshes;
+	std::vector<Baked::Node> nodes;
+	std::vector<Baked::Scene> scenes;
+	int32_t defaultScene = -1;
+
+	Baked::String add_string(const std::string& string);
+	uint64_t add_data(const void* data, size_t size); //Returns the offset into the data section. Data is 16 byte aligned
+
+	//Writes to a temporary file first and renames it, so a failed or interrupted write never leaves a corrupt cache behind
+	bool write(const std::filesystem::path& filePath, uint64_t sourceHash) const;
+
+private:
+	std::string _strings;
+	std::vector<std::byte> _data;
+};
+
+//Memory mapped baked file. Spans stay valid as long as the mapping is held
+class BakedSceneFile {
+public:
+	static std::optional<BakedSceneFile> open(const std::filesystem::path& filePath, uint64_t sourceHash); //Returns nullopt if the file is missing, stale or malformed
+
+	const Baked::Header& header() const { return *reinterpret_cast<const Baked::Header*>(_mapping->data()); }
+	const std::shared_ptr<MappedFile>& mapping() const { return _mapping; }
+
+	std::span<const Baked::Sampler> samplers() const { return section<Baked::Sampler>(header().samplers); }
+	std::span<const Baked::Image> images() const { return section<Baked::Image>(header().images); }
+	std::span<const Baked::Texture> textures() const { return section<Baked::Texture>(header().textures); }
+	std::span<const Baked::Material> materials() const { return section<Baked::Material>(header().materials); }
+	std::span<const Baked::Primitive> primitives() const { return section<Baked::Primitive>(header().primitives); }
+	std::span<const Baked::Mesh> meshes() const { return section<Baked::Mesh>(header().meshes); }
+	std::span<const Baked::Node> nodes() const { return section<Baked::Node>(header().nodes); }
+	std::span<const Baked::Scene> scenes() const { return section<Baked::Scene>(header().scenes); }
+
+	std::string string(Baked::String string) const;
+
+	template<typename T>
+	std::span<const T> data(uint64_t offset, uint64_t count) const {
+		return std::span<const T>(reinterpret_cast<const T*>(_mapping->data() + header().data.offset + offset), count);
+	}
+
+private:
+	std::shared_ptr<MappedFile> _mapping;
+
+	template<typename T>
+	std::span<const T> section(const Baked::Section& section) const {
+		return std::span<const T>(reinterpret_cast<const T*>(_mapping->data() + section.offset), section.count);
+	}
+
+	bool validate() const;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+/*
+	Slots of the bindless Sampled Image and Sampler arrays of the Render System's descriptor set. Slots are handed out from free lists and each add or remove
+	only writes its own descriptor. A removed slot may still be read by frames in flight, so it's only handed out again once the last frame that could read it has completed.
+*/
+class BindlessRegistry {
+public:
+	static constexpr uint32_t IMAGE_BINDING = 0;
+	static constexpr uint32_t SAMPLER_BINDING = 1;
+	static constexpr uint32_t MAX_IMAGE_SLOTS = 65536; //Caps the device limit, which can be in the millions, so the pool stays small
+	static constexpr uint32_t MAX_SAMPLER_SLOTS = 2048; //Samplers are also bound by maxSamplerAllocationCount, commonly 4000
+
+	//Array sizes to create the set layout with. The device's update after bind limits, capped
+	static uint32_t image_capacity(VkPhysicalDevice physicalDevice);
+	static uint32_t sampler_capacity(VkPhysicalDevice physicalDevice);
+
+	void init(VkDevice device, VkDescriptorSet descriptorSet, uint32_t imageCapacity, uint32_t samplerCapacity);
+
+	//Write the descriptor into a free slot and return the slot. Throws when the array is full
+	uint32_t add_image(VkImageView imageView, VkImageLayout layout);
+	uint32_t add_sampler(VkSampler sampler);
+
+	//lastReadingFrame is the last frame whose commands may still index the slot
+	void remove_image(uint32_t slot, uint64_t lastReadingFrame) { _images.retire(slot, lastReadingFrame); }
+	void remove_sampler(uint32_t slot, uint64_t lastReadingFrame) { _samplers.retire(slot, lastReadingFrame); }
+
+	//Frees the removed slots that no frame after completedFrame can read
+	void recycle(uint64_t completedFrame) {
+		_images.recycle(completedFrame);
+		_samplers.recycle(completedFrame);
+	}
+
+	uint32_t image_count() const { return _images.used(); }
+	uint32_t sampler_count() const { return _samplers.used(); }
+
+private:
+	struct SlotAllocator {
+		const char* name;
+		uint32_t capacity = 0;
+		uint32_t next = 0; //Slots from here on were never handed out
+		std::vector<uint32_t> free{};
+		std::vector<std::pair<uint64_t, uint32_t>> retired{}; //Last reading frame and slot, in removal order
+
+		uint32_t allocate();
+		void retire(uint32_t slot, uint64_t lastReadingFrame) { retired.push_back({ lastReadingFrame, slot }); }
+		void recycle(uint64_t completedFrame);
+		uint32_t used() const { return next - static_cast<uint32_t>(free.size() + retired.size()); }
+	};
+
+	VkDevice _device = VK_NULL_HANDLE;
+	VkDescriptorSet _descriptorSet = VK_NULL_HANDLE;
+	SlotAllocator _images{ .name = "Sampled Image" };
+	SlotAllocator _samplers{ .name = "Sampler" };
+
+	void write(uint32_t binding, VkDescriptorType type, uint32_t slot, const VkDescriptorImageInfo& info);
+};
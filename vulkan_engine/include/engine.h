@@ -22,12 +22,17 @@
 #include "Camera.h"
 #include "renderSystem.h"	
 #include "guiSystem.h"
+#include "threadPool.h"
+#include "loader.h"
+#include "sceneBVH.h"
+#include "textureStreamer.h"
 
 #include <vector>
 #include <deque>
 #include <functional>
 #include <filesystem>
 #include <map>
+#include <future>
 
 class Engine {
 public:
@@ -67,9 +72,13 @@ private:
 	//VulkanContext
 	VulkanContext _vkContext;
 
+	//Worker Threads
+	ThreadPool _threadPool;
+
 	//Systems
 	RenderSystem _renderSys{ _vkContext };
 	GUISystem _guiSys{ _vkContext };
+	TextureStreamer _textureStreamer{ _vkContext };
 
 	//Swapchain
 	bool windowResized = false;
@@ -84,5 +93,17 @@ private:
 	GraphicsDataPayload _payload;
 	GUIParameters _guiParam;
 
+	//Spatial Queries over the current Scene
+	SceneBVH _sceneBVH;
+
+	//Background Loading
+	std::future<GraphicsDataPayload> _pendingLoad;
+	LoadProgress _loadProgress;
+
+	void start_background_load(const std::string& filePath);
+	bool finish_background_load();
+
+	void rebuild_sceneBVH();
+
 	void setup_default_data();
 };
\ No newline at end of file
@@ -9,10 +9,19 @@
 #include "vk_mem_alloc.h"
 
 #include "vulkan_helper_types.h"
+#include "shader_types.h"
+#include "meshlet.h"
+#include "indexOptimizer.h"
+#include "transformHierarchy.h"
+#include "mappedFile.h"
 
 #include <vector>
 #include <string>
 #include <memory>
+#include <unordered_set>
+#include <mutex>
+#include <atomic>
+#include <span>
 
 struct Scene;
 struct Node;
@@ -21,6 +30,56 @@ struct Material;
 struct Texture;
 struct PointLight;
 
+/*
+	Records the IDs of objects of a type that were modified since the Render System last consumed the changes.
+	Lets the Render System only extract and upload the data of changed objects instead of walking the whole scene.
+	Guarded by a mutex since background loading threads record changes while the Render System consumes them.
+*/
+struct ChangeJournal {
+	void record(uint32_t id) {
+		std::lock_guard<std::mutex> lock(mutex);
+		changed_ids.insert(id);
+	}
+
+	void record(std::span<const uint32_t> ids) {
+		std::lock_guard<std::mutex> lock(mutex);
+		changed_ids.insert(ids.begin(), ids.end());
+	}
+
+	bool is_changed(uint32_t id) const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return changed_ids.contains(id);
+	}
+
+	bool empty() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return changed_ids.empty();
+	}
+
+	//Returns all recorded IDs and clears the journal
+	std::unordered_set<uint32_t> consume() {
+		std::lock_guard<std::mutex> lock(mutex);
+		std::unordered_set<uint32_t> consumed = std::move(changed_ids);
+		changed_ids.clear();
+		return consumed;
+	}
+
+private:
+	mutable std::mutex mutex;
+	std::unordered_set<uint32_t> changed_ids{};
+};
+
+//Where the Texture Streamer reads a streamed Image's Mip Levels from: its full Mip Chain in a mapped Baked Scene Cache
+struct StreamedImageSource {
+	uint32_t image_index; //Into GraphicsDataPayload::images
+	std::shared_ptr<MappedFile> mapping;
+	uint64_t dataOffset; //Of level 0, from the start of the mapping. Levels are tightly packed one after another
+	VkExtent3D extent; //Of level 0
+	VkFormat format;
+	uint32_t levelCount; //Full Mip Chain
+	uint32_t residentLevel; //Finest level of the image it was loaded with
+};
+
 struct GraphicsDataPayload{
 	size_t current_scene_idx = 0; //The scene to load
 	std::vector<Scene> scenes{};
@@ -31,6 +90,11 @@ struct GraphicsDataPayload{
 	std::vector<std::shared_ptr<Texture>> textures{}; //Global Textures
 	std::vector<std::shared_ptr<Material>> materials{}; //Global Materials
 	std::vector<PointLight> pointLights{};
+	std::vector<StreamedImageSource> streamedImages{}; //Images whose finer Mip Levels the Texture Streamer loads and evicts as needed
+
+	//Vertex cache stats of the Primitives optimized while loading, before and after reordering. Files loaded from their Baked Cache were optimized when baked and add nothing
+	indexoptimizer::CacheStats vertexCache_before{};
+	indexoptimizer::CacheStats vertexCache_after{};
 
 	glm::mat4 camera_transform;
 	glm::mat4 proj_transform;
@@ -40,6 +104,7 @@ struct GraphicsDataPayload{
 struct Scene {
 	std::string name;
 	std::vector<std::shared_ptr<Node>> root_nodes{};
+	std::shared_ptr<TransformHierarchy> transforms; //Created once all the Scene's Nodes are loaded
 };
 
 /*
@@ -58,12 +123,24 @@ struct Node {
 
 	}
 
-	uint32_t getID() {
+	uint32_t getID() const {
 		return id;
 	}
 
-	//Updates the Local Transform as well as its World Transform based on parent
+	//Records that the Node's World Transform changed. Called automatically when the transform is updated
+	void mark_changed() {
+		change_journal.record(id);
+		bounds_journal.record(id);
+	}
+
+	//Updates the Local Transform. Once attached to its Scene's Transform Hierarchy, its World Transform and its descendants' are updated by the hierarchy's next update.
+	//Before that, they're updated right away based on parent
 	void updateLocalTransform(const glm::mat4& newTransform) {
+		if (transform_hierarchy != nullptr) {
+			transform_hierarchy->set_local(transform_index, newTransform);
+			return;
+		}
+
 		local_transform = newTransform;
 		auto locked_parent_node = parent_node.lock();
 		if (locked_parent_node != nullptr) {
@@ -75,20 +152,32 @@ struct Node {
 	}
 
 	const glm::mat4& get_LocalTransform() {
-		return local_transform;
+		return transform_hierarchy != nullptr ? transform_hierarchy->local(transform_index) : local_transform;
 	}
 
 	const glm::mat4& get_WorldTransform() {
-		return world_transform;
+		return transform_hierarchy != nullptr ? transform_hierarchy->world(transform_index) : world_transform;
+	}
+
+	//Moves the Node's Transforms into the hierarchy. Called by TransformHierarchy::create
+	void attach_transform(const std::shared_ptr<TransformHierarchy>& hierarchy, uint32_t index) {
+		transform_hierarchy = hierarchy;
+		transform_index = index;
 	}
+
+	inline static ChangeJournal change_journal{}; //Nodes whose World Transform changed
+	inline static ChangeJournal bounds_journal{}; //Same as change_journal, but consumed by the Scene BVH instead of the Render System
 private:
-	inline static uint32_t available_id = 0;
+	inline static std::atomic<uint32_t> available_id = 0; //Atomic since objects can be created by background loading threads
 	uint32_t id;
-	glm::mat4 local_transform; //Local relative to its parent Node
-	glm::mat4 world_transform; //Local_Transform * Parent's World Transform. If Root Node, Local_Transform * Identity_Matrix. Should be updated when local_transform us updated.
+	std::shared_ptr<TransformHierarchy> transform_hierarchy; //Holds the Transforms once attached
+	uint32_t transform_index = 0;
+	glm::mat4 local_transform; //Local relative to its parent Node. Only used until attached
+	glm::mat4 world_transform; //Parent's World Transform * Local_Transform, so the Local Transform is applied first. If Root Node, Identity_Matrix * Local_Transform. Should be updated when local_transform us updated. Only used until attached
 
 	void updateWorldTransform(const glm::mat4& parentTransform) {
-		world_transform = local_transform * parentTransform;
+		world_transform = parentTransform * local_transform;
+		mark_changed();
 		for (std::shared_ptr<Node> child : child_nodes) {
 			child->updateWorldTransform(world_transform);
 		}
@@ -97,30 +186,121 @@ private:
 
 struct Mesh { 
 	struct Primitive {
-		struct Vertex { //May move these types of structs outside as nesting structs may be bad practice idk
-			glm::vec3 position;
-			glm::vec3 normal;
-			glm::vec4 tangent;
-			//v Have to change how Color_n and Texture_n data is stored to work as passable data.
-			std::vector<glm::vec3> colors{}; //Represents Color0, Color1, ...
-			std::vector<glm::vec2> uvs{}; //Represents Texcoord0, Texcoord1, ...
+		//Vertex Attributes stored as one contiguous stream per attribute. Every stream holds one element per position
+		struct VertexStreams {
+			std::vector<glm::vec3> positions{};
+			std::vector<glm::vec3> normals{};
+			std::vector<glm::vec4> tangents{};
+			std::vector<std::vector<glm::vec3>> colors{}; //Color0, Color1, ... streams
+			std::vector<std::vector<glm::vec2>> uvs{}; //Texcoord0, Texcoord1, ... streams
+		};
+
+		//Vertex and Index data already in the layout the GPU consumes, such as spans into a memory mapped baked scene. Used instead of vertices and indices when present
+		struct GPUReadyGeometry {
+			std::shared_ptr<const void> owner; //Keeps the memory the spans point into alive
+			std::span<const glm::vec3> positions{};
+			std::span<const RenderShader::VertexAttributes> attributes{};
+			std::span<const uint32_t> indices{};
 		};
 
 		VkPrimitiveTopology topology;
-		std::vector<Vertex> vertices{};
+		VertexStreams vertices{};
 		std::vector<uint32_t> indices{};
+		GPUReadyGeometry gpu_geometry{};
 		std::weak_ptr<Material> material;
 
+		//Local space Axis-Aligned Bounding Box of the positions. Used to cull the Primitive's instances against the camera
+		glm::vec3 bounds_min{ 0.0f };
+		glm::vec3 bounds_max{ 0.0f };
+
+		//Meshlets drawn by the Mesh Shader path, with their vertex indices and packed triangles. Built at load by build_meshlets
+		std::vector<MeshShader::Meshlet> meshlets{};
+		std::vector<uint32_t> meshlet_data{};
+
 		Primitive() : id(available_id++) {
 
 		}
 
-		uint32_t getID() {
+		uint32_t getID() const {
 			return id;
 		}
 
+		bool has_gpu_geometry() const {
+			return gpu_geometry.owner != nullptr;
+		}
+
+		size_t vertex_count() const {
+			return has_gpu_geometry() ? gpu_geometry.positions.size() : vertices.positions.size();
+		}
+
+		size_t index_count() const {
+			return has_gpu_geometry() ? gpu_geometry.indices.size() : indices.size();
+		}
+
+		//Fits the bounds to the positions. For when the source didn't provide them
+		void compute_bounds() {
+			std::span<const glm::vec3> positions = has_gpu_geometry() ? gpu_geometry.positions : std::span<const glm::vec3>(vertices.positions);
+			if (positions.empty()) {
+				bounds_min = bounds_max = glm::vec3(0.0f);
+				return;
+			}
+
+			bounds_min = bounds_max = positions[0];
+			for (const glm::vec3& position : positions) {
+				bounds_min = glm::min(bounds_min, position);
+				bounds_max = glm::max(bounds_max, position);
+			}
+		}
+
+		//Reorders the triangles and vertices of an indexed triangle list for the vertex cache, overdraw and vertex fetch, dropping unreferenced vertices. Adds the vertex cache stats to before and after. Other topologies and GPU ready geometry are left as they are
+		void optimize_geometry(indexoptimizer::CacheStats& before, indexoptimizer::CacheStats& after) {
+			size_t vertex_count = vertices.positions.size();
+			if (topology != VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST || has_gpu_geometry() || indices.empty() || !indexoptimizer::is_triangle_list(indices, vertex_count))
+				return;
+
+			before += indexoptimizer::analyze_vertex_cache(indices, vertex_count);
+
+			std::vector<uint32_t> remap;
+			size_t new_count = indexoptimizer::optimize(indices, vertices.positions, remap);
+			indexoptimizer::remap_stream(vertices.positions, remap, new_count);
+			indexoptimizer::remap_stream(vertices.normals, remap, new_count);
+			indexoptimizer::remap_stream(vertices.tangents, remap, new_count);
+			for (std::vector<glm::vec3>& colors : vertices.colors)
+				indexoptimizer::remap_stream(colors, remap, new_count);
+			for (std::vector<glm::vec2>& uvs : vertices.uvs)
+				indexoptimizer::remap_stream(uvs, remap, new_count);
+
+			after += indexoptimizer::analyze_vertex_cache(indices, new_count);
+		}
+
+		//Clusters the triangles into Meshlets. Should be called once the indices and material are final
+		void build_meshlets();
+
+		//Appends the Render Shader's Vertex Attributes built from the streams. Color_0 and Texcoord_0 are used, defaulting to white and -1 when missing
+		void append_vertex_attributes(std::vector<RenderShader::VertexAttributes>& attributes) const {
+			size_t count = vertices.positions.size();
+			const glm::vec3* colors = !vertices.colors.empty() ? vertices.colors[0].data() : nullptr;
+			const glm::vec2* uvs = !vertices.uvs.empty() ? vertices.uvs[0].data() : nullptr;
+
+			size_t first = attributes.size();
+			attributes.resize(first + count);
+			for (size_t i = 0; i < count; i++) {
+				RenderShader::VertexAttributes& attribute = attributes[first + i];
+				attribute.normal = vertices.normals[i];
+				attribute.tangent = vertices.tangents[i];
+				attribute.color = colors != nullptr ? colors[i] : glm::vec3(1.0f, 1.0f, 1.0f);
+				attribute.uv = uvs != nullptr ? uvs[i] : glm::vec2(-1.0f, -1.0f);
+			}
+		}
+
+		//Records that the Primitive's material (or other Primitive Info) changed. Should be called after modifying it
+		void mark_changed() {
+			change_journal.record(id);
+		}
+
+		inline static ChangeJournal change_journal{};
 	private:
-		inline static uint32_t available_id = 0;
+		inline static std::atomic<uint32_t> available_id = 0; //Atomic since objects can be created by background loading threads
 		uint32_t id;
 	};
 
@@ -135,10 +315,17 @@ struct Material {
 
 	}
 
-	uint32_t getID() {
+	uint32_t getID() const {
 		return id;
 	}
 
+	//Records that the Material's values changed. Should be called after modifying any of its members
+	void mark_changed() {
+		change_journal.record(id);
+	}
+
+	inline static ChangeJournal change_journal{};
+
 	std::weak_ptr<Texture> normal_texture;
 	int normal_coord_index = -1; //Index of the specific Texture Coord in the Mesh
 	float normal_scale = 0.0f;
@@ -161,26 +348,51 @@ struct Material {
 	float metallic_Factor = 0.0f;
 	float roughness_Factor = 0.0f;
 
+	bool double_sided = false; //Back faces are visible, so its Primitives' Meshlets are never Normal Cone culled
+
 private:
-	inline static uint32_t available_id = 0;
+	inline static std::atomic<uint32_t> available_id = 0; //Atomic since objects can be created by background loading threads
 	uint32_t id;
 };
 
+//Defined after Material, which it reads
+inline void Mesh::Primitive::build_meshlets() {
+	meshlets.clear();
+	meshlet_data.clear();
+	std::span<const uint32_t> triangle_indices = has_gpu_geometry() ? gpu_geometry.indices : std::span<const uint32_t>(indices);
+	std::span<const glm::vec3> positions = has_gpu_geometry() ? gpu_geometry.positions : std::span<const glm::vec3>(vertices.positions);
+	meshlet::build(triangle_indices, positions, meshlets, meshlet_data);
+
+	//The other paths draw back faces too, so a double sided Primitive's Meshlets can't be culled by their Normal Cones
+	std::shared_ptr<Material> mat = material.lock();
+	if (mat != nullptr && mat->double_sided) {
+		for (MeshShader::Meshlet& meshlet : meshlets)
+			meshlet.cone_cutoff = 1.0f;
+	}
+}
+
 struct Texture {
 	Texture() : id(available_id++) {
 
 	}
 
-	uint32_t getID() {
+	uint32_t getID() const {
 		return id;
 	}
 
+	//Records that the Texture's image or sampler index changed. Should be called after modifying them
+	void mark_changed() {
+		change_journal.record(id);
+	}
+
+	inline static ChangeJournal change_journal{};
+
 	std::string name;
 	int image_index = 0;
 	int sampler_index = 0;
 
 private:
-	inline static uint32_t available_id = 0;
+	inline static std::atomic<uint32_t> available_id = 0; //Atomic since objects can be created by background loading threads
 	uint32_t id;
 };
 
@@ -18,6 +18,24 @@ struct GUIParameters { //Used to pass GUI Parameters and values outside of GUISy
 	std::string OpenedFilePath;
 
 	bool sceneChanged;
+
+	//Background File Loading
+	bool fileLoading = false; //File Opening is disabled while a file is loading
+	float loadProgress = 0.0f; //0 to 1
+	std::string loadStage;
+	std::string loadError; //Why the last load failed, empty if it didn't
+
+	//Rendering
+	bool depthPrepass = true;
+	int renderPath = 0; //Index of the RenderPath
+	float depthPrepassTime = 0.0f; //GPU milliseconds. The Visibility Pass when rendering with the Visibility Buffer
+	float shadingTime = 0.0f;
+	const char* transformISA = ""; //Instruction set the Transform Kernels run with
+
+	//Texture Streaming
+	int textureBudgetMB = 0; //Caps the streamed Textures' VRAM. 0 leaves it to the device's memory budget
+	float streamedTextureMB = 0.0f;
+	float textureBudgetUsedMB = 0.0f; //Budget the streamed Textures were held to last frame
 };
 
 class GUISystem {
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "glm.hpp"
+
+#include <vector>
+#include <span>
+#include <cstdint>
+
+//Reorders indexed triangle lists so fewer vertices are shaded: triangles for the post-transform vertex cache (Tipsify) and then for overdraw, and vertices in the order the triangles first use them
+namespace indexoptimizer {
+
+	constexpr uint32_t CACHE_SIZE = 16; //FIFO entries assumed by the optimizer and the statistics
+	constexpr uint32_t UNUSED = UINT32_MAX; //Remap entry of a vertex no triangle references
+
+	struct CacheStats {
+		size_t triangles = 0;
+		size_t vertices = 0; //Distinct vertices referenced
+		size_t transforms = 0; //Cache misses, so Vertex Shader invocations
+
+		float acmr() const { return triangles > 0 ? static_cast<float>(transforms) / triangles : 0.0f; } //Average Cache Miss Ratio. Transforms per triangle, 0.5 at best
+		float atvr() const { return vertices > 0 ? static_cast<float>(transforms) / vertices : 0.0f; } //Average Transform to Vertex Ratio. 1 at best
+
+		CacheStats& operator+=(const CacheStats& other) {
+			triangles += other.triangles;
+			vertices += other.vertices;
+			transforms += other.transforms;
+			return *this;
+		}
+	};
+
+	//Whether the indices form whole triangles that only reference existing vertices
+	bool is_triangle_list(std::span<const uint32_t> indices, size_t vertex_count);
+
+	//Simulates a FIFO vertex cache of cache_size entries over the indices
+	CacheStats analyze_vertex_cache(std::span<const uint32_t> indices, size_t vertex_count, uint32_t cache_size = CACHE_SIZE);
+
+	//Tipsify. Fans triangles around a vertex at a time, moving on to the vertex that is still in cache and has the fewest triangles left. cluster_starts gets the first triangle of each run that begins at a cache discontinuity
+	void optimize_vertex_cache(std::span<uint32_t> indices, size_t vertex_count, std::vector<uint32_t>& cluster_starts, uint32_t cache_size = CACHE_SIZE);
+
+	//Orders the clusters by how far they face out from the mesh's center, so the triangles likely to occlude others are drawn first. Triangles keep their order within a cluster, so the cache order mostly survives
+	void optimize_overdraw(std::span<uint32_t> indices, std::span<const uint32_t> cluster_starts, std::span<const glm::vec3> positions);
+
+	//Renumbers the vertices in the order the indices first reference them, so vertex fetches walk memory forward. Returns the referenced vertex count, and remap maps each old vertex to its new one or UNUSED
+	size_t optimize_vertex_fetch(std::span<uint32_t> indices, size_t vertex_count, std::vector<uint32_t>& remap);
+
+	//All three passes in order. The vertex streams are then rearranged with remap_stream
+	size_t optimize(std::span<uint32_t> indices, std::span<const glm::vec3> positions, std::vector<uint32_t>& remap);
+
+	//Moves each vertex to its remapped position and drops the unreferenced ones
+	template<typename T>
+	void remap_stream(std::vector<T>& stream, std::span<const uint32_t> remap, size_t new_count) {
+		std::vector<T> remapped(new_count);
+		for (size_t i = 0; i < remap.size() && i < stream.size(); i++) {
+			if (remap[i] != UNUSED)
+				remapped[remap[i]] = stream[i];
+		}
+		stream = std::move(remapped);
+	}
+}
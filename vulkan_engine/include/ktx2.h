@@ -0,0 +1,25 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <vector>
+#include <span>
+#include <optional>
+#include <cstdint>
+
+//Reads KTX2 container files holding a 2D Texture in a format Textures can use directly
+namespace ktx2 {
+
+	struct Texture {
+		VkFormat format;
+		VkExtent3D extent;
+		uint32_t levelCount;
+		std::vector<unsigned char> data; //Levels tightly packed one after another starting from level 0
+	};
+
+	bool is_ktx2(std::span<const unsigned char> bytes);
+
+	//Nothing if the file is malformed, supercompressed (BasisLZ, Zstandard or ZLIB), not a single 2D image, or in a format texcompress doesn't support.
+	//Block Compressed files must hold their full Mip Chain, as BC levels can't be generated on the GPU
+	std::optional<Texture> read(std::span<const unsigned char> bytes);
+}
@@ -2,12 +2,50 @@
 
 #include <fastgltf/types.hpp>
 #include <filesystem>
+#include <atomic>
+#include <span>
 #include "vulkan/vulkan.h"
 #include "graphic_data_types.h"
 #include "vulkanContext.h"
+#include "threadPool.h"
+#include "bakedScene.h"
 //May make a struct to encapsulate to group these functions
 
-void loadGLTFFile(VulkanContext& vkContext, GraphicsDataPayload& dataPayload, std::filesystem::path filePath);
+//Decoded pixels of an Image, 8-bit RGBA unless read from a KTX2 file or Block Compressed. Holds its Mip Levels tightly packed one after another
+struct DecodedImage {
+	std::vector<unsigned char> pixels{};
+	VkExtent3D extent{};
+	uint32_t levelCount = 0;
+	VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+};
+
+//Progress of a loadGLTFFile call. Safe to read from another thread while the load runs
+struct LoadProgress {
+	std::atomic<float> fraction = 0.0f; //0 to 1
+	std::atomic<const char*> stage = "";
+
+	void reset() {
+		fraction = 0.0f;
+		stage = "Starting";
+	}
+};
+
+//Can run on a background thread as long as dataPayload is not used elsewhere until it returns.
+//Loads from the file's Baked Cache when it's up to date, otherwise parses the file and writes the cache for the next load
+void loadGLTFFile(VulkanContext& vkContext, ThreadPool& threadPool, GraphicsDataPayload& dataPayload, std::filesystem::path filePath, LoadProgress* progress = nullptr);
+
+//Loads a Baked Scene into the payload. Primitives keep the file mapped and read their geometry straight from it
+void load_baked_scene(VulkanContext& vkContext, GraphicsDataPayload& dataPayload, const BakedSceneFile& bakedFile, LoadProgress* progress = nullptr);
+
+//Whether a baked Image is loaded with only its tail resident and streamed from the file
+bool is_streamed_image(const Baked::Image& image);
+
+//Lists the baked file's streamed Images in the payload, which holds the file's Images from textureImage_index_offset. residentLevels holds the finest level each Image was uploaded with
+void add_streamed_images(GraphicsDataPayload& dataPayload, const BakedSceneFile& bakedFile, size_t textureImage_index_offset, std::span<const uint32_t> residentLevels);
+
+//Moves all data of a separately loaded payload into dstPayload and switches to the loaded payload's current scene.
+//srcPayload must have started as a copy of dstPayload's Images and Samplers so the loaded Textures' indices are already correct for dstPayload
+void merge_payload(GraphicsDataPayload& dstPayload, GraphicsDataPayload&& srcPayload);
 
 //Converts GLTF Texture Sampler Filter Types to Vulkan Types
 VkFilter extract_filter(fastgltf::Filter filter);
@@ -20,5 +58,24 @@ VkPrimitiveTopology extract_topology_type(fastgltf::PrimitiveType type);
 
 glm::mat4 translate_to_glm_mat4(fastgltf::math::fmat4x4 gltf_mat4);
 
-//Extract Image Data from GLTF data
-std::optional<AllocatedImage> load_image(VulkanContext& vkContext, fastgltf::Asset& asset, fastgltf::Image& image);
\ No newline at end of file
+//Decode Image Data from GLTF data
+DecodedImage decode_image(fastgltf::Asset& asset, fastgltf::Image& image);
+
+//Builds the full Mip Chain of an 8-bit RGBA (UNORM or SRGB) Image on the CPU from its Level 0
+void build_mip_chain(DecodedImage& image);
+
+//Block Compresses every Image whose format entry is a BC format, spreading bands of block rows across the pool
+void compress_images(ThreadPool& threadPool, std::span<DecodedImage> images, std::span<const VkFormat> formats);
+
+//Generates the Mip Levels past uploadedLevels of each loaded Image on the GPU and leaves them Shader Read Only
+void generate_loaded_mipmaps(VulkanContext& vkContext, std::span<AllocatedImage> images, std::span<const uint32_t> uploadedLevels);
+
+//Reads the whole Mip Chain of each of the listed Images back from the GPU, tightly packed. The Images need Transfer Src usage and are left Shader Read Only
+std::vector<std::vector<unsigned char>> read_mip_chains(VulkanContext& vkContext, std::span<AllocatedImage> images, std::span<const size_t> indices);
+
+//Copy Regions of a tightly packed Mip Chain, with buffer offsets relative to the start of Level 0
+std::vector<VkBufferImageCopy> mip_copy_regions(VkFormat format, VkExtent3D extent, uint32_t levelCount);
+
+Baked::Primitive bake_primitive(BakedSceneWriter& bake, const Mesh::Primitive& primitive, int32_t material_index);
+
+Baked::Material bake_material(BakedSceneWriter& bake, const Material& material, const std::vector<std::shared_ptr<Texture>>& textures);
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <cstddef>
+
+//Read only view of a whole file mapped into memory. Pages are only read from disk when touched, so data can be handed straight to staging without an intermediate copy
+class MappedFile {
+public:
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	static std::shared_ptr<MappedFile> open(const std::filesystem::path& filePath); //Returns nullptr if the file does not exist or can't be mapped
+
+	const std::byte* data() const { return _data; }
+	size_t size() const { return _size; }
+
+private:
+	MappedFile() = default;
+
+	const std::byte* _data = nullptr;
+	size_t _size = 0;
+#ifdef _WIN32
+	void* _fileHandle = nullptr;
+	void* _mappingHandle = nullptr;
+#else
+	int _fileDescriptor = -1;
+#endif
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "glm.hpp"
+#include "vulkan/vulkan.h"
+
+#include "shader_types.h"
+
+#include <vector>
+#include <span>
+#include <cstdint>
+
+//Splits triangle lists into Meshlets for the Mesh Shader path. Limits match the Mesh Shader's output limits
+namespace meshlet {
+
+	constexpr uint32_t MAX_VERTICES = 64;
+	constexpr uint32_t MAX_TRIANGLES = 124;
+
+	//Appends the Meshlets of the indexed triangle list and their vertex indices and triangles to data. Triangles are taken in index order, so indices already ordered for locality give tighter Meshlets.
+	//vertex_offset is left at 0, for the caller to set once the vertices are placed
+	void build(std::span<const uint32_t> indices, std::span<const glm::vec3> positions, std::vector<MeshShader::Meshlet>& meshlets, std::vector<uint32_t>& data);
+}
@@ -25,6 +25,8 @@ public:
     VkPipeline build_pipeline(VkDevice device);
 
     void set_shaders(VkShaderModule vertexShader, VkShaderModule fragmentShader);
+    void set_vertex_shader(VkShaderModule vertexShader); //For depth only pipelines, which have no Fragment Shader or Color Attachment
+    void set_mesh_shaders(VkShaderModule taskShader, VkShaderModule meshShader, VkShaderModule fragmentShader); //Vertex Input and Input Assembly are ignored by Mesh Pipelines
     void set_vertex_input(std::vector<VkVertexInputBindingDescription>& bindingDescriptions, std::vector<VkVertexInputAttributeDescription>& attributeDescriptions);
     void set_input_topology(VkPrimitiveTopology topology);
     void set_polygon_mode(VkPolygonMode mode);
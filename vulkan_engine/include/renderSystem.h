@@ -19,19 +19,56 @@
 #include "checkVkResult.h"
 #include "shader_types.h"
 #include "pipeline.h"
+#include "bindlessRegistry.h"
+#include "sceneGeometry.h"
 #include <unordered_map>
-#include <array>
+#include <unordered_set>
+#include <span>
 
 constexpr unsigned int FRAMES_TOTAL = 2;
 
 //-Descriptor Settings
-constexpr uint32_t MAX_SAMPLED_IMAGE_COUNT = 100;
-constexpr uint32_t MAX_SAMPLER_COUNT = 100;
+constexpr uint32_t MAX_HIZ_LEVEL_COUNT = 16; //Enough for a 32768 pixel wide swapchain
+
+//-Clustered Lighting. Must match the constants in default.frag and assignLights.comp
+constexpr uint32_t CLUSTER_GRID_X = 16; //Screen tiles across
+constexpr uint32_t CLUSTER_GRID_Y = 9; //Screen tiles down
+constexpr uint32_t CLUSTER_GRID_Z = 24; //Depth slices, spaced exponentially between the near and far planes
+constexpr uint32_t CLUSTER_COUNT = CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 256; //Further lights touching a cluster are dropped from it
+constexpr float POINTLIGHT_CUTOFF_RADIANCE = 0.01f; //Point Lights are faded out to reach no further than where their radiance falls to this
+
+//Geometry is drawn in two phases per frame for occlusion culling
+enum class CullPhase : uint32_t {
+	Early = 0, //Draws the instances that were visible last frame
+	Late = 1 //Draws the instances that pass the occlusion test against the Hi-Z built from the early phase's depth, and weren't drawn early
+};
+
+//GPU Timestamps written around each phase's geometry passes: Begin, after the Depth Pre-Pass (or Visibility Pass), and End. Followed by the Begin and End of the Visibility Buffer Resolve
+constexpr uint32_t GEOMETRY_TIMESTAMPS_PER_PHASE = 3;
+constexpr uint32_t RESOLVE_TIMESTAMP_BEGIN = GEOMETRY_TIMESTAMPS_PER_PHASE * 2;
+constexpr uint32_t GEOMETRY_TIMESTAMP_COUNT = RESOLVE_TIMESTAMP_BEGIN + 2;
+
+struct GeometryTimings { //GPU time of both phases' geometry passes in a frame, in milliseconds
+	float depthPrepass = 0.0f; //Depth Pre-Pass, or the Visibility Pass when rendering with the Visibility Buffer
+	float shading = 0.0f; //Shading pass, or the Visibility Buffer Resolve
+};
+
+enum class RenderPath {
+	Forward, //Shades each rasterized fragment
+	VisibilityBuffer, //Rasterizes only the Instance and triangle of each pixel, then shades each pixel once in a compute pass
+	MeshShader //Task Shaders cull each visible instance's Meshlets, and Mesh Shaders emit the surviving ones. Falls back to Forward if the device lacks Mesh Shaders
+};
+
+constexpr uint32_t VISBUFFER_EMPTY = UINT32_MAX; //Visibility Buffer texel not covered by any triangle
+
+//-Texture Streaming Feedback. The shading records, per Bindless Image slot, the finest detail it was sampled at: 1 + log2 of the texels per UV unit the sample wanted, rounded up. Must match shading.glsl
+constexpr uint8_t TEXTURE_FEEDBACK_NONE = 0; //Not sampled that frame
 
 enum class DeviceBufferType {
 	ViewProj,
 	Indirect,
-	PrimID,
+	Instance,
 	PrimInfo,
 	Model,
 	Index,
@@ -44,7 +81,7 @@ enum class DeviceBufferType {
 struct DeviceBufferTypeFlags {
 	bool viewProjMatrix = false;
 	bool indirectDraw = false;
-	bool primID = false;
+	bool instance = false;
 	bool primInfo = false;
 	bool modelMatrix = false;
 	bool index = false;
@@ -56,7 +93,7 @@ struct DeviceBufferTypeFlags {
 	void setAll() {
 		viewProjMatrix = true;
 		indirectDraw = true;
-		primID = true;
+		instance = true;
 		primInfo = true;
 		modelMatrix = true;
 		index = true;
@@ -75,10 +112,35 @@ public:
 	VkDescriptorPool _descriptorPool;
 	VkDescriptorSetLayout _descriptorSetLayout;
 	VkDescriptorSet _descriptorSet;
+	BindlessRegistry _bindless; //Slots of the Sampled Image and Sampler arrays
 
 	//Graphics Pipeline
 	VkPipelineLayout _pipelineLayout;
 	VkPipeline _pipeline;
+	VkPipeline _depthPrepassPipeline; //Position only, writes the depth that the shading pass then tests for equality
+	VkPipeline _prepassShadingPipeline; //Same shaders as _pipeline, but only shades fragments that match the pre-pass's depth, without writing depth
+	VkPipeline _visibilityPipeline; //Writes the Instance and triangle of each pixel to the Visibility Image
+
+	//Visibility Buffer Resolve Compute Pipeline
+	VkPipelineLayout _visBufferResolvePipelineLayout; //Set 0 - Bindless Textures and IBL. Set 1 - Visibility and Shaded Images
+	VkPipeline _visBufferResolvePipeline;
+
+	//Mesh Shader Pipeline
+	VkPipelineLayout _meshPipelineLayout;
+	VkPipeline _meshPipeline = VK_NULL_HANDLE; //Only created if the device supports Mesh Shaders
+
+	//Frustum Culling Compute Pipelines
+	VkPipelineLayout _cullPipelineLayout;
+	VkPipeline _cullInstancesPipeline; //Tests each instance against the camera frustum and lists the visible ones under their Draw Command
+	VkPipeline _compactDrawsPipeline; //Packs the Draw Commands that have visible instances into the culled Indirect Draw Buffer
+
+	//Hi-Z Pyramid Build Compute Pipeline
+	VkPipelineLayout _hiZPipelineLayout;
+	VkPipeline _hiZPipeline;
+
+	//Clustered Lighting Compute Pipeline
+	VkPipelineLayout _clusterPipelineLayout;
+	VkPipeline _assignLightsPipeline; //Lists the Point Lights that reach each cluster of the view frustum
 
 	RenderSystem(VulkanContext& vkContext) : _vkContext(vkContext){}
 
@@ -93,11 +155,24 @@ public:
 
 	void resize_swapchain(VkExtent2D windowExtent);
 	void bind_descriptors(GraphicsDataPayload& payload);
+	void unbind_image(uint32_t payloadIndex); //Frees the payload image's slot once the frames in flight are done with it. Textures using it fall back to the default image
+	uint64_t rebind_image(uint32_t payloadIndex, const AllocatedImage& image); //Points the payload image's Textures at a new image in a new slot. Returns the last frame that may still read the old image
 	void setup_drawContexts(const GraphicsDataPayload& payload);
 	void signal_to_updateDeviceBuffers(DeviceBufferTypeFlags deviceBufferTypes);
 	void updateSignaledDeviceBuffers(const GraphicsDataPayload& payload);
 	void setup_hdrMap2();
 	void setup_skybox();
+
+	//Depth Pre-Pass. Toggleable so its cost and savings can be compared per scene with the Geometry Timings
+	void set_depthPrepass(bool enabled) { _depthPrepass = enabled; }
+	GeometryTimings get_geometryTimings() const { return _geometryTimings; }
+
+	//Render Path. Falls back to Forward when the scene doesn't fit in a Visibility Buffer texel
+	void set_renderPath(RenderPath path) { _renderPath = path; }
+
+	//Texture Streaming Feedback of the last completed frame, per payload image. See TEXTURE_FEEDBACK_NONE
+	std::span<const uint8_t> get_textureFeedback() const { return _textureFeedback; }
+	int get_frameNumber() const { return _frameNumber; } //Frame the next run() draws
 private:
 	struct Swapchain {
 		VkSwapchainKHR vkSwapchain;
@@ -110,15 +185,37 @@ private:
 	struct DrawContext {
 		//Draw Resources
 		
-		uint32_t drawCount; //How many draws total in the commands buffer (for the current scene)
+		uint32_t drawCount; //How many draws total in the commands buffer (for the current scene). One per unique Primitive, with every instance of it drawn by the same command
+		uint32_t instanceCount; //How many instances total in the instances buffer
 		AllocatedBuffer indirectDrawCommandsBuffer; //Global Buffer that holds the draw data for each and every primitive/batched data
+		VkDeviceAddress indirectDrawCommandsBufferAddress;
+		AllocatedBuffer culledIndirectDrawCommandsBuffer; //Written by the Culling Passes every frame. Only the Draw Commands with visible instances, with instanceCount set to how many are visible
+		VkDeviceAddress culledIndirectDrawCommandsBufferAddress;
+		AllocatedBuffer cullCountersBuffer; //Count of the culled Draw Commands (read by the Draw), followed by each Draw Command's visible instance count
+		VkDeviceAddress cullCountersBufferAddress;
+		AllocatedBuffer visibleInstancesBuffer; //Index into the instances buffer of each visible instance, read with gl_InstanceIndex
+		VkDeviceAddress visibleInstancesBufferAddress;
 		AllocatedBuffer vertexPosBuffer; //Global Buffer containing every vertex's position for the draw
 		AllocatedBuffer vertexOtherAttribBuffer; //Global Buffer containing every vertex's other attributes besides position, uvs, vertex_colors.
 		AllocatedBuffer indexBuffer;
+		VkDeviceAddress vertexPosBufferAddress; //Vertex and Index addresses are read by the Visibility Buffer Resolve
+		VkDeviceAddress vertexOtherAttribBufferAddress;
+		VkDeviceAddress indexBufferAddress;
+		uint32_t visBufferTriangleBits; //Enough bits for the triangles of the largest draw
+
+		//Buffer Resources - Mesh Shading
+		AllocatedBuffer meshletsBuffer; //Every Primitive's Meshlets, with vertex and data offsets into the global buffers
+		VkDeviceAddress meshletsBufferAddress;
+		AllocatedBuffer meshletDataBuffer; //Each Meshlet's vertex indices followed by its packed triangles
+		VkDeviceAddress meshletDataBufferAddress;
+		AllocatedBuffer meshletDrawsBuffer; //Meshlet range of each Draw Command
+		VkDeviceAddress meshletDrawsBufferAddress;
+		AllocatedBuffer taskCommandsBuffer; //Written by the Culling Passes alongside the culled Draw Commands. Task Shader dispatch of each
+		VkDeviceAddress taskCommandsBufferAddress;
 
 		//Buffer Resources - Geometry Rendering
-		AllocatedBuffer primitiveIdsBuffer;
-		VkDeviceAddress primitiveIdsBufferAddress;
+		AllocatedBuffer instancesBuffer; //Model Matrix and Primitive of each instance. Instances of a draw are contiguous from its firstInstance
+		VkDeviceAddress instancesBufferAddress;
 		AllocatedBuffer primitiveInfosBuffer;
 		VkDeviceAddress primitiveInfosBufferAddress;
 		AllocatedBuffer viewprojMatrixBuffer;
@@ -131,6 +228,10 @@ private:
 		VkDeviceAddress texturesBufferAddress;
 		AllocatedBuffer lightsBuffer;
 		VkDeviceAddress lightsBufferAddress;
+		uint32_t pointLightCount;
+		AllocatedBuffer clusterLightsBuffer; //Written by the Light Assignment Pass every frame. Light count of each cluster, followed by each cluster's light indices
+		VkDeviceAddress clusterLightsBufferAddress;
+		glm::vec2 viewDepthRange; //Distances to the near and far planes of the projection
 
 		//Buffer Resources - Skybox
 		AllocatedBuffer skybox_viewprojMatrixBuffer; 
@@ -143,13 +244,15 @@ private:
 		std::vector<RenderShader::VertexAttributes> attributes;
 		std::vector<uint32_t> indices;
 		RenderShader::ViewProj viewproj;
-		std::vector<int32_t> primitiveIds;
+		std::vector<RenderShader::Instance> instances;
 		std::vector<glm::mat4> model_matrices;
 		std::vector<RenderShader::PrimitiveInfo> primitiveInfos;
 		std::vector<RenderShader::Material> materials;
 		std::vector<RenderShader::Texture> textures;
-		uint32_t pointLightsCount = 0; //Actual number of data in pointLights (Since std::array doesnt actually track its number of valid elements)
-		std::array<RenderShader::PointLight, MAX_POINTLIGHT_COUNT> pointLights;
+		std::vector<RenderShader::PointLight> pointLights;
+		std::vector<MeshShader::Meshlet> meshlets;
+		std::vector<uint32_t> meshlet_data;
+		std::vector<MeshShader::MeshletDraw> meshlet_draws;
 
 		//Copy Infos, dictates how the extracted data should be copied into the buffers
 		VkBufferCopy indirect_copy_info;
@@ -157,8 +260,11 @@ private:
 		VkBufferCopy attrib_copy_info;
 		VkBufferCopy index_copy_info;
 		VkBufferCopy viewprojMatrix_copy_info;
-		VkBufferCopy primId_copy_info;
+		VkBufferCopy instance_copy_info;
 		VkBufferCopy light_copy_info;
+		VkBufferCopy meshlet_copy_info;
+		VkBufferCopy meshletData_copy_info;
+		VkBufferCopy meshletDraw_copy_info;
 		//-Use multiple copy infos in order to place each data using ID-offsets
 		std::vector<VkBufferCopy> modelMatrices_copy_infos; 
 		std::vector<VkBufferCopy> primInfo_copy_infos;
@@ -166,6 +272,31 @@ private:
 		std::vector<VkBufferCopy> texture_copy_infos;
 	};
 
+	//IDs of host objects that changed (according to their Change Journals) but whose data has not been uploaded to a frame's buffers yet
+	struct PendingChanges {
+		std::unordered_set<uint32_t> node_ids;
+		std::unordered_set<uint32_t> primitive_ids;
+		std::unordered_set<uint32_t> material_ids;
+		std::unordered_set<uint32_t> texture_ids;
+
+		bool empty() const {
+			return node_ids.empty() && primitive_ids.empty() && material_ids.empty() && texture_ids.empty();
+		}
+
+		void clear() {
+			node_ids.clear();
+			primitive_ids.clear();
+			material_ids.clear();
+			texture_ids.clear();
+		}
+	};
+
+	//Location of a Primitive in the current scene. Primitives are stored by value in their Mesh, so they are found through the Node that holds the Mesh
+	struct PrimitiveLocation {
+		std::weak_ptr<Node> node;
+		size_t primitive_index;
+	};
+
 	struct Frame {
 		VkCommandPool commandPool; //Might move ownership of commandbools and buffers and related resources to vkcontext
 		VkCommandBuffer commandBuffer;
@@ -173,7 +304,15 @@ private:
 		VkSemaphore swapchainSemaphore, renderSemaphore;
 		VkFence renderFence;
 
+		VkQueryPool timestampQueryPool; //Geometry Timestamps
+		bool timestampsWritten = false; //Whether the query pool holds results of a submitted frame
+
+		AllocatedBuffer textureFeedbackReadback; //Host copy of the Texture Feedback Buffer at the end of the frame
+		bool textureFeedbackWritten = false; //Whether the readback holds the feedback of a submitted frame
+		size_t textureFeedbackSlots = 0; //Image slots copied into the readback
+
 		DrawContext drawContext;
+		PendingChanges pendingChanges; //Changes that still need to be uploaded to this frame's Draw Context
 	};
 
 	//Vulkan Context
@@ -186,6 +325,35 @@ private:
 	//Frames
 	Frame _frames[FRAMES_TOTAL];
 	int _frameNumber = 0;
+
+	//Bindless Slots. Payload image and sampler indices to their slots in the descriptor arrays
+	std::vector<uint32_t> _imageSlots;
+	std::vector<uint32_t> _samplerSlots;
+	std::vector<uint32_t> _slotImages; //Payload image each image slot was last given to, to map the Texture Streaming Feedback back onto payload images
+
+	//Texture Streaming Feedback
+	AllocatedBuffer _textureFeedbackBuffer; //Set 0 Binding 5. One uint per image slot, cleared at the start of each frame. Shared by the frames, as each frame's feedback is copied out before the next frame clears it
+	std::vector<uint8_t> _textureFeedback; //Per payload image, folded from the slots of the last completed frame
+
+	//GPU Timing
+	bool _timestampsSupported = false;
+	float _timestampPeriod = 1.0f; //Nanoseconds per timestamp tick
+	GeometryTimings _geometryTimings;
+
+	//Depth Pre-Pass
+	bool _depthPrepass = true;
+
+	//Visibility Buffer
+	RenderPath _renderPath = RenderPath::Forward;
+	AllocatedImage _visibilityImage; //Instance and triangle of each pixel, packed as (instance << triangleBits) | triangle
+	AllocatedImage _visBufferShadedImage; //Written by the Resolve, then copied to the Swapchain Image, whose format may not support storage
+	VkDescriptorPool _visBufferDescriptorPool;
+	VkDescriptorSetLayout _visBufferDescriptorSetLayout; //Binding 0 - Visibility Image. Binding 1 - Shaded Image
+	VkDescriptorSet _visBufferDescriptorSet;
+
+	//Mesh Shading
+	VkPipelineStageFlags2 _geometryShaderStages = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT; //Stages that read the culled draws and visible instances. Includes the Task and Mesh stages if supported
+
 	Frame& get_current_frame() { return _frames[_frameNumber % FRAMES_TOTAL]; }
 	void go_next_frame() { _frameNumber++;  }
 
@@ -196,13 +364,32 @@ private:
 	//DEBUG - Device Data Updates
 	std::unordered_map<DeviceBufferType, int> _deviceBufferTypesCounter; //Used for keeping track of how many buffers need to updated for each type (across the frames). Plan to change since using string as key is pretty bad
 	RenderShaderData _stagingUpdateData; //Use to stage render data for updates
+	RenderShaderData _changedUpdateData; //Use to stage render data of only the changed objects
+
+	//Lookups from an object's ID to the object. Rebuilt whenever the respective data is fully extracted, and used to resolve the IDs recorded in Change Journals
+	std::unordered_map<uint32_t, std::weak_ptr<Node>> _nodeLookup;
+	std::unordered_map<uint32_t, PrimitiveLocation> _primitiveLookup;
+	std::unordered_map<uint32_t, std::weak_ptr<Material>> _materialLookup;
+	std::unordered_map<uint32_t, std::weak_ptr<Texture>> _textureLookup;
 
-	//DEBUG - Primitive Vertex Input Data Tracker. Might delete
-	std::unordered_map<uint32_t, VkDrawIndexedIndirectCommand> _primID_to_drawCmd;	//Stores and Maps a Primitive's ID to a DrawCommand, which contains the info pertaining to offset and sizes of its indices and vertex info in the GPU buffers. Aka allows us to keep track of vertex and index info using IDs
+	//Geometry Registry. Maps a Primitive's ID to where its vertices and indices are in the geometry buffers. Each Primitive's geometry is only extracted once, and every Node that shares its Mesh draws from the same range
+	std::unordered_map<uint32_t, scenegeometry::GeometryRange> _geometryRegistry;
 
 	//Depth Image
 	AllocatedImage _depthImage;
 
+	//Hi-Z Occlusion Culling
+	AllocatedImage _hiZImage; //Mip pyramid of the farthest depth (min with reverse-Z) in each texel's footprint. First level is the depth image's size rounded down to powers of 2
+	std::vector<VkImageView> _hiZLevelViews; //One per level, for writing it in the build pass
+	VkSampler _hiZSampler; //Min reduction sampler, so one linear sample gives the farthest depth of a 2x2 footprint
+	VkDescriptorPool _hiZDescriptorPool;
+	VkDescriptorSetLayout _hiZDescriptorSetLayout; //Binding 0 - Sampled source. Binding 1 - Storage target
+	std::vector<VkDescriptorSet> _hiZLevelDescriptorSets; //Build pass of each level. Reads the previous level, or the depth image for the first level
+	VkDescriptorSet _hiZCullDescriptorSet; //Whole pyramid for the late pass's occlusion test
+	AllocatedBuffer _instanceVisibilityBuffer; //Shared by the frames, as each frame's early pass draws what the previous frame found visible
+	VkDeviceAddress _instanceVisibilityBufferAddress;
+	bool _resetInstanceVisibility = true; //Set when the instances change, so stale visibility is replaced by drawing everything early for a frame
+
 	//DEBUG - HDR Cubemap
 	AllocatedImage _hdrCubeMap;
 	AllocatedImage _hdrIrradianceCubeMap;
@@ -221,11 +408,30 @@ private:
 	void init_frames();
 	void init_vertexInput();
 	void init_descriptorSet();
+	void init_textureFeedback();
 	void init_graphicsPipeline();
+	void init_cullPipelines();
+	void init_hiZPipeline();
+	void init_clusterPipeline();
+	void init_visBufferPipelines();
+	void init_meshPipeline();
 	
 	//Draw
 	VkResult draw(); //Maybe move draw commands to rendersystem object.
-	void draw_geometry(VkCommandBuffer cmd, const Image& swapchainImage);
+	void cull_geometry(VkCommandBuffer cmd, CullPhase phase);
+	void build_hiZ(VkCommandBuffer cmd);
+	void assign_lights(VkCommandBuffer cmd);
+	void draw_geometry(VkCommandBuffer cmd, const Image& swapchainImage, CullPhase phase);
+	void draw_visibility(VkCommandBuffer cmd, CullPhase phase);
+	void resolve_visibility(VkCommandBuffer cmd, Image& swapchainImage);
+	bool use_visibilityBuffer();
+	void draw_meshlets(VkCommandBuffer cmd, const Image& swapchainImage, CullPhase phase);
+	bool use_meshShaders();
+	void write_timestamp(VkCommandBuffer cmd, uint32_t query);
+	void read_geometryTimestamps();
+	void clear_textureFeedback(VkCommandBuffer cmd);
+	void copy_textureFeedback(VkCommandBuffer cmd);
+	void read_textureFeedback();
 	void draw_skybox(VkCommandBuffer cmd, const Image& swapchainImage);
 	void draw_gui(VkCommandBuffer cmd, const Image& swapchainImage);
 	
@@ -233,14 +439,37 @@ private:
 	std::vector<VkBuffer> get_vertexBuffers();
 	VkBuffer get_indexBuffer();
 	RenderShader::PushConstants get_pushConstants();
-	VkBuffer get_indirectDrawBuffer();
+	CullShader::PushConstants get_cullPushConstants(CullPhase phase);
+	ClusterShader::PushConstants get_clusterPushConstants();
+	VisBufferShader::PushConstants get_visBufferPushConstants();
+	MeshShader::PushConstants get_meshPushConstants();
+	uint32_t get_visBufferTriangleBits(const std::vector<VkDrawIndexedIndirectCommand>& commands);
+	glm::vec2 get_viewDepthRange(const glm::mat4& proj);
+	VkBuffer get_culledIndirectDrawBuffer();
+	VkBuffer get_drawCountBuffer();
 	uint32_t get_drawCount();
 
 	//Depth Image
 	void setup_depthImage();
 
+	//Hi-Z
+	void setup_hiZImage();
+	void destroy_hiZImage();
+
+	//Visibility Buffer
+	void setup_visBufferImages();
+	void destroy_visBufferImages();
+
 	void destroy_swapchain();
 
+	//Bindless Slots
+	uint32_t add_imageSlot(uint32_t payloadIndex, const AllocatedImage& image);
+	uint64_t retire_imageSlot(uint32_t payloadIndex); //Returns the last frame that may still read through the slot
+
 	//Graphics Payload
 	void extract_render_data(const GraphicsDataPayload& payload, DeviceBufferTypeFlags dataType, RenderShaderData& data); //Extracts The specified type of data from payload and output to RenderShaderData param
+	void collect_changes(); //Consumes the host objects' Change Journals and queues the changes for every frame
+	void extract_changed_render_data(const PendingChanges& changes, RenderShaderData& data); //Extracts only the data of changed objects, with copy infos targeting each object's location in the buffers
+	RenderShader::PrimitiveInfo extract_primitiveInfo(const Mesh::Primitive& primitive);
+	RenderShader::Material extract_material(const Material& material);
 };
\ No newline at end of file
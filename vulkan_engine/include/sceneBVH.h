@@ -0,0 +1,121 @@
+#pragma once
+
+#include "glm.hpp"
+
+#include "graphic_data_types.h"
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <cfloat>
+#include <cstdint>
+
+//Axis-Aligned Bounding Box. Starts empty (min > max) so expanding it by anything gives that thing's bounds
+struct AABB {
+	glm::vec3 min{ FLT_MAX };
+	glm::vec3 max{ -FLT_MAX };
+
+	bool empty() const {
+		return min.x > max.x || min.y > max.y || min.z > max.z;
+	}
+
+	glm::vec3 center() const {
+		return (min + max) * 0.5f;
+	}
+
+	glm::vec3 extents() const {
+		return (max - min) * 0.5f;
+	}
+
+	void expand(const glm::vec3& point) {
+		min = glm::min(min, point);
+		max = glm::max(max, point);
+	}
+
+	void expand(const AABB& other) {
+		min = glm::min(min, other.min);
+		max = glm::max(max, other.max);
+	}
+
+	bool overlaps(const AABB& other) const {
+		return min.x <= other.max.x && max.x >= other.min.x && min.y <= other.max.y && max.y >= other.min.y && min.z <= other.max.z && max.z >= other.min.z;
+	}
+
+	//Box that encloses this box transformed by the matrix
+	AABB transformed(const glm::mat4& transform) const;
+};
+
+//Planes of a View Projection Matrix. Follows the Reverse-Z [0, 1] depth range the Render System uses
+struct Frustum {
+	enum class Result { Outside, Intersecting, Inside };
+
+	glm::vec4 planes[6]; //xyz = normal pointing inwards, w = distance
+
+	static Frustum from_viewproj(const glm::mat4& viewproj);
+
+	Result classify(const AABB& box) const;
+};
+
+struct Ray {
+	glm::vec3 origin;
+	glm::vec3 direction;
+};
+
+/*
+	Bounding Volume Hierarchy over the World Space bounds of a Scene's Nodes that have a Mesh. Built as a Linear BVH by sorting the Nodes along a Morton curve, so building
+	is O(n log n) and fast enough to redo whenever the Scene changes. Moved Nodes are refit in place instead, which keeps the queries correct but lets the tree quality degrade
+	if Nodes move far, in which case it should be rebuilt.
+*/
+class SceneBVH {
+public:
+	struct RayHit {
+		std::shared_ptr<Node> node;
+		float distance; //Along the ray to where it enters the Node's bounds
+	};
+
+	void build(const Scene& scene);
+	void clear();
+
+	//Updates the bounds of the given Nodes and their ancestors in the tree. IDs of Nodes that aren't in the BVH are ignored
+	void refit(const std::unordered_set<uint32_t>& changed_node_ids);
+
+	void query_frustum(const Frustum& frustum, std::vector<std::shared_ptr<Node>>& results) const;
+	void query_overlap(const AABB& box, std::vector<std::shared_ptr<Node>>& results) const;
+	bool query_ray(const Ray& ray, RayHit& hit, float max_distance = FLT_MAX) const; //Nearest Node whose bounds the ray hits. Returns false if there are none
+
+	size_t node_count() const { return _items.size(); }
+	const AABB& bounds() const;
+
+	//Bounds of the Node's Mesh in its local space. Empty if it has no Mesh
+	static AABB local_bounds(const Node& node);
+
+private:
+	static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+	static constexpr uint32_t MAX_LEAF_ITEMS = 4;
+
+	struct Item {
+		std::shared_ptr<Node> node;
+		AABB local_bounds;
+		AABB bounds; //World Space
+		uint32_t morton_code;
+	};
+
+	//Children of an internal node are next to each other, so only the first is stored. Leaves list items_count Items starting from first
+	struct TreeNode {
+		AABB bounds;
+		uint32_t parent = INVALID_INDEX;
+		uint32_t first = 0; //First Child if internal, else first Item
+		uint32_t item_count = 0; //0 if internal
+	};
+
+	std::vector<Item> _items; //Sorted by Morton Code
+	std::vector<TreeNode> _tree; //Parents come before their children
+	std::vector<uint32_t> _itemLeaves; //Leaf of each Item
+	std::unordered_map<uint32_t, uint32_t> _itemLookup; //Node ID -> Item index
+
+	void build_subtree(uint32_t tree_index, uint32_t first, uint32_t last);
+	uint32_t find_split(uint32_t first, uint32_t last) const;
+	void update_leaf_bounds(TreeNode& leaf);
+	void update_internal_bounds(TreeNode& internal);
+};
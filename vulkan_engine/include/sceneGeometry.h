@@ -0,0 +1,47 @@
+#pragma once
+
+#include "graphic_data_types.h"
+
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <memory>
+#include <cstdint>
+
+//Gathers a Scene's Primitive geometry into the layout of the Render System's vertex, index and meshlet buffers. Needs no device, so the Render System and the benchmarks share it
+namespace scenegeometry {
+
+	//Location of a Primitive's geometry in the vertex and index buffers
+	struct GeometryRange {
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		int32_t vertexOffset;
+		uint32_t batchIndex; //Instance Batch (and so Indirect Draw Command) that draws every instance of the Primitive
+		uint32_t firstMeshlet;
+		uint32_t meshletCount;
+	};
+
+	//Nodes drawing a registered Primitive
+	struct InstanceBatch {
+		uint32_t primitive_id;
+		std::vector<uint32_t> model_matrix_ids;
+	};
+
+	//Buffers the geometry is appended to. Null ones aren't gathered. meshlets and meshlet_data are set together
+	struct GeometryOutputs {
+		std::vector<glm::vec3>* positions = nullptr;
+		std::vector<RenderShader::VertexAttributes>* attributes = nullptr;
+		std::vector<uint32_t>* indices = nullptr;
+		std::vector<MeshShader::Meshlet>* meshlets = nullptr;
+		std::vector<uint32_t>* meshlet_data = nullptr;
+	};
+
+	using NodeVisitor = std::function<void(const std::shared_ptr<Node>& node)>;
+	using PrimitiveVisitor = std::function<void(const std::shared_ptr<Node>& node, size_t primitive_index)>;
+
+	//Walks the Scene's Nodes depth first and registers each Primitive the first time it's reached, appending its geometry to the outputs. Every Node drawing the Primitive is added to its Instance Batch.
+	//The registry and batches are rebuilt, kept in registration order so the ranges and draw order stay the same for an unchanged Scene.
+	//visit_node is called for every Node, and visit_primitive for each Primitive as it's registered
+	void gather(const Scene& scene, const GeometryOutputs& outputs, std::unordered_map<uint32_t, GeometryRange>& registry, std::vector<InstanceBatch>& batches,
+		const NodeVisitor& visit_node = nullptr, const PrimitiveVisitor& visit_primitive = nullptr);
+}
@@ -5,8 +5,6 @@
 #pragma once
 #include <stdint.h>
 
-constexpr uint32_t MAX_POINTLIGHT_COUNT = 100;
-
 namespace SkyboxShader {
 	struct ViewTransformMatrices {
 		glm::mat4 view;
@@ -22,9 +20,17 @@ namespace RenderShader { //Default Shader
 		glm::vec2 uv;
 	};
 
+	//One per instance of a Primitive. Lets Nodes that share a Mesh draw the same Primitive geometry with their own Model Matrix
+	struct Instance {
+		uint32_t primitive_id;
+		uint32_t model_matrix_id;
+		uint32_t draw_id; //Indirect Draw Command that draws the instance
+	};
+
 	struct PrimitiveInfo {
 		uint32_t mat_id;
-		uint32_t model_matrix_id;
+		glm::vec3 bounds_min; //Local space AABB
+		glm::vec3 bounds_max;
 	};
 
 	struct Material {
@@ -65,21 +71,22 @@ namespace RenderShader { //Default Shader
 		glm::vec3 pos;
 		glm::vec3 color;
 		float power;
-	};
-
-	struct Lights {
-		uint32_t pointLightCount;
-		PointLight pointLights[MAX_POINTLIGHT_COUNT];
+		float range; //Distance where the radiance falls to the cutoff. Lights are only assigned to the clusters within it
 	};
 
 	struct PushConstants {
-		VkDeviceAddress primitiveIdsBufferAddress;
+		VkDeviceAddress instancesBufferAddress;
+		VkDeviceAddress visibleInstancesBufferAddress;
 		VkDeviceAddress primitiveInfosBufferAddress;
 		VkDeviceAddress viewProjMatrixBufferAddress;
 		VkDeviceAddress modelMatricesBufferAddress;
 		VkDeviceAddress materialsBufferAddress;
 		VkDeviceAddress texturesBufferAddress;
 		VkDeviceAddress lightsBufferAddress;
+		VkDeviceAddress clusterLightsBufferAddress;
+		glm::vec2 screenSize;
+		glm::vec2 viewDepthRange; //Distances to the near and far planes, which the depth slices of the clusters span
+		uint32_t visBufferTriangleBits; //Low bits of a Visibility Buffer texel that hold the triangle. The Instance is in the rest
 	};
 }
 
@@ -90,4 +97,117 @@ namespace SpecularCubemapShader {
 		uint32_t height;
 		uint32_t mipLevel;
 	};
+}
+
+namespace CullShader { //Frustum Culling Compute Passes
+	struct PushConstants {
+		VkDeviceAddress instancesBufferAddress;
+		VkDeviceAddress primitiveInfosBufferAddress;
+		VkDeviceAddress modelMatricesBufferAddress;
+		VkDeviceAddress viewProjMatrixBufferAddress;
+		VkDeviceAddress drawCommandsBufferAddress; //Every Indirect Draw Command
+		VkDeviceAddress culledDrawCommandsBufferAddress; //Draw Commands with visible instances, compacted
+		VkDeviceAddress cullCountersBufferAddress; //Compacted Draw Count, followed by the visible instance count of each Draw Command
+		VkDeviceAddress visibleInstancesBufferAddress; //Indices of visible Instances. A Draw Command's visible instances start from its firstInstance
+		VkDeviceAddress instanceVisibilityBufferAddress; //Whether each Instance was visible in the last frame. Written by the late pass
+		uint32_t instanceCount;
+		uint32_t drawCount;
+		glm::vec2 hiZSize; //Extent of the Hi-Z pyramid's first level
+		uint32_t phase; //0 - Early: instances visible last frame. 1 - Late: occlusion tested instances that weren't drawn early
+		VkDeviceAddress meshletDrawsBufferAddress; //Meshlets of each Draw Command, for the Task Commands
+		VkDeviceAddress taskCommandsBufferAddress; //Task Command of each compacted Draw Command, for the Mesh Shader path
+	};
+}
+
+namespace HiZShader { //Hi-Z Pyramid Build Compute Pass
+	struct PushConstants {
+		glm::vec2 levelSize;
+	};
+}
+
+namespace MipmapShader { //Compute Mip Generation, for formats without Linear Blit support
+	struct PushConstants {
+		glm::uvec2 sourceSize;
+		glm::uvec2 levelSize;
+	};
+}
+
+namespace VisBufferShader { //Visibility Buffer Resolve Compute Pass
+	struct PushConstants {
+		VkDeviceAddress instancesBufferAddress;
+		VkDeviceAddress primitiveInfosBufferAddress;
+		VkDeviceAddress viewProjMatrixBufferAddress;
+		VkDeviceAddress modelMatricesBufferAddress;
+		VkDeviceAddress materialsBufferAddress;
+		VkDeviceAddress texturesBufferAddress;
+		VkDeviceAddress lightsBufferAddress;
+		VkDeviceAddress clusterLightsBufferAddress;
+		VkDeviceAddress drawCommandsBufferAddress; //Every Indirect Draw Command, for the firstIndex and vertexOffset of an Instance's Primitive
+		VkDeviceAddress indexBufferAddress;
+		VkDeviceAddress vertexPosBufferAddress;
+		VkDeviceAddress vertexAttribBufferAddress;
+		glm::vec2 screenSize;
+		glm::vec2 viewDepthRange;
+		uint32_t triangleBits;
+	};
+}
+
+namespace MeshShader { //Task and Mesh Shader Path
+	//Cluster of a Primitive's triangles, culled as a whole by the Task Shader
+	struct Meshlet {
+		glm::vec3 center; //Bounding Sphere in the Primitive's local space
+		float radius;
+		glm::vec3 cone_axis; //Normal Cone. Every triangle faces away from a viewer at v when dot(center - v, cone_axis) >= cone_cutoff * length(center - v) + radius
+		float cone_cutoff; //1 when the triangles face too many directions to ever be culled together
+		uint32_t data_offset; //First of the Meshlet's vertex indices in the Meshlet Data. Its triangles follow them, each packed as three 8 bit indices into the vertex indices
+		uint32_t vertex_offset; //Added to the vertex indices, like an Indirect Draw Command's vertexOffset
+		uint32_t vertex_count;
+		uint32_t triangle_count;
+	};
+
+	struct MeshletDraw { //Meshlets of each Indirect Draw Command's Primitive
+		uint32_t firstMeshlet;
+		uint32_t meshletCount;
+	};
+
+	//Written by the Draw Compaction for each culled Draw Command. Starts with a VkDrawMeshTasksIndirectCommandEXT: a Task Workgroup per MESHLETS_PER_TASK Meshlets, for each visible instance
+	struct TaskCommand {
+		uint32_t groupCountX;
+		uint32_t groupCountY;
+		uint32_t groupCountZ;
+		uint32_t firstInstance; //Visible instances of the Draw Command start here in the Visible Instances Buffer
+		uint32_t firstMeshlet;
+		uint32_t meshletCount;
+	};
+
+	//Begins with the same buffers as RenderShader::PushConstants, so the Mesh Pipeline shares the Forward Fragment Shader
+	struct PushConstants {
+		VkDeviceAddress instancesBufferAddress;
+		VkDeviceAddress visibleInstancesBufferAddress;
+		VkDeviceAddress primitiveInfosBufferAddress;
+		VkDeviceAddress viewProjMatrixBufferAddress;
+		VkDeviceAddress modelMatricesBufferAddress;
+		VkDeviceAddress materialsBufferAddress;
+		VkDeviceAddress texturesBufferAddress;
+		VkDeviceAddress lightsBufferAddress;
+		VkDeviceAddress clusterLightsBufferAddress;
+		glm::vec2 screenSize;
+		glm::vec2 viewDepthRange;
+		VkDeviceAddress taskCommandsBufferAddress;
+		VkDeviceAddress meshletsBufferAddress;
+		VkDeviceAddress meshletDataBufferAddress;
+		VkDeviceAddress vertexPosBufferAddress;
+		VkDeviceAddress vertexAttribBufferAddress;
+	};
+}
+
+namespace ClusterShader { //Light Assignment Compute Pass
+	struct PushConstants {
+		VkDeviceAddress viewProjMatrixBufferAddress;
+		VkDeviceAddress lightsBufferAddress;
+		VkDeviceAddress clusterLightsBufferAddress; //Light count of each cluster, followed by the light indices of each cluster
+		glm::vec2 screenSize;
+		glm::vec2 viewDepthRange;
+		uint32_t pointLightCount;
+	};
 }
\ No newline at end of file
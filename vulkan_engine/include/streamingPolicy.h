@@ -0,0 +1,37 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <vector>
+#include <span>
+#include <cstdint>
+
+//Decides the VRAM budget of the Texture Streamer and which Mip Levels each streamed Image holds. Only bookkeeping, the Texture Streamer does the uploads the decisions call for
+namespace streamingpolicy {
+
+	constexpr uint64_t UPLOAD_BYTES_PER_FRAME = 32ull << 20; //Levels staged per frame. At least one Image is always streamed in, however large
+	constexpr float BUDGET_HEADROOM = 0.1f; //Fraction of the device local budget the automatic budget leaves free for everything else's growth
+
+	struct ImageState {
+		uint32_t image_index; //Into GraphicsDataPayload::images
+		VkExtent3D extent; //Of level 0
+		VkFormat format;
+		uint32_t levelCount; //Full Mip Chain
+		uint32_t residentLevel; //Finest level of the Image's current image
+		uint32_t tailLevel; //Finest level no larger than the tail size, which is never evicted
+		uint32_t wantedLevel; //Finest level the feedback asked for recently
+		int wantedFrame; //Last frame the feedback asked for wantedLevel or finer
+		int lastSampledFrame;
+	};
+
+	//Tightly packed size of levels [level, levelCount)
+	uint64_t resident_bytes(const ImageState& image, uint32_t level);
+
+	//Bytes the streamed Images may hold. Without a set budget (budgetMB of 0) they can keep what they hold and take what the device local heaps have free, short of the headroom
+	uint64_t plan_budget(uint64_t deviceBudget, uint64_t deviceUsage, uint64_t residentBytes, uint32_t budgetMB);
+
+	//Moves each Image's residentLevel to what it should hold after this frame and keeps residentBytes, their total resident_bytes, up to date.
+	//Trims unwanted levels, evicts the least recently sampled Images while over budget and streams in one level at a time within the budget and UPLOAD_BYTES_PER_FRAME.
+	//Returns the Images whose residentLevel changed, each once
+	std::vector<size_t> plan_residency(std::span<ImageState> images, uint64_t& residentBytes, uint64_t budgetBytes);
+}
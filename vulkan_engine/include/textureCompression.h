@@ -0,0 +1,40 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <cstdint>
+#include <cstddef>
+
+//CPU Block Compression of RGBA8 Images into BC formats, and the sizes of Images in the formats Textures can be uploaded in
+namespace texcompress {
+
+	constexpr uint32_t BLOCK_DIM = 4; //BC blocks cover 4x4 texels
+
+	//Material slots an Image is sampled by, which decide what its channels hold
+	enum ImageRoleBits : uint32_t {
+		IMAGE_ROLE_COLOR = 1 << 0, //Base Color or Emission
+		IMAGE_ROLE_NORMAL = 1 << 1, //Tangent space XY, Z is reconstructed by the shader
+		IMAGE_ROLE_OCCLUSION = 1 << 2, //R only
+		IMAGE_ROLE_METAL_ROUGH = 1 << 3 //G and B
+	};
+
+	//Whether Textures can be uploaded in the format: RGBA8 or one of the BC formats, UNORM or SRGB
+	bool is_supported(VkFormat format);
+	bool is_block_compressed(VkFormat format);
+
+	//The SRGB variant of a color format, or the format itself if it has none (BC4 and BC5 only hold data)
+	VkFormat srgb_format(VkFormat format);
+
+	//Bytes of one level, tightly packed, and of levelCount levels one after another starting from level 0
+	uint64_t level_size(VkFormat format, uint32_t width, uint32_t height);
+	uint64_t chain_size(VkFormat format, uint32_t width, uint32_t height, uint32_t levelCount);
+
+	//BC5 for normal maps, BC4 for occlusion only, otherwise BC1 or BC3 if alpha is used. Images used by Normal and other slots stay RGBA8, as BC5 would drop their B channel.
+	//Images sampled as color get the SRGB variant, so the hardware decodes them to linear before filtering
+	VkFormat choose_format(uint32_t roles, bool hasAlpha);
+
+	bool has_alpha(const unsigned char* rgba, size_t texelCount);
+
+	//Encodes block rows [firstRow, firstRow + rowCount) of an RGBA8 level as BC1, BC3, BC4 or BC5 (UNORM or SRGB, the blocks are the same) into dst, the start of the level's blocks. Rows can be encoded on separate threads
+	void encode_rows(VkFormat format, const unsigned char* rgba, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t rowCount, unsigned char* dst);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include "vulkanContext.h"
+#include "graphic_data_types.h"
+#include "streamingPolicy.h"
+
+#include <vector>
+#include <span>
+#include <cstdint>
+
+class RenderSystem;
+
+/*
+	Streams the finer Mip Levels of large Images in and out of VRAM. Each streamed Image keeps a resident range [residentLevel, levelCount) as an image of its own, read from the
+	Baked Scene Cache it was loaded from. Changing the range creates a new image, uploads its levels straight from the mapped cache and rebinds the payload Image to it; the old image
+	is destroyed once the frames in flight are done with it.
+	The levels each Image needs come from the Render System's Texture Streaming Feedback. Images left unsampled drop to their tail, the levels no larger than TAIL_SIZE, which always stay resident.
+	When the streamed levels outgrow the VRAM budget the least recently sampled Images lose levels first. The budget and the levels each Image holds are decided by streamingpolicy.
+*/
+class TextureStreamer {
+public:
+	static constexpr uint32_t TAIL_SIZE = 256; //Images wider or taller than this are streamed. Their levels this size and smaller are never evicted
+	static constexpr int UNUSED_FRAMES = 120; //Frames an Image can go unsampled before it drops to its tail
+
+	static bool is_streamed(VkExtent3D extent);
+	static uint32_t tail_level(VkExtent3D extent); //Finest level no larger than TAIL_SIZE
+
+	TextureStreamer(VulkanContext& vkContext) : _vkContext(vkContext) {}
+
+	//Once per frame before the Render System's Device Buffer updates, so rebound Images reach this frame's Texture buffer.
+	//budgetMB caps the streamed Images' VRAM, 0 sizes it from the device local heap budgets alone
+	void update(GraphicsDataPayload& payload, RenderSystem& renderSys, uint32_t budgetMB);
+	void shutdown(); //Destroys the replaced images still waiting on frames. Only once the device is idle
+
+	uint64_t get_residentBytes() const { return _residentBytes; } //Tightly packed size of the streamed Images' resident levels, which the budget is held to
+	uint64_t get_budgetBytes() const { return _budgetBytes; }
+
+private:
+	//A replaced image, destroyed once the last frame that may read it has completed
+	struct RetiredImage {
+		AllocatedImage image;
+		uint64_t lastReadingFrame;
+	};
+
+	VulkanContext& _vkContext;
+
+	std::vector<StreamedImageSource> _sources; //Where each streamed Image's levels are read from
+	std::vector<streamingpolicy::ImageState> _images; //Parallel to _sources
+	std::vector<RetiredImage> _retired;
+	uint64_t _residentBytes = 0;
+	uint64_t _budgetBytes = 0;
+
+	void register_images(const GraphicsDataPayload& payload, int frameNumber);
+	void read_feedback(std::span<const uint8_t> feedback, int frameNumber);
+	uint64_t compute_budget(uint32_t budgetMB, int frameNumber);
+	void make_resident(size_t index, GraphicsDataPayload& payload, RenderSystem& renderSys); //Uploads the levels from the Image's residentLevel
+	void destroy_retired(int frameNumber);
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+//Pool of Worker Threads that each own a Task Queue. Workers take from the back of their own queue and steal from the front of the other workers' queues when theirs is empty
+class ThreadPool {
+public:
+	ThreadPool(uint32_t threadCount = 0); //0 creates a worker for every hardware thread besides the main thread
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void submit(std::function<void()> task);
+	void parallel_for(size_t count, const std::function<void(size_t)>& func); //Runs func(i) for every i in [0, count) across the pool. The calling thread helps run tasks until all of them finish, then rethrows the first exception a task threw
+	uint32_t thread_count() const { return static_cast<uint32_t>(_workers.size()); }
+
+private:
+	struct WorkerQueue {
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	std::vector<std::thread> _workers;
+	std::vector<std::unique_ptr<WorkerQueue>> _queues;
+	std::atomic<uint32_t> _nextQueue = 0; //Round robin queue for tasks submitted from outside the pool
+	std::atomic<size_t> _queuedTasks = 0; //Tasks submitted but not yet taken by any thread
+
+	std::mutex _sleepMutex;
+	std::condition_variable _taskAvailable;
+	bool _stopping = false;
+
+	inline static thread_local int32_t _workerIndex = -1; //Index of the worker the current thread is, -1 if not a worker of any pool
+
+	void worker_loop(uint32_t index);
+	bool try_take(uint32_t startIndex, std::function<void()>& task);
+};
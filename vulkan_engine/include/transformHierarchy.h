@@ -0,0 +1,56 @@
+#pragma once
+
+#include "glm.hpp"
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+struct Scene;
+class ThreadPool;
+
+/*
+	Transforms of a Scene's Nodes stored as flat arrays in depth first order, so a Node's parent always comes before it and its descendants directly follow it.
+	Setting a Local Transform only flags the Node dirty. update() then recomputes the World Transforms (Parent's World * Local) of every dirty subtree in one linear pass,
+	splitting large subtrees into child subtree ranges that run across the Thread Pool.
+*/
+class TransformHierarchy {
+public:
+	static constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+	//Flattens the Scene's Nodes and attaches them, so their Transforms are read from and written to the hierarchy from then on
+	static std::shared_ptr<TransformHierarchy> create(const Scene& scene);
+
+	void set_local(uint32_t index, const glm::mat4& transform) {
+		_locals[index] = transform;
+		_dirty[index] = 1;
+		_hasDirty = true;
+	}
+
+	const glm::mat4& local(uint32_t index) const { return _locals[index]; }
+	const glm::mat4& world(uint32_t index) const { return _worlds[index]; }
+	uint32_t parent(uint32_t index) const { return _parents[index]; }
+	size_t size() const { return _parents.size(); }
+
+	//Recomputes the World Transforms of dirty Nodes and their descendants and records them as changed. Runs on the calling thread alone if pool is null
+	void update(ThreadPool* pool = nullptr);
+
+private:
+	struct Range {
+		uint32_t first;
+		uint32_t end;
+	};
+
+	static constexpr uint32_t MIN_TASK_SIZE = 1024; //Nodes per Thread Pool task. Fewer dirty Nodes than this are updated on the calling thread
+
+	std::vector<uint32_t> _parents;
+	std::vector<uint32_t> _subtreeEnds; //One past the Node's last descendant
+	std::vector<glm::mat4> _locals;
+	std::vector<glm::mat4> _worlds;
+	std::vector<uint8_t> _dirty; //Local Transform changed since the last update
+	std::vector<uint32_t> _nodeIDs;
+	bool _hasDirty = false;
+
+	void split_range(Range range, std::vector<Range>& tasks);
+	void update_range(Range range);
+};
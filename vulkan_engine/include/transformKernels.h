@@ -0,0 +1,25 @@
+#pragma once
+
+#include "glm.hpp"
+
+#include <cstdint>
+#include <cstddef>
+
+//Batched 4x4 Matrix Kernels for composing Transforms. Each has a Scalar, SSE and AVX2 version, and the widest one the CPU supports is picked the first time they're used
+namespace transformkernels {
+
+	enum class ISA { Scalar, SSE, AVX2 };
+
+	ISA active_isa();
+	const char* isa_name(ISA isa);
+
+	//results[i] = parents[i] * locals[i]
+	void multiply(const glm::mat4* parents, const glm::mat4* locals, glm::mat4* results, size_t count);
+
+	//worlds[i] = worlds[parents[i]] * locals[i] for i in [first, end), or locals[i] if parents[i] is no_parent. Parents must come before their children
+	void compose_worlds(const uint32_t* parents, const glm::mat4* locals, glm::mat4* worlds, uint32_t first, uint32_t end, uint32_t no_parent);
+
+	//Versions of a specific ISA. Calling one the CPU doesn't support is undefined
+	void multiply(ISA isa, const glm::mat4* parents, const glm::mat4* locals, glm::mat4* results, size_t count);
+	void compose_worlds(ISA isa, const uint32_t* parents, const glm::mat4* locals, glm::mat4* worlds, uint32_t first, uint32_t end, uint32_t no_parent);
+}
@@ -12,6 +12,12 @@
 #include "vulkan_helper_types.h"
 #include "vulkan_helper_functions.h"
 #include "checkVkResult.h"
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+
+constexpr size_t STAGING_RING_SIZE = 64 * 1024 * 1024; //Size of the persistently mapped Staging Ring. Uploads larger than this use a dedicated Stager
 
 class VulkanContext {
 public:
@@ -23,6 +29,18 @@ public:
 	VkDevice device;
 	uint32_t primaryQueueFamily;
 	VkQueue primaryQueue;
+	uint32_t transferQueueFamily; //Queue used for Staged Uploads. May be the Primary Queue if the device has no other queue to use
+	VkQueue transferQueue;
+
+	//Mesh Shading (VK_EXT_mesh_shader). Only enabled if the device supports Task and Mesh Shaders
+	bool meshShaderSupported = false;
+	PFN_vkCmdDrawMeshTasksIndirectCountEXT cmdDrawMeshTasksIndirectCount = nullptr;
+
+	//Block Compressed Textures (textureCompressionBC). Only enabled if the device supports them
+	bool bcTextureSupported = false;
+
+	//Memory Budget (VK_EXT_memory_budget). Only enabled if the device supports it, otherwise VMA's heap budgets are estimates
+	bool memoryBudgetSupported = false;
 
 	//VMA
 	VmaAllocator allocator;
@@ -32,13 +50,30 @@ public:
 	VkCommandBuffer immCommandBuffer;
 	VkFence immFence;
 
+	//Transfer Commands
+	VkCommandPool transferCommandPool;
+
+	std::mutex queueSubmitMutex; //Guards Queue submissions, since uploads can be submitted from background threads and the Transfer Queue may be the Primary Queue
+
+	//Staged Uploads
+	VkSemaphore uploadTimeline; //Timeline Semaphore signaled by the Transfer Queue submissions of staged uploads. Waited on by consumers and used to reclaim Staging Ring space
+
 	void init(SDL_Window* window);
 	void shutdown();
 
 	//Immediate Command
-	VkCommandBuffer start_immediate_recording();
+	VkCommandBuffer start_immediate_recording(); //Also submits any pending staged uploads first and has the immediate commands wait on them. Other threads' immediate commands wait until this recording is submitted and complete
 	void submit_immediate_commands();
 
+	//Staged Uploads
+	uint64_t submit_staged_uploads(); //Submits all pending staged uploads to the Transfer Queue. Returns the Upload Timeline value consumers must wait on
+	void flush_staged_uploads(); //Submits all pending staged uploads and waits on the host for them to finish
+	void wait_for_uploads(uint64_t timelineValue);
+	bool has_staged_uploads() const {
+		std::lock_guard<std::recursive_mutex> lock(_uploadMutex);
+		return !_pendingBufferCopies.empty() || !_pendingImageCopies.empty();
+	}
+
 	//Buffer
 	AllocatedBuffer create_buffer(const char* name, size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage, VmaAllocationCreateFlags allocFlags);
 	AllocatedBuffer create_buffer(const char* name, VkBufferCreateInfo bufferInfo, VmaAllocationCreateInfo allocInfo); //WHen Buffer Creation requires more specific details
@@ -51,13 +86,98 @@ public:
 	AllocatedImage create_image(const char* name, VkImageCreateInfo imageInfo, VmaAllocationCreateInfo allocInfo, VkImageViewCreateInfo imageViewInfo); //When Image Creation requires more specific details
 	void destroy_image(const AllocatedImage& image);
 	void update_image(AllocatedImage& image, void* srcData, size_t dataSize); //Uploads raw data to an image. !!!Might change param to implement specific settings like vkbufferimagecopy param
+	void update_image(AllocatedImage& image, const void* srcData, size_t dataSize, const std::vector<VkBufferImageCopy>& copyRegions); //Uploads raw data to multiple subresources of an image, such as a whole mip chain. Region buffer offsets are relative to srcData
 	void update_image(AllocatedImage& dstImage, AllocatedImage& srcImage, uint32_t copyCount, const VkImageCopy* copyInfo);
+	AllocatedBuffer read_image(VkCommandBuffer cmd, AllocatedImage& image, size_t dataSize, const std::vector<VkBufferImageCopy>& copyRegions); //Records copying subresources of an image, such as a whole mip chain, into a new host readable buffer. Read it once cmd has completed, then destroy it. The image needs Transfer Src usage
 
 	void transition_image(VkCommandBuffer cmd, Image& image, VkImageLayout targetLayout);
 
-	void generate_mipmaps(VkCommandBuffer cmd, AllocatedImage& image, uint32_t levelCount, uint32_t layerCount);
+	//Mip Generation
+	VkImageUsageFlags mipmap_usage(VkFormat format); //Usage an Image needs so generate_mipmaps can fill its levels. Blit usage where the format supports Linear Blits, otherwise Storage for the Compute fallback
+	void generate_mipmaps(VkCommandBuffer cmd, AllocatedImage& image, uint32_t levelCount, uint32_t layerCount, uint32_t firstLevel = 1); //Fills levels firstLevel to levelCount - 1, each from the level above it
+	void release_mipmap_resources(VkCommandBuffer cmd); //Destroys the Compute fallback's Image Views and Descriptor Sets recorded into cmd. Call once its commands have completed
 
 	//Sampler
 	VkSampler create_sampler(VkSamplerCreateInfo& samplerCreateInfo);
 	void destroy_sampler(const VkSampler& sampler);
+
+private:
+	//A Buffer Copy from Staging Memory waiting to be recorded
+	struct PendingBufferCopy {
+		VkBuffer srcBuffer;
+		VkBuffer dstBuffer;
+		VkBufferCopy copyInfo;
+	};
+
+	//An Image Upload from Staging Memory waiting to be recorded. The Image's layout is already set to its final layout when queued
+	struct PendingImageCopy {
+		VkBuffer srcBuffer;
+		VkImage dstImage;
+		VkImageLayout oldLayout;
+		VkImageLayout finalLayout;
+		std::vector<VkBufferImageCopy> copyInfos;
+	};
+
+	//Portion of the Staging Ring (or a dedicated Stager) in use by a submission until the Upload Timeline reaches timelineValue
+	struct StagingRegion {
+		size_t size;
+		uint64_t timelineValue;
+		AllocatedBuffer dedicatedStager{}; //Only valid for uploads too large for the Staging Ring
+		bool dedicated = false;
+	};
+
+	struct TransferCommand {
+		VkCommandBuffer cmd;
+		uint64_t timelineValue = 0; //Command Buffer can be reused once the Upload Timeline reaches this value
+	};
+
+	struct StagingAllocation {
+		VkBuffer buffer;
+		size_t offset;
+		void* mappedData;
+	};
+
+	mutable std::recursive_mutex _uploadMutex; //Guards the Staging Ring and pending uploads, which can be used by background loading threads
+	std::mutex _immediateMutex; //Held from start_immediate_recording until submit_immediate_commands completes
+
+	//-Staging Ring
+	AllocatedBuffer _stagingRing;
+	size_t _stagingRingHead = 0; //Offset where the next allocation starts
+	size_t _stagingRingUsed = 0; //Bytes either in flight or pending (includes padding wasted when wrapping)
+	size_t _stagingRingPendingSize = 0; //Bytes allocated since the last record_staged_uploads
+	std::vector<AllocatedBuffer> _pendingDedicatedStagers;
+	std::deque<StagingRegion> _inFlightStagingRegions;
+	uint64_t _uploadTimelineValue = 0; //Last value handed out to be signaled
+	uint64_t _immUploadWaitValue = 0; //Upload Timeline value the current Immediate Command submission waits on
+
+	std::vector<TransferCommand> _transferCommands;
+	std::vector<uint32_t> _queueFamilyIndices; //Queue Families that access uploaded resources. Resources are shared concurrently if there is more than one
+
+	std::vector<PendingBufferCopy> _pendingBufferCopies;
+	std::vector<PendingImageCopy> _pendingImageCopies;
+
+	//Level Views and Descriptor Pools (one per Compute generate_mipmaps call) a Command Buffer reads until released
+	struct MipmapResources {
+		std::vector<VkDescriptorPool> descriptorPools;
+		std::vector<VkImageView> levelViews;
+	};
+
+	//-Compute Mip Generation. Created on first use
+	std::mutex _mipmapMutex;
+	VkDescriptorSetLayout _mipmapDescriptorSetLayout = VK_NULL_HANDLE; //Binding 0 - Sampled source level. Binding 1 - Storage target level
+	VkPipelineLayout _mipmapPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline _mipmapPipeline = VK_NULL_HANDLE;
+	std::unordered_map<VkCommandBuffer, MipmapResources> _mipmapResources; //Kept per Command Buffer, so releasing one recording's resources never frees those of another still in use
+
+	void destroy_mipmap_resources(const MipmapResources& resources);
+
+	bool supports_blit_mipmaps(VkFormat format);
+	void init_mipmapPipeline();
+	void generate_mipmaps_blit(VkCommandBuffer cmd, AllocatedImage& image, uint32_t levelCount, uint32_t layerCount, uint32_t firstLevel);
+	void generate_mipmaps_compute(VkCommandBuffer cmd, AllocatedImage& image, uint32_t levelCount, uint32_t layerCount, uint32_t firstLevel);
+
+	void set_upload_sharing(bool transferDst, VkSharingMode& sharingMode, uint32_t& queueFamilyIndexCount, const uint32_t*& pQueueFamilyIndices);
+	uint64_t record_staged_uploads(VkCommandBuffer cmd);
+	StagingAllocation allocate_staging(size_t size, std::unique_lock<std::recursive_mutex>& lock); //lock must hold _uploadMutex exactly once
+	void reclaim_staging();
 };
\ No newline at end of file
@@ -10,6 +10,8 @@ namespace vkutil {
 	
 	void copy_image_to_image(VkCommandBuffer cmd, VkImage source, VkImage destination, VkExtent2D srcSize, VkExtent2D dstSize);
 
+	void memory_barrier(VkCommandBuffer cmd, VkPipelineStageFlags2 srcStageMask, VkAccessFlags2 srcAccessMask, VkPipelineStageFlags2 dstStageMask, VkAccessFlags2 dstAccessMask);
+
 	//Shader Load Function
 	bool load_shader_module(const char* filePath, VkDevice device, VkShaderModule* outShaderModule);
 
@@ -1,9 +1,21 @@
-C:/VulkanSDK/1.3.283.0/Bin/glslc default.vert -o default_vert.spv
-C:/VulkanSDK/1.3.283.0/Bin/glslc default.frag -o default_frag.spv
-C:/VulkanSDK/1.3.283.0/Bin/glslc skybox.vert -o skybox_vert.spv
-C:/VulkanSDK/1.3.283.0/Bin/glslc skybox.frag -o skybox_frag.spv
-C:/VulkanSDK/1.3.283.0/Bin/glslc hdrImageSample.comp -o hdrImageSample_comp.spv
-C:/VulkanSDK/1.3.283.0/Bin/glslc diffuseIrradianceImage.comp -o diffuseIrradianceImage_comp.spv
-C:/VulkanSDK/1.3.283.0/Bin/glslc specularPrefilteredMap.comp -o specularPrefilteredMap_comp.spv
-C:/VulkanSDK/1.3.283.0/Bin/glslc specularBRDFIntegrationLUT.comp -o specularBRDFIntegrationLUT_comp.spv
-pause
\ No newline at end of file
+cd /d "%~dp0"
+C:/VulkanSDK/1.3.283.0/Bin/glslc default.vert -o default_vert.spv || exit /b 1
+C:/VulkanSDK/1.3.283.0/Bin/glslc default.frag -o default_frag.spv || exit /b 1
+C:/VulkanSDK/1.3.283.0/Bin/glslc skybox.vert -o skybox_vert.spv || exit /b 1
+C:/VulkanSDK/1.3.283.0/Bin/glslc skybox.frag -o skybox_frag.spv || exit /b 1
+C:/VulkanSDK/1.3.283.0/Bin/glslc hdrImageSample.comp -o hdrImageSample_comp.spv || exit /b 1
+C:/VulkanSDK/1.3.283.0/Bin/glslc diffuseIrradianceImage.comp -o diffuseIrradianceImage_comp.spv || exit /b 1
+C:/VulkanSDK/1.3.283.0/Bin/glslc specularPrefilteredMap.comp -o specularPrefilteredMap_comp.spv || exit /b 1
+C:/VulkanSDK/1.3.283.0/Bin/glslc specularBRDFIntegrationLUT.comp -o specularBRDFIntegrationLUT_comp.spv || exit /b 1
+C:/VulkanSDK/1.3.283.0/Bin/glslc cullInstances.comp -o cullInstances_comp.spv || exit /b 1
+C:/VulkanSDK/1.3.283.0/Bin/glslc compactDraws.comp -o compactDraws_comp.spv || exit /b 1
+C:/VulkanSDK/1.3.283.0/Bin/glslc buildHiZ.comp -o buildHiZ_comp.spv || exit /b 1
+C:/VulkanSDK/1.3.283.0/Bin/glslc assignLights.comp -o assignLights_comp.spv || exit /b 1
+C:/VulkanSDK/1.3.283.0/Bin/glslc depthPrepass.vert -o depthPrepass_vert.spv || exit /b 1
+C:/VulkanSDK/1.3.283.0/Bin/glslc visibility.vert -o visibility_vert.spv || exit /b 1
+C:/VulkanSDK/1.3.283.0/Bin/glslc visibility.frag -o visibility_frag.spv || exit /b 1
+C:/VulkanSDK/1.3.283.0/Bin/glslc visibilityResolve.comp -o visibilityResolve_comp.spv || exit /b 1
+C:/VulkanSDK/1.3.283.0/Bin/glslc --target-env=vulkan1.3 meshlet.task -o meshlet_task.spv || exit /b 1
+C:/VulkanSDK/1.3.283.0/Bin/glslc --target-env=vulkan1.3 meshlet.mesh -o meshlet_mesh.spv || exit /b 1
+C:/VulkanSDK/1.3.283.0/Bin/glslc generateMipmap.comp -o generateMipmap_comp.spv || exit /b 1
+if not "%1"=="nopause" pause
\ No newline at end of file
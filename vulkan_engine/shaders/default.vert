@@ -3,14 +3,22 @@
 #extension GL_EXT_nonuniform_qualifier : require
 #extension GL_EXT_scalar_block_layout : require
 
-const uint MAX_TEXTURE2D_COUNT = 100;
-const uint MAX_SAMPLER_COUNT = 100;
-
-const uint MAX_POINTLIGHT_COUNT = 100;
+const uint CLUSTER_GRID_X = 16; //Must match RenderSystem's constants
+const uint CLUSTER_GRID_Y = 9;
+const uint CLUSTER_GRID_Z = 24;
+const uint CLUSTER_COUNT = CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+const uint MAX_LIGHTS_PER_CLUSTER = 256;
+
+struct Instance {
+	uint primitive_id;
+	uint model_matrix_id;
+	uint draw_id;
+};
 
 struct PrimitiveInfo {
 	uint mat_id;
-	uint model_matrix_id;
+	vec3 bounds_min;
+	vec3 bounds_max;
 };
 
 struct Material {
@@ -45,14 +53,19 @@ struct PointLight {
 	vec3 pos;
 	vec3 color;
 	float power;
+	float range; //Distance past which the light's contribution is cut off. 0 or less is unbounded
 };
 
-layout(scalar, buffer_reference, buffer_reference_align = 4) buffer PrimitiveIdsBuffer { 
-	int prim_ids[]; //Index with glDrawID
+layout(scalar, buffer_reference, buffer_reference_align = 4) buffer InstancesBuffer { 
+	Instance instances[]; //Index with VisibleInstancesBuffer::instance_ids
+};
+
+layout(scalar, buffer_reference, buffer_reference_align = 4) buffer VisibleInstancesBuffer {
+	uint instance_ids[]; //Index with gl_InstanceIndex. Written by the Culling Passes
 };
 
 layout(scalar, buffer_reference, buffer_reference_align = 4) buffer PrimitiveInfosBuffer { //Unsure what buffer_reference_align should be
-	PrimitiveInfo primitiveInfos[]; //Index with prim_id
+	PrimitiveInfo primitiveInfos[]; //Index with Instance::primitive_id
 };
 
 layout(scalar, buffer_reference, buffer_reference_align = 4) buffer ViewProjMatrixBuffer { //Probably rename this to be like camera or something related
@@ -62,7 +75,7 @@ layout(scalar, buffer_reference, buffer_reference_align = 4) buffer ViewProjMatr
 };
 
 layout(scalar, buffer_reference, buffer_reference_align = 4) buffer ModelMatricesBuffer {
-	mat4 model[]; //Index with PrimitiveInfo::model_matrix_id
+	mat4 model[]; //Index with Instance::model_matrix_id
 };
 
 layout(scalar, buffer_reference, buffer_reference_align = 4) buffer MaterialsBuffer {
@@ -74,22 +87,30 @@ layout(scalar, buffer_reference, buffer_reference_align = 4) buffer TexturesBuff
 };
 
 layout(scalar, buffer_reference, buffer_reference_align = 4) buffer LightsBuffer {
-	int pointLightCount;
-	PointLight lights[MAX_POINTLIGHT_COUNT];
+	PointLight lights[]; //Index with ClusterLightsBuffer::lightIndices
+};
+
+layout(scalar, buffer_reference, buffer_reference_align = 4) buffer ClusterLightsBuffer {
+	uint lightCounts[CLUSTER_COUNT];
+	uint lightIndices[]; //MAX_LIGHTS_PER_CLUSTER per cluster. Written by the Light Assignment Pass
 };
 
 layout(push_constant) uniform PushConstants {
-	PrimitiveIdsBuffer primIdBuffer;
+	InstancesBuffer instanceBuffer;
+	VisibleInstancesBuffer visibleInstanceBuffer;
 	PrimitiveInfosBuffer primInfoBuffer;
 	ViewProjMatrixBuffer viewprojBuffer;
 	ModelMatricesBuffer modelsBuffer;
 	MaterialsBuffer matBuffer;
 	TexturesBuffer texBuffer;
 	LightsBuffer lightBuffer;
+	ClusterLightsBuffer clusterLightsBuffer;
+	vec2 screenSize;
+	vec2 viewDepthRange; //Distances to the near and far planes
 };
 
-layout(set = 0, binding = 0) uniform texture2D texture_images[MAX_TEXTURE2D_COUNT]; //Index with Texture::textureImage_id
-layout(set = 0, binding = 1) uniform sampler samplers[MAX_SAMPLER_COUNT]; //Index with Texture::sampler_id
+layout(set = 0, binding = 0) uniform texture2D texture_images[]; //Index with Texture::textureImage_id
+layout(set = 0, binding = 1) uniform sampler samplers[]; //Index with Texture::sampler_id
 layout(set = 0, binding = 2) uniform samplerCube IBL_irradianceCubemap;
 layout(set = 0, binding = 3) uniform samplerCube IBL_specPreFilteredCubemap;
 layout(set = 0, binding = 4) uniform sampler2D IBL_specLUT;
@@ -101,19 +122,20 @@ layout(location = 2) in vec4 tangent;
 layout(location = 3) in vec3 color; //COLOR_0
 layout(location = 4) in vec2 uv; //TEXCOORD_0
 
-layout(location = 0) out int outPrimID; //Passing drawID to fragShader
+layout(location = 0) out int outPrimID; //Passing the Primitive's ID to fragShader
 layout(location = 1) out vec3 outColor;
 layout(location = 2) out vec2 outUV;
 layout(location = 3) out vec3 outFragPos;
 layout(location = 4) out vec3 outNormal;
 layout(location = 5) out mat3 TBN;
 
+invariant gl_Position; //Matches the Depth Pre-Pass's depth exactly for the EQUAL depth test
+
 void main() {
-	int primID = primIdBuffer.prim_ids[gl_DrawID];
-	PrimitiveInfo primitive = primInfoBuffer.primitiveInfos[primID];
-	mat4 model = modelsBuffer.model[primitive.model_matrix_id];
+	Instance instance = instanceBuffer.instances[visibleInstanceBuffer.instance_ids[gl_InstanceIndex]];
+	mat4 model = modelsBuffer.model[instance.model_matrix_id];
 
-	outPrimID = primID;
+	outPrimID = int(instance.primitive_id);
 	outColor = color;
 	outUV = uv;
 	outFragPos = (model * vec4(inPosition, 1.0f)).xyz;
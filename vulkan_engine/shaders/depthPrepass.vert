@@ -0,0 +1,51 @@
+#version 460
+#extension GL_EXT_buffer_reference2 : require
+#extension GL_EXT_scalar_block_layout : require
+
+//Position only Depth Pre-Pass. gl_Position must be computed exactly as default.vert does, so the shading pass's EQUAL depth test matches
+struct Instance {
+	uint primitive_id;
+	uint model_matrix_id;
+	uint draw_id;
+};
+
+layout(scalar, buffer_reference, buffer_reference_align = 4) buffer InstancesBuffer { 
+	Instance instances[];
+};
+
+layout(scalar, buffer_reference, buffer_reference_align = 4) buffer VisibleInstancesBuffer {
+	uint instance_ids[];
+};
+
+layout(scalar, buffer_reference, buffer_reference_align = 4) buffer ViewProjMatrixBuffer {
+	mat4 view;
+	mat4 proj;
+	vec3 camPos;
+};
+
+layout(scalar, buffer_reference, buffer_reference_align = 4) buffer ModelMatricesBuffer {
+	mat4 model[];
+};
+
+//Unused here, but declared to keep the Push Constants' layout
+layout(buffer_reference) buffer PrimitiveInfosBuffer;
+
+layout(push_constant) uniform PushConstants {
+	InstancesBuffer instanceBuffer;
+	VisibleInstancesBuffer visibleInstanceBuffer;
+	PrimitiveInfosBuffer primInfoBuffer;
+	ViewProjMatrixBuffer viewprojBuffer;
+	ModelMatricesBuffer modelsBuffer;
+};
+
+//-------------------------------------------------------------------------------------
+layout(location = 0) in vec3 inPosition;
+
+invariant gl_Position;
+
+void main() {
+	Instance instance = instanceBuffer.instances[visibleInstanceBuffer.instance_ids[gl_InstanceIndex]];
+	mat4 model = modelsBuffer.model[instance.model_matrix_id];
+
+	gl_Position = viewprojBuffer.proj * viewprojBuffer.view * model * vec4(inPosition, 1.0f);
+}
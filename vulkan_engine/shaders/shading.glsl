@@ -0,0 +1,226 @@
+/*
+	PBR Material Shading shared by default.frag and the Visibility Buffer Resolve.
+	The including shader first declares the cluster constants, the Push Constant buffers (primInfoBuffer, matBuffer, texBuffer, viewprojBuffer, lightBuffer, clusterLightsBuffer),
+	screenSize, viewDepthRange and the bindless Set 0, including the Texture Feedback Buffer (textureFeedback).
+*/
+
+const float PI = 3.14159265359;
+const bool FLIP_ENVIRON_MAP_Y = false; //Used for IBL Enviroment Cubemaps to flip certain vector-y components in case of upside down cubemap sampling. Dont think I need this for now but keeping here just in case an Enviromap caues me trouble
+
+struct SurfaceInput {
+	uint primID;
+	vec2 uv; //TexCoord_0
+	vec2 uvDdx; //Screen space derivatives of uv. Explicit, as the Visibility Buffer Resolve has no implicit derivatives
+	vec2 uvDdy;
+	vec3 fragPos; //World space
+	vec3 normal;
+	mat3 TBN;
+	vec2 fragCoord; //Framebuffer position of the pixel's center
+};
+
+float BRDF_NormalDistributionFunction(vec3 normal, vec3 halfwayVector, float roughness);
+float BRDF_GeometryAttenuationFunction(vec3 normal, vec3 viewDir, vec3 lightDir, float roughness);
+float BRDF_GeometrySchlickGGX(float NdotV, float roughness);
+vec3 BRDF_fresnelFunction(float cosTheta, vec3 base_reflectivity);
+vec3 BRDF_fresnelFunction_roughness(float cosTheta, vec3 base_reflectivity, float roughness);
+
+//Texture Streaming Feedback. Must match renderSystem.h
+const uint TEXTURE_FEEDBACK_GRID = 4; //Only one pixel of each 4x4 square records feedback, which still catches every Texture covering a few pixels
+const float TEXTURE_FEEDBACK_MAX_DETAIL = 30.0;
+
+//Records the finest detail the Texture was sampled at: 1 + log2 of the texels per UV unit a texel per pixel needs, rounded up. Only raises the value, and skips the atomic when it wouldn't
+void write_texture_feedback(Texture tex, SurfaceInput surface) {
+	uvec2 pixel = uvec2(surface.fragCoord);
+	if (pixel.x % TEXTURE_FEEDBACK_GRID != 0 || pixel.y % TEXTURE_FEEDBACK_GRID != 0)
+		return;
+
+	float footprint = max(length(surface.uvDdx), length(surface.uvDdy)); //UV units per pixel
+	uint detail = uint(clamp(ceil(-log2(max(footprint, 1e-9))), 0.0, TEXTURE_FEEDBACK_MAX_DETAIL)) + 1;
+	if (textureFeedback[tex.textureImage_id] < detail)
+		atomicMax(textureFeedback[tex.textureImage_id], detail);
+}
+
+//Neighbouring pixels may use different Textures, so the indices are nonuniform
+vec4 sample_texture(Texture tex, SurfaceInput surface) {
+	write_texture_feedback(tex, surface);
+	return textureGrad(sampler2D(texture_images[nonuniformEXT(tex.textureImage_id)], samplers[nonuniformEXT(tex.sampler_id)]), surface.uv, surface.uvDdx, surface.uvDdy);
+}
+
+vec3 shade_surface(SurfaceInput surface) {
+	PrimitiveInfo primitive = primInfoBuffer.primitiveInfos[surface.primID];
+	Material mat = matBuffer.materials[primitive.mat_id];
+
+	//Think maybe having default values should be used if material uses a texcoord other than 0. Dont want unexpected runtime errors
+	vec3 baseColor;
+	vec3 normal;
+	float metallic;
+	float roughness;
+	float ao;
+	vec3 emission;
+
+	//Sample Textures
+	//-BaseColor
+	Texture baseColor_texture = texBuffer.textures[mat.baseColor_texture_id];
+	if (mat.baseColor_texcoord_id == -1) //If Texcoord doesn't exist, just return vertex color.
+		baseColor = mat.baseColor_factor.rgb;
+	else if (mat.baseColor_texcoord_id == 0) { //If it uses TexCorrd_0, grab from vertex input. 
+			baseColor = sample_texture(baseColor_texture, surface).rgb * mat.baseColor_factor.rgb; //Sampled Texture Value * Associated Factor. Color Textures are SRGB, so they're already decoded to Linear Space
+	}
+
+	//-Normal
+	Texture normal_texture = texBuffer.textures[mat.normal_texture_id];
+	if (mat.normal_texcoord_id == -1)
+		normal = surface.normal;
+	else if (mat.normal_texcoord_id == 0) {
+		vec2 normal_xy = sample_texture(normal_texture, surface).rg * 2.0 - 1.0; //Transform normal from [0,1] range to [-1,1] range. Only XY is read, as BC5 Normal Maps drop B
+		normal = vec3(normal_xy * mat.normal_scale, sqrt(max(1.0 - dot(normal_xy, normal_xy), 0.0))); //Reconstruct Z from the unit length XY
+		normal = normalize(surface.TBN * normal); //Transform the Normal Vector from Tangent Space to World Space
+	}
+
+	//-Metal_Roughness 
+	Texture metal_roughness_texture = texBuffer.textures[mat.metal_rough_texture_id];
+	if (mat.metal_rough_texcoord_id == -1) {
+		metallic = mat.metallic_factor;
+		roughness = mat.roughness_factor;
+	}
+	else if (mat.metal_rough_texcoord_id == 0) {
+		metallic = sample_texture(metal_roughness_texture, surface).b * mat.metallic_factor;
+		roughness = sample_texture(metal_roughness_texture, surface).g * mat.roughness_factor;
+	}
+
+	//Occlusion
+	Texture occlusion_texture = texBuffer.textures[mat.occlusion_texture_id];
+	if (mat.occlusion_texcoord_id == -1) {
+		ao = 1.0;
+	}
+	else if (mat.occlusion_texcoord_id == 0) {
+		ao = sample_texture(occlusion_texture, surface).r * mat.occlusion_strength;
+	}
+
+	//Emission
+	Texture emission_texture = texBuffer.textures[mat.emission_texture_id];
+	if (mat.emission_texcoord_id == -1) {
+		emission = vec3(0.0, 0.0, 0.0);
+	}
+	else if (mat.emission_texcoord_id == 0) {
+		emission = sample_texture(emission_texture, surface).rgb * mat.emission_factor;
+	}
+
+	//Direct Lighting Calculations
+	normal = normalize(normal);
+	vec3 viewDir = normalize(viewprojBuffer.camPos - surface.fragPos);
+	vec3 reflectVec = reflect(-viewDir, normal);
+
+	vec3 base_reflectivity = vec3(0.04);
+	base_reflectivity = mix(base_reflectivity, baseColor, metallic);
+
+	//Find the fragment's cluster. Its depth slice is exponential in view depth, matching the Light Assignment Pass
+	float viewDepth = -(viewprojBuffer.view * vec4(surface.fragPos, 1.0)).z;
+	uvec2 tile = min(uvec2(surface.fragCoord / screenSize * vec2(CLUSTER_GRID_X, CLUSTER_GRID_Y)), uvec2(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1));
+	float slice = log(max(viewDepth, viewDepthRange.x) / viewDepthRange.x) / log(viewDepthRange.y / viewDepthRange.x) * float(CLUSTER_GRID_Z);
+	uint clusterIndex = tile.x + tile.y * CLUSTER_GRID_X + min(uint(slice), CLUSTER_GRID_Z - 1) * CLUSTER_GRID_X * CLUSTER_GRID_Y;
+
+	vec3 irradiance = vec3(0.0f);
+	uint clusterLightCount = clusterLightsBuffer.lightCounts[clusterIndex];
+	for (uint i = 0; i < clusterLightCount; i++) { //Calculate irradiance of the Point Lights reaching this cluster
+		PointLight light = lightBuffer.lights[clusterLightsBuffer.lightIndices[clusterIndex * MAX_LIGHTS_PER_CLUSTER + i]];
+		vec3 lightDir = normalize(light.pos - surface.fragPos);
+		vec3 halfwayVector = normalize(viewDir + lightDir);
+		float lightDistance = length(light.pos - surface.fragPos);
+		float rangeRatio = light.range > 0.0 ? lightDistance / light.range : 0.0; //A range of 0 or less is unbounded
+		float window = clamp(1.0 - rangeRatio * rangeRatio * rangeRatio * rangeRatio, 0.0, 1.0); //Fades the inverse square falloff to 0 at the light's range, so lights outside a cluster's list aren't missed
+		float attenuation = window * window / (lightDistance * lightDistance);
+		vec3 radiance = light.color * light.power * attenuation; //Light's Radiance
+
+		//Cook-Torrance BRDF
+		float NDF = BRDF_NormalDistributionFunction(normal, halfwayVector, roughness);
+		float G = BRDF_GeometryAttenuationFunction(normal, viewDir, lightDir, roughness);
+		vec3 F = BRDF_fresnelFunction(max(dot(halfwayVector, viewDir), 0.0), base_reflectivity);
+
+		vec3 kS = F; //Ratio of reflected light
+		vec3 kD = vec3(1.0) - kS; //Ratio of refracted light
+		kD *= 1.0 - metallic; 
+
+		vec3 numerator = NDF * G * F;
+		float denominator = 4.0 * max(dot(normal, viewDir), 0.0) * max(dot(normal, lightDir), 0.0) + 0.0001;
+		vec3 specular = numerator / denominator;
+
+		float NdotL = max(dot(normal, lightDir), 0.0);
+		irradiance += (kD * baseColor / PI + specular) * radiance * NdotL;
+	}
+	
+	//IBL Ambient Lighting/Irradiance
+	vec3 F = BRDF_fresnelFunction_roughness(max(dot(normal,viewDir), 0.0), base_reflectivity, roughness);
+	vec3 kS = F;
+	vec3 kD = 1.0 - kS;
+	kD *= 1.0 - metallic;
+
+	vec3 enviro_normal = normal; //Used to sample Enviroment Irradiance Cubemap
+	if (FLIP_ENVIRON_MAP_Y) 
+		enviro_normal.y = -enviro_normal.y;
+	vec3 enviro_irradiance = texture(IBL_irradianceCubemap, enviro_normal).rgb;
+
+	vec3 diffuse = enviro_irradiance * baseColor;
+
+	//IBL Specular Lighting
+	const float MAX_REFLECTION_LOD = 5.0;
+
+	vec3 enviro_reflect = reflectVec;
+	if (FLIP_ENVIRON_MAP_Y)
+		enviro_reflect.y = -enviro_reflect.y;
+	vec3 prefilteredColor = textureLod(IBL_specPreFilteredCubemap, enviro_reflect, roughness * MAX_REFLECTION_LOD).rgb;
+	vec2 brdf = texture(IBL_specLUT, vec2(max(dot(normal, viewDir), 0.0), roughness)).rg;
+	vec3 specular = prefilteredColor * (F * brdf.x + brdf.y);
+	vec3 ambient = (kD * diffuse + specular) * ao; //Ambient Lighting
+
+	//Final Color Adjustments
+	vec3 finalColor = ambient + irradiance; 
+	finalColor = finalColor / (finalColor + vec3(1.0)); //Reinhard Tone Mapping. Gamma Correction happens when written to the SRGB Swapchain Image
+	finalColor += emission; //Add Emission (temp)
+	return finalColor;
+}
+
+//Returns value of how much of the surface's microfacets diverge from the alignment with the halfway-vector
+float BRDF_NormalDistributionFunction(vec3 normal, vec3 halfwayVector, float roughness) {
+	//Trowbridge-Reitz GGX
+	float a = roughness * roughness; //Squaring roughness produces more correct results apparently
+	float a2 = a * a;
+	float NdotH = max(dot(normal, halfwayVector), 0.0);
+	float NdotH2 = NdotH * NdotH;
+
+	float denom = (NdotH2 * (a2 - 1.0) + 1.0);
+	denom = PI * denom * denom;
+
+	return a2 / denom;
+}
+
+//Returns value of how much the microfacets shadow each other.
+float BRDF_GeometryAttenuationFunction(vec3 normal, vec3 viewDir, vec3 lightDir, float roughness) {
+	//Smith's Shadowing Function
+	float NdotV = max(dot(normal, viewDir), 0.0);
+	float NdotL = max(dot(normal, lightDir), 0.0);
+	float ggx1 = BRDF_GeometrySchlickGGX(NdotV, roughness); //Geometry Obstruction from View Direction
+	float ggx2 = BRDF_GeometrySchlickGGX(NdotL, roughness); //Geometry Shadowing from Light Direction
+
+	return ggx1 * ggx2;
+}
+
+//Returns value of geometry of obstruction involving a direction vector and surface roughness
+float BRDF_GeometrySchlickGGX(float NdotV, float roughness) {
+//Schlick-GGX (GGX and Schlick-Beckmann approximation)
+	float r = (roughness + 1.0);
+	float k = (r * r) / 8.0; 
+
+	float denom = NdotV * (1.0 - k) + k;
+
+	return NdotV / denom;
+}
+
+//Returns the value (as a vector) of how much the surface relfects based on viewing angle.
+vec3 BRDF_fresnelFunction(float cosTheta, vec3 base_reflectivity) {
+	return base_reflectivity + (1.0 - base_reflectivity) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+}
+
+vec3 BRDF_fresnelFunction_roughness(float cosTheta, vec3 base_reflectivity, float roughness) {
+	return base_reflectivity + (max(vec3(1.0 - roughness), base_reflectivity) - base_reflectivity) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+}
@@ -0,0 +1,15 @@
+#version 460
+
+//Visibility Pass. Packs the Instance and the triangle within its draw into one texel
+layout(push_constant) uniform PushConstants {
+	layout(offset = 88) uint visBufferTriangleBits; //Follows the buffers, screenSize and viewDepthRange of RenderShader::PushConstants
+};
+
+//-------------------------------------------------------------------------------------
+layout(location = 0) flat in uint inInstanceID;
+
+layout(location = 0) out uint outVisibility;
+
+void main() {
+	outVisibility = (inInstanceID << visBufferTriangleBits) | uint(gl_PrimitiveID); //gl_PrimitiveID restarts at 0 for every draw and instance
+}
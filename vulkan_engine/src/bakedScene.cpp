@@ -0,0 +1,251 @@
+#include "bakedScene.h"
+#include "textureCompression.h"
+
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <cctype>
+
+namespace {
+	constexpr uint64_t SECTION_ALIGNMENT = 16;
+
+	uint64_t align_up(uint64_t value, uint64_t alignment) {
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	//FNV-1a
+	uint64_t hash_bytes(uint64_t hash, const void* data, size_t size) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++) {
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	template<typename T>
+	bool section_in_bounds(const Baked::Section& section, size_t fileSize) {
+		return section.offset % alignof(T) == 0 && section.offset <= fileSize && section.count <= (fileSize - section.offset) / sizeof(T);
+	}
+
+	bool range_in_bounds(uint64_t offset, uint64_t size, uint64_t limit) {
+		return offset <= limit && size <= limit - offset;
+	}
+}
+
+uint64_t Baked::hash_source(const std::filesystem::path& sourcePath) {
+	uint64_t hash = 14695981039346656037ull;
+
+	std::shared_ptr<MappedFile> source = MappedFile::open(sourcePath);
+	if (source == nullptr)
+		return hash;
+	hash = hash_bytes(hash, source->data(), source->size());
+
+	//External buffers and images aren't parsed on a cache hit, so their stamps stand in for their content
+	std::vector<std::filesystem::path> resources;
+	std::error_code error;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(sourcePath.parent_path(), error)) {
+		if (!entry.is_regular_file(error))
+			continue;
+
+		std::string extension = entry.path().extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		if (extension == ".bin" || extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".ktx2")
+			resources.push_back(entry.path());
+	}
+	std::sort(resources.begin(), resources.end());
+
+	for (const std::filesystem::path& resource : resources) {
+		std::string name = resource.filename().string();
+		uint64_t size = std::filesystem::file_size(resource, error);
+		int64_t writeTime = std::filesystem::last_write_time(resource, error).time_since_epoch().count();
+
+		hash = hash_bytes(hash, name.data(), name.size());
+		hash = hash_bytes(hash, &size, sizeof(size));
+		hash = hash_bytes(hash, &writeTime, sizeof(writeTime));
+	}
+
+	return hash;
+}
+
+uint32_t Baked::full_mip_count(uint32_t width, uint32_t height) {
+	return static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+}
+
+std::filesystem::path Baked::cache_path(const std::filesystem::path& sourcePath) {
+	std::filesystem::path cachePath = sourcePath;
+	cachePath += ".vkbake";
+	return cachePath;
+}
+
+Baked::String BakedSceneWriter::add_string(const std::string& string) {
+	Baked::String bakedString{ .offset = _strings.size(), .length = static_cast<uint32_t>(string.size()) };
+	_strings += string;
+	return bakedString;
+}
+
+uint64_t BakedSceneWriter::add_data(const void* data, size_t size) {
+	uint64_t offset = align_up(_data.size(), SECTION_ALIGNMENT);
+	_data.resize(offset + size);
+	if (size > 0)
+		memcpy(_data.data() + offset, data, size);
+	return offset;
+}
+
+bool BakedSceneWriter::write(const std::filesystem::path& filePath, uint64_t sourceHash) const {
+	Baked::Header header{};
+	memcpy(header.magic, Baked::MAGIC, sizeof(header.magic));
+	header.version = Baked::VERSION;
+	header.attributeStride = sizeof(RenderShader::VertexAttributes);
+	header.sourceHash = sourceHash;
+	header.defaultScene = defaultScene;
+
+	//Lay out every section after the header
+	uint64_t fileSize = sizeof(Baked::Header);
+	auto place_section = [&](Baked::Section& section, uint64_t count, uint64_t stride) {
+		fileSize = align_up(fileSize, SECTION_ALIGNMENT);
+		section = { .offset = fileSize, .count = count };
+		fileSize += count * stride;
+	};
+
+	place_section(header.samplers, samplers.size(), sizeof(Baked::Sampler));
+	place_section(header.images, images.size(), sizeof(Baked::Image));
+	place_section(header.textures, textures.size(), sizeof(Baked::Texture));
+	place_section(header.materials, materials.size(), sizeof(Baked::Material));
+	place_section(header.primitives, primitives.size(), sizeof(Baked::Primitive));
+	place_section(header.meshes, meshes.size(), sizeof(Baked::Mesh));
+	place_section(header.nodes, nodes.size(), sizeof(Baked::Node));
+	place_section(header.scenes, scenes.size(), sizeof(Baked::Scene));
+	place_section(header.strings, _strings.size(), 1);
+	place_section(header.data, _data.size(), 1);
+
+	std::filesystem::path tempPath = filePath;
+	tempPath += ".tmp";
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+
+		uint64_t written = 0;
+		auto write_section = [&](const Baked::Section& section, const void* data, uint64_t size) {
+			static const char zeros[SECTION_ALIGNMENT] = {};
+			file.write(zeros, section.offset - written);
+			file.write(static_cast<const char*>(data), size);
+			written = section.offset + size;
+		};
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		written = sizeof(header);
+		write_section(header.samplers, samplers.data(), samplers.size() * sizeof(Baked::Sampler));
+		write_section(header.images, images.data(), images.size() * sizeof(Baked::Image));
+		write_section(header.textures, textures.data(), textures.size() * sizeof(Baked::Texture));
+		write_section(header.materials, materials.data(), materials.size() * sizeof(Baked::Material));
+		write_section(header.primitives, primitives.data(), primitives.size() * sizeof(Baked::Primitive));
+		write_section(header.meshes, meshes.data(), meshes.size() * sizeof(Baked::Mesh));
+		write_section(header.nodes, nodes.data(), nodes.size() * sizeof(Baked::Node));
+		write_section(header.scenes, scenes.data(), scenes.size() * sizeof(Baked::Scene));
+		write_section(header.strings, _strings.data(), _strings.size());
+		write_section(header.data, _data.data(), _data.size());
+
+		if (!file)
+			return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, filePath, error);
+	if (error) {
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+
+	return true;
+}
+
+std::optional<BakedSceneFile> BakedSceneFile::open(const std::filesystem::path& filePath, uint64_t sourceHash) {
+	BakedSceneFile bakedFile;
+	bakedFile._mapping = MappedFile::open(filePath);
+	if (bakedFile._mapping == nullptr || !bakedFile.validate() || bakedFile.header().sourceHash != sourceHash)
+		return std::nullopt;
+
+	return bakedFile;
+}
+
+std::string BakedSceneFile::string(Baked::String string) const {
+	return std::string(reinterpret_cast<const char*>(_mapping->data() + header().strings.offset + string.offset), string.length);
+}
+
+//Checks every offset and index in the file so a truncated or corrupt cache is rejected instead of read out of bounds
+bool BakedSceneFile::validate() const {
+	size_t fileSize = _mapping->size();
+	if (fileSize < sizeof(Baked::Header))
+		return false;
+
+	const Baked::Header& head = header();
+	if (memcmp(head.magic, Baked::MAGIC, sizeof(head.magic)) != 0 || head.version != Baked::VERSION || head.attributeStride != sizeof(RenderShader::VertexAttributes))
+		return false;
+
+	if (!section_in_bounds<Baked::Sampler>(head.samplers, fileSize) || !section_in_bounds<Baked::Image>(head.images, fileSize) ||
+		!section_in_bounds<Baked::Texture>(head.textures, fileSize) || !section_in_bounds<Baked::Material>(head.materials, fileSize) ||
+		!section_in_bounds<Baked::Primitive>(head.primitives, fileSize) || !section_in_bounds<Baked::Mesh>(head.meshes, fileSize) ||
+		!section_in_bounds<Baked::Node>(head.nodes, fileSize) || !section_in_bounds<Baked::Scene>(head.scenes, fileSize) ||
+		!section_in_bounds<char>(head.strings, fileSize) || !section_in_bounds<std::byte>(head.data, fileSize) || head.data.offset % SECTION_ALIGNMENT != 0)
+		return false;
+
+	auto valid_string = [&](const Baked::String& string) { return range_in_bounds(string.offset, string.length, head.strings.count); };
+	auto valid_index = [](int32_t index, size_t count) { return index >= -1 && index < static_cast<int64_t>(count); };
+	auto valid_data = [&](uint64_t offset, uint64_t count, uint64_t stride, uint64_t alignment) {
+		return offset % alignment == 0 && count <= head.data.count / stride && range_in_bounds(offset, count * stride, head.data.count);
+	};
+
+	for (const Baked::Image& image : images()) {
+		VkFormat format = static_cast<VkFormat>(image.format);
+		if (!valid_string(image.name) || !valid_data(image.dataOffset, image.dataSize, 1, 1) || image.width == 0 || image.height == 0 || !texcompress::is_supported(format))
+			return false;
+		if (image.levelCount == 0 || image.levelCount > Baked::full_mip_count(image.width, image.height) || image.dataSize != texcompress::chain_size(format, image.width, image.height, image.levelCount))
+			return false;
+		if (texcompress::is_block_compressed(format) && image.levelCount != Baked::full_mip_count(image.width, image.height)) //BC levels can't be generated on the GPU
+			return false;
+	}
+
+	for (const Baked::Texture& texture : textures()) {
+		if (!valid_string(texture.name) || !valid_index(texture.image_index, head.images.count) || !valid_index(texture.sampler_index, head.samplers.count))
+			return false;
+	}
+
+	for (const Baked::Material& material : materials()) {
+		if (!valid_string(material.name))
+			return false;
+		for (int32_t texture : { material.normal_texture, material.occlusion_texture, material.emission_texture, material.baseColor_texture, material.metal_rough_texture }) {
+			if (!valid_index(texture, head.textures.count))
+				return false;
+		}
+	}
+
+	for (const Baked::Primitive& primitive : primitives()) {
+		if (!valid_index(primitive.material_index, head.materials.count) ||
+			!valid_data(primitive.positionsOffset, primitive.vertexCount, sizeof(glm::vec3), alignof(glm::vec3)) ||
+			!valid_data(primitive.attributesOffset, primitive.vertexCount, sizeof(RenderShader::VertexAttributes), alignof(RenderShader::VertexAttributes)) ||
+			!valid_data(primitive.indicesOffset, primitive.indexCount, sizeof(uint32_t), alignof(uint32_t)))
+			return false;
+	}
+
+	for (const Baked::Mesh& mesh : meshes()) {
+		if (!valid_string(mesh.name) || !range_in_bounds(mesh.firstPrimitive, mesh.primitiveCount, head.primitives.count))
+			return false;
+	}
+
+	for (const Baked::Scene& scene : scenes()) {
+		if (!valid_string(scene.name) || !range_in_bounds(scene.firstNode, scene.nodeCount, head.nodes.count))
+			return false;
+
+		for (uint32_t i = 0; i < scene.nodeCount; i++) {
+			const Baked::Node& node = nodes()[scene.firstNode + i];
+			if (!valid_string(node.name) || !valid_index(node.mesh_index, head.meshes.count) || node.parent_index < -1 || node.parent_index >= static_cast<int64_t>(i))
+				return false;
+		}
+	}
+
+	return valid_index(head.defaultScene, head.scenes.count);
+}
@@ -0,0 +1,84 @@
+#include "bindlessRegistry.h"
+
+#include <stdexcept>
+#include <format>
+#include <algorithm>
+
+namespace {
+	VkPhysicalDeviceDescriptorIndexingProperties get_indexing_properties(VkPhysicalDevice physicalDevice) {
+		VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+		indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+		VkPhysicalDeviceProperties2 properties{};
+		properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties.pNext = &indexingProperties;
+		vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+		return indexingProperties;
+	}
+}
+
+//The arrays are read by the Fragment and Compute stages, so the per stage limits apply as well as the per set ones
+uint32_t BindlessRegistry::image_capacity(VkPhysicalDevice physicalDevice) {
+	VkPhysicalDeviceDescriptorIndexingProperties properties = get_indexing_properties(physicalDevice);
+	return std::min({ properties.maxDescriptorSetUpdateAfterBindSampledImages, properties.maxPerStageDescriptorUpdateAfterBindSampledImages, MAX_IMAGE_SLOTS });
+}
+
+uint32_t BindlessRegistry::sampler_capacity(VkPhysicalDevice physicalDevice) {
+	VkPhysicalDeviceDescriptorIndexingProperties properties = get_indexing_properties(physicalDevice);
+	return std::min({ properties.maxDescriptorSetUpdateAfterBindSamplers, properties.maxPerStageDescriptorUpdateAfterBindSamplers, MAX_SAMPLER_SLOTS });
+}
+
+void BindlessRegistry::init(VkDevice device, VkDescriptorSet descriptorSet, uint32_t imageCapacity, uint32_t samplerCapacity) {
+	_device = device;
+	_descriptorSet = descriptorSet;
+	_images.capacity = imageCapacity;
+	_samplers.capacity = samplerCapacity;
+}
+
+uint32_t BindlessRegistry::add_image(VkImageView imageView, VkImageLayout layout) {
+	uint32_t slot = _images.allocate();
+	write(IMAGE_BINDING, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, slot, { .sampler = VK_NULL_HANDLE, .imageView = imageView, .imageLayout = layout });
+	return slot;
+}
+
+uint32_t BindlessRegistry::add_sampler(VkSampler sampler) {
+	uint32_t slot = _samplers.allocate();
+	write(SAMPLER_BINDING, VK_DESCRIPTOR_TYPE_SAMPLER, slot, { .sampler = sampler, .imageView = VK_NULL_HANDLE, .imageLayout = VK_IMAGE_LAYOUT_UNDEFINED });
+	return slot;
+}
+
+//Reuses the most recently freed slot, otherwise takes the next never used one
+uint32_t BindlessRegistry::SlotAllocator::allocate() {
+	if (!free.empty()) {
+		uint32_t slot = free.back();
+		free.pop_back();
+		return slot;
+	}
+
+	if (next >= capacity)
+		throw std::runtime_error(std::format("Bindless {} array is full ({} slots)", name, capacity));
+
+	return next++;
+}
+
+void BindlessRegistry::SlotAllocator::recycle(uint64_t completedFrame) {
+	auto still_read = std::stable_partition(retired.begin(), retired.end(), [completedFrame](const std::pair<uint64_t, uint32_t>& entry) { return entry.first <= completedFrame; });
+	for (auto it = retired.begin(); it != still_read; it++)
+		free.push_back(it->second);
+	retired.erase(retired.begin(), still_read);
+}
+
+//The bindings are Update After Bind and Update Unused While Pending, so a slot no pending frame reads can be written while those frames are in flight
+void BindlessRegistry::write(uint32_t binding, VkDescriptorType type, uint32_t slot, const VkDescriptorImageInfo& info) {
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = _descriptorSet;
+	descriptorWrite.dstBinding = binding;
+	descriptorWrite.dstArrayElement = slot;
+	descriptorWrite.descriptorType = type;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pImageInfo = &info;
+
+	vkUpdateDescriptorSets(_device, 1, &descriptorWrite, 0, nullptr);
+}
@@ -16,11 +16,13 @@
 #include "loader.h"
 #include "pipeline.h"
 #include "shader_types.h"
+#include "transformKernels.h"
 
 #include <thread>
 #include <iostream>
 #include <format>
 #include <stack>
+#include <algorithm>
 
 void Engine::init() {
 	//Initialize SDL Window
@@ -33,6 +35,8 @@ void Engine::init() {
 	//Initialize Vulkan Context
 	_vkContext.init(_window);
 
+	_guiParam.transformISA = transformkernels::isa_name(transformkernels::active_isa());
+
 	//Initalize Systems
 	_renderSys.init(_windowExtent);
 	_guiSys.init(_window, _renderSys.get_swapChainFormat());
@@ -41,7 +45,7 @@ void Engine::init() {
 
 	//LAZY CODE STUFF
 	//-Load File Data
-	loadGLTFFile(_vkContext, _payload, "C:\\Github\\vulkan_engine\\vulkan_engine\\assets\\Sample_Models\\MetalRoughSpheres\\MetalRoughSpheres.gltf"); //Exception expected to be thrown since allocated data in payload is not released
+	loadGLTFFile(_vkContext, _threadPool, _payload, "C:\\Github\\vulkan_engine\\vulkan_engine\\assets\\Sample_Models\\MetalRoughSpheres\\MetalRoughSpheres.gltf"); //Exception expected to be thrown since allocated data in payload is not released
 	
 	_camera = Camera({ 0.0f, 0.0f, 0.15f });
 	_camera.update_view_matrix();
@@ -59,6 +63,8 @@ void Engine::init() {
 	_renderSys.bind_descriptors(_payload);
 	//Upload Draw Data
 	_renderSys.setup_drawContexts(_payload);
+
+	rebuild_sceneBVH();
 }
 
 void Engine::run() {
@@ -130,30 +136,60 @@ void Engine::run() {
 
 		if (_guiParam.fileOpened) {
 			_guiParam.fileOpened = false;
-			loadGLTFFile(_vkContext, _payload, _guiParam.OpenedFilePath); //Testing this
-			DeviceBufferTypeFlags dataType;
-			dataType.setAll();
-			_renderSys.signal_to_updateDeviceBuffers(dataType);
-			_renderSys.bind_descriptors(_payload);
+			start_background_load(_guiParam.OpenedFilePath);
 		}
 
+		//Splice in a finished Background Load
+		if (_pendingLoad.valid() && _pendingLoad.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			if (finish_background_load()) {
+				DeviceBufferTypeFlags dataType;
+				dataType.setAll();
+				_renderSys.signal_to_updateDeviceBuffers(dataType);
+				_renderSys.bind_descriptors(_payload);
+				rebuild_sceneBVH();
+			}
+		}
+
+		_guiParam.fileLoading = _pendingLoad.valid();
+		_guiParam.loadProgress = _loadProgress.fraction;
+		_guiParam.loadStage = _loadProgress.stage.load();
+
 		if (_guiParam.sceneChanged) {
 			_guiParam.sceneChanged = false;
 			//_renderSys.signal_to_updateDeviceBuffer(DeviceBufferType::ModelMatrix | DeviceBufferType::IndirectDraw | DeviceBufferType::PrimitiveID | DeviceBufferType::Vertex | DeviceBufferType::Index | DeviceBufferType::PrimitiveInfo);
 			DeviceBufferTypeFlags dataType;
 			dataType.modelMatrix = true;
 			dataType.indirectDraw = true;
-			dataType.primID = true;
+			dataType.instance = true;
 			dataType.primInfo = true;
 			dataType.vertex = true;
 			dataType.index = true;
 			_renderSys.signal_to_updateDeviceBuffers(dataType); //Need to fix stuff to ensure that it only updates what is neccesary instead of All
+			rebuild_sceneBVH();
 		}
 
+		//World Transforms of Nodes moved since the last frame
+		if (!_payload.scenes.empty() && _payload.scenes[_payload.current_scene_idx].transforms != nullptr)
+			_payload.scenes[_payload.current_scene_idx].transforms->update(&_threadPool);
+
+		//Refit the BVH to Nodes that moved
+		_sceneBVH.refit(Node::bounds_journal.consume());
+
+		//Stream Texture levels in and out by the feedback of the last completed frame. Rebound Images reach this frame's Texture buffer below
+		_textureStreamer.update(_payload, _renderSys, static_cast<uint32_t>(std::max(_guiParam.textureBudgetMB, 0)));
+		_guiParam.streamedTextureMB = _textureStreamer.get_residentBytes() / (1024.0f * 1024.0f);
+		_guiParam.textureBudgetUsedMB = _textureStreamer.get_budgetBytes() / (1024.0f * 1024.0f);
+
 		//Render System Device Data/Render Data Updates
 		_renderSys.updateSignaledDeviceBuffers(_payload);
 
+		_renderSys.set_depthPrepass(_guiParam.depthPrepass);
+		_renderSys.set_renderPath(static_cast<RenderPath>(_guiParam.renderPath));
 		result = _renderSys.run();
+
+		GeometryTimings geometryTimings = _renderSys.get_geometryTimings();
+		_guiParam.depthPrepassTime = geometryTimings.depthPrepass;
+		_guiParam.shadingTime = geometryTimings.shading;
 		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
 			windowResized = true;
 			continue;
@@ -161,9 +197,73 @@ void Engine::run() {
 	}
 }
 
+//Loads the file on a background thread into a separate payload, which is merged into the engine's payload by finish_background_load once done
+void Engine::start_background_load(const std::string& filePath) {
+	if (_pendingLoad.valid())
+		return;
+
+	//The loaded payload starts with the current Images and Samplers so the loaded Textures index them correctly once merged. Only loads add to these, and only one load runs at a time
+	GraphicsDataPayload loadPayload;
+	loadPayload.images = _payload.images;
+	loadPayload.samplers = _payload.samplers;
+
+	_loadProgress.reset();
+	_guiParam.loadError.clear();
+	_pendingLoad = std::async(std::launch::async, [this, filePath, loadPayload = std::move(loadPayload)]() mutable {
+		size_t sharedImages = loadPayload.images.size();
+		size_t sharedSamplers = loadPayload.samplers.size();
+		try {
+			loadGLTFFile(_vkContext, _threadPool, loadPayload, filePath, &_loadProgress);
+			_vkContext.flush_staged_uploads(); //Have the uploads finish on this thread so the render thread never waits on them
+		}
+		catch (...) {
+			//The payload is dropped, so free what the load created before it failed. Its uploads must finish first, as they write the Images and hold staging space
+			_vkContext.flush_staged_uploads();
+			for (size_t i = sharedImages; i < loadPayload.images.size(); i++)
+				_vkContext.destroy_image(loadPayload.images[i]);
+			for (size_t i = sharedSamplers; i < loadPayload.samplers.size(); i++)
+				_vkContext.destroy_sampler(loadPayload.samplers[i]);
+			throw;
+		}
+		return std::move(loadPayload);
+	});
+}
+
+//Merges the finished Background Load into the payload. Returns false if the load failed, which the GUI reports
+bool Engine::finish_background_load() {
+	try {
+		merge_payload(_payload, _pendingLoad.get());
+	}
+	catch (const std::exception& e) {
+		_guiParam.loadError = std::format("Failed to load file: {}", e.what());
+		return false;
+	}
+
+	return true;
+}
+
+//Builds the BVH over the current Scene. The journaled moves are already reflected in the new tree, so they're dropped
+void Engine::rebuild_sceneBVH() {
+	Node::bounds_journal.consume();
+
+	if (_payload.scenes.empty()) {
+		_sceneBVH.clear();
+		return;
+	}
+
+	_sceneBVH.build(_payload.scenes[_payload.current_scene_idx]);
+}
+
 void Engine::cleanup() {
+	//Let a Background Load finish so its resources are owned by the payload and cleaned up with it
+	if (_pendingLoad.valid())
+		finish_background_load();
+
 	vkDeviceWaitIdle(_vkContext.device);
 
+	//Images the Texture Streamer replaced. The payload holds the current ones
+	_textureStreamer.shutdown();
+
 	//Payload Cleanup
 	for (VkSampler& sampler : _payload.samplers) {
 		_vkContext.destroy_sampler(sampler);
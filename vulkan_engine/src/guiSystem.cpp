@@ -1,5 +1,7 @@
 #include "guiSystem.h"
 
+#include <cmath>
+
 void GUISystem::init(SDL_Window* window, const VkFormat& swapChainFormat) {
 	init_imgui(window, swapChainFormat);
 
@@ -16,7 +18,7 @@ void GUISystem::run(GUIParameters& param, GraphicsDataPayload& graphics_payload)
 
 	if (ImGui::BeginMainMenuBar()) {
 		if (ImGui::BeginMenu("File")) {
-			if (ImGui::MenuItem("Open")) {
+			if (ImGui::MenuItem("Open", nullptr, false, !param.fileLoading)) {
 				fileExplorer.Open();
 			}
 			ImGui::EndMenu();
@@ -45,13 +47,43 @@ void GUISystem::run(GUIParameters& param, GraphicsDataPayload& graphics_payload)
 			ImGui::EndCombo();
 		}
 
+		//Loading Progress
+		if (param.fileLoading) {
+			ImGui::SeparatorText("Loading");
+			ImGui::Text("%s", param.loadStage.c_str());
+			ImGui::ProgressBar(param.loadProgress);
+		}
+		else if (!param.loadError.empty()) {
+			ImGui::SeparatorText("Loading");
+			ImGui::TextWrapped("%s", param.loadError.c_str());
+		}
+
+		//Rendering
+		ImGui::SeparatorText("Rendering");
+		ImGui::Checkbox("Depth Pre-Pass", &param.depthPrepass);
+		ImGui::Combo("Render Path", &param.renderPath, "Forward\0Visibility Buffer\0Mesh Shader\0");
+		ImGui::Text("Depth Pre-Pass: %.3f ms", param.depthPrepassTime);
+		ImGui::Text("Shading: %.3f ms", param.shadingTime);
+		ImGui::Text("Transform Kernels: %s", param.transformISA);
+		if (graphics_payload.vertexCache_before.triangles > 0) {
+			const indexoptimizer::CacheStats& before = graphics_payload.vertexCache_before;
+			const indexoptimizer::CacheStats& after = graphics_payload.vertexCache_after;
+			ImGui::Text("Vertex Cache ACMR: %.3f -> %.3f", before.acmr(), after.acmr());
+			ImGui::Text("Vertex Cache ATVR: %.3f -> %.3f", before.atvr(), after.atvr());
+		}
+
+		//Texture Streaming
+		ImGui::SeparatorText("Texture Streaming");
+		ImGui::SliderInt("VRAM Budget (MB)", &param.textureBudgetMB, 0, 8192, param.textureBudgetMB == 0 ? "Auto" : "%d");
+		ImGui::Text("Streamed Textures: %.1f / %.1f MB", param.streamedTextureMB, param.textureBudgetUsedMB);
+
 		//ImGui::SeparatorText("Node Tree");
 		ImGui::End();
 	}
 
 	//File Explorer
 	fileExplorer.Display();
-	if (fileExplorer.HasSelected()) {
+	if (fileExplorer.HasSelected() && !param.fileLoading) {
 		param.fileOpened = true;
 		param.OpenedFilePath = fileExplorer.GetSelected().string();
 		fileExplorer.ClearSelected();
@@ -92,6 +124,13 @@ void GUISystem::init_imgui(SDL_Window* window, const VkFormat& swapChainFormat)
 	ImGui::CreateContext();
 	ImGui_ImplSDL2_InitForVulkan(window);
 
+	//The Style's colors are authored in sRGB, but the SRGB Swapchain Image encodes what's written to it. Converting them to Linear keeps them looking the same
+	for (ImVec4& color : ImGui::GetStyle().Colors) {
+		float* channels[3] = { &color.x, &color.y, &color.z };
+		for (float* c : channels)
+			*c = *c <= 0.04045f ? *c / 12.92f : std::pow((*c + 0.055f) / 1.055f, 2.4f);
+	}
+
 	ImGui_ImplVulkan_InitInfo init_info{}; 
 	init_info.Instance = _vkContext.instance;
 	init_info.PhysicalDevice = _vkContext.physicalDevice;
@@ -0,0 +1,215 @@
+#include "indexOptimizer.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace {
+	constexpr uint32_t NO_VERTEX = UINT32_MAX;
+
+	//Triangles using each vertex, as one array with a range per vertex
+	struct Adjacency {
+		std::vector<uint32_t> offsets; //Vertex v's triangles are triangles[offsets[v]] to triangles[offsets[v + 1]]
+		std::vector<uint32_t> triangles;
+
+		Adjacency(std::span<const uint32_t> indices, size_t vertex_count) : offsets(vertex_count + 1, 0), triangles(indices.size()) {
+			for (uint32_t index : indices)
+				offsets[index + 1]++;
+			for (size_t v = 0; v < vertex_count; v++)
+				offsets[v + 1] += offsets[v];
+
+			std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++)
+				triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+	};
+}
+
+namespace indexoptimizer {
+
+	bool is_triangle_list(std::span<const uint32_t> indices, size_t vertex_count) {
+		if (indices.size() % 3 != 0)
+			return false;
+		return std::all_of(indices.begin(), indices.end(), [vertex_count](uint32_t index) { return index < vertex_count; });
+	}
+
+	//A vertex is in a FIFO cache if it was added within the last cache_size additions, so timestamps stand in for the queue
+	CacheStats analyze_vertex_cache(std::span<const uint32_t> indices, size_t vertex_count, uint32_t cache_size) {
+		CacheStats stats{};
+		stats.triangles = indices.size() / 3;
+
+		std::vector<uint32_t> cache_times(vertex_count, 0);
+		uint32_t timestamp = cache_size + 1;
+		for (uint32_t index : indices) {
+			if (cache_times[index] == 0)
+				stats.vertices++;
+			if (timestamp - cache_times[index] > cache_size) {
+				cache_times[index] = timestamp++;
+				stats.transforms++;
+			}
+		}
+
+		return stats;
+	}
+
+	void optimize_vertex_cache(std::span<uint32_t> indices, size_t vertex_count, std::vector<uint32_t>& cluster_starts, uint32_t cache_size) {
+		cluster_starts.clear();
+		if (indices.empty())
+			return;
+
+		Adjacency adjacency(indices, vertex_count);
+		std::vector<uint32_t> live_counts(vertex_count); //Triangles not yet emitted
+		for (size_t v = 0; v < vertex_count; v++)
+			live_counts[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+
+		std::vector<uint32_t> cache_times(vertex_count, 0);
+		std::vector<uint8_t> emitted(indices.size() / 3, 0);
+		std::vector<uint32_t> dead_ends; //Recently emitted vertices, to resume from when the fan's neighbours are used up
+		std::vector<uint32_t> candidates; //Vertices of the triangles just emitted
+		std::vector<uint32_t> output;
+		output.reserve(indices.size());
+
+		uint32_t timestamp = cache_size + 1;
+		uint32_t cursor = 0; //Vertices before it have no triangles left
+		auto next_live_vertex = [&]() {
+			while (cursor < vertex_count && live_counts[cursor] == 0)
+				cursor++;
+			return cursor < vertex_count ? cursor : NO_VERTEX;
+		};
+
+		uint32_t fan = next_live_vertex();
+		cluster_starts.push_back(0);
+		while (fan != NO_VERTEX) {
+			//Emit every remaining triangle around the fanning vertex
+			candidates.clear();
+			for (uint32_t a = adjacency.offsets[fan]; a < adjacency.offsets[fan + 1]; a++) {
+				uint32_t triangle = adjacency.triangles[a];
+				if (emitted[triangle])
+					continue;
+
+				for (uint32_t k = 0; k < 3; k++) {
+					uint32_t v = indices[triangle * 3 + k];
+					output.push_back(v);
+					dead_ends.push_back(v);
+					candidates.push_back(v);
+					live_counts[v]--;
+					if (timestamp - cache_times[v] > cache_size)
+						cache_times[v] = timestamp++;
+				}
+				emitted[triangle] = 1;
+			}
+
+			//Next fan is the candidate that stays in cache while its triangles are emitted and is the oldest in cache, so it's used before being evicted
+			uint32_t best = NO_VERTEX;
+			int64_t best_priority = -1;
+			for (uint32_t v : candidates) {
+				if (live_counts[v] == 0)
+					continue;
+
+				int64_t priority = 0;
+				if (timestamp - cache_times[v] + 2 * live_counts[v] <= cache_size)
+					priority = timestamp - cache_times[v];
+				if (priority > best_priority) {
+					best = v;
+					best_priority = priority;
+				}
+			}
+
+			//Otherwise resume from the most recent dead end, or the next vertex with triangles left. Either way the cache is cold, so a new cluster begins
+			if (best == NO_VERTEX) {
+				while (!dead_ends.empty() && best == NO_VERTEX) {
+					uint32_t v = dead_ends.back();
+					dead_ends.pop_back();
+					if (live_counts[v] > 0)
+						best = v;
+				}
+				if (best == NO_VERTEX)
+					best = next_live_vertex();
+				if (best != NO_VERTEX)
+					cluster_starts.push_back(static_cast<uint32_t>(output.size() / 3));
+			}
+
+			fan = best;
+		}
+
+		std::copy(output.begin(), output.end(), indices.begin());
+	}
+
+	void optimize_overdraw(std::span<uint32_t> indices, std::span<const uint32_t> cluster_starts, std::span<const glm::vec3> positions) {
+		uint32_t triangle_count = static_cast<uint32_t>(indices.size() / 3);
+		if (cluster_starts.size() < 2)
+			return;
+
+		//Area weighted centroid and normal of each cluster, and of the whole mesh
+		struct Cluster {
+			uint32_t first;
+			uint32_t end;
+			glm::vec3 centroid;
+			glm::vec3 normal;
+			float sort_key;
+		};
+		std::vector<Cluster> clusters(cluster_starts.size());
+
+		glm::vec3 mesh_centroid(0.0f);
+		float mesh_area = 0.0f;
+		for (size_t c = 0; c < clusters.size(); c++) {
+			Cluster& cluster = clusters[c];
+			cluster.first = cluster_starts[c];
+			cluster.end = c + 1 < cluster_starts.size() ? cluster_starts[c + 1] : triangle_count;
+
+			glm::vec3 centroid(0.0f);
+			glm::vec3 normal(0.0f);
+			float area = 0.0f;
+			for (uint32_t t = cluster.first; t < cluster.end; t++) {
+				const glm::vec3& p0 = positions[indices[t * 3]];
+				const glm::vec3& p1 = positions[indices[t * 3 + 1]];
+				const glm::vec3& p2 = positions[indices[t * 3 + 2]];
+
+				glm::vec3 cross = glm::cross(p1 - p0, p2 - p0); //Length is twice the area
+				float triangle_area = glm::length(cross);
+				centroid += (p0 + p1 + p2) * (triangle_area / 3.0f);
+				normal += cross;
+				area += triangle_area;
+			}
+
+			mesh_centroid += centroid;
+			mesh_area += area;
+			cluster.centroid = area > 0.0f ? centroid / area : positions[indices[cluster.first * 3]];
+			float normal_length = glm::length(normal);
+			cluster.normal = normal_length > 0.0f ? normal / normal_length : glm::vec3(0.0f);
+		}
+		if (mesh_area > 0.0f)
+			mesh_centroid /= mesh_area;
+
+		for (Cluster& cluster : clusters)
+			cluster.sort_key = glm::dot(cluster.centroid - mesh_centroid, cluster.normal);
+
+		std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.sort_key > b.sort_key; });
+
+		std::vector<uint32_t> output;
+		output.reserve(indices.size());
+		for (const Cluster& cluster : clusters)
+			output.insert(output.end(), indices.begin() + cluster.first * 3, indices.begin() + cluster.end * 3);
+
+		std::copy(output.begin(), output.end(), indices.begin());
+	}
+
+	size_t optimize_vertex_fetch(std::span<uint32_t> indices, size_t vertex_count, std::vector<uint32_t>& remap) {
+		remap.assign(vertex_count, UNUSED);
+
+		uint32_t next_vertex = 0;
+		for (uint32_t& index : indices) {
+			if (remap[index] == UNUSED)
+				remap[index] = next_vertex++;
+			index = remap[index];
+		}
+
+		return next_vertex;
+	}
+
+	size_t optimize(std::span<uint32_t> indices, std::span<const glm::vec3> positions, std::vector<uint32_t>& remap) {
+		std::vector<uint32_t> cluster_starts;
+		optimize_vertex_cache(indices, positions.size(), cluster_starts);
+		optimize_overdraw(indices, cluster_starts, positions);
+		return optimize_vertex_fetch(indices, positions.size(), remap);
+	}
+}
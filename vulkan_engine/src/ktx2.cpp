@@ -0,0 +1,81 @@
+#include "ktx2.h"
+#include "textureCompression.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+namespace {
+	constexpr unsigned char IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	struct Header {
+		uint32_t vkFormat;
+		uint32_t typeSize;
+		uint32_t pixelWidth;
+		uint32_t pixelHeight;
+		uint32_t pixelDepth;
+		uint32_t layerCount;
+		uint32_t faceCount;
+		uint32_t levelCount; //0 asks the loader to generate the Mip Chain
+		uint32_t supercompressionScheme;
+	};
+
+	//Follows the Header after the Data Format Descriptor, Key/Value and Supercompression Global Data offsets
+	constexpr size_t LEVEL_INDEX_OFFSET = sizeof(IDENTIFIER) + sizeof(Header) + 4 * sizeof(uint32_t) + 2 * sizeof(uint64_t);
+
+	struct LevelIndex {
+		uint64_t byteOffset;
+		uint64_t byteLength;
+		uint64_t uncompressedByteLength;
+	};
+}
+
+namespace ktx2 {
+
+	bool is_ktx2(std::span<const unsigned char> bytes) {
+		return bytes.size() >= sizeof(IDENTIFIER) && memcmp(bytes.data(), IDENTIFIER, sizeof(IDENTIFIER)) == 0;
+	}
+
+	std::optional<Texture> read(std::span<const unsigned char> bytes) {
+		if (!is_ktx2(bytes) || bytes.size() < LEVEL_INDEX_OFFSET)
+			return std::nullopt;
+
+		Header header;
+		memcpy(&header, bytes.data() + sizeof(IDENTIFIER), sizeof(header));
+
+		VkFormat format = static_cast<VkFormat>(header.vkFormat);
+		if (header.supercompressionScheme != 0 || !texcompress::is_supported(format))
+			return std::nullopt;
+		if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1)
+			return std::nullopt;
+
+		uint32_t fullLevelCount = static_cast<uint32_t>(std::floor(std::log2(std::max(header.pixelWidth, header.pixelHeight)))) + 1;
+		uint32_t levelCount = std::max(header.levelCount, 1u);
+		if (levelCount > fullLevelCount || (texcompress::is_block_compressed(format) && levelCount != fullLevelCount))
+			return std::nullopt;
+		if (bytes.size() < LEVEL_INDEX_OFFSET + levelCount * sizeof(LevelIndex))
+			return std::nullopt;
+
+		Texture texture{};
+		texture.format = format;
+		texture.extent = { .width = header.pixelWidth, .height = header.pixelHeight, .depth = 1 };
+		texture.levelCount = levelCount;
+		texture.data.resize(texcompress::chain_size(format, header.pixelWidth, header.pixelHeight, levelCount));
+
+		//The file stores the smallest level first, but the Level Index lists level 0 first
+		size_t dstOffset = 0;
+		for (uint32_t level = 0; level < levelCount; level++) {
+			LevelIndex index;
+			memcpy(&index, bytes.data() + LEVEL_INDEX_OFFSET + level * sizeof(LevelIndex), sizeof(index));
+
+			uint64_t levelSize = texcompress::level_size(format, std::max(header.pixelWidth >> level, 1u), std::max(header.pixelHeight >> level, 1u));
+			if (index.byteLength != levelSize || index.byteOffset > bytes.size() || index.byteLength > bytes.size() - index.byteOffset)
+				return std::nullopt;
+
+			memcpy(texture.data.data() + dstOffset, bytes.data() + index.byteOffset, levelSize);
+			dstOffset += levelSize;
+		}
+
+		return texture;
+	}
+}
@@ -6,12 +6,41 @@
 #include <glm.hpp>
 #include <fastgltf/glm_element_traits.hpp> //Neccesarry to allow glm types to be used in fastgltf templates
 #include <stb_image.h>
+#include "textureCompression.h"
+#include "ktx2.h"
+#include "textureStreamer.h"
 #include <iostream>
+#include <fstream>
 #include <stack>
+#include <unordered_map>
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+static void report_progress(LoadProgress* progress, const char* stage, float fraction) {
+	if (progress != nullptr) {
+		progress->stage = stage;
+		progress->fraction = fraction;
+	}
+}
+
+void loadGLTFFile(VulkanContext& vkContext, ThreadPool& threadPool, GraphicsDataPayload& dataPayload, std::filesystem::path filePath, LoadProgress* progress) { 
+	//Use the Baked Cache of the file if it's still up to date
+	report_progress(progress, "Reading Cache", 0.0f);
+	std::filesystem::path cachePath = Baked::cache_path(filePath);
+	uint64_t sourceHash = Baked::hash_source(filePath);
+	//A cache holding Block Compressed Images is only usable where they're supported. Elsewhere the file is loaded again and cached uncompressed
+	std::optional<BakedSceneFile> bakedFile = BakedSceneFile::open(cachePath, sourceHash);
+	if (bakedFile && (vkContext.bcTextureSupported || std::ranges::none_of(bakedFile->images(), [](const Baked::Image& image) { return texcompress::is_block_compressed(static_cast<VkFormat>(image.format)); }))) {
+		load_baked_scene(vkContext, dataPayload, *bakedFile, progress);
+		return;
+	}
+
+	BakedSceneWriter bake; //Records everything loaded below to write the cache at the end
 
-void loadGLTFFile(VulkanContext& vkContext, GraphicsDataPayload& dataPayload, std::filesystem::path filePath) { 
 	//Parser and GLTF LOading Code
-	fastgltf::Parser parser;
+	report_progress(progress, "Parsing File", 0.0f);
+	fastgltf::Parser parser(fastgltf::Extensions::KHR_texture_basisu);
 
 	auto data = fastgltf::GltfDataBuffer::FromPath(filePath);
 	if (data.error() != fastgltf::Error::None)
@@ -45,29 +74,113 @@ void loadGLTFFile(VulkanContext& vkContext, GraphicsDataPayload& dataPayload, st
 		samplerInfo.mipmapMode = extract_mipmap_mode(sampler.minFilter.value_or(fastgltf::Filter::Nearest));
 		
 		temp_samplers[temp_samplers.size() - 1] = vkContext.create_sampler(samplerInfo);
+		bake.samplers.push_back({ .magFilter = samplerInfo.magFilter, .minFilter = samplerInfo.minFilter, .mipmapMode = samplerInfo.mipmapMode });
 	}
 
 	dataPayload.samplers.insert(dataPayload.samplers.end(), temp_samplers.begin(), temp_samplers.end()); //Add Samplers to Payload
 
 	//Load Images
+	//-Material slots each Image is sampled by, which pick its compressed format. A Texture's KTX2 Image and its fallback both get its slots
+	std::vector<uint32_t> image_roles(asset.images.size(), 0);
+	auto add_image_role = [&](size_t textureIndex, uint32_t role) {
+		const fastgltf::Texture& texture = asset.textures[textureIndex];
+		if (texture.imageIndex.has_value())
+			image_roles[texture.imageIndex.value()] |= role;
+		if (texture.basisuImageIndex.has_value())
+			image_roles[texture.basisuImageIndex.value()] |= role;
+	};
+	for (fastgltf::Material& mat : asset.materials) {
+		if (mat.normalTexture.has_value())
+			add_image_role(mat.normalTexture.value().textureIndex, texcompress::IMAGE_ROLE_NORMAL);
+		if (mat.occlusionTexture.has_value())
+			add_image_role(mat.occlusionTexture.value().textureIndex, texcompress::IMAGE_ROLE_OCCLUSION);
+		if (mat.emissiveTexture.has_value())
+			add_image_role(mat.emissiveTexture.value().textureIndex, texcompress::IMAGE_ROLE_COLOR);
+		if (mat.pbrData.baseColorTexture.has_value())
+			add_image_role(mat.pbrData.baseColorTexture.value().textureIndex, texcompress::IMAGE_ROLE_COLOR);
+		if (mat.pbrData.metallicRoughnessTexture.has_value())
+			add_image_role(mat.pbrData.metallicRoughnessTexture.value().textureIndex, texcompress::IMAGE_ROLE_METAL_ROUGH);
+	}
+
+	//-Decode every Image in parallel. Images to compress get their Mip Chain built on the CPU, as BC levels can't be generated on the GPU. The rest only upload the levels they have and the GPU generates the others once the uploads land.
+	//Streamed Images need their whole Mip Chain in the cache, as the Texture Streamer loads their levels from it, so the levels the GPU generated are read back for it
+	report_progress(progress, "Decoding Images", 0.1f);
+	std::vector<DecodedImage> decoded_images(asset.images.size());
+	std::vector<VkFormat> compressed_formats(asset.images.size(), VK_FORMAT_UNDEFINED); //BC format to compress each Image to, if any
+	std::atomic<size_t> decoded_count = 0;
+	threadPool.parallel_for(asset.images.size(), [&](size_t i) {
+		DecodedImage& decoded = decoded_images[i];
+		decoded = decode_image(asset, asset.images[i]);
+
+		if (texcompress::is_block_compressed(decoded.format) && !vkContext.bcTextureSupported) {
+			decoded = {}; //Counts as failed to load, so Textures use their fallback Image
+		}
+		else if (decoded.format == VK_FORMAT_R8G8B8A8_UNORM && !decoded.pixels.empty()) {
+			//Color Images are sRGB encoded, so the hardware decodes them to linear before filtering. KTX2 files state their own format
+			if (image_roles[i] & texcompress::IMAGE_ROLE_COLOR)
+				decoded.format = VK_FORMAT_R8G8B8A8_SRGB;
+
+			if (vkContext.bcTextureSupported) {
+				compressed_formats[i] = texcompress::choose_format(image_roles[i], texcompress::has_alpha(decoded.pixels.data(), static_cast<size_t>(decoded.extent.width) * decoded.extent.height));
+				if (texcompress::is_block_compressed(compressed_formats[i]))
+					build_mip_chain(decoded);
+			}
+		}
+		report_progress(progress, "Decoding Images", 0.1f + 0.3f * (++decoded_count) / asset.images.size());
+	});
+
+	report_progress(progress, "Compressing Images", 0.4f);
+	compress_images(threadPool, decoded_images, compressed_formats);
+	report_progress(progress, "Uploading Images", 0.6f);
+
+	//-Create and Upload the decoded Images. The uploads are staged and submitted together as one batch
 	std::vector<AllocatedImage> temp_images;
+	std::vector<uint32_t> temp_image_levels; //Levels uploaded for each Image
+	std::vector<int> image_payload_indices(asset.images.size(), -1); //Payload index of each of the file's Images, -1 if it failed to load
+	std::vector<size_t> readback_images; //Streamed Images cached with the Mip Chain the GPU generates, by index into temp_images and bake.images
 	temp_images.reserve(asset.images.size());
 
-	for (fastgltf::Image& image : asset.images) {
-		std::optional<AllocatedImage> img = load_image(vkContext, asset, image);
+	for (size_t i = 0; i < decoded_images.size(); i++) {
+		DecodedImage& decoded = decoded_images[i];
+		if (!decoded.pixels.empty()) {
+			const char* name = !asset.images[i].name.empty() ? asset.images[i].name.c_str() : "null_name";
+			uint32_t fullLevelCount = Baked::full_mip_count(decoded.extent.width, decoded.extent.height);
+			bool readBack = decoded.levelCount < fullLevelCount && TextureStreamer::is_streamed(decoded.extent) && !texcompress::is_block_compressed(decoded.format);
+			VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+			if (decoded.levelCount < fullLevelCount)
+				usage |= vkContext.mipmap_usage(decoded.format);
+			if (readBack)
+				usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+			AllocatedImage newImage = vkContext.create_image(name, decoded.extent, decoded.format, usage, true);
+			vkContext.update_image(newImage, decoded.pixels.data(), decoded.pixels.size(), mip_copy_regions(decoded.format, decoded.extent, decoded.levelCount));
+
+			if (readBack) {
+				//Its pixels are added once read back
+				bake.images.push_back({ .name = bake.add_string(asset.images[i].name), .width = decoded.extent.width, .height = decoded.extent.height, .levelCount = fullLevelCount, .format = decoded.format });
+				readback_images.push_back(temp_images.size());
+			}
+			else {
+				bake.images.push_back({ .name = bake.add_string(asset.images[i].name), .width = decoded.extent.width, .height = decoded.extent.height, .levelCount = decoded.levelCount, .format = decoded.format,
+					.dataOffset = bake.add_data(decoded.pixels.data(), decoded.pixels.size()), .dataSize = decoded.pixels.size() });
+			}
+			decoded.pixels = {};
 
-		if (img.has_value()) {
-			temp_images.push_back(img.value());
+			image_payload_indices[i] = static_cast<int>(textureImage_index_offset + temp_images.size());
+			temp_images.push_back(newImage);
+			temp_image_levels.push_back(decoded.levelCount);
 		}
 		else {
 			//Failed to Load Image, Store Error
-			std::cout << "GLTF Failed to Load Texture: " << image.name << std::endl;
+			std::cout << "GLTF Failed to Load Texture: " << asset.images[i].name << std::endl;
 		}
 	}
+	vkContext.submit_staged_uploads(); //Start the uploads now so they overlap the rest of the loading
 
 	dataPayload.images.insert(dataPayload.images.end(), temp_images.begin(), temp_images.end()); //Add Images to Payload
 
 	//Load Textures
+	report_progress(progress, "Loading Materials", 0.7f);
 	std::vector<std::shared_ptr<Texture>> temp_textures;
 	temp_textures.reserve(asset.textures.size());
 
@@ -75,11 +188,22 @@ void loadGLTFFile(VulkanContext& vkContext, GraphicsDataPayload& dataPayload, st
 		temp_textures.push_back(std::make_shared<Texture>());
 		int i = temp_textures.size() - 1;
 
+		//Prefer the KTX2 Image of KHR_texture_basisu, falling back to the core Image when it couldn't be loaded
+		int image_index = -1;
+		if (texture.basisuImageIndex.has_value())
+			image_index = image_payload_indices[texture.basisuImageIndex.value()];
+		if (image_index < 0 && texture.imageIndex.has_value())
+			image_index = image_payload_indices[texture.imageIndex.value()];
+
 		temp_textures[i]->name = texture.name;
-		if (texture.imageIndex.has_value())
-			temp_textures[i]->image_index = texture.imageIndex.value() + textureImage_index_offset; 
+		if (image_index >= 0)
+			temp_textures[i]->image_index = image_index;
 		if (texture.samplerIndex.has_value())
 			temp_textures[i]->sampler_index = texture.samplerIndex.value() + samplers_index_offset;
+
+		bake.textures.push_back({ .name = bake.add_string(texture.name),
+			.image_index = image_index >= 0 ? static_cast<int32_t>(image_index - textureImage_index_offset) : -1,
+			.sampler_index = texture.samplerIndex.has_value() ? static_cast<int32_t>(texture.samplerIndex.value()) : -1 });
 	}
 
 	dataPayload.textures.insert(dataPayload.textures.end(), temp_textures.begin(), temp_textures.end()); //Add Textures to Payload
@@ -129,11 +253,16 @@ void loadGLTFFile(VulkanContext& vkContext, GraphicsDataPayload& dataPayload, st
 		}
 		temp_materials[i]->metallic_Factor = mat.pbrData.metallicFactor;
 		temp_materials[i]->roughness_Factor = mat.pbrData.roughnessFactor;
+
+		temp_materials[i]->double_sided = mat.doubleSided;
+
+		bake.materials.push_back(bake_material(bake, *temp_materials[i], temp_textures));
 	}
 
 	dataPayload.materials.insert(dataPayload.materials.end(), temp_materials.begin(), temp_materials.end());
 
 	//Load Mesh Data
+	report_progress(progress, "Loading Meshes", 0.75f);
 	std::vector<std::shared_ptr<Mesh>> temp_meshes;
 	temp_meshes.reserve(asset.meshes.size());
 
@@ -142,6 +271,7 @@ void loadGLTFFile(VulkanContext& vkContext, GraphicsDataPayload& dataPayload, st
 		int i = temp_meshes.size() - 1;
 
 		temp_meshes[i]->name = mesh.name;
+		bake.meshes.push_back({ .name = bake.add_string(mesh.name), .firstPrimitive = static_cast<uint32_t>(bake.primitives.size()), .primitiveCount = static_cast<uint32_t>(mesh.primitives.size()) });
 
 		temp_meshes[i]->primitives.reserve(mesh.primitives.size());
 		for (auto&& p : mesh.primitives) {
@@ -158,82 +288,77 @@ void loadGLTFFile(VulkanContext& vkContext, GraphicsDataPayload& dataPayload, st
 			//Indices
 			if (p.indicesAccessor.has_value()) {
 				fastgltf::Accessor& index_accessor = asset.accessors[p.indicesAccessor.value()];
-				current_primitive.indices.reserve(index_accessor.count);
-
-				fastgltf::iterateAccessor<std::uint32_t>(asset, index_accessor,
-					[&](std::uint32_t idx) {
-						current_primitive.indices.push_back(idx);
-					});
+				current_primitive.indices.resize(index_accessor.count);
+				fastgltf::copyFromAccessor<std::uint32_t>(asset, index_accessor, current_primitive.indices.data());
 			}
 
-			//Vertex Positions
+			//Vertex Positions. Every other stream is sized to match
+			Mesh::Primitive::VertexStreams& streams = current_primitive.vertices;
 			auto position_attrib = p.findAttribute("POSITION");
 			if (position_attrib != p.attributes.end()) {
 				fastgltf::Accessor& pos_accessor = asset.accessors[position_attrib->accessorIndex];
-				
-				current_primitive.vertices.reserve(pos_accessor.count);
-				fastgltf::iterateAccessor<glm::vec3>(asset, pos_accessor,
-					[&](glm::vec3 pos) {
-						current_primitive.vertices.emplace_back();
-						current_primitive.vertices[current_primitive.vertices.size() - 1].position = pos;
-					});
+				streams.positions.resize(pos_accessor.count);
+				fastgltf::copyFromAccessor<glm::vec3>(asset, pos_accessor, streams.positions.data());
+
+				//Bounds. glTF requires min/max on positions, but fall back to fitting them if they're missing or in quantized units
+				if (pos_accessor.componentType == fastgltf::ComponentType::Float && pos_accessor.min.has_value() && pos_accessor.max.has_value() && pos_accessor.min->size() == 3 && pos_accessor.max->size() == 3) {
+					current_primitive.bounds_min = glm::vec3(pos_accessor.min->get<double>(0), pos_accessor.min->get<double>(1), pos_accessor.min->get<double>(2));
+					current_primitive.bounds_max = glm::vec3(pos_accessor.max->get<double>(0), pos_accessor.max->get<double>(1), pos_accessor.max->get<double>(2));
+				}
+				else {
+					current_primitive.compute_bounds();
+				}
 			}
+			size_t vertex_count = streams.positions.size();
+
+			//Copies a whole accessor straight into a stream. Missing or mismatched accessors leave the stream zeroed
+			auto copy_stream = [&]<typename T>(std::string_view attribName, std::vector<T>& stream) {
+				stream.assign(vertex_count, T(0.0f));
+				auto attrib = p.findAttribute(attribName);
+				if (attrib == p.attributes.end())
+					return false;
+
+				fastgltf::Accessor& accessor = asset.accessors[attrib->accessorIndex];
+				if (accessor.count != vertex_count) {
+					std::cout << std::format("GLTF Primitive Attribute {} has {} elements instead of {}", attribName, accessor.count, vertex_count) << std::endl;
+					return true;
+				}
+
+				fastgltf::copyFromAccessor<T>(asset, accessor, stream.data());
+				return true;
+			};
 
 			//Vertex Normals
-			auto normals_attrib = p.findAttribute("NORMAL");
-			if (normals_attrib != p.attributes.end()) {
-				fastgltf::iterateAccessorWithIndex<glm::vec3>(asset, asset.accessors[normals_attrib->accessorIndex],
-					[&](glm::vec3 norm, std::size_t idx) {
-						current_primitive.vertices[idx].normal = norm;
-					});
-			}
+			copy_stream("NORMAL", streams.normals);
 
 			//Vertex Tangents
-			auto tangents_attrib = p.findAttribute("TANGENT");
-			if (tangents_attrib != p.attributes.end()) {
-				fastgltf::iterateAccessorWithIndex<glm::vec4>(asset, asset.accessors[tangents_attrib->accessorIndex],
-					[&](glm::vec4 tan, std::size_t idx) {
-						current_primitive.vertices[idx].tangent = tan;
-					});
-			}
+			copy_stream("TANGENT", streams.tangents);
 
 			//UV Coords
-			int i = 0;
-			while(true) {
-				std::string attribName = "TEXCOORD_" + std::to_string(i);
-				auto uv_attrib = p.findAttribute(attribName);
-				if (uv_attrib != p.attributes.end()) {
-					fastgltf::iterateAccessorWithIndex<glm::vec2>(asset, asset.accessors[uv_attrib->accessorIndex],
-						[&](glm::vec2 uv, std::size_t idx) {
-							current_primitive.vertices[idx].uvs.push_back(uv);
-						});
-				}
-				else
+			for (int i = 0; ; i++) {
+				std::vector<glm::vec2> uvs;
+				if (!copy_stream("TEXCOORD_" + std::to_string(i), uvs))
 					break;
-
-				i++;
+				streams.uvs.push_back(std::move(uvs));
 			}
 
 			//Vertex Colors
-			i = 0;
-			while (true) {
-				std::string attribName = "COLOR_" + std::to_string(i);
-				auto color_attrib = p.findAttribute(attribName);
-				if (color_attrib != p.attributes.end()) {
-					fastgltf::iterateAccessorWithIndex<glm::vec3>(asset, asset.accessors[color_attrib->accessorIndex],
-						[&](glm::vec3 color, size_t idx) {
-							current_primitive.vertices[idx].colors.push_back(color);
-						});
-				}
-				else
+			for (int i = 0; ; i++) {
+				std::vector<glm::vec3> colors;
+				if (!copy_stream("COLOR_" + std::to_string(i), colors))
 					break;
-
-				i++;
+				streams.colors.push_back(std::move(colors));
 			}
+
+			current_primitive.optimize_geometry(dataPayload.vertexCache_before, dataPayload.vertexCache_after);
+			current_primitive.build_meshlets();
+
+			bake.primitives.push_back(bake_primitive(bake, current_primitive, p.materialIndex.has_value() ? static_cast<int32_t>(p.materialIndex.value()) : -1));
 		}
 	}
 
 	//Load Scene
+	report_progress(progress, "Loading Scenes", 0.9f);
 	size_t scenes_offset = dataPayload.scenes.size(); //Used as offset to scenes currently being added
 	for (int i = 0; i < asset.scenes.size(); i++) {
 		dataPayload.scenes.emplace_back();
@@ -241,6 +366,7 @@ void loadGLTFFile(VulkanContext& vkContext, GraphicsDataPayload& dataPayload, st
 		
 		if (asset.defaultScene.has_value() && i == asset.defaultScene.value()) { //Set Current/Default Scene from this file if it exists
 			dataPayload.current_scene_idx = scenes_offset + i;
+			bake.defaultScene = i;
 		}
 
 		scene.name = filePath.stem().string() + "_";
@@ -249,6 +375,9 @@ void loadGLTFFile(VulkanContext& vkContext, GraphicsDataPayload& dataPayload, st
 		else
 			scene.name += std::format("Scene{}", i);
 
+		Baked::Scene bakedScene{ .name = bake.add_string(scene.name), .firstNode = static_cast<uint32_t>(bake.nodes.size()), .nodeCount = 0 };
+		std::unordered_map<const Node*, int32_t> baked_node_indices; //Index of each loaded Node within the baked Scene
+
 		//Load Nodes. Perform DFS to get all the nodes in the scene
 		std::stack<size_t> DFS_node_index_stack; //Maps the correct nodes to traverse for DFS
 		std::stack<std::pair<std::shared_ptr<Node>, int>> DFS_node_parent_stack; //Tracks the correct parent node of the current node when traversing. Also keeps track of how many times the parent node will be used before it can be popped
@@ -285,6 +414,14 @@ void loadGLTFFile(VulkanContext& vkContext, GraphicsDataPayload& dataPayload, st
 
 			//Add Local Transform. Do it before adding children to prevent function from recursing
 			node->updateLocalTransform(translate_to_glm_mat4(fastgltf::getTransformMatrix(asset.nodes[node_index])));
+
+			//Parents are always visited before their children, which is the order the baked file expects
+			Baked::Node bakedNode{ .name = bake.add_string(node->name), .mesh_index = asset.nodes[node_index].meshIndex.has_value() ? static_cast<int32_t>(asset.nodes[node_index].meshIndex.value()) : -1, .parent_index = -1 };
+			if (std::shared_ptr<Node> parent = node->parent_node.lock())
+				bakedNode.parent_index = baked_node_indices[parent.get()];
+			memcpy(bakedNode.local_transform, &node->get_LocalTransform(), sizeof(bakedNode.local_transform));
+			baked_node_indices[node.get()] = bakedScene.nodeCount++;
+			bake.nodes.push_back(bakedNode);
 			
 			//Check if node has children, thus adding children to DFS idnex stack and the node itself to parent stack
 			if (!asset.nodes[node_index].children.empty()) {
@@ -294,7 +431,249 @@ void loadGLTFFile(VulkanContext& vkContext, GraphicsDataPayload& dataPayload, st
 				}
 			}
 		}
+
+		scene.transforms = TransformHierarchy::create(scene);
+
+		bake.scenes.push_back(bakedScene);
+	}
+
+	report_progress(progress, "Generating Mipmaps", 0.92f);
+	generate_loaded_mipmaps(vkContext, std::span(dataPayload.images).subspan(textureImage_index_offset, temp_images.size()), temp_image_levels);
+
+	std::vector<std::vector<unsigned char>> mip_chains = read_mip_chains(vkContext, std::span(dataPayload.images).subspan(textureImage_index_offset, temp_images.size()), readback_images);
+	for (size_t i = 0; i < readback_images.size(); i++) {
+		Baked::Image& bakedImage = bake.images[readback_images[i]];
+		bakedImage.dataOffset = bake.add_data(mip_chains[i].data(), mip_chains[i].size());
+		bakedImage.dataSize = mip_chains[i].size();
+	}
+	mip_chains = {};
+
+	//Cache the loaded file so the next load of it can skip parsing and decoding
+	report_progress(progress, "Writing Cache", 0.95f);
+	if (!bake.write(cachePath, sourceHash)) {
+		std::cout << std::format("Failed to write Baked Scene Cache: {}", cachePath.string()) << std::endl;
+	}
+	else if (std::optional<BakedSceneFile> writtenFile = BakedSceneFile::open(cachePath, sourceHash)) {
+		//The large Images were uploaded whole, and are streamed from the written cache from now on
+		add_streamed_images(dataPayload, *writtenFile, textureImage_index_offset, std::vector<uint32_t>(writtenFile->images().size(), 0));
+	}
+
+	report_progress(progress, "Done", 1.0f);
+}
+
+void load_baked_scene(VulkanContext& vkContext, GraphicsDataPayload& dataPayload, const BakedSceneFile& bakedFile, LoadProgress* progress) {
+	size_t textureImage_index_offset = dataPayload.images.size();
+	size_t samplers_index_offset = dataPayload.samplers.size();
+
+	//Load Texture Samplers
+	for (const Baked::Sampler& sampler : bakedFile.samplers()) {
+		VkSamplerCreateInfo samplerInfo{};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.pNext = nullptr;
+		samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+		samplerInfo.minLod = 0;
+		samplerInfo.magFilter = static_cast<VkFilter>(sampler.magFilter);
+		samplerInfo.minFilter = static_cast<VkFilter>(sampler.minFilter);
+		samplerInfo.mipmapMode = static_cast<VkSamplerMipmapMode>(sampler.mipmapMode);
+
+		dataPayload.samplers.push_back(vkContext.create_sampler(samplerInfo));
+	}
+
+	//Load Images. The pixels are staged straight from the mapped file with the Mip Levels it holds. Streamed Images only load their tail, the Texture Streamer loads finer levels once they're sampled
+	report_progress(progress, "Uploading Images", 0.1f);
+	std::vector<uint32_t> image_levels;
+	std::vector<uint32_t> resident_levels;
+	for (const Baked::Image& image : bakedFile.images()) {
+		std::string name = bakedFile.string(image.name);
+		VkExtent3D extent{ .width = image.width, .height = image.height, .depth = 1 };
+		VkFormat format = static_cast<VkFormat>(image.format);
+
+		uint32_t residentLevel = is_streamed_image(image) ? TextureStreamer::tail_level(extent) : 0;
+		VkExtent3D residentExtent{ .width = std::max(image.width >> residentLevel, 1u), .height = std::max(image.height >> residentLevel, 1u), .depth = 1 };
+		uint64_t residentOffset = texcompress::chain_size(format, image.width, image.height, residentLevel);
+		uint64_t residentSize = image.dataSize - residentOffset;
+
+		VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		if (image.levelCount < Baked::full_mip_count(image.width, image.height))
+			usage |= vkContext.mipmap_usage(format);
+
+		AllocatedImage newImage = vkContext.create_image(!name.empty() ? name.c_str() : "null_name", residentExtent, format, usage, true);
+		vkContext.update_image(newImage, bakedFile.data<std::byte>(image.dataOffset + residentOffset, residentSize).data(), residentSize, mip_copy_regions(format, residentExtent, image.levelCount - residentLevel));
+
+		dataPayload.images.push_back(newImage);
+		image_levels.push_back(image.levelCount - residentLevel);
+		resident_levels.push_back(residentLevel);
+	}
+	add_streamed_images(dataPayload, bakedFile, textureImage_index_offset, resident_levels);
+	vkContext.submit_staged_uploads(); //Start the uploads now so they overlap the rest of the loading
+
+	//Load Textures
+	report_progress(progress, "Loading Materials", 0.6f);
+	std::vector<std::shared_ptr<Texture>> temp_textures;
+	temp_textures.reserve(bakedFile.textures().size());
+
+	for (const Baked::Texture& bakedTexture : bakedFile.textures()) {
+		std::shared_ptr<Texture> texture = std::make_shared<Texture>();
+		texture->name = bakedFile.string(bakedTexture.name);
+		if (bakedTexture.image_index >= 0)
+			texture->image_index = bakedTexture.image_index + textureImage_index_offset;
+		if (bakedTexture.sampler_index >= 0)
+			texture->sampler_index = bakedTexture.sampler_index + samplers_index_offset;
+
+		temp_textures.push_back(texture);
+	}
+
+	dataPayload.textures.insert(dataPayload.textures.end(), temp_textures.begin(), temp_textures.end());
+
+	//Load Materials
+	auto baked_texture = [&](int32_t index) { return index >= 0 ? temp_textures[index] : std::shared_ptr<Texture>(); };
+
+	std::vector<std::shared_ptr<Material>> temp_materials;
+	temp_materials.reserve(bakedFile.materials().size());
+
+	for (const Baked::Material& bakedMaterial : bakedFile.materials()) {
+		std::shared_ptr<Material> material = std::make_shared<Material>();
+		material->name = bakedFile.string(bakedMaterial.name);
+
+		material->normal_texture = baked_texture(bakedMaterial.normal_texture);
+		material->normal_coord_index = bakedMaterial.normal_coord_index;
+		material->normal_scale = bakedMaterial.normal_scale;
+
+		material->occlusion_texture = baked_texture(bakedMaterial.occlusion_texture);
+		material->occlusion_coord_index = bakedMaterial.occlusion_coord_index;
+		material->occlusion_strength = bakedMaterial.occlusion_strength;
+
+		material->emission_texture = baked_texture(bakedMaterial.emission_texture);
+		material->emission_coord_index = bakedMaterial.emission_coord_index;
+		material->emission_Factor = glm::vec3(bakedMaterial.emission_Factor[0], bakedMaterial.emission_Factor[1], bakedMaterial.emission_Factor[2]);
+
+		material->baseColor_texture = baked_texture(bakedMaterial.baseColor_texture);
+		material->baseColor_coord_index = bakedMaterial.baseColor_coord_index;
+		material->baseColor_Factor = glm::vec4(bakedMaterial.baseColor_Factor[0], bakedMaterial.baseColor_Factor[1], bakedMaterial.baseColor_Factor[2], bakedMaterial.baseColor_Factor[3]);
+
+		material->metal_rough_texture = baked_texture(bakedMaterial.metal_rough_texture);
+		material->metal_rough_coord_index = bakedMaterial.metal_rough_coord_index;
+		material->metallic_Factor = bakedMaterial.metallic_Factor;
+		material->roughness_Factor = bakedMaterial.roughness_Factor;
+
+		material->double_sided = bakedMaterial.double_sided != 0;
+
+		temp_materials.push_back(material);
+	}
+
+	dataPayload.materials.insert(dataPayload.materials.end(), temp_materials.begin(), temp_materials.end());
+
+	//Load Mesh Data. Primitives point straight into the mapped file instead of copying their vertices
+	report_progress(progress, "Loading Meshes", 0.7f);
+	std::vector<std::shared_ptr<Mesh>> temp_meshes;
+	temp_meshes.reserve(bakedFile.meshes().size());
+
+	for (const Baked::Mesh& bakedMesh : bakedFile.meshes()) {
+		std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+		mesh->name = bakedFile.string(bakedMesh.name);
+
+		mesh->primitives.resize(bakedMesh.primitiveCount);
+		for (uint32_t i = 0; i < bakedMesh.primitiveCount; i++) {
+			const Baked::Primitive& bakedPrimitive = bakedFile.primitives()[bakedMesh.firstPrimitive + i];
+			Mesh::Primitive& primitive = mesh->primitives[i];
+
+			primitive.topology = static_cast<VkPrimitiveTopology>(bakedPrimitive.topology);
+			if (bakedPrimitive.material_index >= 0)
+				primitive.material = temp_materials[bakedPrimitive.material_index];
+
+			primitive.gpu_geometry.owner = bakedFile.mapping();
+			primitive.gpu_geometry.positions = bakedFile.data<glm::vec3>(bakedPrimitive.positionsOffset, bakedPrimitive.vertexCount);
+			primitive.gpu_geometry.attributes = bakedFile.data<RenderShader::VertexAttributes>(bakedPrimitive.attributesOffset, bakedPrimitive.vertexCount);
+			primitive.gpu_geometry.indices = bakedFile.data<uint32_t>(bakedPrimitive.indicesOffset, bakedPrimitive.indexCount);
+			primitive.bounds_min = glm::vec3(bakedPrimitive.bounds_min[0], bakedPrimitive.bounds_min[1], bakedPrimitive.bounds_min[2]);
+			primitive.bounds_max = glm::vec3(bakedPrimitive.bounds_max[0], bakedPrimitive.bounds_max[1], bakedPrimitive.bounds_max[2]);
+			primitive.build_meshlets();
+		}
+
+		temp_meshes.push_back(mesh);
+	}
+
+	//Load Scenes
+	report_progress(progress, "Loading Scenes", 0.9f);
+	size_t scenes_offset = dataPayload.scenes.size();
+	for (size_t i = 0; i < bakedFile.scenes().size(); i++) {
+		const Baked::Scene& bakedScene = bakedFile.scenes()[i];
+		Scene& scene = dataPayload.scenes.emplace_back();
+		scene.name = bakedFile.string(bakedScene.name);
+
+		if (bakedFile.header().defaultScene == static_cast<int32_t>(i))
+			dataPayload.current_scene_idx = scenes_offset + i;
+
+		//Nodes are stored with parents first, so a Node's parent already exists when it's created
+		std::vector<std::shared_ptr<Node>> scene_nodes;
+		scene_nodes.reserve(bakedScene.nodeCount);
+		for (uint32_t j = 0; j < bakedScene.nodeCount; j++) {
+			const Baked::Node& bakedNode = bakedFile.nodes()[bakedScene.firstNode + j];
+			std::shared_ptr<Node> node = std::make_shared<Node>();
+			node->name = bakedFile.string(bakedNode.name);
+
+			if (bakedNode.mesh_index >= 0)
+				node->mesh = temp_meshes[bakedNode.mesh_index];
+
+			if (bakedNode.parent_index >= 0) {
+				scene_nodes[bakedNode.parent_index]->child_nodes.push_back(node);
+				node->parent_node = scene_nodes[bakedNode.parent_index];
+			}
+			else {
+				scene.root_nodes.push_back(node);
+			}
+
+			glm::mat4 local_transform;
+			memcpy(&local_transform, bakedNode.local_transform, sizeof(local_transform));
+			node->updateLocalTransform(local_transform);
+
+			scene_nodes.push_back(node);
+		}
+
+		scene.transforms = TransformHierarchy::create(scene);
 	}
+
+	report_progress(progress, "Generating Mipmaps", 0.95f);
+	generate_loaded_mipmaps(vkContext, std::span(dataPayload.images).subspan(textureImage_index_offset, image_levels.size()), image_levels);
+
+	report_progress(progress, "Done", 1.0f);
+}
+
+//Only Images whose whole Mip Chain is baked can be streamed, as the finer levels are read back from the file
+bool is_streamed_image(const Baked::Image& image) {
+	return image.levelCount == Baked::full_mip_count(image.width, image.height) && TextureStreamer::is_streamed({ .width = image.width, .height = image.height, .depth = 1 });
+}
+
+void add_streamed_images(GraphicsDataPayload& dataPayload, const BakedSceneFile& bakedFile, size_t textureImage_index_offset, std::span<const uint32_t> residentLevels) {
+	std::span<const Baked::Image> images = bakedFile.images();
+	for (size_t i = 0; i < images.size(); i++) {
+		const Baked::Image& image = images[i];
+		if (!is_streamed_image(image))
+			continue;
+
+		dataPayload.streamedImages.push_back({ .image_index = static_cast<uint32_t>(textureImage_index_offset + i), .mapping = bakedFile.mapping(), .dataOffset = bakedFile.header().data.offset + image.dataOffset,
+			.extent = { .width = image.width, .height = image.height, .depth = 1 }, .format = static_cast<VkFormat>(image.format), .levelCount = image.levelCount, .residentLevel = residentLevels[i] });
+	}
+}
+
+void merge_payload(GraphicsDataPayload& dstPayload, GraphicsDataPayload&& srcPayload) {
+	if (srcPayload.images.size() < dstPayload.images.size() || srcPayload.samplers.size() < dstPayload.samplers.size())
+		throw std::runtime_error("Merged Payload does not start with the destination Payload's Images and Samplers");
+
+	size_t scenes_offset = dstPayload.scenes.size();
+
+	//Only the Images and Samplers after the shared ones are new
+	dstPayload.samplers.insert(dstPayload.samplers.end(), srcPayload.samplers.begin() + dstPayload.samplers.size(), srcPayload.samplers.end());
+	dstPayload.images.insert(dstPayload.images.end(), srcPayload.images.begin() + dstPayload.images.size(), srcPayload.images.end());
+	dstPayload.textures.insert(dstPayload.textures.end(), srcPayload.textures.begin(), srcPayload.textures.end());
+	dstPayload.materials.insert(dstPayload.materials.end(), srcPayload.materials.begin(), srcPayload.materials.end());
+	dstPayload.scenes.insert(dstPayload.scenes.end(), std::make_move_iterator(srcPayload.scenes.begin()), std::make_move_iterator(srcPayload.scenes.end()));
+	dstPayload.streamedImages.insert(dstPayload.streamedImages.end(), std::make_move_iterator(srcPayload.streamedImages.begin()), std::make_move_iterator(srcPayload.streamedImages.end()));
+	dstPayload.vertexCache_before += srcPayload.vertexCache_before;
+	dstPayload.vertexCache_after += srcPayload.vertexCache_after;
+
+	if (!srcPayload.scenes.empty())
+		dstPayload.current_scene_idx = scenes_offset + srcPayload.current_scene_idx;
 }
 
 VkFilter extract_filter(fastgltf::Filter filter) {
@@ -350,67 +729,35 @@ glm::mat4 translate_to_glm_mat4(fastgltf::math::fmat4x4 gltf_mat4) {
 	return result_transform;
 }
 
-std::optional<AllocatedImage> load_image(VulkanContext& vkContext, fastgltf::Asset& asset, fastgltf::Image& image) {
-	AllocatedImage newImage{};
-	int width, height, nrChannels;
-	
-	const char* name;
-	if (!image.name.empty())
-		name = image.name.c_str();
-	else
-		name = "null_name";
+//Decodes an Image's data into 8-bit RGBA pixels, or takes the levels of a KTX2 file as they are. Only touches the asset, so it can run on any thread
+DecodedImage decode_image(fastgltf::Asset& asset, fastgltf::Image& image) {
+	DecodedImage decoded{};
+	std::vector<unsigned char> fileBytes; //Holds the bytes of Images stored in their own file
+	std::span<const unsigned char> bytes;
 
 	std::visit(fastgltf::visitor{
 		[](auto& arg) {
-			std::cout << "A load_images function encountered an unaccounted for DataSource type from its std::visit function." << std::endl;
+			std::cout << "A decode_image function encountered an unaccounted for DataSource type from its std::visit function." << std::endl;
 		},
 		[&](fastgltf::sources::URI& filePath) {
 			assert(filePath.fileByteOffset == 0);
 			assert(filePath.uri.isLocalPath());
 
 			const std::string path(filePath.uri.path().begin(), filePath.uri.path().end());
-			unsigned char* data = stbi_load(path.c_str(), &width, &height, &nrChannels, 4);
-
-			if (data) {
-				VkExtent3D imageSize;
-				imageSize.width = width;
-				imageSize.height = height;
-				imageSize.depth = 1;
-				newImage = vkContext.create_image(name, imageSize, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, false);
-				vkContext.update_image(newImage, data, imageSize.width * imageSize.height * imageSize.depth * 4);
-
-				stbi_image_free(data);
-			}
+			std::ifstream file(path, std::ios::binary | std::ios::ate);
+			if (!file.is_open())
+				return;
+
+			fileBytes.resize(static_cast<size_t>(file.tellg()));
+			file.seekg(0);
+			file.read(reinterpret_cast<char*>(fileBytes.data()), fileBytes.size());
+			bytes = fileBytes;
 		},
 		[&](fastgltf::sources::Array& array) {
-			unsigned char* data = stbi_load_from_memory(reinterpret_cast<unsigned char*>(&(array.bytes[0])), static_cast<int>(array.bytes.size()), &width, &height, &nrChannels, 4);
-
-			if (data) {
-				VkExtent3D imageSize;
-				imageSize.width = width;
-				imageSize.height = height;
-				imageSize.depth = 1;
-
-				newImage = vkContext.create_image(name, imageSize, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, false);
-				vkContext.update_image(newImage, data, imageSize.width * imageSize.height * imageSize.depth * 4);
-
-				stbi_image_free(data);
-			}
+			bytes = { reinterpret_cast<const unsigned char*>(array.bytes.data()), array.bytes.size() };
 		},
 		[&](fastgltf::sources::Vector& vector) {
-			unsigned char* data = stbi_load_from_memory(reinterpret_cast<unsigned char*>(&(vector.bytes[0])), static_cast<int>(vector.bytes.size()), &width, &height, &nrChannels, 4); //Potential Undefined Behavior points due to casting
-
-			if (data) {
-				VkExtent3D imageSize;
-				imageSize.width = width;
-				imageSize.height = height;
-				imageSize.depth = 1;
-
-				newImage = vkContext.create_image(name, imageSize, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, false);
-				vkContext.update_image(newImage, data, imageSize.width * imageSize.height * imageSize.depth * 4);
-
-				stbi_image_free(data);
-			}
+			bytes = { reinterpret_cast<const unsigned char*>(vector.bytes.data()), vector.bytes.size() }; //Potential Undefined Behavior points due to casting
 		},
 		[&](fastgltf::sources::BufferView& view) {
 			fastgltf::BufferView& bufferView = asset.bufferViews[view.bufferViewIndex];
@@ -419,26 +766,263 @@ std::optional<AllocatedImage> load_image(VulkanContext& vkContext, fastgltf::Ass
 			std::visit(fastgltf::visitor{
 				[](auto& arg) {},
 				[&](fastgltf::sources::Vector& vector) {
-					unsigned char* data = stbi_load_from_memory(reinterpret_cast<unsigned char*>(&(vector.bytes[0])) + bufferView.byteOffset, static_cast<int>(bufferView.byteLength), &width, &height, &nrChannels, 4); //Potential Undefined Behavior points due to casting
+					bytes = { reinterpret_cast<const unsigned char*>(vector.bytes.data()) + bufferView.byteOffset, bufferView.byteLength }; //Potential Undefined Behavior points due to casting
+				}
+				}, buffer.data);
+		}
+		}, image.data);
+
+	if (bytes.empty())
+		return decoded;
+
+	if (ktx2::is_ktx2(bytes)) {
+		if (std::optional<ktx2::Texture> texture = ktx2::read(bytes)) {
+			decoded.pixels = std::move(texture->data);
+			decoded.extent = texture->extent;
+			decoded.levelCount = texture->levelCount;
+			decoded.format = texture->format;
+		}
+		else {
+			std::cout << std::format("Image {} is a KTX2 file that can't be used directly (supercompressed or unsupported format)", image.name) << std::endl;
+		}
+		return decoded;
+	}
 
-					if (data) {
-						VkExtent3D imageSize;
-						imageSize.width = width;
-						imageSize.height = height;
-						imageSize.depth = 1;
+	int width, height, nrChannels;
+	unsigned char* pixels = stbi_load_from_memory(bytes.data(), static_cast<int>(bytes.size()), &width, &height, &nrChannels, 4);
+	if (pixels != nullptr) {
+		decoded.extent.width = width;
+		decoded.extent.height = height;
+		decoded.extent.depth = 1;
+		decoded.levelCount = 1;
+		decoded.pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+		stbi_image_free(pixels);
+	}
+
+	return decoded;
+}
+
+//Blits (or downsamples in Compute) every Image's Mip Levels past the uploaded ones, all in one Immediate submission that waits on the Images' staged uploads
+void generate_loaded_mipmaps(VulkanContext& vkContext, std::span<AllocatedImage> images, std::span<const uint32_t> uploadedLevels) {
+	bool missingLevels = false;
+	for (size_t i = 0; i < images.size(); i++)
+		missingLevels |= uploadedLevels[i] < Baked::full_mip_count(images[i].extent.width, images[i].extent.height);
+	if (!missingLevels)
+		return;
+
+	VkCommandBuffer cmd = vkContext.start_immediate_recording();
+	for (size_t i = 0; i < images.size(); i++) {
+		uint32_t levelCount = Baked::full_mip_count(images[i].extent.width, images[i].extent.height);
+		if (uploadedLevels[i] >= levelCount)
+			continue;
+
+		vkContext.generate_mipmaps(cmd, images[i], levelCount, 1, uploadedLevels[i]);
+		vkContext.transition_image(cmd, images[i], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
+	vkContext.submit_immediate_commands();
+}
+
+//Read back in one immediate submission, after the mipmaps have been generated
+std::vector<std::vector<unsigned char>> read_mip_chains(VulkanContext& vkContext, std::span<AllocatedImage> images, std::span<const size_t> indices) {
+	std::vector<std::vector<unsigned char>> chains(indices.size());
+	if (indices.empty())
+		return chains;
+
+	std::vector<AllocatedBuffer> readbacks;
+	readbacks.reserve(indices.size());
+	VkCommandBuffer cmd = vkContext.start_immediate_recording();
+	for (size_t i = 0; i < indices.size(); i++) {
+		AllocatedImage& image = images[indices[i]];
+		uint32_t levelCount = Baked::full_mip_count(image.extent.width, image.extent.height);
+		chains[i].resize(texcompress::chain_size(image.format, image.extent.width, image.extent.height, levelCount));
+
+		readbacks.push_back(vkContext.read_image(cmd, image, chains[i].size(), mip_copy_regions(image.format, image.extent, levelCount)));
+		vkContext.transition_image(cmd, image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
+	vkContext.submit_immediate_commands();
+
+	for (size_t i = 0; i < readbacks.size(); i++) {
+		VK_CHECK(vmaInvalidateAllocation(vkContext.allocator, readbacks[i].allocation, 0, VK_WHOLE_SIZE));
+		memcpy(chains[i].data(), readbacks[i].info.pMappedData, chains[i].size());
+		vkContext.destroy_buffer(readbacks[i]);
+	}
+	return chains;
+}
 
-						newImage = vkContext.create_image(name, imageSize, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, false);
-						vkContext.update_image(newImage, data, imageSize.width * imageSize.height * imageSize.depth * 4);
+//Appends every lower Mip Level to a decoded 8-bit RGBA Image, each a 2x2 box filter of the level above. SRGB Images are averaged in linear space, alpha never is
+void build_mip_chain(DecodedImage& image) {
+	if (image.pixels.empty() || texcompress::is_block_compressed(image.format))
+		return;
 
-						stbi_image_free(data);
-					}
+	bool srgb = image.format == VK_FORMAT_R8G8B8A8_SRGB;
+	std::array<float, 256> to_linear;
+	for (uint32_t value = 0; value < 256; value++) {
+		float c = value / 255.0f;
+		to_linear[value] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+	auto to_srgb = [](float c) {
+		c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+		return static_cast<unsigned char>(std::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f);
+	};
+
+	uint32_t levelCount = Baked::full_mip_count(image.extent.width, image.extent.height);
+	image.pixels.resize(texcompress::chain_size(image.format, image.extent.width, image.extent.height, levelCount));
+
+	size_t srcOffset = 0;
+	uint32_t srcWidth = image.extent.width;
+	uint32_t srcHeight = image.extent.height;
+	for (uint32_t level = 1; level < levelCount; level++) {
+		uint32_t dstWidth = std::max(srcWidth / 2, 1u);
+		uint32_t dstHeight = std::max(srcHeight / 2, 1u);
+		size_t dstOffset = srcOffset + static_cast<size_t>(srcWidth) * srcHeight * 4;
+
+		const unsigned char* src = image.pixels.data() + srcOffset;
+		unsigned char* dst = image.pixels.data() + dstOffset;
+		for (uint32_t y = 0; y < dstHeight; y++) {
+			uint32_t y0 = std::min(y * 2, srcHeight - 1);
+			uint32_t y1 = std::min(y * 2 + 1, srcHeight - 1);
+			for (uint32_t x = 0; x < dstWidth; x++) {
+				uint32_t x0 = std::min(x * 2, srcWidth - 1);
+				uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1);
+				for (uint32_t c = 0; c < 4; c++) {
+					unsigned char s00 = src[(y0 * srcWidth + x0) * 4 + c], s01 = src[(y0 * srcWidth + x1) * 4 + c], s10 = src[(y1 * srcWidth + x0) * 4 + c], s11 = src[(y1 * srcWidth + x1) * 4 + c];
+					if (srgb && c < 3)
+						dst[(y * dstWidth + x) * 4 + c] = to_srgb((to_linear[s00] + to_linear[s01] + to_linear[s10] + to_linear[s11]) / 4.0f);
+					else
+						dst[(y * dstWidth + x) * 4 + c] = static_cast<unsigned char>((s00 + s01 + s10 + s11 + 2) / 4);
 				}
-				}, buffer.data);
+			}
 		}
-		}, image.data);
 
-	if (newImage.image == VK_NULL_HANDLE)
-		return {};
-	else
-		return newImage;
-}
\ No newline at end of file
+		srcOffset = dstOffset;
+		srcWidth = dstWidth;
+		srcHeight = dstHeight;
+	}
+
+	image.levelCount = levelCount;
+}
+
+//Splits every level into bands of block rows so one large Image doesn't leave the rest of the pool idle, then swaps each Image's pixels for its blocks
+void compress_images(ThreadPool& threadPool, std::span<DecodedImage> images, std::span<const VkFormat> formats) {
+	constexpr uint32_t BAND_ROWS = 16; //Block rows encoded per task
+
+	struct Band {
+		size_t image;
+		uint32_t width, height;
+		size_t srcOffset, dstOffset;
+		uint32_t firstRow, rowCount;
+	};
+
+	std::vector<Band> bands;
+	std::vector<std::vector<unsigned char>> compressed(images.size());
+	for (size_t i = 0; i < images.size(); i++) {
+		const DecodedImage& image = images[i];
+		if (image.pixels.empty() || texcompress::is_block_compressed(image.format) || !texcompress::is_block_compressed(formats[i]))
+			continue;
+
+		compressed[i].resize(texcompress::chain_size(formats[i], image.extent.width, image.extent.height, image.levelCount));
+
+		size_t srcOffset = 0, dstOffset = 0;
+		for (uint32_t level = 0; level < image.levelCount; level++) {
+			uint32_t width = std::max(image.extent.width >> level, 1u);
+			uint32_t height = std::max(image.extent.height >> level, 1u);
+			uint32_t blockRows = (height + texcompress::BLOCK_DIM - 1) / texcompress::BLOCK_DIM;
+			for (uint32_t row = 0; row < blockRows; row += BAND_ROWS)
+				bands.push_back({ .image = i, .width = width, .height = height, .srcOffset = srcOffset, .dstOffset = dstOffset, .firstRow = row, .rowCount = std::min(BAND_ROWS, blockRows - row) });
+
+			srcOffset += texcompress::level_size(image.format, width, height);
+			dstOffset += texcompress::level_size(formats[i], width, height);
+		}
+	}
+
+	threadPool.parallel_for(bands.size(), [&](size_t b) {
+		const Band& band = bands[b];
+		texcompress::encode_rows(formats[band.image], images[band.image].pixels.data() + band.srcOffset, band.width, band.height, band.firstRow, band.rowCount, compressed[band.image].data() + band.dstOffset);
+	});
+
+	for (size_t i = 0; i < images.size(); i++) {
+		if (compressed[i].empty())
+			continue;
+		images[i].pixels = std::move(compressed[i]);
+		images[i].format = formats[i];
+	}
+}
+
+std::vector<VkBufferImageCopy> mip_copy_regions(VkFormat format, VkExtent3D extent, uint32_t levelCount) {
+	std::vector<VkBufferImageCopy> copyRegions(levelCount);
+
+	VkDeviceSize offset = 0;
+	for (uint32_t level = 0; level < levelCount; level++) {
+		VkExtent3D levelExtent{ .width = std::max(extent.width >> level, 1u), .height = std::max(extent.height >> level, 1u), .depth = 1 };
+
+		VkBufferImageCopy& copyRegion = copyRegions[level];
+		copyRegion.bufferOffset = offset;
+		copyRegion.bufferRowLength = 0;
+		copyRegion.bufferImageHeight = 0;
+
+		copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		copyRegion.imageSubresource.mipLevel = level;
+		copyRegion.imageSubresource.baseArrayLayer = 0;
+		copyRegion.imageSubresource.layerCount = 1;
+		copyRegion.imageExtent = levelExtent;
+
+		offset += texcompress::level_size(format, levelExtent.width, levelExtent.height);
+	}
+
+	return copyRegions;
+}
+
+//Converts a loaded Primitive's Vertex Streams to the layout the Render Shader reads and stores them with its Indices in the bake
+Baked::Primitive bake_primitive(BakedSceneWriter& bake, const Mesh::Primitive& primitive, int32_t material_index) {
+	std::vector<RenderShader::VertexAttributes> attributes;
+	primitive.append_vertex_attributes(attributes);
+	const std::vector<glm::vec3>& positions = primitive.vertices.positions;
+
+	Baked::Primitive bakedPrimitive{};
+	bakedPrimitive.topology = primitive.topology;
+	bakedPrimitive.material_index = material_index;
+	bakedPrimitive.vertexCount = static_cast<uint32_t>(positions.size());
+	bakedPrimitive.indexCount = static_cast<uint32_t>(primitive.indices.size());
+	bakedPrimitive.positionsOffset = bake.add_data(positions.data(), positions.size() * sizeof(glm::vec3));
+	bakedPrimitive.attributesOffset = bake.add_data(attributes.data(), attributes.size() * sizeof(RenderShader::VertexAttributes));
+	bakedPrimitive.indicesOffset = bake.add_data(primitive.indices.data(), primitive.indices.size() * sizeof(uint32_t));
+	for (int axis = 0; axis < 3; axis++) {
+		bakedPrimitive.bounds_min[axis] = primitive.bounds_min[axis];
+		bakedPrimitive.bounds_max[axis] = primitive.bounds_max[axis];
+	}
+	return bakedPrimitive;
+}
+
+Baked::Material bake_material(BakedSceneWriter& bake, const Material& material, const std::vector<std::shared_ptr<Texture>>& textures) {
+	auto texture_index = [&](const std::weak_ptr<Texture>& texture) {
+		auto it = std::find(textures.begin(), textures.end(), texture.lock());
+		return it != textures.end() && *it != nullptr ? static_cast<int32_t>(it - textures.begin()) : -1;
+	};
+
+	Baked::Material bakedMaterial{};
+	bakedMaterial.name = bake.add_string(material.name);
+
+	bakedMaterial.normal_texture = texture_index(material.normal_texture);
+	bakedMaterial.normal_coord_index = material.normal_coord_index;
+	bakedMaterial.normal_scale = material.normal_scale;
+
+	bakedMaterial.occlusion_texture = texture_index(material.occlusion_texture);
+	bakedMaterial.occlusion_coord_index = material.occlusion_coord_index;
+	bakedMaterial.occlusion_strength = material.occlusion_strength;
+
+	bakedMaterial.emission_texture = texture_index(material.emission_texture);
+	bakedMaterial.emission_coord_index = material.emission_coord_index;
+	memcpy(bakedMaterial.emission_Factor, &material.emission_Factor, sizeof(bakedMaterial.emission_Factor));
+
+	bakedMaterial.baseColor_texture = texture_index(material.baseColor_texture);
+	bakedMaterial.baseColor_coord_index = material.baseColor_coord_index;
+	memcpy(bakedMaterial.baseColor_Factor, &material.baseColor_Factor, sizeof(bakedMaterial.baseColor_Factor));
+
+	bakedMaterial.metal_rough_texture = texture_index(material.metal_rough_texture);
+	bakedMaterial.metal_rough_coord_index = material.metal_rough_coord_index;
+	bakedMaterial.metallic_Factor = material.metallic_Factor;
+	bakedMaterial.roughness_Factor = material.roughness_Factor;
+
+	bakedMaterial.double_sided = material.double_sided ? 1 : 0;
+	return bakedMaterial;
+}
@@ -0,0 +1,68 @@
+#include "mappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+	if (_data != nullptr)
+		UnmapViewOfFile(_data);
+	if (_mappingHandle != nullptr)
+		CloseHandle(_mappingHandle);
+	if (_fileHandle != nullptr && _fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(_fileHandle);
+#else
+	if (_data != nullptr)
+		munmap(const_cast<std::byte*>(_data), _size);
+	if (_fileDescriptor >= 0)
+		close(_fileDescriptor);
+#endif
+}
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::filesystem::path& filePath) {
+	std::shared_ptr<MappedFile> mappedFile(new MappedFile());
+
+#ifdef _WIN32
+	mappedFile->_fileHandle = CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (mappedFile->_fileHandle == INVALID_HANDLE_VALUE)
+		return nullptr;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(mappedFile->_fileHandle, &fileSize) || fileSize.QuadPart == 0)
+		return nullptr;
+	mappedFile->_size = static_cast<size_t>(fileSize.QuadPart);
+
+	mappedFile->_mappingHandle = CreateFileMappingW(mappedFile->_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappedFile->_mappingHandle == nullptr)
+		return nullptr;
+
+	mappedFile->_data = static_cast<const std::byte*>(MapViewOfFile(mappedFile->_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	if (mappedFile->_data == nullptr)
+		return nullptr;
+#else
+	mappedFile->_fileDescriptor = ::open(filePath.c_str(), O_RDONLY);
+	if (mappedFile->_fileDescriptor < 0)
+		return nullptr;
+
+	struct stat fileStat;
+	if (fstat(mappedFile->_fileDescriptor, &fileStat) != 0 || fileStat.st_size == 0)
+		return nullptr;
+	mappedFile->_size = static_cast<size_t>(fileStat.st_size);
+
+	void* mapping = mmap(nullptr, mappedFile->_size, PROT_READ, MAP_PRIVATE, mappedFile->_fileDescriptor, 0);
+	if (mapping == MAP_FAILED)
+		return nullptr;
+	mappedFile->_data = static_cast<const std::byte*>(mapping);
+	madvise(mapping, mappedFile->_size, MADV_SEQUENTIAL);
+#endif
+
+	return mappedFile;
+}
@@ -0,0 +1,114 @@
+#include "meshlet.h"
+
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+
+namespace {
+	using MeshShader::Meshlet;
+
+	constexpr uint8_t UNASSIGNED = 0xFF; //Vertex not in the Meshlet being built
+
+	//Bounding Sphere around the center of the vertices' box, and a Normal Cone around the area weighted average of the triangles' normals
+	void compute_bounds(Meshlet& bounds, const uint32_t* vertices, const uint32_t* triangles, std::span<const glm::vec3> positions) {
+		glm::vec3 boxMin(FLT_MAX);
+		glm::vec3 boxMax(-FLT_MAX);
+		for (uint32_t i = 0; i < bounds.vertex_count; i++) {
+			boxMin = glm::min(boxMin, positions[vertices[i]]);
+			boxMax = glm::max(boxMax, positions[vertices[i]]);
+		}
+
+		bounds.center = (boxMin + boxMax) * 0.5f;
+		bounds.radius = 0.0f;
+		for (uint32_t i = 0; i < bounds.vertex_count; i++)
+			bounds.radius = std::max(bounds.radius, glm::length(positions[vertices[i]] - bounds.center));
+
+		glm::vec3 normals[meshlet::MAX_TRIANGLES];
+		uint32_t normalCount = 0;
+		glm::vec3 axis(0.0f);
+		for (uint32_t i = 0; i < bounds.triangle_count; i++) {
+			const glm::vec3& p0 = positions[vertices[triangles[i] & 0xFF]];
+			const glm::vec3& p1 = positions[vertices[(triangles[i] >> 8) & 0xFF]];
+			const glm::vec3& p2 = positions[vertices[(triangles[i] >> 16) & 0xFF]];
+
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0); //Length is twice the area
+			float length = glm::length(normal);
+			if (length <= 0.0f) //Degenerate triangles face nowhere
+				continue;
+
+			axis += normal;
+			normals[normalCount++] = normal / length;
+		}
+
+		float axisLength = glm::length(axis);
+		if (normalCount == 0 || axisLength <= 0.0f) {
+			bounds.cone_axis = glm::vec3(0.0f, 0.0f, 1.0f);
+			bounds.cone_cutoff = 1.0f;
+			return;
+		}
+
+		bounds.cone_axis = axis / axisLength;
+		float minDot = 1.0f;
+		for (uint32_t i = 0; i < normalCount; i++)
+			minDot = std::min(minDot, glm::dot(normals[i], bounds.cone_axis));
+
+		//The normals lie within acos(minDot) of the axis, so every triangle faces away from views within 90 - acos(minDot) degrees of it, whose cosine is sin(acos(minDot))
+		bounds.cone_cutoff = minDot <= 0.0f ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+	}
+}
+
+namespace meshlet {
+
+	void build(std::span<const uint32_t> indices, std::span<const glm::vec3> positions, std::vector<MeshShader::Meshlet>& meshlets, std::vector<uint32_t>& data) {
+		std::vector<uint8_t> localIndices(positions.size(), UNASSIGNED); //Index of each vertex within the Meshlet being built
+		std::vector<uint32_t> vertices;
+		std::vector<uint32_t> triangles;
+		vertices.reserve(MAX_VERTICES);
+		triangles.reserve(MAX_TRIANGLES);
+
+		auto flush = [&]() {
+			if (triangles.empty())
+				return;
+
+			Meshlet meshlet{};
+			meshlet.data_offset = static_cast<uint32_t>(data.size());
+			meshlet.vertex_count = static_cast<uint32_t>(vertices.size());
+			meshlet.triangle_count = static_cast<uint32_t>(triangles.size());
+			compute_bounds(meshlet, vertices.data(), triangles.data(), positions);
+
+			data.insert(data.end(), vertices.begin(), vertices.end());
+			data.insert(data.end(), triangles.begin(), triangles.end());
+			meshlets.push_back(meshlet);
+
+			for (uint32_t vertex : vertices)
+				localIndices[vertex] = UNASSIGNED;
+			vertices.clear();
+			triangles.clear();
+		};
+
+		auto local_index = [&](uint32_t vertex) -> uint32_t {
+			if (localIndices[vertex] == UNASSIGNED) {
+				localIndices[vertex] = static_cast<uint8_t>(vertices.size());
+				vertices.push_back(vertex);
+			}
+			return localIndices[vertex];
+		};
+
+		for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+			uint32_t a = indices[i];
+			uint32_t b = indices[i + 1];
+			uint32_t c = indices[i + 2];
+			if (a >= positions.size() || b >= positions.size() || c >= positions.size())
+				continue;
+
+			//Start a new Meshlet when the triangle's new vertices or the triangle itself don't fit
+			uint32_t newVertices = (localIndices[a] == UNASSIGNED) + (localIndices[b] == UNASSIGNED && b != a) + (localIndices[c] == UNASSIGNED && c != a && c != b);
+			if (vertices.size() + newVertices > MAX_VERTICES || triangles.size() == MAX_TRIANGLES)
+				flush();
+
+			triangles.push_back(local_index(a) | (local_index(b) << 8) | (local_index(c) << 16));
+		}
+
+		flush();
+	}
+}
@@ -36,7 +36,7 @@ VkPipeline PipelineBuilder::build_pipeline(VkDevice device) {
     colorBlending.pNext = nullptr;
     colorBlending.logicOpEnable = VK_FALSE;
     colorBlending.logicOp = VK_LOGIC_OP_COPY;
-    colorBlending.attachmentCount = 1;
+    colorBlending.attachmentCount = _renderInfo.colorAttachmentCount;
     colorBlending.pAttachments = &_colorBlendAttachment;
 
     VkGraphicsPipelineCreateInfo pipelineInfo{};
@@ -80,6 +80,20 @@ void PipelineBuilder::set_shaders(VkShaderModule vertexShader, VkShaderModule fr
     _shaderStages.push_back(vkutil::pipeline_shader_stage_create_info(VK_SHADER_STAGE_FRAGMENT_BIT, fragmentShader));
 }
 
+void PipelineBuilder::set_vertex_shader(VkShaderModule vertexShader) {
+    _shaderStages.clear();
+
+    _shaderStages.push_back(vkutil::pipeline_shader_stage_create_info(VK_SHADER_STAGE_VERTEX_BIT, vertexShader));
+}
+
+void PipelineBuilder::set_mesh_shaders(VkShaderModule taskShader, VkShaderModule meshShader, VkShaderModule fragmentShader) {
+    _shaderStages.clear();
+
+    _shaderStages.push_back(vkutil::pipeline_shader_stage_create_info(VK_SHADER_STAGE_TASK_BIT_EXT, taskShader));
+    _shaderStages.push_back(vkutil::pipeline_shader_stage_create_info(VK_SHADER_STAGE_MESH_BIT_EXT, meshShader));
+    _shaderStages.push_back(vkutil::pipeline_shader_stage_create_info(VK_SHADER_STAGE_FRAGMENT_BIT, fragmentShader));
+}
+
 void PipelineBuilder::set_vertex_input(std::vector<VkVertexInputBindingDescription>& bindingDescriptions, std::vector<VkVertexInputAttributeDescription>& attributeDescriptions) {
     _vertexInput.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
     _vertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
@@ -1,21 +1,30 @@
 #include "renderSystem.h"
 #include <iostream>
 #include <format>
-#include <stack>
+#include <bit>
+#include <algorithm>
 
 void RenderSystem::init(VkExtent2D windowExtent) {
 	init_swapchain(windowExtent);
 	init_frames();
 	init_vertexInput();
 	init_descriptorSet();
+	init_textureFeedback();
 	init_graphicsPipeline();
+	init_hiZPipeline();
+	init_cullPipelines();
+	init_clusterPipeline();
+	init_visBufferPipelines();
+	init_meshPipeline();
 
 	setup_depthImage();
+	setup_hiZImage();
+	setup_visBufferImages();
 
 	//temp code
 	_deviceBufferTypesCounter[DeviceBufferType::ViewProj] = 0;
 	_deviceBufferTypesCounter[DeviceBufferType::Indirect] = 0;
-	_deviceBufferTypesCounter[DeviceBufferType::PrimID] = 0;
+	_deviceBufferTypesCounter[DeviceBufferType::Instance] = 0;
 	_deviceBufferTypesCounter[DeviceBufferType::PrimInfo] = 0;
 	_deviceBufferTypesCounter[DeviceBufferType::Model] = 0;
 	_deviceBufferTypesCounter[DeviceBufferType::Index] = 0;
@@ -53,31 +62,73 @@ void RenderSystem::shutdown() {
 	//Depth Image
 	_vkContext.destroy_image(_depthImage);
 
+	//Hi-Z
+	destroy_hiZImage();
+	vkDestroyPipelineLayout(_vkContext.device, _hiZPipelineLayout, nullptr);
+	vkDestroyPipeline(_vkContext.device, _hiZPipeline, nullptr);
+	vkDestroyDescriptorSetLayout(_vkContext.device, _hiZDescriptorSetLayout, nullptr);
+	vkDestroyDescriptorPool(_vkContext.device, _hiZDescriptorPool, nullptr);
+	_vkContext.destroy_sampler(_hiZSampler);
+	_vkContext.destroy_buffer(_instanceVisibilityBuffer);
+
+	//Visibility Buffer
+	destroy_visBufferImages();
+	vkDestroyPipeline(_vkContext.device, _visibilityPipeline, nullptr);
+	vkDestroyPipelineLayout(_vkContext.device, _visBufferResolvePipelineLayout, nullptr);
+	vkDestroyPipeline(_vkContext.device, _visBufferResolvePipeline, nullptr);
+	vkDestroyDescriptorSetLayout(_vkContext.device, _visBufferDescriptorSetLayout, nullptr);
+	vkDestroyDescriptorPool(_vkContext.device, _visBufferDescriptorPool, nullptr);
+
+	//Mesh Shading
+	if (_meshPipeline != VK_NULL_HANDLE)
+		vkDestroyPipeline(_vkContext.device, _meshPipeline, nullptr);
+	vkDestroyPipelineLayout(_vkContext.device, _meshPipelineLayout, nullptr);
+
 	//Cleanup Pipeline
 	vkDestroyPipelineLayout(_vkContext.device, _pipelineLayout, nullptr);
 	vkDestroyPipeline(_vkContext.device, _pipeline, nullptr);
+	vkDestroyPipeline(_vkContext.device, _depthPrepassPipeline, nullptr);
+	vkDestroyPipeline(_vkContext.device, _prepassShadingPipeline, nullptr);
+	vkDestroyPipelineLayout(_vkContext.device, _cullPipelineLayout, nullptr);
+	vkDestroyPipeline(_vkContext.device, _cullInstancesPipeline, nullptr);
+	vkDestroyPipeline(_vkContext.device, _compactDrawsPipeline, nullptr);
+	vkDestroyPipelineLayout(_vkContext.device, _clusterPipelineLayout, nullptr);
+	vkDestroyPipeline(_vkContext.device, _assignLightsPipeline, nullptr);
 
 	//Cleanup Descriptor Stuff
 	vkDestroyDescriptorSetLayout(_vkContext.device, _descriptorSetLayout, nullptr);
 	vkDestroyDescriptorPool(_vkContext.device, _descriptorPool, nullptr);
 
+	//Texture Streaming Feedback
+	_vkContext.destroy_buffer(_textureFeedbackBuffer);
+
 	for (Frame& frame : _frames) {
 		vkDestroyCommandPool(_vkContext.device, frame.commandPool, nullptr);
 		vkDestroySemaphore(_vkContext.device, frame.renderSemaphore, nullptr);
 		vkDestroySemaphore(_vkContext.device, frame.swapchainSemaphore, nullptr);
 		vkDestroyFence(_vkContext.device, frame.renderFence, nullptr);
+		vkDestroyQueryPool(_vkContext.device, frame.timestampQueryPool, nullptr);
+		_vkContext.destroy_buffer(frame.textureFeedbackReadback);
 
 		_vkContext.destroy_buffer(frame.drawContext.indirectDrawCommandsBuffer);
+		_vkContext.destroy_buffer(frame.drawContext.culledIndirectDrawCommandsBuffer);
+		_vkContext.destroy_buffer(frame.drawContext.cullCountersBuffer);
+		_vkContext.destroy_buffer(frame.drawContext.visibleInstancesBuffer);
 		_vkContext.destroy_buffer(frame.drawContext.vertexPosBuffer);
 		_vkContext.destroy_buffer(frame.drawContext.vertexOtherAttribBuffer);
 		_vkContext.destroy_buffer(frame.drawContext.indexBuffer);
+		_vkContext.destroy_buffer(frame.drawContext.meshletsBuffer);
+		_vkContext.destroy_buffer(frame.drawContext.meshletDataBuffer);
+		_vkContext.destroy_buffer(frame.drawContext.meshletDrawsBuffer);
+		_vkContext.destroy_buffer(frame.drawContext.taskCommandsBuffer);
 		_vkContext.destroy_buffer(frame.drawContext.viewprojMatrixBuffer);
 		_vkContext.destroy_buffer(frame.drawContext.modelMatricesBuffer);
-		_vkContext.destroy_buffer(frame.drawContext.primitiveIdsBuffer);
+		_vkContext.destroy_buffer(frame.drawContext.instancesBuffer);
 		_vkContext.destroy_buffer(frame.drawContext.primitiveInfosBuffer);
 		_vkContext.destroy_buffer(frame.drawContext.materialsBuffer);
 		_vkContext.destroy_buffer(frame.drawContext.texturesBuffer);
 		_vkContext.destroy_buffer(frame.drawContext.lightsBuffer);
+		_vkContext.destroy_buffer(frame.drawContext.clusterLightsBuffer);
 		_vkContext.destroy_buffer(frame.drawContext.skybox_viewprojMatrixBuffer);
 	}
 
@@ -100,15 +151,15 @@ VkFormat RenderSystem::get_swapChainFormat() {
 void RenderSystem::init_swapchain(VkExtent2D windowExtent) {
 	vkb::SwapchainBuilder builder{ _vkContext.physicalDevice, _vkContext.device, _vkContext.surface };
 
-	_swapchain.format = VK_FORMAT_B8G8R8A8_UNORM; //Might change when needed to implement high precision stuff.
-
-	builder.set_desired_format(VkSurfaceFormatKHR{ .format = _swapchain.format, .colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR });
+	//Shaders write Linear colors and the hardware encodes them
+	builder.set_desired_format(VkSurfaceFormatKHR{ .format = VK_FORMAT_B8G8R8A8_SRGB, .colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR });
 	builder.set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR);
 	builder.set_desired_extent(windowExtent.width, windowExtent.height);
 	builder.add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT);
 
 	vkb::Swapchain vkbSwapchain = builder.build().value();
 
+	_swapchain.format = vkbSwapchain.image_format; //The surface may not support the desired format, in which case vk-bootstrap falls back to another
 	_swapchain.extent = vkbSwapchain.extent;
 	_swapchain.vkSwapchain = vkbSwapchain.swapchain;
 
@@ -139,6 +190,22 @@ void RenderSystem::init_frames() {
 	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 	semaphoreCreateInfo.pNext = nullptr;
 
+	//Timestamps are only usable if the queue records them
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(_vkContext.physicalDevice, &deviceProperties);
+	_timestampPeriod = deviceProperties.limits.timestampPeriod;
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(_vkContext.physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(_vkContext.physicalDevice, &queueFamilyCount, queueFamilies.data());
+	_timestampsSupported = queueFamilies[_vkContext.primaryQueueFamily].timestampValidBits > 0;
+
+	VkQueryPoolCreateInfo queryPoolInfo{};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = GEOMETRY_TIMESTAMP_COUNT;
+
 	for (int i = 0; i < FRAMES_TOTAL; i++) {
 		VK_CHECK(vkCreateCommandPool(_vkContext.device, &cmdPoolInfo, nullptr, &_frames[i].commandPool));
 
@@ -154,6 +221,7 @@ void RenderSystem::init_frames() {
 		VK_CHECK(vkCreateFence(_vkContext.device, &fenceCreateInfo, nullptr, &_frames[i].renderFence));
 		VK_CHECK(vkCreateSemaphore(_vkContext.device, &semaphoreCreateInfo, nullptr, &_frames[i].swapchainSemaphore));
 		VK_CHECK(vkCreateSemaphore(_vkContext.device, &semaphoreCreateInfo, nullptr, &_frames[i].renderSemaphore));
+		VK_CHECK(vkCreateQueryPool(_vkContext.device, &queryPoolInfo, nullptr, &_frames[i].timestampQueryPool));
 	}
 }
 
@@ -209,11 +277,16 @@ void RenderSystem::init_vertexInput() {
 }
 
 void RenderSystem::init_descriptorSet() {
+	uint32_t imageCapacity = BindlessRegistry::image_capacity(_vkContext.physicalDevice);
+	uint32_t samplerCapacity = BindlessRegistry::sampler_capacity(_vkContext.physicalDevice);
+	std::cout << std::format("Render System: Bindless capacity of {} Sampled Images and {} Samplers\n", imageCapacity, samplerCapacity);
+
 	//Create Descriptor Pool
 	std::vector<VkDescriptorPoolSize> poolSizes = {
-		{.type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, .descriptorCount = MAX_SAMPLED_IMAGE_COUNT },
-		{.type = VK_DESCRIPTOR_TYPE_SAMPLER, .descriptorCount = MAX_SAMPLER_COUNT },
-		{.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 3 }
+		{.type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, .descriptorCount = imageCapacity },
+		{.type = VK_DESCRIPTOR_TYPE_SAMPLER, .descriptorCount = samplerCapacity },
+		{.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 3 },
+		{.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1 }
 	};
 
 	VkDescriptorPoolCreateInfo poolInfo{};
@@ -229,16 +302,18 @@ void RenderSystem::init_descriptorSet() {
 	//Create Descriptor Set Layout for Descriptors
 	//-Set Layout Bindings
 	std::vector<VkDescriptorSetLayoutBinding> layout_bindings = {
-		{.binding = 0, .descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, .descriptorCount = MAX_SAMPLED_IMAGE_COUNT,
-		.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT, .pImmutableSamplers = nullptr },
-		{.binding = 1, .descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER, .descriptorCount = MAX_SAMPLER_COUNT,
-		.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT, .pImmutableSamplers = nullptr },
+		{.binding = 0, .descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, .descriptorCount = imageCapacity,
+		.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT, .pImmutableSamplers = nullptr },
+		{.binding = 1, .descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER, .descriptorCount = samplerCapacity,
+		.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT, .pImmutableSamplers = nullptr },
 		{.binding = 2, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1,
-		.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT, .pImmutableSamplers = nullptr },
+		.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT, .pImmutableSamplers = nullptr },
 		{.binding = 3, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1,
-		.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT, .pImmutableSamplers = nullptr },
+		.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT, .pImmutableSamplers = nullptr },
 		{.binding = 4, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1,
-		.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT, .pImmutableSamplers = nullptr },
+		.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT, .pImmutableSamplers = nullptr },
+		{.binding = 5, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1,
+		.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT, .pImmutableSamplers = nullptr },
 	};
 
 	//-Set Binding Flags
@@ -247,7 +322,8 @@ void RenderSystem::init_descriptorSet() {
 		VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT,
 		VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
 		VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
-		VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+		VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
+		0 //Texture Feedback Buffer, written once at init
 	};
 
 	VkDescriptorSetLayoutBindingFlagsCreateInfo set_binding_flags{};
@@ -275,6 +351,37 @@ void RenderSystem::init_descriptorSet() {
 
 	if (vkAllocateDescriptorSets(_vkContext.device, &allocInfo, &_descriptorSet) != VK_SUCCESS)
 		throw std::runtime_error("Failed to allocate Descriptor Set");
+
+	_bindless.init(_vkContext.device, _descriptorSet, imageCapacity, samplerCapacity);
+}
+
+//One uint per image slot the Bindless Registry can hand out, so the shading can index it with any Texture's image slot
+void RenderSystem::init_textureFeedback() {
+	size_t feedbackSize = sizeof(uint32_t) * BindlessRegistry::image_capacity(_vkContext.physicalDevice);
+
+	_textureFeedbackBuffer = _vkContext.create_buffer("Texture Feedback Buffer", feedbackSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0);
+
+	int i = 1;
+	for (Frame& frame : _frames) {
+		frame.textureFeedbackReadback = _vkContext.create_buffer(std::format("Texture Feedback Readback {}", i).c_str(), feedbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST, VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT);
+		i++;
+	}
+
+	VkDescriptorBufferInfo feedbackInfo{};
+	feedbackInfo.buffer = _textureFeedbackBuffer.buffer;
+	feedbackInfo.offset = 0;
+	feedbackInfo.range = VK_WHOLE_SIZE;
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = _descriptorSet;
+	descriptorWrite.dstBinding = 5;
+	descriptorWrite.dstArrayElement = 0;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pBufferInfo = &feedbackInfo;
+
+	vkUpdateDescriptorSets(_vkContext.device, 1, &descriptorWrite, 0, nullptr);
 }
 
 void RenderSystem::setup_drawContexts(const GraphicsDataPayload& payload) { 
@@ -293,42 +400,68 @@ void RenderSystem::setup_drawContexts(const GraphicsDataPayload& payload) {
 	size_t alloc_indirect_size = sizeof(VkDrawIndexedIndirectCommand) * renderData.indirect_commands.size();
 	size_t alloc_viewprojMatrix_size = sizeof(RenderShader::ViewProj);
 	size_t alloc_modelMatrices_size = sizeof(glm::mat4) * renderData.model_matrices.size();
-	size_t alloc_primIds_size = sizeof(int32_t) * renderData.primitiveIds.size();
+	size_t alloc_instances_size = sizeof(RenderShader::Instance) * renderData.instances.size();
 	size_t alloc_primInfo_size = sizeof(RenderShader::PrimitiveInfo) * renderData.primitiveInfos.size();
 	size_t alloc_materials_size = sizeof(RenderShader::Material) * renderData.materials.size();
 	size_t alloc_textures_size = sizeof(RenderShader::Texture) * renderData.textures.size();
-	size_t alloc_lights_size = sizeof(RenderShader::Lights);
+	size_t alloc_lights_size = sizeof(RenderShader::PointLight) * renderData.pointLights.size();
+	size_t alloc_meshlets_size = sizeof(MeshShader::Meshlet) * renderData.meshlets.size();
+	size_t alloc_meshletData_size = sizeof(uint32_t) * renderData.meshlet_data.size();
+	size_t alloc_meshletDraws_size = sizeof(MeshShader::MeshletDraw) * renderData.meshlet_draws.size();
+	size_t alloc_clusterLights_size = sizeof(uint32_t) * (CLUSTER_COUNT + CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER);
 	size_t alloc_skyboxViewprojMatrix_size = sizeof(SkyboxShader::ViewTransformMatrices);
 
+	//Instance Visibility Buffer. Shared by every frame
+	_instanceVisibilityBuffer = _vkContext.create_buffer("Instance Visibility Buffer", buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0);
+	VkBufferDeviceAddressInfo visibility_address_info{ .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO, .buffer = _instanceVisibilityBuffer.buffer };
+	_instanceVisibilityBufferAddress = vkGetBufferDeviceAddress(_vkContext.device, &visibility_address_info);
+	_resetInstanceVisibility = true;
+
 	int i = 1;
 	for (Frame& frame : _frames) {
 		DrawContext& currentDrawContext = frame.drawContext;
 		currentDrawContext.drawCount = renderData.indirect_commands.size();
+		currentDrawContext.instanceCount = renderData.instances.size();
+		currentDrawContext.visBufferTriangleBits = get_visBufferTriangleBits(renderData.indirect_commands);
+		currentDrawContext.pointLightCount = renderData.pointLights.size();
+		currentDrawContext.viewDepthRange = get_viewDepthRange(renderData.viewproj.proj);
 
-		//Draw Coommand and Vertex Input Buffers	
+		//Draw Coommand and Vertex Input Buffers. Vertex Input Buffers are also read through BDA by the Visibility Buffer Resolve
 		VmaAllocationCreateFlags allocFlags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_ALLOW_TRANSFER_INSTEAD_BIT;
-		currentDrawContext.indirectDrawCommandsBuffer = _vkContext.create_buffer(std::format("Indirect Draw Commands Buffer {}", i).c_str(), buffer_size, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, allocFlags);
-		currentDrawContext.vertexPosBuffer = _vkContext.create_buffer(std::format("Vertex Position Buffer {}", i).c_str(), buffer_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, allocFlags);
-		currentDrawContext.vertexOtherAttribBuffer = _vkContext.create_buffer(std::format("Vertex Other Attributes Buffer {}", i).c_str(), buffer_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, allocFlags);
-		currentDrawContext.indexBuffer = _vkContext.create_buffer(std::format("Index Buffer {}", i).c_str(), buffer_size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, allocFlags);
+		VkBufferUsageFlags vertexUsageFlags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		currentDrawContext.indirectDrawCommandsBuffer = _vkContext.create_buffer(std::format("Indirect Draw Commands Buffer {}", i).c_str(), buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, allocFlags); //Only read by the Culling Passes and the Visibility Buffer Resolve
+		currentDrawContext.vertexPosBuffer = _vkContext.create_buffer(std::format("Vertex Position Buffer {}", i).c_str(), buffer_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | vertexUsageFlags, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, allocFlags);
+		currentDrawContext.vertexOtherAttribBuffer = _vkContext.create_buffer(std::format("Vertex Other Attributes Buffer {}", i).c_str(), buffer_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | vertexUsageFlags, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, allocFlags);
+		currentDrawContext.indexBuffer = _vkContext.create_buffer(std::format("Index Buffer {}", i).c_str(), buffer_size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | vertexUsageFlags, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, allocFlags);
 		
 		//BDA Buffers
 		VkBufferUsageFlags storageUsageFlags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
 		currentDrawContext.viewprojMatrixBuffer = _vkContext.create_buffer(std::format("View and Projection Matrix Buffer {}", i).c_str(), buffer_size, storageUsageFlags, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, allocFlags); //Careful as if the alloc size is 0. Will cause errors. Also Note: Some of these buffers are not dynamic, thus dont need to use buffer_size variable
 		currentDrawContext.modelMatricesBuffer = _vkContext.create_buffer(std::format("Model Matrices Buffer {}", i).c_str(), buffer_size, storageUsageFlags, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, allocFlags);
-		currentDrawContext.primitiveIdsBuffer = _vkContext.create_buffer(std::format("Primitive IDs Buffer {}", i).c_str(), buffer_size, storageUsageFlags, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, allocFlags);
+		currentDrawContext.instancesBuffer = _vkContext.create_buffer(std::format("Instances Buffer {}", i).c_str(), buffer_size, storageUsageFlags, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, allocFlags);
 		currentDrawContext.primitiveInfosBuffer = _vkContext.create_buffer(std::format("Primitive Infos Buffer {}", i).c_str(), buffer_size, storageUsageFlags, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, allocFlags);
 		currentDrawContext.materialsBuffer = _vkContext.create_buffer(std::format("Materials Buffer {}", i).c_str(), buffer_size, storageUsageFlags, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, allocFlags);
 		currentDrawContext.texturesBuffer = _vkContext.create_buffer(std::format("Textures Buffer {}", i).c_str(), buffer_size, storageUsageFlags, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, allocFlags);
 		currentDrawContext.lightsBuffer = _vkContext.create_buffer(std::format("Lights Buffer {}", i).c_str(), buffer_size, storageUsageFlags, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, allocFlags);
+		currentDrawContext.meshletsBuffer = _vkContext.create_buffer(std::format("Meshlets Buffer {}", i).c_str(), buffer_size, storageUsageFlags, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, allocFlags);
+		currentDrawContext.meshletDataBuffer = _vkContext.create_buffer(std::format("Meshlet Data Buffer {}", i).c_str(), buffer_size, storageUsageFlags, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, allocFlags);
+		currentDrawContext.meshletDrawsBuffer = _vkContext.create_buffer(std::format("Meshlet Draws Buffer {}", i).c_str(), buffer_size, storageUsageFlags, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, allocFlags);
+
+		//Culling Buffers. Only written on the device, so no host access
+		VkBufferUsageFlags cullUsageFlags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+		currentDrawContext.culledIndirectDrawCommandsBuffer = _vkContext.create_buffer(std::format("Culled Indirect Draw Commands Buffer {}", i).c_str(), buffer_size, cullUsageFlags | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0);
+		currentDrawContext.cullCountersBuffer = _vkContext.create_buffer(std::format("Cull Counters Buffer {}", i).c_str(), buffer_size, cullUsageFlags | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0);
+		currentDrawContext.visibleInstancesBuffer = _vkContext.create_buffer(std::format("Visible Instances Buffer {}", i).c_str(), buffer_size, cullUsageFlags, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0);
+		currentDrawContext.taskCommandsBuffer = _vkContext.create_buffer(std::format("Task Commands Buffer {}", i).c_str(), buffer_size, cullUsageFlags | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0);
+		currentDrawContext.clusterLightsBuffer = _vkContext.create_buffer(std::format("Cluster Lights Buffer {}", i).c_str(), alloc_clusterLights_size, cullUsageFlags, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0);
 
 		VkBufferDeviceAddressInfo address_info{ .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO };
 		address_info.buffer = currentDrawContext.viewprojMatrixBuffer.buffer;
 		currentDrawContext.viewprojMatrixBufferAddress = vkGetBufferDeviceAddress(_vkContext.device, &address_info);
 		address_info.buffer = currentDrawContext.modelMatricesBuffer.buffer;
 		currentDrawContext.modelMatricesBufferAddress = vkGetBufferDeviceAddress(_vkContext.device, &address_info);
-		address_info.buffer = currentDrawContext.primitiveIdsBuffer.buffer;
-		currentDrawContext.primitiveIdsBufferAddress = vkGetBufferDeviceAddress(_vkContext.device, &address_info);
+		address_info.buffer = currentDrawContext.instancesBuffer.buffer;
+		currentDrawContext.instancesBufferAddress = vkGetBufferDeviceAddress(_vkContext.device, &address_info);
 		address_info.buffer = currentDrawContext.primitiveInfosBuffer.buffer;
 		currentDrawContext.primitiveInfosBufferAddress = vkGetBufferDeviceAddress(_vkContext.device, &address_info);
 		address_info.buffer = currentDrawContext.materialsBuffer.buffer;
@@ -337,6 +470,30 @@ void RenderSystem::setup_drawContexts(const GraphicsDataPayload& payload) {
 		currentDrawContext.texturesBufferAddress = vkGetBufferDeviceAddress(_vkContext.device, &address_info);
 		address_info.buffer = currentDrawContext.lightsBuffer.buffer;
 		currentDrawContext.lightsBufferAddress = vkGetBufferDeviceAddress(_vkContext.device, &address_info);
+		address_info.buffer = currentDrawContext.indirectDrawCommandsBuffer.buffer;
+		currentDrawContext.indirectDrawCommandsBufferAddress = vkGetBufferDeviceAddress(_vkContext.device, &address_info);
+		address_info.buffer = currentDrawContext.culledIndirectDrawCommandsBuffer.buffer;
+		currentDrawContext.culledIndirectDrawCommandsBufferAddress = vkGetBufferDeviceAddress(_vkContext.device, &address_info);
+		address_info.buffer = currentDrawContext.cullCountersBuffer.buffer;
+		currentDrawContext.cullCountersBufferAddress = vkGetBufferDeviceAddress(_vkContext.device, &address_info);
+		address_info.buffer = currentDrawContext.visibleInstancesBuffer.buffer;
+		currentDrawContext.visibleInstancesBufferAddress = vkGetBufferDeviceAddress(_vkContext.device, &address_info);
+		address_info.buffer = currentDrawContext.clusterLightsBuffer.buffer;
+		currentDrawContext.clusterLightsBufferAddress = vkGetBufferDeviceAddress(_vkContext.device, &address_info);
+		address_info.buffer = currentDrawContext.vertexPosBuffer.buffer;
+		currentDrawContext.vertexPosBufferAddress = vkGetBufferDeviceAddress(_vkContext.device, &address_info);
+		address_info.buffer = currentDrawContext.vertexOtherAttribBuffer.buffer;
+		currentDrawContext.vertexOtherAttribBufferAddress = vkGetBufferDeviceAddress(_vkContext.device, &address_info);
+		address_info.buffer = currentDrawContext.indexBuffer.buffer;
+		currentDrawContext.indexBufferAddress = vkGetBufferDeviceAddress(_vkContext.device, &address_info);
+		address_info.buffer = currentDrawContext.meshletsBuffer.buffer;
+		currentDrawContext.meshletsBufferAddress = vkGetBufferDeviceAddress(_vkContext.device, &address_info);
+		address_info.buffer = currentDrawContext.meshletDataBuffer.buffer;
+		currentDrawContext.meshletDataBufferAddress = vkGetBufferDeviceAddress(_vkContext.device, &address_info);
+		address_info.buffer = currentDrawContext.meshletDrawsBuffer.buffer;
+		currentDrawContext.meshletDrawsBufferAddress = vkGetBufferDeviceAddress(_vkContext.device, &address_info);
+		address_info.buffer = currentDrawContext.taskCommandsBuffer.buffer;
+		currentDrawContext.taskCommandsBufferAddress = vkGetBufferDeviceAddress(_vkContext.device, &address_info);
 		
 		//Uniform Buffers - Skybox
 		currentDrawContext.skybox_viewprojMatrixBuffer = _vkContext.create_buffer(std::format("Skybox View and Projection Matrix Buffer {}", i).c_str(), sizeof(SkyboxShader::ViewTransformMatrices), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, allocFlags);
@@ -348,15 +505,18 @@ void RenderSystem::setup_drawContexts(const GraphicsDataPayload& payload) {
 		_vkContext.update_buffer(currentDrawContext.indexBuffer, renderData.indices.data(), alloc_index_size, renderData.index_copy_info);
 		_vkContext.update_buffer(currentDrawContext.viewprojMatrixBuffer, &renderData.viewproj, alloc_viewprojMatrix_size, renderData.viewprojMatrix_copy_info);
 		_vkContext.update_buffer(currentDrawContext.modelMatricesBuffer, renderData.model_matrices.data(), alloc_modelMatrices_size, renderData.modelMatrices_copy_infos);
-		_vkContext.update_buffer(currentDrawContext.primitiveIdsBuffer, renderData.primitiveIds.data(), alloc_primIds_size, renderData.primId_copy_info);
+		_vkContext.update_buffer(currentDrawContext.instancesBuffer, renderData.instances.data(), alloc_instances_size, renderData.instance_copy_info);
 		_vkContext.update_buffer(currentDrawContext.primitiveInfosBuffer, renderData.primitiveInfos.data(), alloc_primInfo_size, renderData.primInfo_copy_infos);
 		_vkContext.update_buffer(currentDrawContext.materialsBuffer, renderData.materials.data(), alloc_materials_size, renderData.material_copy_infos);
 		_vkContext.update_buffer(currentDrawContext.texturesBuffer, renderData.textures.data(), alloc_textures_size, renderData.texture_copy_infos);
-
-		RenderShader::Lights lights; //Have to Construct Structure first with appropriate data before uploading data
-		lights.pointLightCount = renderData.pointLightsCount;
-		std::copy(renderData.pointLights.begin(), renderData.pointLights.end(), lights.pointLights);
-		_vkContext.update_buffer(currentDrawContext.lightsBuffer, (void*)&lights, alloc_lights_size, renderData.light_copy_info);
+		if (!renderData.pointLights.empty())
+			_vkContext.update_buffer(currentDrawContext.lightsBuffer, renderData.pointLights.data(), alloc_lights_size, renderData.light_copy_info);
+		if (!renderData.meshlets.empty()) {
+			_vkContext.update_buffer(currentDrawContext.meshletsBuffer, renderData.meshlets.data(), alloc_meshlets_size, renderData.meshlet_copy_info);
+			_vkContext.update_buffer(currentDrawContext.meshletDataBuffer, renderData.meshlet_data.data(), alloc_meshletData_size, renderData.meshletData_copy_info);
+		}
+		if (!renderData.meshlet_draws.empty())
+			_vkContext.update_buffer(currentDrawContext.meshletDrawsBuffer, renderData.meshlet_draws.data(), alloc_meshletDraws_size, renderData.meshletDraw_copy_info);
 		i++;
 
 		SkyboxShader::ViewTransformMatrices skybox_viewproj;
@@ -383,19 +543,121 @@ VkBuffer RenderSystem::get_indexBuffer() {
 RenderShader::PushConstants RenderSystem::get_pushConstants() {
 	DrawContext& currentDrawContext = get_current_frame().drawContext;
 	RenderShader::PushConstants pushconstants{};
-	pushconstants.primitiveIdsBufferAddress = currentDrawContext.primitiveIdsBufferAddress;
+	pushconstants.instancesBufferAddress = currentDrawContext.instancesBufferAddress;
+	pushconstants.visibleInstancesBufferAddress = currentDrawContext.visibleInstancesBufferAddress;
+	pushconstants.primitiveInfosBufferAddress = currentDrawContext.primitiveInfosBufferAddress;
+	pushconstants.viewProjMatrixBufferAddress = currentDrawContext.viewprojMatrixBufferAddress;
+	pushconstants.modelMatricesBufferAddress = currentDrawContext.modelMatricesBufferAddress;
+	pushconstants.materialsBufferAddress = currentDrawContext.materialsBufferAddress;
+	pushconstants.texturesBufferAddress = currentDrawContext.texturesBufferAddress;
+	pushconstants.lightsBufferAddress = currentDrawContext.lightsBufferAddress;
+	pushconstants.clusterLightsBufferAddress = currentDrawContext.clusterLightsBufferAddress;
+	pushconstants.screenSize = glm::vec2(_swapchain.extent.width, _swapchain.extent.height);
+	pushconstants.viewDepthRange = currentDrawContext.viewDepthRange;
+	pushconstants.visBufferTriangleBits = currentDrawContext.visBufferTriangleBits;
+	return pushconstants;
+}
+
+CullShader::PushConstants RenderSystem::get_cullPushConstants(CullPhase phase) {
+	DrawContext& currentDrawContext = get_current_frame().drawContext;
+	CullShader::PushConstants pushconstants{};
+	pushconstants.instancesBufferAddress = currentDrawContext.instancesBufferAddress;
+	pushconstants.primitiveInfosBufferAddress = currentDrawContext.primitiveInfosBufferAddress;
+	pushconstants.modelMatricesBufferAddress = currentDrawContext.modelMatricesBufferAddress;
+	pushconstants.viewProjMatrixBufferAddress = currentDrawContext.viewprojMatrixBufferAddress;
+	pushconstants.drawCommandsBufferAddress = currentDrawContext.indirectDrawCommandsBufferAddress;
+	pushconstants.culledDrawCommandsBufferAddress = currentDrawContext.culledIndirectDrawCommandsBufferAddress;
+	pushconstants.cullCountersBufferAddress = currentDrawContext.cullCountersBufferAddress;
+	pushconstants.visibleInstancesBufferAddress = currentDrawContext.visibleInstancesBufferAddress;
+	pushconstants.instanceVisibilityBufferAddress = _instanceVisibilityBufferAddress;
+	pushconstants.instanceCount = currentDrawContext.instanceCount;
+	pushconstants.drawCount = currentDrawContext.drawCount;
+	pushconstants.hiZSize = glm::vec2(_hiZImage.extent.width, _hiZImage.extent.height);
+	pushconstants.phase = static_cast<uint32_t>(phase);
+	pushconstants.meshletDrawsBufferAddress = currentDrawContext.meshletDrawsBufferAddress;
+	pushconstants.taskCommandsBufferAddress = currentDrawContext.taskCommandsBufferAddress;
+	return pushconstants;
+}
+
+ClusterShader::PushConstants RenderSystem::get_clusterPushConstants() {
+	DrawContext& currentDrawContext = get_current_frame().drawContext;
+	ClusterShader::PushConstants pushconstants{};
+	pushconstants.viewProjMatrixBufferAddress = currentDrawContext.viewprojMatrixBufferAddress;
+	pushconstants.lightsBufferAddress = currentDrawContext.lightsBufferAddress;
+	pushconstants.clusterLightsBufferAddress = currentDrawContext.clusterLightsBufferAddress;
+	pushconstants.screenSize = glm::vec2(_swapchain.extent.width, _swapchain.extent.height);
+	pushconstants.viewDepthRange = currentDrawContext.viewDepthRange;
+	pushconstants.pointLightCount = currentDrawContext.pointLightCount;
+	return pushconstants;
+}
+
+VisBufferShader::PushConstants RenderSystem::get_visBufferPushConstants() {
+	DrawContext& currentDrawContext = get_current_frame().drawContext;
+	VisBufferShader::PushConstants pushconstants{};
+	pushconstants.instancesBufferAddress = currentDrawContext.instancesBufferAddress;
+	pushconstants.primitiveInfosBufferAddress = currentDrawContext.primitiveInfosBufferAddress;
+	pushconstants.viewProjMatrixBufferAddress = currentDrawContext.viewprojMatrixBufferAddress;
+	pushconstants.modelMatricesBufferAddress = currentDrawContext.modelMatricesBufferAddress;
+	pushconstants.materialsBufferAddress = currentDrawContext.materialsBufferAddress;
+	pushconstants.texturesBufferAddress = currentDrawContext.texturesBufferAddress;
+	pushconstants.lightsBufferAddress = currentDrawContext.lightsBufferAddress;
+	pushconstants.clusterLightsBufferAddress = currentDrawContext.clusterLightsBufferAddress;
+	pushconstants.drawCommandsBufferAddress = currentDrawContext.indirectDrawCommandsBufferAddress;
+	pushconstants.indexBufferAddress = currentDrawContext.indexBufferAddress;
+	pushconstants.vertexPosBufferAddress = currentDrawContext.vertexPosBufferAddress;
+	pushconstants.vertexAttribBufferAddress = currentDrawContext.vertexOtherAttribBufferAddress;
+	pushconstants.screenSize = glm::vec2(_swapchain.extent.width, _swapchain.extent.height);
+	pushconstants.viewDepthRange = currentDrawContext.viewDepthRange;
+	pushconstants.triangleBits = currentDrawContext.visBufferTriangleBits;
+	return pushconstants;
+}
+
+MeshShader::PushConstants RenderSystem::get_meshPushConstants() {
+	DrawContext& currentDrawContext = get_current_frame().drawContext;
+	MeshShader::PushConstants pushconstants{};
+	pushconstants.instancesBufferAddress = currentDrawContext.instancesBufferAddress;
+	pushconstants.visibleInstancesBufferAddress = currentDrawContext.visibleInstancesBufferAddress;
 	pushconstants.primitiveInfosBufferAddress = currentDrawContext.primitiveInfosBufferAddress;
 	pushconstants.viewProjMatrixBufferAddress = currentDrawContext.viewprojMatrixBufferAddress;
 	pushconstants.modelMatricesBufferAddress = currentDrawContext.modelMatricesBufferAddress;
 	pushconstants.materialsBufferAddress = currentDrawContext.materialsBufferAddress;
 	pushconstants.texturesBufferAddress = currentDrawContext.texturesBufferAddress;
 	pushconstants.lightsBufferAddress = currentDrawContext.lightsBufferAddress;
+	pushconstants.clusterLightsBufferAddress = currentDrawContext.clusterLightsBufferAddress;
+	pushconstants.screenSize = glm::vec2(_swapchain.extent.width, _swapchain.extent.height);
+	pushconstants.viewDepthRange = currentDrawContext.viewDepthRange;
+	pushconstants.taskCommandsBufferAddress = currentDrawContext.taskCommandsBufferAddress;
+	pushconstants.meshletsBufferAddress = currentDrawContext.meshletsBufferAddress;
+	pushconstants.meshletDataBufferAddress = currentDrawContext.meshletDataBufferAddress;
+	pushconstants.vertexPosBufferAddress = currentDrawContext.vertexPosBufferAddress;
+	pushconstants.vertexAttribBufferAddress = currentDrawContext.vertexOtherAttribBufferAddress;
 	return pushconstants;
 }
 
-VkBuffer RenderSystem::get_indirectDrawBuffer() {
+//Fewest bits that can index every triangle of the largest Draw Command. The rest of a Visibility Buffer texel indexes the Instance
+uint32_t RenderSystem::get_visBufferTriangleBits(const std::vector<VkDrawIndexedIndirectCommand>& commands) {
+	uint32_t maxTriangleCount = 1;
+	for (const VkDrawIndexedIndirectCommand& command : commands)
+		maxTriangleCount = std::max(maxTriangleCount, command.indexCount / 3);
+	return std::max(static_cast<uint32_t>(std::bit_width(maxTriangleCount - 1)), 1u);
+}
+
+//Distances to the near and far planes. The projection is Reverse-Z, so the near plane is at depth 1
+glm::vec2 RenderSystem::get_viewDepthRange(const glm::mat4& proj) {
+	glm::mat4 invProj = glm::inverse(proj);
+	glm::vec4 nearPoint = invProj * glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+	glm::vec4 farPoint = invProj * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	return glm::vec2(-nearPoint.z / nearPoint.w, -farPoint.z / farPoint.w);
+}
+
+VkBuffer RenderSystem::get_culledIndirectDrawBuffer() {
 	DrawContext& currentDrawContext = get_current_frame().drawContext;
-	return currentDrawContext.indirectDrawCommandsBuffer.buffer;
+	return currentDrawContext.culledIndirectDrawCommandsBuffer.buffer;
+}
+
+VkBuffer RenderSystem::get_drawCountBuffer() {
+	DrawContext& currentDrawContext = get_current_frame().drawContext;
+	return currentDrawContext.cullCountersBuffer.buffer; //The count is the first counter
 }
 
 uint32_t RenderSystem::get_drawCount() {
@@ -409,8 +671,8 @@ void RenderSystem::signal_to_updateDeviceBuffers(DeviceBufferTypeFlags bufferTyp
 		_deviceBufferTypesCounter[DeviceBufferType::ViewProj] = FRAMES_TOTAL;
 	if (bufferType.indirectDraw)
 		_deviceBufferTypesCounter[DeviceBufferType::Indirect] = FRAMES_TOTAL;
-	if (bufferType.primID)
-		_deviceBufferTypesCounter[DeviceBufferType::PrimID] = FRAMES_TOTAL;
+	if (bufferType.instance)
+		_deviceBufferTypesCounter[DeviceBufferType::Instance] = FRAMES_TOTAL;
 	if (bufferType.primInfo)
 		_deviceBufferTypesCounter[DeviceBufferType::PrimInfo] = FRAMES_TOTAL;
 	if (bufferType.modelMatrix)
@@ -428,14 +690,17 @@ void RenderSystem::signal_to_updateDeviceBuffers(DeviceBufferTypeFlags bufferTyp
 }
 
 void RenderSystem::updateSignaledDeviceBuffers(const GraphicsDataPayload& payload) {
+	//The current frame's buffers may still be read by its previous submission, and staged uploads to them run on the Transfer Queue without any ordering against it
+	VK_CHECK(vkWaitForFences(_vkContext.device, 1, &get_current_frame().renderFence, true, 1000000000));
+
 	DeviceBufferTypeFlags dataType;
 	//FIgure out which render data type flags were signaled
 	if (_deviceBufferTypesCounter[DeviceBufferType::ViewProj] == FRAMES_TOTAL)
 		dataType.viewProjMatrix = true;
 	if (_deviceBufferTypesCounter[DeviceBufferType::Indirect] == FRAMES_TOTAL)
 		dataType.indirectDraw = true;
-	if (_deviceBufferTypesCounter[DeviceBufferType::PrimID] == FRAMES_TOTAL)
-		dataType.primID = true;
+	if (_deviceBufferTypesCounter[DeviceBufferType::Instance] == FRAMES_TOTAL)
+		dataType.instance = true;
 	if (_deviceBufferTypesCounter[DeviceBufferType::PrimInfo] == FRAMES_TOTAL)
 		dataType.primInfo = true;
 	if (_deviceBufferTypesCounter[DeviceBufferType::Model] == FRAMES_TOTAL)
@@ -451,6 +716,9 @@ void RenderSystem::updateSignaledDeviceBuffers(const GraphicsDataPayload& payloa
 	if (_deviceBufferTypesCounter[DeviceBufferType::Light] == FRAMES_TOTAL)
 		dataType.light = true;
 
+	//Queue any changes recorded in the host objects' Change Journals
+	collect_changes();
+
 	//Stage Data of those that were only recently signaled to be updated
 	extract_render_data(payload, dataType, _stagingUpdateData);
 
@@ -458,6 +726,7 @@ void RenderSystem::updateSignaledDeviceBuffers(const GraphicsDataPayload& payloa
 	if (_deviceBufferTypesCounter[DeviceBufferType::ViewProj] > 0) {
 		size_t viewSize = sizeof(RenderShader::ViewProj);
 		_vkContext.update_buffer(get_current_frame().drawContext.viewprojMatrixBuffer, &_stagingUpdateData.viewproj, viewSize, _stagingUpdateData.viewprojMatrix_copy_info);
+		get_current_frame().drawContext.viewDepthRange = get_viewDepthRange(_stagingUpdateData.viewproj.proj);
 
 		//Skybox Buffer
 		SkyboxShader::ViewTransformMatrices skybox_viewprojMatrix;
@@ -476,15 +745,22 @@ void RenderSystem::updateSignaledDeviceBuffers(const GraphicsDataPayload& payloa
 
 	if (_deviceBufferTypesCounter[DeviceBufferType::Indirect] > 0) {
 		get_current_frame().drawContext.drawCount = _stagingUpdateData.indirect_commands.size();
+		get_current_frame().drawContext.visBufferTriangleBits = get_visBufferTriangleBits(_stagingUpdateData.indirect_commands);
 		size_t indirectSize = sizeof(VkDrawIndexedIndirectCommand) * _stagingUpdateData.indirect_commands.size();
 		_vkContext.update_buffer(get_current_frame().drawContext.indirectDrawCommandsBuffer, _stagingUpdateData.indirect_commands.data(), indirectSize, _stagingUpdateData.indirect_copy_info);
+		if (!_stagingUpdateData.meshlet_draws.empty()) {
+			size_t meshletDrawSize = sizeof(MeshShader::MeshletDraw) * _stagingUpdateData.meshlet_draws.size();
+			_vkContext.update_buffer(get_current_frame().drawContext.meshletDrawsBuffer, _stagingUpdateData.meshlet_draws.data(), meshletDrawSize, _stagingUpdateData.meshletDraw_copy_info);
+		}
 		_deviceBufferTypesCounter[DeviceBufferType::Indirect]--;
 	}
 	
-	if (_deviceBufferTypesCounter[DeviceBufferType::PrimID] > 0) {
-		size_t primIDsize = sizeof(int32_t) * _stagingUpdateData.primitiveIds.size();
-		_vkContext.update_buffer(get_current_frame().drawContext.primitiveIdsBuffer, _stagingUpdateData.primitiveIds.data(), primIDsize, _stagingUpdateData.primId_copy_info);
-		_deviceBufferTypesCounter[DeviceBufferType::PrimID]--;
+	if (_deviceBufferTypesCounter[DeviceBufferType::Instance] > 0) {
+		get_current_frame().drawContext.instanceCount = _stagingUpdateData.instances.size();
+		_resetInstanceVisibility = true; //Instance indices no longer match the recorded visibility
+		size_t instanceSize = sizeof(RenderShader::Instance) * _stagingUpdateData.instances.size();
+		_vkContext.update_buffer(get_current_frame().drawContext.instancesBuffer, _stagingUpdateData.instances.data(), instanceSize, _stagingUpdateData.instance_copy_info);
+		_deviceBufferTypesCounter[DeviceBufferType::Instance]--;
 	}
 
 	if (_deviceBufferTypesCounter[DeviceBufferType::PrimInfo] > 0) {
@@ -502,6 +778,12 @@ void RenderSystem::updateSignaledDeviceBuffers(const GraphicsDataPayload& payloa
 	if (_deviceBufferTypesCounter[DeviceBufferType::Index] > 0) {
 		size_t indiceSize = sizeof(uint32_t) * _stagingUpdateData.indices.size();
 		_vkContext.update_buffer(get_current_frame().drawContext.indexBuffer, _stagingUpdateData.indices.data(), indiceSize, _stagingUpdateData.index_copy_info);
+		if (!_stagingUpdateData.meshlets.empty()) {
+			size_t meshletSize = sizeof(MeshShader::Meshlet) * _stagingUpdateData.meshlets.size();
+			size_t meshletDataSize = sizeof(uint32_t) * _stagingUpdateData.meshlet_data.size();
+			_vkContext.update_buffer(get_current_frame().drawContext.meshletsBuffer, _stagingUpdateData.meshlets.data(), meshletSize, _stagingUpdateData.meshlet_copy_info);
+			_vkContext.update_buffer(get_current_frame().drawContext.meshletDataBuffer, _stagingUpdateData.meshlet_data.data(), meshletDataSize, _stagingUpdateData.meshletData_copy_info);
+		}
 		_deviceBufferTypesCounter[DeviceBufferType::Index]--;
 	}
 
@@ -526,13 +808,30 @@ void RenderSystem::updateSignaledDeviceBuffers(const GraphicsDataPayload& payloa
 	}
 
 	if (_deviceBufferTypesCounter[DeviceBufferType::Light] > 0) {
-		size_t lightSize = sizeof(RenderShader::Lights);
-		RenderShader::Lights lights;
-		lights.pointLightCount = _stagingUpdateData.pointLightsCount;
-		std::copy(_stagingUpdateData.pointLights.begin(), _stagingUpdateData.pointLights.end(), lights.pointLights);
-		_vkContext.update_buffer(get_current_frame().drawContext.lightsBuffer, (void*)&lights, lightSize, _stagingUpdateData.light_copy_info);
+		get_current_frame().drawContext.pointLightCount = _stagingUpdateData.pointLights.size();
+		size_t lightSize = sizeof(RenderShader::PointLight) * _stagingUpdateData.pointLights.size();
+		if (lightSize > 0)
+			_vkContext.update_buffer(get_current_frame().drawContext.lightsBuffer, _stagingUpdateData.pointLights.data(), lightSize, _stagingUpdateData.light_copy_info);
 		_deviceBufferTypesCounter[DeviceBufferType::Light]--;
 	}
+
+	//Upload only the changed objects' data into their locations in the current frame's buffers
+	PendingChanges& pendingChanges = get_current_frame().pendingChanges;
+	if (!pendingChanges.empty()) {
+		extract_changed_render_data(pendingChanges, _changedUpdateData);
+		DrawContext& currentDrawContext = get_current_frame().drawContext;
+
+		if (!_changedUpdateData.model_matrices.empty())
+			_vkContext.update_buffer(currentDrawContext.modelMatricesBuffer, _changedUpdateData.model_matrices.data(), sizeof(glm::mat4) * _changedUpdateData.model_matrices.size(), _changedUpdateData.modelMatrices_copy_infos);
+		if (!_changedUpdateData.primitiveInfos.empty())
+			_vkContext.update_buffer(currentDrawContext.primitiveInfosBuffer, _changedUpdateData.primitiveInfos.data(), sizeof(RenderShader::PrimitiveInfo) * _changedUpdateData.primitiveInfos.size(), _changedUpdateData.primInfo_copy_infos);
+		if (!_changedUpdateData.materials.empty())
+			_vkContext.update_buffer(currentDrawContext.materialsBuffer, _changedUpdateData.materials.data(), sizeof(RenderShader::Material) * _changedUpdateData.materials.size(), _changedUpdateData.material_copy_infos);
+		if (!_changedUpdateData.textures.empty())
+			_vkContext.update_buffer(currentDrawContext.texturesBuffer, _changedUpdateData.textures.data(), sizeof(RenderShader::Texture) * _changedUpdateData.textures.size(), _changedUpdateData.texture_copy_infos);
+
+		pendingChanges.clear();
+	}
 }
 
 void RenderSystem::init_graphicsPipeline() {
@@ -549,6 +848,12 @@ void RenderSystem::init_graphicsPipeline() {
 	else
 		std::cout << "Fragment Shader successfully loaded" << std::endl;
 
+	VkShaderModule depthPrepassShader;
+	if (!vkutil::load_shader_module("shaders/depthPrepass_vert.spv", _vkContext.device, &depthPrepassShader))
+		throw std::runtime_error("Error trying to create Depth Pre-Pass Shader Module");
+	else
+		std::cout << "Depth Pre-Pass Shader successfully loaded" << std::endl;
+
 	//Set Pipeline Layout - Descriptor Sets and Push Constants Layout
 	VkPushConstantRange range{};
 	range.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
@@ -579,13 +884,348 @@ void RenderSystem::init_graphicsPipeline() {
 
 	_pipeline = pipelineBuilder.build_pipeline(_vkContext.device);
 
+	//-Shading after a Depth Pre-Pass. Fragments hidden behind the pre-pass's depth fail the test before shading
+	pipelineBuilder.enable_depthtest(false, VK_COMPARE_OP_EQUAL);
+
+	_prepassShadingPipeline = pipelineBuilder.build_pipeline(_vkContext.device);
+
+	//-Depth Pre-Pass. Only reads the Vertex Position Buffer
+	std::vector<VkVertexInputBindingDescription> positionBindingDescriptions = { _bindingDescriptions[0] };
+	std::vector<VkVertexInputAttributeDescription> positionAttributeDescriptions = { _attribueDescriptions[0] };
+
+	PipelineBuilder depthPipelineBuilder;
+	depthPipelineBuilder._pipelineLayout = _pipelineLayout;
+	depthPipelineBuilder.set_vertex_shader(depthPrepassShader);
+	depthPipelineBuilder.set_vertex_input(positionBindingDescriptions, positionAttributeDescriptions);
+	depthPipelineBuilder.set_input_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+	depthPipelineBuilder.set_polygon_mode(VK_POLYGON_MODE_FILL);
+	depthPipelineBuilder.set_cull_mode(VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE);
+	depthPipelineBuilder.set_multisampling_none();
+	depthPipelineBuilder.disable_blending();
+	depthPipelineBuilder.enable_depthtest(true, VK_COMPARE_OP_GREATER_OR_EQUAL);
+	depthPipelineBuilder.set_depth_format(VK_FORMAT_D32_SFLOAT);
+
+	_depthPrepassPipeline = depthPipelineBuilder.build_pipeline(_vkContext.device);
+
 	vkDestroyShaderModule(_vkContext.device, vertexShader, nullptr);
 	vkDestroyShaderModule(_vkContext.device, fragShader, nullptr);
+	vkDestroyShaderModule(_vkContext.device, depthPrepassShader, nullptr);
+}
+
+void RenderSystem::init_cullPipelines() {
+	//Load Shaders
+	VkShaderModule cullInstancesShader;
+	if (!vkutil::load_shader_module("shaders/cullInstances_comp.spv", _vkContext.device, &cullInstancesShader))
+		throw std::runtime_error("Error trying to create Cull Instances Shader Module");
+	else
+		std::cout << "Cull Instances Shader successfully loaded" << std::endl;
+
+	VkShaderModule compactDrawsShader;
+	if (!vkutil::load_shader_module("shaders/compactDraws_comp.spv", _vkContext.device, &compactDrawsShader))
+		throw std::runtime_error("Error trying to create Compact Draws Shader Module");
+	else
+		std::cout << "Compact Draws Shader successfully loaded" << std::endl;
+
+	//Set Pipeline Layout - Every buffer is reached through Push Constants. The only Descriptor Set is the Hi-Z
+	VkPushConstantRange range{};
+	range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	range.offset = 0;
+	range.size = sizeof(CullShader::PushConstants);
+
+	VkPipelineLayoutCreateInfo pipeline_layout_info = vkutil::pipeline_layout_create_info();
+	pipeline_layout_info.setLayoutCount = 1;
+	pipeline_layout_info.pSetLayouts = &_hiZDescriptorSetLayout;
+	pipeline_layout_info.pushConstantRangeCount = 1;
+	pipeline_layout_info.pPushConstantRanges = &range;
+
+	VK_CHECK(vkCreatePipelineLayout(_vkContext.device, &pipeline_layout_info, nullptr, &_cullPipelineLayout));
+
+	//Build Pipelines
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = vkutil::pipeline_shader_stage_create_info(VK_SHADER_STAGE_COMPUTE_BIT, cullInstancesShader);
+	pipelineInfo.layout = _cullPipelineLayout;
+
+	if (vkCreateComputePipelines(_vkContext.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_cullInstancesPipeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create Cull Instances Pipeline");
+
+	pipelineInfo.stage.module = compactDrawsShader;
+
+	if (vkCreateComputePipelines(_vkContext.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_compactDrawsPipeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create Compact Draws Pipeline");
+
+	vkDestroyShaderModule(_vkContext.device, cullInstancesShader, nullptr);
+	vkDestroyShaderModule(_vkContext.device, compactDrawsShader, nullptr);
+}
+
+void RenderSystem::init_clusterPipeline() {
+	VkShaderModule assignLightsShader;
+	if (!vkutil::load_shader_module("shaders/assignLights_comp.spv", _vkContext.device, &assignLightsShader))
+		throw std::runtime_error("Error trying to create Assign Lights Shader Module");
+	else
+		std::cout << "Assign Lights Shader successfully loaded" << std::endl;
+
+	//Set Pipeline Layout - Every buffer is reached through Push Constants
+	VkPushConstantRange range{};
+	range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	range.offset = 0;
+	range.size = sizeof(ClusterShader::PushConstants);
+
+	VkPipelineLayoutCreateInfo pipeline_layout_info = vkutil::pipeline_layout_create_info();
+	pipeline_layout_info.pushConstantRangeCount = 1;
+	pipeline_layout_info.pPushConstantRanges = &range;
+
+	VK_CHECK(vkCreatePipelineLayout(_vkContext.device, &pipeline_layout_info, nullptr, &_clusterPipelineLayout));
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = vkutil::pipeline_shader_stage_create_info(VK_SHADER_STAGE_COMPUTE_BIT, assignLightsShader);
+	pipelineInfo.layout = _clusterPipelineLayout;
+
+	if (vkCreateComputePipelines(_vkContext.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_assignLightsPipeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create Assign Lights Pipeline");
+
+	vkDestroyShaderModule(_vkContext.device, assignLightsShader, nullptr);
+}
+
+void RenderSystem::init_visBufferPipelines() {
+	//Load Shaders
+	VkShaderModule visibilityVertShader;
+	if (!vkutil::load_shader_module("shaders/visibility_vert.spv", _vkContext.device, &visibilityVertShader))
+		throw std::runtime_error("Error trying to create Visibility Vertex Shader Module");
+	else
+		std::cout << "Visibility Vertex Shader successfully loaded" << std::endl;
+
+	VkShaderModule visibilityFragShader;
+	if (!vkutil::load_shader_module("shaders/visibility_frag.spv", _vkContext.device, &visibilityFragShader))
+		throw std::runtime_error("Error trying to create Visibility Fragment Shader Module");
+	else
+		std::cout << "Visibility Fragment Shader successfully loaded" << std::endl;
+
+	VkShaderModule resolveShader;
+	if (!vkutil::load_shader_module("shaders/visibilityResolve_comp.spv", _vkContext.device, &resolveShader))
+		throw std::runtime_error("Error trying to create Visibility Resolve Shader Module");
+	else
+		std::cout << "Visibility Resolve Shader successfully loaded" << std::endl;
+
+	//-Visibility Pass. Position only, with the Forward Pipeline's layout
+	std::vector<VkVertexInputBindingDescription> positionBindingDescriptions = { _bindingDescriptions[0] };
+	std::vector<VkVertexInputAttributeDescription> positionAttributeDescriptions = { _attribueDescriptions[0] };
+
+	PipelineBuilder pipelineBuilder;
+	pipelineBuilder._pipelineLayout = _pipelineLayout;
+	pipelineBuilder.set_shaders(visibilityVertShader, visibilityFragShader);
+	pipelineBuilder.set_vertex_input(positionBindingDescriptions, positionAttributeDescriptions);
+	pipelineBuilder.set_input_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+	pipelineBuilder.set_polygon_mode(VK_POLYGON_MODE_FILL);
+	pipelineBuilder.set_cull_mode(VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE);
+	pipelineBuilder.set_multisampling_none();
+	pipelineBuilder.disable_blending();
+	pipelineBuilder.enable_depthtest(true, VK_COMPARE_OP_GREATER_OR_EQUAL);
+	pipelineBuilder.set_color_attachment_format(VK_FORMAT_R32_UINT);
+	pipelineBuilder.set_depth_format(VK_FORMAT_D32_SFLOAT);
+
+	_visibilityPipeline = pipelineBuilder.build_pipeline(_vkContext.device);
+
+	//-Resolve. Set 0 is the Forward Pipeline's bindless set, Set 1 the Visibility and Shaded Images
+	VkDescriptorPoolSize poolSize = { .type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = 2 };
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	poolInfo.maxSets = 1;
+
+	if (vkCreateDescriptorPool(_vkContext.device, &poolInfo, nullptr, &_visBufferDescriptorPool) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create Visibility Buffer Descriptor Pool");
+
+	std::vector<VkDescriptorSetLayoutBinding> layout_bindings = {
+		{.binding = 0, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .pImmutableSamplers = nullptr },
+		{.binding = 1, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .pImmutableSamplers = nullptr }
+	};
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(layout_bindings.size());
+	layoutInfo.pBindings = layout_bindings.data();
+
+	if (vkCreateDescriptorSetLayout(_vkContext.device, &layoutInfo, nullptr, &_visBufferDescriptorSetLayout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create Visibility Buffer Descriptor Set Layout");
+
+	VkPushConstantRange range{};
+	range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	range.offset = 0;
+	range.size = sizeof(VisBufferShader::PushConstants);
+
+	VkDescriptorSetLayout setLayouts[2] = { _descriptorSetLayout, _visBufferDescriptorSetLayout };
+
+	VkPipelineLayoutCreateInfo pipeline_layout_info = vkutil::pipeline_layout_create_info();
+	pipeline_layout_info.setLayoutCount = 2;
+	pipeline_layout_info.pSetLayouts = setLayouts;
+	pipeline_layout_info.pushConstantRangeCount = 1;
+	pipeline_layout_info.pPushConstantRanges = &range;
+
+	VK_CHECK(vkCreatePipelineLayout(_vkContext.device, &pipeline_layout_info, nullptr, &_visBufferResolvePipelineLayout));
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = vkutil::pipeline_shader_stage_create_info(VK_SHADER_STAGE_COMPUTE_BIT, resolveShader);
+	pipelineInfo.layout = _visBufferResolvePipelineLayout;
+
+	if (vkCreateComputePipelines(_vkContext.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_visBufferResolvePipeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create Visibility Resolve Pipeline");
+
+	vkDestroyShaderModule(_vkContext.device, visibilityVertShader, nullptr);
+	vkDestroyShaderModule(_vkContext.device, visibilityFragShader, nullptr);
+	vkDestroyShaderModule(_vkContext.device, resolveShader, nullptr);
+}
+
+void RenderSystem::init_meshPipeline() {
+	//Set 0 is the Forward Pipeline's bindless set, read by the shared Fragment Shader. Without Mesh Shaders the layout is still made (without the stages it can't name), so shutdown stays unconditional
+	VkPushConstantRange range{};
+	range.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	if (_vkContext.meshShaderSupported)
+		range.stageFlags |= VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT;
+	range.offset = 0;
+	range.size = sizeof(MeshShader::PushConstants);
+
+	VkPipelineLayoutCreateInfo pipeline_layout_info = vkutil::pipeline_layout_create_info();
+	pipeline_layout_info.setLayoutCount = 1;
+	pipeline_layout_info.pSetLayouts = &_descriptorSetLayout;
+	pipeline_layout_info.pushConstantRangeCount = 1;
+	pipeline_layout_info.pPushConstantRanges = &range;
+
+	VK_CHECK(vkCreatePipelineLayout(_vkContext.device, &pipeline_layout_info, nullptr, &_meshPipelineLayout));
+
+	if (!_vkContext.meshShaderSupported)
+		return;
+
+	_geometryShaderStages |= VK_PIPELINE_STAGE_2_TASK_SHADER_BIT_EXT | VK_PIPELINE_STAGE_2_MESH_SHADER_BIT_EXT;
+
+	//Load Shaders
+	VkShaderModule taskShader;
+	if (!vkutil::load_shader_module("shaders/meshlet_task.spv", _vkContext.device, &taskShader))
+		throw std::runtime_error("Error trying to create Meshlet Task Shader Module");
+	else
+		std::cout << "Meshlet Task Shader successfully loaded" << std::endl;
+
+	VkShaderModule meshShader;
+	if (!vkutil::load_shader_module("shaders/meshlet_mesh.spv", _vkContext.device, &meshShader))
+		throw std::runtime_error("Error trying to create Meshlet Mesh Shader Module");
+	else
+		std::cout << "Meshlet Mesh Shader successfully loaded" << std::endl;
+
+	VkShaderModule fragShader;
+	if (!vkutil::load_shader_module("shaders/default_frag.spv", _vkContext.device, &fragShader))
+		throw std::runtime_error("error trying to create Frag Shader Module");
+
+	PipelineBuilder pipelineBuilder;
+	pipelineBuilder._pipelineLayout = _meshPipelineLayout;
+	pipelineBuilder.set_mesh_shaders(taskShader, meshShader, fragShader);
+	pipelineBuilder.set_polygon_mode(VK_POLYGON_MODE_FILL);
+	pipelineBuilder.set_cull_mode(VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE);
+	pipelineBuilder.set_multisampling_none();
+	pipelineBuilder.disable_blending();
+	pipelineBuilder.enable_depthtest(true, VK_COMPARE_OP_GREATER_OR_EQUAL);
+	pipelineBuilder.set_color_attachment_format(_swapchain.format);
+	pipelineBuilder.set_depth_format(VK_FORMAT_D32_SFLOAT);
+
+	_meshPipeline = pipelineBuilder.build_pipeline(_vkContext.device);
+
+	vkDestroyShaderModule(_vkContext.device, taskShader, nullptr);
+	vkDestroyShaderModule(_vkContext.device, meshShader, nullptr);
+	vkDestroyShaderModule(_vkContext.device, fragShader, nullptr);
+}
+
+void RenderSystem::init_hiZPipeline() {
+	//Min Reduction Sampler
+	VkSamplerReductionModeCreateInfo reductionInfo{};
+	reductionInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_REDUCTION_MODE_CREATE_INFO;
+	reductionInfo.reductionMode = VK_SAMPLER_REDUCTION_MODE_MIN;
+
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.pNext = &reductionInfo;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+	_hiZSampler = _vkContext.create_sampler(samplerInfo);
+
+	//Descriptors. A set per level for the build pass, and one for the cull pass
+	std::vector<VkDescriptorPoolSize> poolSizes = {
+		{.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = MAX_HIZ_LEVEL_COUNT + 1 },
+		{.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = MAX_HIZ_LEVEL_COUNT }
+	};
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = MAX_HIZ_LEVEL_COUNT + 1;
+
+	if (vkCreateDescriptorPool(_vkContext.device, &poolInfo, nullptr, &_hiZDescriptorPool) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create Hi-Z Descriptor Pool");
+
+	std::vector<VkDescriptorSetLayoutBinding> layout_bindings = {
+		{.binding = 0, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .pImmutableSamplers = nullptr },
+		{.binding = 1, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .pImmutableSamplers = nullptr }
+	};
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(layout_bindings.size());
+	layoutInfo.pBindings = layout_bindings.data();
+
+	if (vkCreateDescriptorSetLayout(_vkContext.device, &layoutInfo, nullptr, &_hiZDescriptorSetLayout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create Hi-Z Descriptor Set Layout");
+
+	//Pipeline
+	VkShaderModule hiZShader;
+	if (!vkutil::load_shader_module("shaders/buildHiZ_comp.spv", _vkContext.device, &hiZShader))
+		throw std::runtime_error("Error trying to create Hi-Z Shader Module");
+	else
+		std::cout << "Hi-Z Shader successfully loaded" << std::endl;
+
+	VkPushConstantRange range{};
+	range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	range.offset = 0;
+	range.size = sizeof(HiZShader::PushConstants);
+
+	VkPipelineLayoutCreateInfo pipeline_layout_info = vkutil::pipeline_layout_create_info();
+	pipeline_layout_info.setLayoutCount = 1;
+	pipeline_layout_info.pSetLayouts = &_hiZDescriptorSetLayout;
+	pipeline_layout_info.pushConstantRangeCount = 1;
+	pipeline_layout_info.pPushConstantRanges = &range;
+
+	VK_CHECK(vkCreatePipelineLayout(_vkContext.device, &pipeline_layout_info, nullptr, &_hiZPipelineLayout));
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = vkutil::pipeline_shader_stage_create_info(VK_SHADER_STAGE_COMPUTE_BIT, hiZShader);
+	pipelineInfo.layout = _hiZPipelineLayout;
+
+	if (vkCreateComputePipelines(_vkContext.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_hiZPipeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create Hi-Z Pipeline");
+
+	vkDestroyShaderModule(_vkContext.device, hiZShader, nullptr);
 }
 
 VkResult RenderSystem::draw() {
 	VK_CHECK(vkWaitForFences(_vkContext.device, 1, &get_current_frame().renderFence, true, 1000000000));
 
+	//The frame FRAMES_TOTAL ago has finished, so its Texture Feedback is ready. Read before its slots are recycled, while every slot still maps to the image that frame sampled through it
+	read_textureFeedback();
+
+	//The fence was signaled by the frame FRAMES_TOTAL ago, so slots that frame was the last to read can be reused
+	if (_frameNumber >= FRAMES_TOTAL)
+		_bindless.recycle(_frameNumber - FRAMES_TOTAL);
+
 	//Acquire the next swapchain image
 	VkResult result;
 	result = vkAcquireNextImageKHR(_vkContext.device, _swapchain.vkSwapchain, 1000000000, get_current_frame().swapchainSemaphore, nullptr, &_swapchainImageIndex);
@@ -598,6 +1238,9 @@ VkResult RenderSystem::draw() {
 
 	VK_CHECK(vkResetFences(_vkContext.device, 1, &get_current_frame().renderFence));
 
+	//This frame's previous submission has finished, so its timestamps are ready
+	read_geometryTimestamps();
+
 	VkCommandBuffer cmd = get_current_frame().commandBuffer;
 
 	VK_CHECK(vkResetCommandBuffer(cmd, 0));
@@ -611,76 +1254,315 @@ VkResult RenderSystem::draw() {
 	VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
 	Image swapchainImage = get_currentSwapchainImage();
 
+	if (_timestampsSupported) {
+		vkCmdResetQueryPool(cmd, get_current_frame().timestampQueryPool, 0, GEOMETRY_TIMESTAMP_COUNT);
+		get_current_frame().timestampsWritten = true;
+	}
+
 	//Transition Images for Drawing
 	_vkContext.transition_image(cmd, swapchainImage, VK_IMAGE_LAYOUT_GENERAL);
 	_vkContext.transition_image(cmd, _depthImage, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
 
-	//Clear Color
-	VkClearColorValue clearValue = { {0.5f, 0.5f, 0.5f, 0.5f} };
+	//Clear Color
+	VkClearColorValue clearValue = { {0.5f, 0.5f, 0.5f, 0.5f} };
+
+	VkImageSubresourceRange clearRange = vkutil::image_subresource_range(VK_IMAGE_ASPECT_COLOR_BIT);
+
+	vkCmdClearColorImage(cmd, swapchainImage.image, VK_IMAGE_LAYOUT_GENERAL, &clearValue, 1, &clearRange);
+
+	//Start the frame's Texture Streaming Feedback from nothing sampled
+	clear_textureFeedback(cmd);
+
+	//List the Point Lights reaching each cluster, for the Geometry's shading
+	assign_lights(cmd);
+
+	//Draw Geometry in two phases. First what was visible last frame, then what the Hi-Z built from that reveals as newly visible
+	bool visibilityBuffer = use_visibilityBuffer();
+	bool meshShaders = use_meshShaders();
+
+	cull_geometry(cmd, CullPhase::Early);
+	if (visibilityBuffer)
+		draw_visibility(cmd, CullPhase::Early);
+	else if (meshShaders)
+		draw_meshlets(cmd, swapchainImage, CullPhase::Early);
+	else
+		draw_geometry(cmd, swapchainImage, CullPhase::Early);
+
+	build_hiZ(cmd);
+
+	cull_geometry(cmd, CullPhase::Late);
+	if (visibilityBuffer)
+		draw_visibility(cmd, CullPhase::Late);
+	else if (meshShaders)
+		draw_meshlets(cmd, swapchainImage, CullPhase::Late);
+	else
+		draw_geometry(cmd, swapchainImage, CullPhase::Late);
+
+	//Shade the Visibility Buffer. The timestamps are still written on the Forward path, so every query is available when read back
+	write_timestamp(cmd, RESOLVE_TIMESTAMP_BEGIN);
+	if (visibilityBuffer)
+		resolve_visibility(cmd, swapchainImage);
+	write_timestamp(cmd, RESOLVE_TIMESTAMP_BEGIN + 1);
+
+	//All Textures have been sampled, so copy out the Texture Streaming Feedback
+	copy_textureFeedback(cmd);
+
+	//Draw Skybox
+	draw_skybox(cmd, swapchainImage);
+
+	//Draw GUI
+	draw_gui(cmd, swapchainImage);
+
+	//Transition for Presentation
+	_vkContext.transition_image(cmd, swapchainImage, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+	VK_CHECK(vkEndCommandBuffer(cmd));
+
+	//Submit this frame's staged uploads to the Transfer Queue. The frame waits on the Upload Timeline on the GPU instead of the CPU
+	uint64_t uploadWaitValue = _vkContext.submit_staged_uploads();
+
+	VkCommandBufferSubmitInfo cmdInfo = vkutil::command_buffer_submit_info(cmd);
+	VkSemaphoreSubmitInfo waitInfos[2];
+	waitInfos[0] = vkutil::semaphore_submit_info(VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, get_current_frame().swapchainSemaphore);
+	waitInfos[1] = vkutil::semaphore_submit_info(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, _vkContext.uploadTimeline);
+	waitInfos[1].value = uploadWaitValue;
+	VkSemaphoreSubmitInfo signalInfo = vkutil::semaphore_submit_info(VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT, get_current_frame().renderSemaphore);
+
+	VkSubmitInfo2 submit = vkutil::submit_info(&cmdInfo, &signalInfo, waitInfos);
+	submit.waitSemaphoreInfoCount = 2;
+
+	std::unique_lock<std::mutex> queueLock(_vkContext.queueSubmitMutex);
+	VK_CHECK(vkQueueSubmit2(_vkContext.primaryQueue, 1, &submit, get_current_frame().renderFence));
+
+	VkPresentInfoKHR presentInfo{};
+	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	presentInfo.pNext = nullptr;
+	presentInfo.pSwapchains = &_swapchain.vkSwapchain;
+	presentInfo.swapchainCount = 1;
+	presentInfo.pWaitSemaphores = &get_current_frame().renderSemaphore;
+	presentInfo.waitSemaphoreCount = 1;
+	presentInfo.pImageIndices = &_swapchainImageIndex;
+
+	result = vkQueuePresentKHR(_vkContext.primaryQueue, &presentInfo);
+	queueLock.unlock();
+
+	go_next_frame();
+	
+	if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+		std::cerr << "Render System: Failed to present" << std::endl;
+	}
+
+	return result;
+}
+
+//Culling on the device. Visible instances are listed under their Draw Command, then the Draw Commands with any visible instance are compacted into the culled Indirect Draw Buffer that draw_geometry reads
+void RenderSystem::cull_geometry(VkCommandBuffer cmd, CullPhase phase) {
+	constexpr uint32_t CULL_WORKGROUP_SIZE = 64; //Matches local_size_x of both culling shaders
+
+	CullShader::PushConstants pushconstants = get_cullPushConstants(phase);
+
+	//The previous phase's draw (or the previous frame's) reads the buffers that are about to be reset, and its late pass wrote the visibility read here
+	vkutil::memory_barrier(cmd, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | _geometryShaderStages | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+	//Treat every instance as visible last frame when the recorded visibility is stale
+	if (phase == CullPhase::Early && _resetInstanceVisibility) {
+		vkCmdFillBuffer(cmd, _instanceVisibilityBuffer.buffer, 0, VK_WHOLE_SIZE, 1);
+		_resetInstanceVisibility = false;
+	}
+
+	//Reset the Culled Draw Count and every Draw Command's visible instance count
+	vkCmdFillBuffer(cmd, get_drawCountBuffer(), 0, sizeof(uint32_t) * (pushconstants.drawCount + 1), 0);
+	vkutil::memory_barrier(cmd, VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+	//Cull Instances
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _cullInstancesPipeline);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _cullPipelineLayout, 0, 1, &_hiZCullDescriptorSet, 0, nullptr);
+	vkCmdPushConstants(cmd, _cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullShader::PushConstants), &pushconstants);
+	vkCmdDispatch(cmd, (pushconstants.instanceCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+	vkutil::memory_barrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+	//Compact Draw Commands
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _compactDrawsPipeline);
+	vkCmdDispatch(cmd, (pushconstants.drawCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+	vkutil::memory_barrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | _geometryShaderStages, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+}
+
+//Reduces the depth drawn so far into the Hi-Z pyramid, one level per dispatch
+void RenderSystem::build_hiZ(VkCommandBuffer cmd) {
+	constexpr uint32_t HIZ_WORKGROUP_SIZE = 8; //Matches local_size_x and local_size_y of the Hi-Z shader
+
+	_vkContext.transition_image(cmd, _depthImage, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL);
+	if (_hiZImage.layout != VK_IMAGE_LAYOUT_GENERAL) //Stays in General, as it's both written and sampled
+		_vkContext.transition_image(cmd, _hiZImage, VK_IMAGE_LAYOUT_GENERAL);
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _hiZPipeline);
+
+	for (uint32_t level = 0; level < _hiZLevelViews.size(); level++) {
+		HiZShader::PushConstants pushconstants{};
+		pushconstants.levelSize = glm::vec2(std::max(_hiZImage.extent.width >> level, 1u), std::max(_hiZImage.extent.height >> level, 1u));
+
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _hiZPipelineLayout, 0, 1, &_hiZLevelDescriptorSets[level], 0, nullptr);
+		vkCmdPushConstants(cmd, _hiZPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(HiZShader::PushConstants), &pushconstants);
+		vkCmdDispatch(cmd, (static_cast<uint32_t>(pushconstants.levelSize.x) + HIZ_WORKGROUP_SIZE - 1) / HIZ_WORKGROUP_SIZE, (static_cast<uint32_t>(pushconstants.levelSize.y) + HIZ_WORKGROUP_SIZE - 1) / HIZ_WORKGROUP_SIZE, 1);
+
+		//The next level, or the late pass's occlusion test, reads this level
+		vkutil::memory_barrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
+	}
+
+	_vkContext.transition_image(cmd, _depthImage, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+}
+
+//Assigns the Point Lights to the clusters of the view frustum they reach, so each fragment only shades the lights of its own cluster
+void RenderSystem::assign_lights(VkCommandBuffer cmd) {
+	constexpr uint32_t CLUSTER_WORKGROUP_SIZE = 128; //Matches local_size_x of the Light Assignment shader
+
+	ClusterShader::PushConstants pushconstants = get_clusterPushConstants();
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _assignLightsPipeline);
+	vkCmdPushConstants(cmd, _clusterPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ClusterShader::PushConstants), &pushconstants);
+	vkCmdDispatch(cmd, (CLUSTER_COUNT + CLUSTER_WORKGROUP_SIZE - 1) / CLUSTER_WORKGROUP_SIZE, 1, 1);
+
+	vkutil::memory_barrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT); //Read by the Forward shading or the Visibility Buffer Resolve
+}
+
+//Draws the geometry that survived the phase's culling. With the Depth Pre-Pass, a position only pass lays down the depth first, so the shading pass shades each pixel once instead of once per overlapping surface
+void RenderSystem::draw_geometry(VkCommandBuffer cmd, const Image& swapchainImage, CullPhase phase) {
+	uint32_t firstTimestamp = static_cast<uint32_t>(phase) * GEOMETRY_TIMESTAMPS_PER_PHASE;
+	write_timestamp(cmd, firstTimestamp);
+
+	VkExtent2D swapchainExtent = get_swapChainExtent();
+
+	//Set Dynamic States
+	VkViewport viewport{};
+	viewport.x = 0;
+	viewport.y = swapchainExtent.height; //Move origin to swapchain height
+	viewport.width = swapchainExtent.width;
+	viewport.height = -1.0 * swapchainExtent.height; //Flip Viewport to account for flipped y-coord in glm calculations
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+
+	vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+	VkRect2D scissor{};
+	scissor.offset.x = 0;
+	scissor.offset.y = 0;
+	scissor.extent.width = swapchainExtent.width;
+	scissor.extent.height = swapchainExtent.height;
+
+	vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+	//Bind Descriptor Set. Both passes' pipelines share the layout, so the bindings and Push Constants carry over between them
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout, 0, 1, &_descriptorSet, 0, nullptr);
+
+	//Bind Vertex Input Buffers. The Depth Pre-Pass only reads the first (positions)
+	std::vector<VkBuffer> vertexBuffers = get_vertexBuffers();
+	std::vector<VkDeviceSize> vertexOffsets = { 0, 0 };
+	vkCmdBindVertexBuffers(cmd, 0, vertexBuffers.size(), vertexBuffers.data(), vertexOffsets.data());
+	vkCmdBindIndexBuffer(cmd, get_indexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+
+	//Push Constants
+	RenderShader::PushConstants pushconstants = get_pushConstants();
+	vkCmdPushConstants(cmd, _pipelineLayout, VK_SHADER_STAGE_ALL_GRAPHICS, 0, sizeof(RenderShader::PushConstants), &pushconstants);
+
+	VkRenderingAttachmentInfo depthAttachment = vkutil::depth_attachment_info(_depthImage.imageView, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+	if (phase == CullPhase::Late)
+		depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD; //Keeps the depth of the geometry drawn in the early phase
+
+	//Depth Pre-Pass
+	if (_depthPrepass) {
+		VkRenderingInfo depthRenderInfo = vkutil::rendering_info(swapchainExtent, nullptr, &depthAttachment);
+		vkCmdBeginRendering(cmd, &depthRenderInfo);
+
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _depthPrepassPipeline);
+		vkCmdDrawIndexedIndirectCount(cmd, get_culledIndirectDrawBuffer(), 0, get_drawCountBuffer(), 0, get_drawCount(), sizeof(VkDrawIndexedIndirectCommand));
 
-	VkImageSubresourceRange clearRange = vkutil::image_subresource_range(VK_IMAGE_ASPECT_COLOR_BIT);
+		vkCmdEndRendering(cmd);
 
-	vkCmdClearColorImage(cmd, swapchainImage.image, VK_IMAGE_LAYOUT_GENERAL, &clearValue, 1, &clearRange);
+		vkutil::memory_barrier(cmd, VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT);
+		depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD; //Shading tests against the pre-pass's depth
+	}
 
-	//Draw Geometry
-	draw_geometry(cmd, swapchainImage);
+	write_timestamp(cmd, firstTimestamp + 1);
 
-	//Draw Skybox
-	draw_skybox(cmd, swapchainImage);
+	//Shading
+	VkRenderingAttachmentInfo colorAttachment = vkutil::attachment_info(swapchainImage.imageView, nullptr, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+	VkRenderingInfo renderInfo = vkutil::rendering_info(swapchainExtent, &colorAttachment, &depthAttachment);
+	vkCmdBeginRendering(cmd, &renderInfo);
 
-	//Draw GUI
-	draw_gui(cmd, swapchainImage);
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _depthPrepass ? _prepassShadingPipeline : _pipeline);
 
-	//Transition for Presentation
-	_vkContext.transition_image(cmd, swapchainImage, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	//Draw. Only the Draw Commands that survived culling, with the count read from the Cull Counters
+	vkCmdDrawIndexedIndirectCount(cmd, get_culledIndirectDrawBuffer(), 0, get_drawCountBuffer(), 0, get_drawCount(), sizeof(VkDrawIndexedIndirectCommand));
 
-	VK_CHECK(vkEndCommandBuffer(cmd));
+	vkCmdEndRendering(cmd);
 
-	VkCommandBufferSubmitInfo cmdInfo = vkutil::command_buffer_submit_info(cmd);
-	VkSemaphoreSubmitInfo waitInfo = vkutil::semaphore_submit_info(VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, get_current_frame().swapchainSemaphore);
-	VkSemaphoreSubmitInfo signalInfo = vkutil::semaphore_submit_info(VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT, get_current_frame().renderSemaphore);
+	write_timestamp(cmd, firstTimestamp + 2);
+}
 
-	VkSubmitInfo2 submit = vkutil::submit_info(&cmdInfo, &signalInfo, &waitInfo);
+//Draws the geometry that survived the phase's culling as Meshlets. Each Task Command covers a culled Draw Command's visible instances, whose Meshlets are culled again in the Task Shader. No Depth Pre-Pass, as Meshlets outside the view or facing away are already skipped
+void RenderSystem::draw_meshlets(VkCommandBuffer cmd, const Image& swapchainImage, CullPhase phase) {
+	uint32_t firstTimestamp = static_cast<uint32_t>(phase) * GEOMETRY_TIMESTAMPS_PER_PHASE;
+	write_timestamp(cmd, firstTimestamp);
+	write_timestamp(cmd, firstTimestamp + 1);
 
-	VK_CHECK(vkQueueSubmit2(_vkContext.primaryQueue, 1, &submit, get_current_frame().renderFence));
+	VkExtent2D swapchainExtent = get_swapChainExtent();
 
-	VkPresentInfoKHR presentInfo{};
-	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-	presentInfo.pNext = nullptr;
-	presentInfo.pSwapchains = &_swapchain.vkSwapchain;
-	presentInfo.swapchainCount = 1;
-	presentInfo.pWaitSemaphores = &get_current_frame().renderSemaphore;
-	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pImageIndices = &_swapchainImageIndex;
+	//Set Dynamic States. Same flipped Viewport as draw_geometry
+	VkViewport viewport{};
+	viewport.x = 0;
+	viewport.y = swapchainExtent.height;
+	viewport.width = swapchainExtent.width;
+	viewport.height = -1.0 * swapchainExtent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
 
-	result = vkQueuePresentKHR(_vkContext.primaryQueue, &presentInfo);
+	vkCmdSetViewport(cmd, 0, 1, &viewport);
 
-	go_next_frame();
-	
-	if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-		std::cerr << "Render System: Failed to present" << std::endl;
-	}
+	VkRect2D scissor{};
+	scissor.offset.x = 0;
+	scissor.offset.y = 0;
+	scissor.extent.width = swapchainExtent.width;
+	scissor.extent.height = swapchainExtent.height;
 
-	return result;
-}
+	vkCmdSetScissor(cmd, 0, 1, &scissor);
 
-void RenderSystem::draw_geometry(VkCommandBuffer cmd, const Image& swapchainImage) {
-	VkRenderingAttachmentInfo colorAttachment = vkutil::attachment_info(swapchainImage.imageView, nullptr, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-	VkRenderingAttachmentInfo depthAttachment = vkutil::depth_attachment_info(_depthImage.imageView, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _meshPipelineLayout, 0, 1, &_descriptorSet, 0, nullptr);
 
-	VkExtent2D swapchainExtent = get_swapChainExtent();
+	MeshShader::PushConstants pushconstants = get_meshPushConstants();
+	vkCmdPushConstants(cmd, _meshPipelineLayout, VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(MeshShader::PushConstants), &pushconstants);
+
+	VkRenderingAttachmentInfo depthAttachment = vkutil::depth_attachment_info(_depthImage.imageView, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+	if (phase == CullPhase::Late)
+		depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD; //Keeps the depth of the geometry drawn in the early phase
 
+	VkRenderingAttachmentInfo colorAttachment = vkutil::attachment_info(swapchainImage.imageView, nullptr, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 	VkRenderingInfo renderInfo = vkutil::rendering_info(swapchainExtent, &colorAttachment, &depthAttachment);
 	vkCmdBeginRendering(cmd, &renderInfo);
 
-	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline);
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _meshPipeline);
 
-	//Set Dynamic States
+	//Task Commands were written to the same slots as the culled Draw Commands, so they share the Culled Draw Count
+	_vkContext.cmdDrawMeshTasksIndirectCount(cmd, get_current_frame().drawContext.taskCommandsBuffer.buffer, 0, get_drawCountBuffer(), 0, get_drawCount(), sizeof(MeshShader::TaskCommand));
+
+	vkCmdEndRendering(cmd);
+
+	write_timestamp(cmd, firstTimestamp + 2);
+}
+
+//Rasterizes the geometry that survived the phase's culling into the Visibility Image. Only positions are read, and each pixel only stores which Instance and triangle covers it
+void RenderSystem::draw_visibility(VkCommandBuffer cmd, CullPhase phase) {
+	uint32_t firstTimestamp = static_cast<uint32_t>(phase) * GEOMETRY_TIMESTAMPS_PER_PHASE;
+	write_timestamp(cmd, firstTimestamp);
+
+	VkExtent2D swapchainExtent = get_swapChainExtent();
+
+	//Set Dynamic States. Same flipped Viewport as draw_geometry, so the Resolve reconstructs the same triangles
 	VkViewport viewport{};
 	viewport.x = 0;
-	viewport.y = swapchainExtent.height; //Move origin to swapchain height
+	viewport.y = swapchainExtent.height;
 	viewport.width = swapchainExtent.width;
-	viewport.height = -1.0 * swapchainExtent.height; //Flip Viewport to account for flipped y-coord in glm calculations
+	viewport.height = -1.0 * swapchainExtent.height;
 	viewport.minDepth = 0.0f;
 	viewport.maxDepth = 1.0f;
 
@@ -694,23 +1576,147 @@ void RenderSystem::draw_geometry(VkCommandBuffer cmd, const Image& swapchainImag
 
 	vkCmdSetScissor(cmd, 0, 1, &scissor);
 
-	//Bind Descriptor Set
 	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout, 0, 1, &_descriptorSet, 0, nullptr);
 
-	//Bind Vertex Input Buffers
+	//Bind Vertex Input Buffers. Only the first (positions) is read
 	std::vector<VkBuffer> vertexBuffers = get_vertexBuffers();
 	std::vector<VkDeviceSize> vertexOffsets = { 0, 0 };
 	vkCmdBindVertexBuffers(cmd, 0, vertexBuffers.size(), vertexBuffers.data(), vertexOffsets.data());
 	vkCmdBindIndexBuffer(cmd, get_indexBuffer(), 0, VK_INDEX_TYPE_UINT32);
 
-	//Push Constants
 	RenderShader::PushConstants pushconstants = get_pushConstants();
 	vkCmdPushConstants(cmd, _pipelineLayout, VK_SHADER_STAGE_ALL_GRAPHICS, 0, sizeof(RenderShader::PushConstants), &pushconstants);
 
-	//Draw
-	vkCmdDrawIndexedIndirect(cmd, get_indirectDrawBuffer(), 0, get_drawCount(), sizeof(VkDrawIndexedIndirectCommand));
+	_vkContext.transition_image(cmd, _visibilityImage, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+
+	//The early phase clears, the late phase keeps what the early phase drew
+	VkClearValue visibilityClear{};
+	visibilityClear.color.uint32[0] = VISBUFFER_EMPTY;
+	VkRenderingAttachmentInfo colorAttachment = vkutil::attachment_info(_visibilityImage.imageView, phase == CullPhase::Early ? &visibilityClear : nullptr, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+	VkRenderingAttachmentInfo depthAttachment = vkutil::depth_attachment_info(_depthImage.imageView, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+	if (phase == CullPhase::Late)
+		depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+
+	VkRenderingInfo renderInfo = vkutil::rendering_info(swapchainExtent, &colorAttachment, &depthAttachment);
+	vkCmdBeginRendering(cmd, &renderInfo);
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _visibilityPipeline);
+	vkCmdDrawIndexedIndirectCount(cmd, get_culledIndirectDrawBuffer(), 0, get_drawCountBuffer(), 0, get_drawCount(), sizeof(VkDrawIndexedIndirectCommand));
 
 	vkCmdEndRendering(cmd);
+
+	//Visibility Pass is the first timestamp pair, so it's compared against the Depth Pre-Pass. There is no per-phase shading
+	write_timestamp(cmd, firstTimestamp + 1);
+	write_timestamp(cmd, firstTimestamp + 2);
+}
+
+//Shades every covered pixel of the Visibility Image once. Its triangle's vertices are fetched and its attributes interpolated with barycentrics computed from the pixel's position,
+//then it's shaded with the same functions as the Forward shading and copied to the Swapchain Image
+void RenderSystem::resolve_visibility(VkCommandBuffer cmd, Image& swapchainImage) {
+	constexpr uint32_t RESOLVE_WORKGROUP_SIZE = 8; //Matches local_size_x and local_size_y of the Resolve shader
+
+	_vkContext.transition_image(cmd, _visibilityImage, VK_IMAGE_LAYOUT_GENERAL);
+	_vkContext.transition_image(cmd, _visBufferShadedImage, VK_IMAGE_LAYOUT_GENERAL);
+
+	VisBufferShader::PushConstants pushconstants = get_visBufferPushConstants();
+	VkDescriptorSet descriptorSets[2] = { _descriptorSet, _visBufferDescriptorSet };
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _visBufferResolvePipeline);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _visBufferResolvePipelineLayout, 0, 2, descriptorSets, 0, nullptr);
+	vkCmdPushConstants(cmd, _visBufferResolvePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(VisBufferShader::PushConstants), &pushconstants);
+
+	VkExtent2D swapchainExtent = get_swapChainExtent();
+	vkCmdDispatch(cmd, (swapchainExtent.width + RESOLVE_WORKGROUP_SIZE - 1) / RESOLVE_WORKGROUP_SIZE, (swapchainExtent.height + RESOLVE_WORKGROUP_SIZE - 1) / RESOLVE_WORKGROUP_SIZE, 1);
+
+	//Copy to the Swapchain Image
+	_vkContext.transition_image(cmd, _visBufferShadedImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+	_vkContext.transition_image(cmd, swapchainImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+	vkutil::copy_image_to_image(cmd, _visBufferShadedImage.image, swapchainImage.image, swapchainExtent, swapchainExtent);
+
+	_vkContext.transition_image(cmd, swapchainImage, VK_IMAGE_LAYOUT_GENERAL);
+}
+
+//Needs enough bits above the triangle bits of a texel for every Instance
+bool RenderSystem::use_visibilityBuffer() {
+	DrawContext& currentDrawContext = get_current_frame().drawContext;
+	return _renderPath == RenderPath::VisibilityBuffer && static_cast<uint64_t>(currentDrawContext.instanceCount) < (1ull << (32 - currentDrawContext.visBufferTriangleBits));
+}
+
+//Falls back to the Forward path on devices without Mesh Shaders
+bool RenderSystem::use_meshShaders() {
+	return _renderPath == RenderPath::MeshShader && _meshPipeline != VK_NULL_HANDLE;
+}
+
+void RenderSystem::write_timestamp(VkCommandBuffer cmd, uint32_t query) {
+	if (_timestampsSupported)
+		vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, get_current_frame().timestampQueryPool, query);
+}
+
+//Converts the current frame's Geometry Timestamps from its last submission into the Geometry Timings
+void RenderSystem::read_geometryTimestamps() {
+	Frame& frame = get_current_frame();
+	if (!frame.timestampsWritten)
+		return;
+
+	uint64_t timestamps[GEOMETRY_TIMESTAMP_COUNT];
+	if (vkGetQueryPoolResults(_vkContext.device, frame.timestampQueryPool, 0, GEOMETRY_TIMESTAMP_COUNT, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+		return;
+
+	double msPerTick = _timestampPeriod / 1000000.0;
+	uint64_t prepassTicks = 0;
+	uint64_t shadingTicks = 0;
+	for (uint32_t phase = 0; phase < 2; phase++) {
+		const uint64_t* phaseTimestamps = timestamps + phase * GEOMETRY_TIMESTAMPS_PER_PHASE;
+		prepassTicks += phaseTimestamps[1] - phaseTimestamps[0];
+		shadingTicks += phaseTimestamps[2] - phaseTimestamps[1];
+	}
+	shadingTicks += timestamps[RESOLVE_TIMESTAMP_BEGIN + 1] - timestamps[RESOLVE_TIMESTAMP_BEGIN];
+
+	_geometryTimings.depthPrepass = static_cast<float>(prepassTicks * msPerTick);
+	_geometryTimings.shading = static_cast<float>(shadingTicks * msPerTick);
+}
+
+//The previous frame's copy reads the buffer before it's cleared, and the clear lands before the shading's atomics
+void RenderSystem::clear_textureFeedback(VkCommandBuffer cmd) {
+	vkutil::memory_barrier(cmd, VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT);
+	vkCmdFillBuffer(cmd, _textureFeedbackBuffer.buffer, 0, VK_WHOLE_SIZE, TEXTURE_FEEDBACK_NONE);
+	vkutil::memory_barrier(cmd, VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+}
+
+//Copied into the frame's readback, which is read once the frame's fence is signaled. Only the slots handed out so far can hold feedback
+void RenderSystem::copy_textureFeedback(VkCommandBuffer cmd) {
+	Frame& frame = get_current_frame();
+	if (_slotImages.empty())
+		return;
+
+	vkutil::memory_barrier(cmd, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT);
+
+	VkBufferCopy copy{ .srcOffset = 0, .dstOffset = 0, .size = sizeof(uint32_t) * _slotImages.size() };
+	vkCmdCopyBuffer(cmd, _textureFeedbackBuffer.buffer, frame.textureFeedbackReadback.buffer, 1, &copy);
+
+	vkutil::memory_barrier(cmd, VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+	frame.textureFeedbackWritten = true;
+	frame.textureFeedbackSlots = _slotImages.size();
+}
+
+//Folds the current frame's Texture Feedback from its last submission onto payload images, keeping the finest detail of the slots each image was given
+void RenderSystem::read_textureFeedback() {
+	std::fill(_textureFeedback.begin(), _textureFeedback.end(), TEXTURE_FEEDBACK_NONE);
+
+	Frame& frame = get_current_frame();
+	if (!frame.textureFeedbackWritten)
+		return;
+
+	VK_CHECK(vmaInvalidateAllocation(_vkContext.allocator, frame.textureFeedbackReadback.allocation, 0, VK_WHOLE_SIZE));
+	const uint32_t* slotFeedback = static_cast<const uint32_t*>(frame.textureFeedbackReadback.info.pMappedData);
+
+	for (size_t slot = 0; slot < frame.textureFeedbackSlots; slot++) {
+		uint32_t payloadIndex = _slotImages[slot];
+		if (slotFeedback[slot] != TEXTURE_FEEDBACK_NONE && payloadIndex < _textureFeedback.size())
+			_textureFeedback[payloadIndex] = std::max(_textureFeedback[payloadIndex], static_cast<uint8_t>(std::min<uint32_t>(slotFeedback[slot], UINT8_MAX)));
+	}
 }
 
 void RenderSystem::draw_skybox(VkCommandBuffer cmd, const Image& swapchainImage) {
@@ -809,42 +1815,21 @@ void RenderSystem::resize_swapchain(VkExtent2D windowExtent) {
 	//Recreate DepthImage with new adjusted Swapchain size
 	_vkContext.destroy_image(_depthImage);
 	setup_depthImage();
+	destroy_hiZImage();
+	setup_hiZImage();
+	destroy_visBufferImages();
+	setup_visBufferImages();
 }
 
 void RenderSystem::bind_descriptors(GraphicsDataPayload& payload) {
-	std::vector<VkWriteDescriptorSet> descriptorWrites(5);
-
-	//Graphic Payload Texture Image and Samplers
-	std::vector<VkDescriptorImageInfo> sampledImages_imgInfos;
-	for (auto& image : payload.images) {
-		VkDescriptorImageInfo imgInfo{};
-		imgInfo.imageLayout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL;
-		imgInfo.imageView = image.imageView;
-		sampledImages_imgInfos.push_back(imgInfo);
-	}
+	//Graphic Payload Texture Images and Samplers. The payload only appends them, so only the new ones are written, each into its own slot
+	for (size_t i = _imageSlots.size(); i < payload.images.size(); i++)
+		_imageSlots.push_back(add_imageSlot(static_cast<uint32_t>(i), payload.images[i]));
+	_textureFeedback.resize(_imageSlots.size(), TEXTURE_FEEDBACK_NONE);
+	for (size_t i = _samplerSlots.size(); i < payload.samplers.size(); i++)
+		_samplerSlots.push_back(_bindless.add_sampler(payload.samplers[i]));
 
-	descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWrites[0].dstSet = _descriptorSet;
-	descriptorWrites[0].dstBinding = 0;
-	descriptorWrites[0].dstArrayElement = 0;
-	descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-	descriptorWrites[0].descriptorCount = sampledImages_imgInfos.size();
-	descriptorWrites[0].pImageInfo = sampledImages_imgInfos.data();
-
-	std::vector<VkDescriptorImageInfo> sampler_imgInfos;
-	for (auto& sampler : payload.samplers) {
-		VkDescriptorImageInfo imgInfo{};
-		imgInfo.sampler = sampler;
-		sampler_imgInfos.push_back(imgInfo);
-	}
-
-	descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWrites[1].dstSet = _descriptorSet;
-	descriptorWrites[1].dstBinding = 1;
-	descriptorWrites[1].dstArrayElement = 0;
-	descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
-	descriptorWrites[1].descriptorCount = sampler_imgInfos.size();
-	descriptorWrites[1].pImageInfo = sampler_imgInfos.data();
+	std::vector<VkWriteDescriptorSet> descriptorWrites(3);
 
 	//IBL Resources
 	VkDescriptorImageInfo enviroIrradianceCubemapInfo;
@@ -852,50 +1837,200 @@ void RenderSystem::bind_descriptors(GraphicsDataPayload& payload) {
 	enviroIrradianceCubemapInfo.imageView = _hdrIrradianceCubeMap.imageView;
 	enviroIrradianceCubemapInfo.sampler = _cubemapSampler;
 
-	descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWrites[2].dstSet = _descriptorSet;
-	descriptorWrites[2].dstBinding = 2;
-	descriptorWrites[2].dstArrayElement = 0;
-	descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	descriptorWrites[2].descriptorCount = 1;
-	descriptorWrites[2].pImageInfo = &enviroIrradianceCubemapInfo;
+	descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrites[0].dstSet = _descriptorSet;
+	descriptorWrites[0].dstBinding = 2;
+	descriptorWrites[0].dstArrayElement = 0;
+	descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrites[0].descriptorCount = 1;
+	descriptorWrites[0].pImageInfo = &enviroIrradianceCubemapInfo;
 	
 	VkDescriptorImageInfo enviroSpecPrefilteredCubemapInfo;
 	enviroSpecPrefilteredCubemapInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 	enviroSpecPrefilteredCubemapInfo.imageView = _hdrSpecularCubeMap.imageView;
 	enviroSpecPrefilteredCubemapInfo.sampler = _cubemapSampler;
 
-	descriptorWrites[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWrites[3].dstSet = _descriptorSet;
-	descriptorWrites[3].dstBinding = 3;
-	descriptorWrites[3].dstArrayElement = 0;
-	descriptorWrites[3].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	descriptorWrites[3].descriptorCount = 1;
-	descriptorWrites[3].pImageInfo = &enviroSpecPrefilteredCubemapInfo;
+	descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrites[1].dstSet = _descriptorSet;
+	descriptorWrites[1].dstBinding = 3;
+	descriptorWrites[1].dstArrayElement = 0;
+	descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrites[1].descriptorCount = 1;
+	descriptorWrites[1].pImageInfo = &enviroSpecPrefilteredCubemapInfo;
 
 	VkDescriptorImageInfo enviroSpecLUTInfo;
 	enviroSpecLUTInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 	enviroSpecLUTInfo.imageView = _hdrSpecularLUT.imageView;
 	enviroSpecLUTInfo.sampler = _cubemapSampler;
 
-	descriptorWrites[4].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWrites[4].dstSet = _descriptorSet;
-	descriptorWrites[4].dstBinding = 4;
-	descriptorWrites[4].dstArrayElement = 0;
-	descriptorWrites[4].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	descriptorWrites[4].descriptorCount = 1;
-	descriptorWrites[4].pImageInfo = &enviroSpecLUTInfo;
+	descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrites[2].dstSet = _descriptorSet;
+	descriptorWrites[2].dstBinding = 4;
+	descriptorWrites[2].dstArrayElement = 0;
+	descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrites[2].descriptorCount = 1;
+	descriptorWrites[2].pImageInfo = &enviroSpecLUTInfo;
 
 	vkUpdateDescriptorSets(_vkContext.device, descriptorWrites.size(), descriptorWrites.data(), 0, nullptr);
 }
 
+//Index 0 is the default image, so it's never unbound
+void RenderSystem::unbind_image(uint32_t payloadIndex) {
+	if (payloadIndex == 0 || payloadIndex >= _imageSlots.size() || _imageSlots[payloadIndex] == _imageSlots[0])
+		return;
+
+	retire_imageSlot(payloadIndex);
+	_imageSlots[payloadIndex] = _imageSlots[0];
+
+	DeviceBufferTypeFlags dataType;
+	dataType.texture = true;
+	signal_to_updateDeviceBuffers(dataType);
+}
+
+//The old image stays bound in its slot until the slot is recycled, so frames still reading through it see a whole image while the Texture buffers move over to the new slot
+uint64_t RenderSystem::rebind_image(uint32_t payloadIndex, const AllocatedImage& image) {
+	if (payloadIndex == 0 || payloadIndex >= _imageSlots.size())
+		throw std::runtime_error("Rebound image is not a bound payload image");
+
+	uint64_t lastReadingFrame = _imageSlots[payloadIndex] != _imageSlots[0] ? retire_imageSlot(payloadIndex) : 0;
+	_imageSlots[payloadIndex] = add_imageSlot(payloadIndex, image);
+
+	DeviceBufferTypeFlags dataType;
+	dataType.texture = true;
+	signal_to_updateDeviceBuffers(dataType);
+
+	return lastReadingFrame;
+}
+
+uint32_t RenderSystem::add_imageSlot(uint32_t payloadIndex, const AllocatedImage& image) {
+	uint32_t slot = _bindless.add_image(image.imageView, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL);
+	if (slot >= _slotImages.size())
+		_slotImages.resize(slot + 1, UINT32_MAX);
+	_slotImages[slot] = payloadIndex;
+	return slot;
+}
+
+//Each frame's Texture buffer is rewritten within the next FRAMES_TOTAL frames, after which none reads the old slot
+uint64_t RenderSystem::retire_imageSlot(uint32_t payloadIndex) {
+	uint64_t lastReadingFrame = _frameNumber + FRAMES_TOTAL - 1;
+	_bindless.remove_image(_imageSlots[payloadIndex], lastReadingFrame);
+	return lastReadingFrame;
+}
+
 void RenderSystem::setup_depthImage() {
 	VkExtent2D swapchainExtent = get_swapChainExtent();
 	VkExtent3D depthExtent;
 	depthExtent.width = swapchainExtent.width;
 	depthExtent.height = swapchainExtent.height;
 	depthExtent.depth = 1;
-	_depthImage = _vkContext.create_image("Depth Image", depthExtent, VK_FORMAT_D32_SFLOAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, false);
+	_depthImage = _vkContext.create_image("Depth Image", depthExtent, VK_FORMAT_D32_SFLOAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, false); //Sampled to build the Hi-Z
+}
+
+//Sized from the Depth Image, so it's rebuilt along with it
+void RenderSystem::setup_hiZImage() {
+	VkExtent3D hiZExtent;
+	hiZExtent.width = std::bit_floor(_depthImage.extent.width); //Power of 2 levels, so every texel past level 0 reduces exactly 2x2 texels of the level above. Level 0 texels reduce up to 3x3 depth texels
+	hiZExtent.height = std::bit_floor(_depthImage.extent.height);
+	hiZExtent.depth = 1;
+	_hiZImage = _vkContext.create_image("Hi-Z Image", hiZExtent, VK_FORMAT_R32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, true);
+
+	uint32_t levelCount = std::min(static_cast<uint32_t>(std::floor(std::log2(std::max(hiZExtent.width, hiZExtent.height)))) + 1, MAX_HIZ_LEVEL_COUNT);
+	_hiZLevelViews.resize(levelCount);
+	for (uint32_t level = 0; level < levelCount; level++) {
+		VkImageViewCreateInfo view_info = vkutil::imageview_create_info(VK_FORMAT_R32_SFLOAT, _hiZImage.image, VK_IMAGE_ASPECT_COLOR_BIT);
+		view_info.subresourceRange.baseMipLevel = level;
+		view_info.subresourceRange.levelCount = 1;
+		VK_CHECK(vkCreateImageView(_vkContext.device, &view_info, nullptr, &_hiZLevelViews[level]));
+	}
+
+	//Descriptor Sets
+	VK_CHECK(vkResetDescriptorPool(_vkContext.device, _hiZDescriptorPool, 0));
+
+	std::vector<VkDescriptorSetLayout> setLayouts(levelCount + 1, _hiZDescriptorSetLayout);
+	std::vector<VkDescriptorSet> sets(levelCount + 1);
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = _hiZDescriptorPool;
+	allocInfo.descriptorSetCount = static_cast<uint32_t>(setLayouts.size());
+	allocInfo.pSetLayouts = setLayouts.data();
+
+	if (vkAllocateDescriptorSets(_vkContext.device, &allocInfo, sets.data()) != VK_SUCCESS)
+		throw std::runtime_error("Failed to allocate Hi-Z Descriptor Sets");
+
+	_hiZCullDescriptorSet = sets[levelCount];
+	_hiZLevelDescriptorSets.assign(sets.begin(), sets.begin() + levelCount);
+
+	std::vector<VkDescriptorImageInfo> sourceInfos(levelCount + 1);
+	std::vector<VkDescriptorImageInfo> targetInfos(levelCount);
+	std::vector<VkWriteDescriptorSet> descriptorWrites;
+	descriptorWrites.reserve(levelCount * 2 + 1);
+
+	for (uint32_t level = 0; level < levelCount; level++) {
+		if (level == 0)
+			sourceInfos[level] = { .sampler = _hiZSampler, .imageView = _depthImage.imageView, .imageLayout = VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL };
+		else
+			sourceInfos[level] = { .sampler = _hiZSampler, .imageView = _hiZLevelViews[level - 1], .imageLayout = VK_IMAGE_LAYOUT_GENERAL };
+		targetInfos[level] = { .sampler = VK_NULL_HANDLE, .imageView = _hiZLevelViews[level], .imageLayout = VK_IMAGE_LAYOUT_GENERAL };
+
+		descriptorWrites.push_back({ .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = _hiZLevelDescriptorSets[level], .dstBinding = 0, .dstArrayElement = 0, .descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .pImageInfo = &sourceInfos[level] });
+		descriptorWrites.push_back({ .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = _hiZLevelDescriptorSets[level], .dstBinding = 1, .dstArrayElement = 0, .descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .pImageInfo = &targetInfos[level] });
+	}
+
+	sourceInfos[levelCount] = { .sampler = _hiZSampler, .imageView = _hiZImage.imageView, .imageLayout = VK_IMAGE_LAYOUT_GENERAL };
+	descriptorWrites.push_back({ .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = _hiZCullDescriptorSet, .dstBinding = 0, .dstArrayElement = 0, .descriptorCount = 1,
+		.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .pImageInfo = &sourceInfos[levelCount] });
+
+	vkUpdateDescriptorSets(_vkContext.device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+void RenderSystem::destroy_hiZImage() {
+	for (VkImageView levelView : _hiZLevelViews)
+		vkDestroyImageView(_vkContext.device, levelView, nullptr);
+	_hiZLevelViews.clear();
+	_vkContext.destroy_image(_hiZImage);
+}
+
+//Sized to the Swapchain, so they're rebuilt along with it
+void RenderSystem::setup_visBufferImages() {
+	VkExtent2D swapchainExtent = get_swapChainExtent();
+	VkExtent3D extent;
+	extent.width = swapchainExtent.width;
+	extent.height = swapchainExtent.height;
+	extent.depth = 1;
+	_visibilityImage = _vkContext.create_image("Visibility Image", extent, VK_FORMAT_R32_UINT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT, false);
+	_visBufferShadedImage = _vkContext.create_image("Visibility Buffer Shaded Image", extent, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, false);
+
+	//Descriptor Set
+	VK_CHECK(vkResetDescriptorPool(_vkContext.device, _visBufferDescriptorPool, 0));
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = _visBufferDescriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &_visBufferDescriptorSetLayout;
+
+	if (vkAllocateDescriptorSets(_vkContext.device, &allocInfo, &_visBufferDescriptorSet) != VK_SUCCESS)
+		throw std::runtime_error("Failed to allocate Visibility Buffer Descriptor Set");
+
+	VkDescriptorImageInfo imageInfos[2] = {
+		{ .sampler = VK_NULL_HANDLE, .imageView = _visibilityImage.imageView, .imageLayout = VK_IMAGE_LAYOUT_GENERAL },
+		{ .sampler = VK_NULL_HANDLE, .imageView = _visBufferShadedImage.imageView, .imageLayout = VK_IMAGE_LAYOUT_GENERAL }
+	};
+
+	VkWriteDescriptorSet descriptorWrites[2] = {
+		{ .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = _visBufferDescriptorSet, .dstBinding = 0, .dstArrayElement = 0, .descriptorCount = 1, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .pImageInfo = &imageInfos[0] },
+		{ .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = _visBufferDescriptorSet, .dstBinding = 1, .dstArrayElement = 0, .descriptorCount = 1, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .pImageInfo = &imageInfos[1] }
+	};
+
+	vkUpdateDescriptorSets(_vkContext.device, 2, descriptorWrites, 0, nullptr);
+}
+
+void RenderSystem::destroy_visBufferImages() {
+	_vkContext.destroy_image(_visibilityImage);
+	_vkContext.destroy_image(_visBufferShadedImage);
 }
 
 void RenderSystem::destroy_swapchain() {
@@ -916,32 +2051,34 @@ void RenderSystem::extract_render_data(const GraphicsDataPayload& payload, Devic
 	}
 
 	if (dataType.light) {
-		uint32_t pointLightsCount = 0;
-		auto pointLight_it = data.pointLights.begin();
+		data.pointLights.clear();
 		for (const PointLight& pointLight : payload.pointLights) {
-			*pointLight_it = { .pos = pointLight.pos, .color = pointLight.color, .power = pointLight.power };
-			pointLightsCount++;
-			pointLight_it++;
+			//Radiance is power * color / distance^2, so it falls to the cutoff at sqrt(power * color / cutoff)
+			float peakRadiance = pointLight.power * std::max(pointLight.color.r, std::max(pointLight.color.g, pointLight.color.b));
+			if (peakRadiance <= 0.0f) //Lights nothing, and the shaders take a range of 0 as unbounded
+				continue;
+			float range = std::sqrt(peakRadiance / POINTLIGHT_CUTOFF_RADIANCE);
+			data.pointLights.push_back({ .pos = pointLight.pos, .color = pointLight.color, .power = pointLight.power, .range = range });
 		}
-		data.pointLightsCount = pointLightsCount;
-		data.light_copy_info = { .srcOffset = 0, .dstOffset = 0, .size = sizeof(RenderShader::Lights) };
+		data.light_copy_info = { .srcOffset = 0, .dstOffset = 0, .size = sizeof(RenderShader::PointLight) * data.pointLights.size() };
 	}
 
 	//Navigate each scene, and each scene's root nodes, and through each root node's children
-	if (dataType.modelMatrix || dataType.indirectDraw || dataType.primID || dataType.vertex || dataType.index || dataType.primInfo) {
+	if (dataType.modelMatrix || dataType.indirectDraw || dataType.instance || dataType.vertex || dataType.index || dataType.primInfo) {
 		//Clear any specified data from RenderShaderData parameter
 		if (dataType.modelMatrix) {
 			data.model_matrices.clear();
 			data.modelMatrices_copy_infos.clear();
+			_nodeLookup.clear();
 		}
 
 		if (dataType.indirectDraw) {
-			_primID_to_drawCmd.clear();
 			data.indirect_commands.clear();
+			data.meshlet_draws.clear();
 		}
 
-		if (dataType.primID) {
-			data.primitiveIds.clear();
+		if (dataType.instance) {
+			data.instances.clear();
 		}
 
 		if (dataType.vertex) {
@@ -951,98 +2088,80 @@ void RenderSystem::extract_render_data(const GraphicsDataPayload& payload, Devic
 		
 		if (dataType.index) {
 			data.indices.clear();
+			data.meshlets.clear();
+			data.meshlet_data.clear();
 		}
 
 		if (dataType.primInfo) {
 			data.primitiveInfos.clear();
 			data.primInfo_copy_infos.clear();
+			_primitiveLookup.clear();
 		}
 
-		//Extract Data from Current Scene (only)
-		const Scene& scene = payload.scenes[payload.current_scene_idx];
-		//Add all root nodes in current scene to Stack
-		std::stack<std::shared_ptr<Node>> dfs_node_stack;
-		for (auto root_node : scene.root_nodes) {
-			dfs_node_stack.push(root_node);
+		//Extract Data from Current Scene (only). The geometry layout is rebuilt on every traversal, and stays the same for an unchanged scene even when only some data types are extracted
+		scenegeometry::GeometryOutputs geometry_outputs{};
+		if (dataType.vertex) {
+			geometry_outputs.positions = &data.positions;
+			geometry_outputs.attributes = &data.attributes;
+		}
+		if (dataType.index) {
+			geometry_outputs.indices = &data.indices;
+			geometry_outputs.meshlets = &data.meshlets;
+			geometry_outputs.meshlet_data = &data.meshlet_data;
 		}
-		//Perform DFS, traverse all Nodes
-		while (!dfs_node_stack.empty()) {
-			std::shared_ptr<Node> node = dfs_node_stack.top();
-			dfs_node_stack.pop();
-
-			//Add currentNode's children to Stack
-			for (std::shared_ptr<Node> child_node : node->child_nodes) {
-				dfs_node_stack.push(child_node);
-			}
 
-			//Model Matrices
-			if (dataType.modelMatrix) {
+		//Model Matrices
+		scenegeometry::NodeVisitor visit_node = nullptr;
+		if (dataType.modelMatrix) {
+			visit_node = [&](const std::shared_ptr<Node>& node) {
 				data.modelMatrices_copy_infos.push_back({ .srcOffset = data.model_matrices.size() * sizeof(glm::mat4), .dstOffset = node->getID() * sizeof(glm::mat4), .size = sizeof(glm::mat4) });
 				data.model_matrices.push_back(node->get_WorldTransform());
-			}
-
-			//Check if Node represents Mesh
-			if (node->mesh != nullptr) {
-				std::shared_ptr<Mesh>& currentMesh = node->mesh;
-
-				//Iterate through it's primitives and add their data to 
-				for (Mesh::Primitive primitive : currentMesh->primitives) {
-					//Indirect Draw Command
-					if (dataType.indirectDraw) {
-						VkDrawIndexedIndirectCommand indirect_command{};
-						indirect_command.firstIndex = data.indices.size();
-						indirect_command.indexCount = primitive.indices.size();
-						indirect_command.vertexOffset = data.positions.size();
-						indirect_command.firstInstance = 0;
-						indirect_command.instanceCount = 1;
-
-						_primID_to_drawCmd[primitive.getID()] = indirect_command; //Add to primID mapping structure
-
-						data.indirect_commands.push_back(indirect_command);
-
-						//Primitive Ids
-						if (dataType.primID) {
-							data.primitiveIds.push_back(primitive.getID());
-						}
-					}
+				_nodeLookup[node->getID()] = node;
+			};
+		}
 
-					//Vertex's Position and other Vertex Attributes
-					if (dataType.vertex) {
-						for (Mesh::Primitive::Vertex vertex : primitive.vertices) {
-							RenderShader::VertexAttributes attribute;
-							attribute.normal = vertex.normal;
-							attribute.tangent = vertex.tangent;
-							if (vertex.colors.empty())
-								attribute.color = glm::vec3(1.0f, 1.0f, 1.0f);
-							else
-								attribute.color = vertex.colors[0]; //Get Color_0
-							if (vertex.uvs.empty())
-								attribute.uv = glm::vec2(-1.0f, -1.0f);
-							else
-								attribute.uv = vertex.uvs[0]; //Get TexCoord_0
-
-							data.positions.push_back(vertex.position);
-							data.attributes.push_back(attribute);
-						}
-					}
+		//PrimitiveInfo
+		scenegeometry::PrimitiveVisitor visit_primitive = nullptr;
+		if (dataType.primInfo) {
+			visit_primitive = [&](const std::shared_ptr<Node>& node, size_t primitive_index) {
+				const Mesh::Primitive& primitive = node->mesh->primitives[primitive_index];
+				data.primInfo_copy_infos.push_back({ .srcOffset = data.primitiveInfos.size() * sizeof(RenderShader::PrimitiveInfo), .dstOffset = primitive.getID() * sizeof(RenderShader::PrimitiveInfo), .size = sizeof(RenderShader::PrimitiveInfo) });
+				data.primitiveInfos.push_back(extract_primitiveInfo(primitive));
+				_primitiveLookup[primitive.getID()] = { .node = node, .primitive_index = primitive_index };
+			};
+		}
 
-					//Indices
-					if (dataType.index) {
-						data.indices.insert(data.indices.end(), primitive.indices.begin(), primitive.indices.end());
-					}
+		std::vector<scenegeometry::InstanceBatch> instance_batches;
+		scenegeometry::gather(payload.scenes[payload.current_scene_idx], geometry_outputs, _geometryRegistry, instance_batches, visit_node, visit_primitive);
+
+		//Instance Batching. Every registered Primitive gets one Indirect Draw Command that draws all of its instances, which sit contiguously in the Instances Buffer from firstInstance
+		if (dataType.indirectDraw || dataType.instance) {
+			uint32_t first_instance = 0;
+			for (const scenegeometry::InstanceBatch& batch : instance_batches) {
+				const scenegeometry::GeometryRange& geometry = _geometryRegistry[batch.primitive_id];
+				const std::vector<uint32_t>& model_matrix_ids = batch.model_matrix_ids;
+
+				//Indirect Draw Command
+				if (dataType.indirectDraw) {
+					VkDrawIndexedIndirectCommand indirect_command{};
+					indirect_command.firstIndex = geometry.firstIndex;
+					indirect_command.indexCount = geometry.indexCount;
+					indirect_command.vertexOffset = geometry.vertexOffset;
+					indirect_command.firstInstance = first_instance;
+					indirect_command.instanceCount = static_cast<uint32_t>(model_matrix_ids.size());
+
+					data.indirect_commands.push_back(indirect_command);
+					data.meshlet_draws.push_back({ .firstMeshlet = geometry.firstMeshlet, .meshletCount = geometry.meshletCount });
+				}
 
-					//PrimitiveInfo
-					if (dataType.primInfo) {
-						data.primInfo_copy_infos.push_back({ .srcOffset = data.primitiveInfos.size() * sizeof(RenderShader::PrimitiveInfo), .dstOffset = primitive.getID() * sizeof(RenderShader::PrimitiveInfo), .size = sizeof(RenderShader::PrimitiveInfo) });
-						RenderShader::PrimitiveInfo prmInfo{};
-						if (primitive.material.expired() != true)
-							prmInfo.mat_id = primitive.material.lock()->getID();
-						else
-							prmInfo.mat_id = 0;
-						prmInfo.model_matrix_id = node->getID();
-						data.primitiveInfos.push_back(prmInfo);
+				//Instances
+				if (dataType.instance) {
+					for (uint32_t model_matrix_id : model_matrix_ids) {
+						data.instances.push_back({ .primitive_id = batch.primitive_id, .model_matrix_id = model_matrix_id, .draw_id = geometry.batchIndex });
 					}
 				}
+
+				first_instance += static_cast<uint32_t>(model_matrix_ids.size());
 			}
 		}
 
@@ -1051,65 +2170,29 @@ void RenderSystem::extract_render_data(const GraphicsDataPayload& payload, Devic
 			data.pos_copy_info = { .srcOffset = 0, .dstOffset = 0, .size = sizeof(glm::vec3) * data.positions.size() };
 			data.attrib_copy_info = { .srcOffset = 0, .dstOffset = 0, .size = sizeof(RenderShader::VertexAttributes) * data.attributes.size() };
 		}
-		if (dataType.index)
+		if (dataType.index) {
 			data.index_copy_info = { .srcOffset = 0, .dstOffset = 0, .size = sizeof(uint32_t) * data.indices.size() };
-		if (dataType.indirectDraw)
+			data.meshlet_copy_info = { .srcOffset = 0, .dstOffset = 0, .size = sizeof(MeshShader::Meshlet) * data.meshlets.size() };
+			data.meshletData_copy_info = { .srcOffset = 0, .dstOffset = 0, .size = sizeof(uint32_t) * data.meshlet_data.size() };
+		}
+		if (dataType.indirectDraw) {
 			data.indirect_copy_info = { .srcOffset = 0, .dstOffset = 0, .size = sizeof(VkDrawIndexedIndirectCommand) * data.indirect_commands.size() };
-		if (dataType.primID)
-			data.primId_copy_info = { .srcOffset = 0, .dstOffset = 0, .size = sizeof(int32_t) * data.primitiveIds.size() };
+			data.meshletDraw_copy_info = { .srcOffset = 0, .dstOffset = 0, .size = sizeof(MeshShader::MeshletDraw) * data.meshlet_draws.size() };
+		}
+		if (dataType.instance)
+			data.instance_copy_info = { .srcOffset = 0, .dstOffset = 0, .size = sizeof(RenderShader::Instance) * data.instances.size() };
 	}
 
 	//Get Materials
 	if (dataType.material) {
 		data.materials.clear();
 		data.material_copy_infos.clear();
+		_materialLookup.clear();
 
-		for (std::shared_ptr<Material> material : payload.materials) {
+		for (const std::shared_ptr<Material>& material : payload.materials) {
 			data.material_copy_infos.push_back({ .srcOffset = data.materials.size() * sizeof(RenderShader::Material), .dstOffset = material->getID() * sizeof(RenderShader::Material), .size = sizeof(RenderShader::Material) });
-			RenderShader::Material mat{};
-
-			//Base Color
-			if (material->baseColor_texture.expired() != true)
-				mat.baseColor_texture_id = material->baseColor_texture.lock()->getID();
-			else
-				mat.baseColor_texture_id = 0;
-			mat.baseColor_texCoord_id = material->baseColor_coord_index;
-			mat.baseColor_factor = material->baseColor_Factor;
-			
-			//Normal
-			if (material->normal_texture.expired() != true)
-				mat.normal_texture_id = material->normal_texture.lock()->getID();
-			else
-				mat.normal_texture_id = 0;
-			mat.normal_texcoord_id = material->normal_coord_index;
-			mat.normal_scale = material->normal_scale;
-			
-			//Metal-Rough
-			if (material->metal_rough_texture.expired() != true)
-				mat.metal_rough_texture_id = material->metal_rough_texture.lock()->getID();
-			else
-				mat.metal_rough_texture_id = 0;
-			mat.metal_rough_texcoord_id = material->metal_rough_coord_index;
-			mat.metallic_factor = material->metallic_Factor;
-			mat.roughness_factor = material->roughness_Factor;
-			
-			//Occlusion
-			if (material->occlusion_texture.expired() != true)
-				mat.occlusion_texture_id = material->occlusion_texture.lock()->getID();
-			else
-				mat.occlusion_texture_id = 0;
-			mat.occlusion_texcoord_id = material->occlusion_coord_index;
-			mat.occlusion_strength = material->occlusion_strength;
-			
-			//Emission
-			if (material->emission_texture.expired() != true)
-				mat.emission_texture_id = material->emission_texture.lock()->getID();
-			else
-				mat.emission_texture_id = 0;
-			mat.emission_texcoord_id = material->emission_coord_index;
-			mat.emission_factor = material->emission_Factor;
-			
-			data.materials.push_back(mat);
+			data.materials.push_back(extract_material(*material));
+			_materialLookup[material->getID()] = material;
 		}
 	}
 
@@ -1117,17 +2200,163 @@ void RenderSystem::extract_render_data(const GraphicsDataPayload& payload, Devic
 	if (dataType.texture) {
 		data.textures.clear();
 		data.texture_copy_infos.clear();
+		_textureLookup.clear();
 
 		for (auto& texture : payload.textures) {
 			data.texture_copy_infos.push_back({ .srcOffset = data.textures.size() * sizeof(RenderShader::Texture), .dstOffset = texture->getID() * sizeof(RenderShader::Texture), .size = sizeof(RenderShader::Texture) });
 			RenderShader::Texture tex{};
-			tex.textureImage_id = texture->image_index;
-			tex.sampler_id = texture->sampler_index;
+			tex.textureImage_id = _imageSlots[texture->image_index];
+			tex.sampler_id = _samplerSlots[texture->sampler_index];
 			data.textures.push_back(tex);
+			_textureLookup[texture->getID()] = texture;
 		}
 	}
 }
 
+//Consume every Change Journal and queue the changed IDs for each frame, since each frame has its own set of device buffers to update
+void RenderSystem::collect_changes() {
+	if (Node::change_journal.empty() && Mesh::Primitive::change_journal.empty() && Material::change_journal.empty() && Texture::change_journal.empty())
+		return;
+
+	std::unordered_set<uint32_t> changed_nodes = Node::change_journal.consume();
+	std::unordered_set<uint32_t> changed_primitives = Mesh::Primitive::change_journal.consume();
+	std::unordered_set<uint32_t> changed_materials = Material::change_journal.consume();
+	std::unordered_set<uint32_t> changed_textures = Texture::change_journal.consume();
+
+	for (Frame& frame : _frames) {
+		frame.pendingChanges.node_ids.insert(changed_nodes.begin(), changed_nodes.end());
+		frame.pendingChanges.primitive_ids.insert(changed_primitives.begin(), changed_primitives.end());
+		frame.pendingChanges.material_ids.insert(changed_materials.begin(), changed_materials.end());
+		frame.pendingChanges.texture_ids.insert(changed_textures.begin(), changed_textures.end());
+	}
+}
+
+//Extract only the data of the changed objects. IDs that are not part of the current scene (not in the lookups) are skipped, as they will be extracted in full when their scene is loaded
+void RenderSystem::extract_changed_render_data(const PendingChanges& changes, RenderShaderData& data) {
+	data.model_matrices.clear();
+	data.modelMatrices_copy_infos.clear();
+	data.primitiveInfos.clear();
+	data.primInfo_copy_infos.clear();
+	data.materials.clear();
+	data.material_copy_infos.clear();
+	data.textures.clear();
+	data.texture_copy_infos.clear();
+
+	//Model Matrices
+	for (uint32_t node_id : changes.node_ids) {
+		auto node_it = _nodeLookup.find(node_id);
+		if (node_it == _nodeLookup.end())
+			continue;
+		std::shared_ptr<Node> node = node_it->second.lock();
+		if (node == nullptr)
+			continue;
+
+		data.modelMatrices_copy_infos.push_back({ .srcOffset = data.model_matrices.size() * sizeof(glm::mat4), .dstOffset = node_id * sizeof(glm::mat4), .size = sizeof(glm::mat4) });
+		data.model_matrices.push_back(node->get_WorldTransform());
+	}
+
+	//Primitive Infos
+	for (uint32_t primitive_id : changes.primitive_ids) {
+		auto primitive_it = _primitiveLookup.find(primitive_id);
+		if (primitive_it == _primitiveLookup.end())
+			continue;
+		std::shared_ptr<Node> node = primitive_it->second.node.lock();
+		if (node == nullptr || node->mesh == nullptr || primitive_it->second.primitive_index >= node->mesh->primitives.size())
+			continue;
+
+		const Mesh::Primitive& primitive = node->mesh->primitives[primitive_it->second.primitive_index];
+		data.primInfo_copy_infos.push_back({ .srcOffset = data.primitiveInfos.size() * sizeof(RenderShader::PrimitiveInfo), .dstOffset = primitive_id * sizeof(RenderShader::PrimitiveInfo), .size = sizeof(RenderShader::PrimitiveInfo) });
+		data.primitiveInfos.push_back(extract_primitiveInfo(primitive));
+	}
+
+	//Materials
+	for (uint32_t material_id : changes.material_ids) {
+		auto material_it = _materialLookup.find(material_id);
+		if (material_it == _materialLookup.end())
+			continue;
+		std::shared_ptr<Material> material = material_it->second.lock();
+		if (material == nullptr)
+			continue;
+
+		data.material_copy_infos.push_back({ .srcOffset = data.materials.size() * sizeof(RenderShader::Material), .dstOffset = material_id * sizeof(RenderShader::Material), .size = sizeof(RenderShader::Material) });
+		data.materials.push_back(extract_material(*material));
+	}
+
+	//Textures
+	for (uint32_t texture_id : changes.texture_ids) {
+		auto texture_it = _textureLookup.find(texture_id);
+		if (texture_it == _textureLookup.end())
+			continue;
+		std::shared_ptr<Texture> texture = texture_it->second.lock();
+		if (texture == nullptr)
+			continue;
+
+		data.texture_copy_infos.push_back({ .srcOffset = data.textures.size() * sizeof(RenderShader::Texture), .dstOffset = texture_id * sizeof(RenderShader::Texture), .size = sizeof(RenderShader::Texture) });
+		RenderShader::Texture tex{};
+		tex.textureImage_id = _imageSlots[texture->image_index];
+		tex.sampler_id = _samplerSlots[texture->sampler_index];
+		data.textures.push_back(tex);
+	}
+}
+
+RenderShader::PrimitiveInfo RenderSystem::extract_primitiveInfo(const Mesh::Primitive& primitive) {
+	RenderShader::PrimitiveInfo prmInfo{};
+	if (primitive.material.expired() != true)
+		prmInfo.mat_id = primitive.material.lock()->getID();
+	else
+		prmInfo.mat_id = 0;
+	prmInfo.bounds_min = primitive.bounds_min;
+	prmInfo.bounds_max = primitive.bounds_max;
+	return prmInfo;
+}
+
+RenderShader::Material RenderSystem::extract_material(const Material& material) {
+	RenderShader::Material mat{};
+
+	//Base Color
+	if (material.baseColor_texture.expired() != true)
+		mat.baseColor_texture_id = material.baseColor_texture.lock()->getID();
+	else
+		mat.baseColor_texture_id = 0;
+	mat.baseColor_texCoord_id = material.baseColor_coord_index;
+	mat.baseColor_factor = material.baseColor_Factor;
+
+	//Normal
+	if (material.normal_texture.expired() != true)
+		mat.normal_texture_id = material.normal_texture.lock()->getID();
+	else
+		mat.normal_texture_id = 0;
+	mat.normal_texcoord_id = material.normal_coord_index;
+	mat.normal_scale = material.normal_scale;
+
+	//Metal-Rough
+	if (material.metal_rough_texture.expired() != true)
+		mat.metal_rough_texture_id = material.metal_rough_texture.lock()->getID();
+	else
+		mat.metal_rough_texture_id = 0;
+	mat.metal_rough_texcoord_id = material.metal_rough_coord_index;
+	mat.metallic_factor = material.metallic_Factor;
+	mat.roughness_factor = material.roughness_Factor;
+
+	//Occlusion
+	if (material.occlusion_texture.expired() != true)
+		mat.occlusion_texture_id = material.occlusion_texture.lock()->getID();
+	else
+		mat.occlusion_texture_id = 0;
+	mat.occlusion_texcoord_id = material.occlusion_coord_index;
+	mat.occlusion_strength = material.occlusion_strength;
+
+	//Emission
+	if (material.emission_texture.expired() != true)
+		mat.emission_texture_id = material.emission_texture.lock()->getID();
+	else
+		mat.emission_texture_id = 0;
+	mat.emission_texcoord_id = material.emission_coord_index;
+	mat.emission_factor = material.emission_Factor;
+
+	return mat;
+}
+
 void RenderSystem::setup_hdrMap2() {
 	//Temp have file loading here. Might move loading code to loader.h/loader.cpp. And have only engine class actually initiate the load and pass the data to renderSystem.
 	//Load HDR Equirectangular Image and Create it's Sampler
@@ -1144,6 +2373,7 @@ void RenderSystem::setup_hdrMap2() {
 		imageSize.depth = 1;
 		hdrImage = _vkContext.create_image("HDR Image", imageSize, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, false);
 		_vkContext.update_image(hdrImage, data, 4 * imageSize.width * imageSize.height * imageSize.depth * 4);
+		_vkContext.flush_staged_uploads(); //The HDR Image is read by the cubemap compute submission below, which does not go through the Staged Uploads
 
 		stbi_image_free(data);
 	}
@@ -1699,12 +2929,16 @@ void RenderSystem::setup_hdrMap2() {
 	VkCommandBufferSubmitInfo cmdInfo = vkutil::command_buffer_submit_info(hdr_commandBuffer);
 	VkSubmitInfo2 submit = vkutil::submit_info(&cmdInfo, nullptr, nullptr);
 
-	VK_CHECK(vkQueueSubmit2(_vkContext.primaryQueue, 1, &submit, cubeMap_computeFence));
+	{
+		std::lock_guard<std::mutex> queueLock(_vkContext.queueSubmitMutex);
+		VK_CHECK(vkQueueSubmit2(_vkContext.primaryQueue, 1, &submit, cubeMap_computeFence));
+	}
 
 	//-Wait for Compute commands for both to finish
 	VK_CHECK(vkWaitForFences(_vkContext.device, 1, &cubeMap_computeFence, true, 1000000000));
 
 	//Delete Resources
+	_vkContext.release_mipmap_resources(hdr_commandBuffer);
 	vkDestroyFence(_vkContext.device, cubeMap_computeFence, nullptr);
 	vkDestroyCommandPool(_vkContext.device, hdr_commandPool, nullptr);
 	vkDestroyPipeline(_vkContext.device, specularLUT_pipeline, nullptr);
@@ -1836,7 +3070,7 @@ void RenderSystem::setup_skybox() {
 	pipelineBuilder.set_multisampling_none();
 	pipelineBuilder.disable_blending();
 	pipelineBuilder.enable_depthtest(true, VK_COMPARE_OP_GREATER_OR_EQUAL);
-	pipelineBuilder.set_color_attachment_format(VK_FORMAT_B8G8R8A8_UNORM);
+	pipelineBuilder.set_color_attachment_format(_swapchain.format);
 	pipelineBuilder.set_depth_format(VK_FORMAT_D32_SFLOAT);
 
 	_skyboxPipeline = pipelineBuilder.build_pipeline(_vkContext.device);
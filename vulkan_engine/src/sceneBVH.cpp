@@ -0,0 +1,378 @@
+#include "sceneBVH.h"
+
+#include <algorithm>
+#include <stack>
+#include <bit>
+#include <cmath>
+
+namespace {
+	//Spreads the lower 10 bits so there are two 0 bits between each
+	uint32_t expand_bits(uint32_t value) {
+		value = (value * 0x00010001u) & 0xFF0000FFu;
+		value = (value * 0x00000101u) & 0x0F00F00Fu;
+		value = (value * 0x00000011u) & 0xC30C30C3u;
+		value = (value * 0x00000005u) & 0x49249249u;
+		return value;
+	}
+
+	//30 bit Morton Code of a point normalized to [0, 1]
+	uint32_t morton_code(const glm::vec3& point) {
+		glm::vec3 quantized = glm::clamp(point * 1024.0f, glm::vec3(0.0f), glm::vec3(1023.0f));
+		return (expand_bits(static_cast<uint32_t>(quantized.x)) << 2) | (expand_bits(static_cast<uint32_t>(quantized.y)) << 1) | expand_bits(static_cast<uint32_t>(quantized.z));
+	}
+
+	//Slab test. Returns the distance the ray enters the box, or a negative value if it misses
+	float intersect_ray(const AABB& box, const glm::vec3& origin, const glm::vec3& inv_direction, float max_distance) {
+		glm::vec3 t0 = (box.min - origin) * inv_direction;
+		glm::vec3 t1 = (box.max - origin) * inv_direction;
+		glm::vec3 t_near = glm::min(t0, t1);
+		glm::vec3 t_far = glm::max(t0, t1);
+
+		float enter = std::max(std::max(t_near.x, t_near.y), std::max(t_near.z, 0.0f));
+		float exit = std::min(std::min(t_far.x, t_far.y), std::min(t_far.z, max_distance));
+		return enter <= exit ? enter : -1.0f;
+	}
+}
+
+AABB AABB::transformed(const glm::mat4& transform) const {
+	if (empty())
+		return AABB{};
+
+	//Arvo: The extents of the new box are the absolute rotated extents of the old one
+	glm::vec3 new_center = glm::vec3(transform * glm::vec4(center(), 1.0f));
+	glm::vec3 old_extents = extents();
+	glm::vec3 new_extents = glm::abs(glm::vec3(transform[0])) * old_extents.x + glm::abs(glm::vec3(transform[1])) * old_extents.y + glm::abs(glm::vec3(transform[2])) * old_extents.z;
+
+	return AABB{ .min = new_center - new_extents, .max = new_center + new_extents };
+}
+
+//Gribb-Hartmann. Same planes as the cull shader's
+Frustum Frustum::from_viewproj(const glm::mat4& viewproj) {
+	glm::mat4 rows = glm::transpose(viewproj);
+
+	Frustum frustum;
+	frustum.planes[0] = rows[3] + rows[0]; //Left
+	frustum.planes[1] = rows[3] - rows[0]; //Right
+	frustum.planes[2] = rows[3] + rows[1]; //Bottom
+	frustum.planes[3] = rows[3] - rows[1]; //Top
+	frustum.planes[4] = rows[2]; //z >= 0
+	frustum.planes[5] = rows[3] - rows[2]; //z <= w
+	return frustum;
+}
+
+Frustum::Result Frustum::classify(const AABB& box) const {
+	glm::vec3 center = box.center();
+	glm::vec3 extents = box.extents();
+
+	Result result = Result::Inside;
+	for (const glm::vec4& plane : planes) {
+		float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+		float radius = glm::dot(glm::abs(glm::vec3(plane)), extents);
+		if (distance < -radius)
+			return Result::Outside;
+		if (distance < radius)
+			result = Result::Intersecting;
+	}
+
+	return result;
+}
+
+AABB SceneBVH::local_bounds(const Node& node) {
+	AABB bounds{};
+	if (node.mesh == nullptr)
+		return bounds;
+
+	for (const Mesh::Primitive& primitive : node.mesh->primitives) {
+		bounds.expand(primitive.bounds_min);
+		bounds.expand(primitive.bounds_max);
+	}
+
+	return bounds;
+}
+
+void SceneBVH::build(const Scene& scene) {
+	clear();
+
+	//Gather Nodes with Meshes
+	std::stack<std::shared_ptr<Node>> dfs_node_stack;
+	for (const std::shared_ptr<Node>& root_node : scene.root_nodes)
+		dfs_node_stack.push(root_node);
+
+	AABB centroid_bounds{};
+	while (!dfs_node_stack.empty()) {
+		std::shared_ptr<Node> node = dfs_node_stack.top();
+		dfs_node_stack.pop();
+
+		for (const std::shared_ptr<Node>& child_node : node->child_nodes)
+			dfs_node_stack.push(child_node);
+
+		AABB node_local_bounds = local_bounds(*node);
+		if (node_local_bounds.empty())
+			continue;
+
+		Item item{ .node = node, .local_bounds = node_local_bounds, .bounds = node_local_bounds.transformed(node->get_WorldTransform()), .morton_code = 0 };
+		centroid_bounds.expand(item.bounds.center());
+		_items.push_back(std::move(item));
+	}
+
+	if (_items.empty())
+		return;
+
+	//Sort along the Morton Curve of the centroids
+	glm::vec3 centroid_size = glm::max(centroid_bounds.max - centroid_bounds.min, glm::vec3(FLT_EPSILON));
+	for (Item& item : _items)
+		item.morton_code = morton_code((item.bounds.center() - centroid_bounds.min) / centroid_size);
+
+	std::sort(_items.begin(), _items.end(), [](const Item& a, const Item& b) { return a.morton_code < b.morton_code; });
+
+	_itemLeaves.resize(_items.size());
+	_itemLookup.reserve(_items.size());
+	for (uint32_t i = 0; i < _items.size(); i++)
+		_itemLookup[_items[i].node->getID()] = i;
+
+	_tree.reserve(_items.size() * 2);
+	_tree.emplace_back();
+	build_subtree(0, 0, static_cast<uint32_t>(_items.size()) - 1);
+}
+
+void SceneBVH::clear() {
+	_items.clear();
+	_tree.clear();
+	_itemLeaves.clear();
+	_itemLookup.clear();
+}
+
+//Builds the subtree of the Items in [first, last] into the already allocated tree node
+void SceneBVH::build_subtree(uint32_t tree_index, uint32_t first, uint32_t last) {
+	uint32_t count = last - first + 1;
+	if (count <= MAX_LEAF_ITEMS) {
+		TreeNode& leaf = _tree[tree_index];
+		leaf.first = first;
+		leaf.item_count = count;
+		for (uint32_t i = first; i <= last; i++)
+			_itemLeaves[i] = tree_index;
+		update_leaf_bounds(leaf);
+		return;
+	}
+
+	uint32_t split = find_split(first, last);
+
+	//Allocate both Children together. _tree may reallocate, so the node is only referenced by index until the children are built
+	uint32_t left_index = static_cast<uint32_t>(_tree.size());
+	_tree.emplace_back();
+	_tree.emplace_back();
+	_tree[tree_index].first = left_index;
+	_tree[left_index].parent = tree_index;
+	_tree[left_index + 1].parent = tree_index;
+
+	build_subtree(left_index, first, split);
+	build_subtree(left_index + 1, split + 1, last);
+
+	update_internal_bounds(_tree[tree_index]);
+}
+
+//Last Item of the left half: where the highest differing bit of the Morton Codes in the range changes. Splits in the middle if all the codes are the same
+uint32_t SceneBVH::find_split(uint32_t first, uint32_t last) const {
+	uint32_t first_code = _items[first].morton_code;
+	uint32_t last_code = _items[last].morton_code;
+	if (first_code == last_code)
+		return (first + last) / 2;
+
+	int common_prefix = std::countl_zero(first_code ^ last_code);
+
+	//Binary search for the last Item that shares more than the common prefix with the first
+	uint32_t split = first;
+	uint32_t step = last - first;
+	do {
+		step = (step + 1) / 2;
+		uint32_t new_split = split + step;
+		if (new_split < last && std::countl_zero(first_code ^ _items[new_split].morton_code) > common_prefix)
+			split = new_split;
+	} while (step > 1);
+
+	return split;
+}
+
+void SceneBVH::update_leaf_bounds(TreeNode& leaf) {
+	leaf.bounds = AABB{};
+	for (uint32_t i = leaf.first; i < leaf.first + leaf.item_count; i++)
+		leaf.bounds.expand(_items[i].bounds);
+}
+
+void SceneBVH::update_internal_bounds(TreeNode& internal) {
+	internal.bounds = _tree[internal.first].bounds;
+	internal.bounds.expand(_tree[internal.first + 1].bounds);
+}
+
+void SceneBVH::refit(const std::unordered_set<uint32_t>& changed_node_ids) {
+	if (_tree.empty() || changed_node_ids.empty())
+		return;
+
+	std::vector<uint32_t> dirty_leaves;
+	for (uint32_t node_id : changed_node_ids) {
+		auto item_it = _itemLookup.find(node_id);
+		if (item_it == _itemLookup.end())
+			continue;
+
+		Item& item = _items[item_it->second];
+		item.bounds = item.local_bounds.transformed(item.node->get_WorldTransform());
+		dirty_leaves.push_back(_itemLeaves[item_it->second]);
+	}
+
+	if (dirty_leaves.empty())
+		return;
+
+	//When a large part of the Scene moved, refitting every node bottom up is cheaper than walking up from each leaf. Children come after their parents, so reverse order visits them first
+	if (dirty_leaves.size() * 4 > _items.size()) {
+		for (size_t i = _tree.size(); i-- > 0;) {
+			TreeNode& tree_node = _tree[i];
+			if (tree_node.item_count > 0)
+				update_leaf_bounds(tree_node);
+			else
+				update_internal_bounds(tree_node);
+		}
+		return;
+	}
+
+	std::sort(dirty_leaves.begin(), dirty_leaves.end());
+	dirty_leaves.erase(std::unique(dirty_leaves.begin(), dirty_leaves.end()), dirty_leaves.end());
+
+	for (uint32_t leaf_index : dirty_leaves) {
+		update_leaf_bounds(_tree[leaf_index]);
+
+		//Walk up until an ancestor's bounds stop changing
+		uint32_t parent_index = _tree[leaf_index].parent;
+		while (parent_index != INVALID_INDEX) {
+			TreeNode& parent = _tree[parent_index];
+			AABB old_bounds = parent.bounds;
+			update_internal_bounds(parent);
+			if (parent.bounds.min == old_bounds.min && parent.bounds.max == old_bounds.max)
+				break;
+			parent_index = parent.parent;
+		}
+	}
+}
+
+void SceneBVH::query_frustum(const Frustum& frustum, std::vector<std::shared_ptr<Node>>& results) const {
+	if (_tree.empty())
+		return;
+
+	std::vector<uint32_t> tree_stack{ 0 };
+	while (!tree_stack.empty()) {
+		const TreeNode& tree_node = _tree[tree_stack.back()];
+		tree_stack.pop_back();
+
+		Frustum::Result result = frustum.classify(tree_node.bounds);
+		if (result == Frustum::Result::Outside)
+			continue;
+
+		if (tree_node.item_count > 0) {
+			for (uint32_t i = tree_node.first; i < tree_node.first + tree_node.item_count; i++) {
+				if (result == Frustum::Result::Inside || frustum.classify(_items[i].bounds) != Frustum::Result::Outside)
+					results.push_back(_items[i].node);
+			}
+			continue;
+		}
+
+		//Everything under a node that's fully inside is visible without testing further
+		if (result == Frustum::Result::Inside) {
+			std::vector<uint32_t> subtree_stack{ tree_node.first, tree_node.first + 1 };
+			while (!subtree_stack.empty()) {
+				const TreeNode& subtree_node = _tree[subtree_stack.back()];
+				subtree_stack.pop_back();
+
+				if (subtree_node.item_count > 0) {
+					for (uint32_t i = subtree_node.first; i < subtree_node.first + subtree_node.item_count; i++)
+						results.push_back(_items[i].node);
+				}
+				else {
+					subtree_stack.push_back(subtree_node.first);
+					subtree_stack.push_back(subtree_node.first + 1);
+				}
+			}
+			continue;
+		}
+
+		tree_stack.push_back(tree_node.first);
+		tree_stack.push_back(tree_node.first + 1);
+	}
+}
+
+void SceneBVH::query_overlap(const AABB& box, std::vector<std::shared_ptr<Node>>& results) const {
+	if (_tree.empty())
+		return;
+
+	std::vector<uint32_t> tree_stack{ 0 };
+	while (!tree_stack.empty()) {
+		const TreeNode& tree_node = _tree[tree_stack.back()];
+		tree_stack.pop_back();
+
+		if (!tree_node.bounds.overlaps(box))
+			continue;
+
+		if (tree_node.item_count > 0) {
+			for (uint32_t i = tree_node.first; i < tree_node.first + tree_node.item_count; i++) {
+				if (_items[i].bounds.overlaps(box))
+					results.push_back(_items[i].node);
+			}
+		}
+		else {
+			tree_stack.push_back(tree_node.first);
+			tree_stack.push_back(tree_node.first + 1);
+		}
+	}
+}
+
+bool SceneBVH::query_ray(const Ray& ray, RayHit& hit, float max_distance) const {
+	if (_tree.empty())
+		return false;
+
+	glm::vec3 inv_direction = 1.0f / ray.direction; //Zero components become infinity, which the slab test handles
+	float nearest = max_distance;
+	const Item* nearest_item = nullptr;
+
+	std::vector<uint32_t> tree_stack{ 0 };
+	while (!tree_stack.empty()) {
+		const TreeNode& tree_node = _tree[tree_stack.back()];
+		tree_stack.pop_back();
+
+		if (intersect_ray(tree_node.bounds, ray.origin, inv_direction, nearest) < 0.0f)
+			continue;
+
+		if (tree_node.item_count > 0) {
+			for (uint32_t i = tree_node.first; i < tree_node.first + tree_node.item_count; i++) {
+				float distance = intersect_ray(_items[i].bounds, ray.origin, inv_direction, nearest);
+				if (distance >= 0.0f && (nearest_item == nullptr || distance < nearest)) {
+					nearest = distance;
+					nearest_item = &_items[i];
+				}
+			}
+			continue;
+		}
+
+		//Visit the nearer Child first so farther subtrees are more likely to be skipped
+		float left_distance = intersect_ray(_tree[tree_node.first].bounds, ray.origin, inv_direction, nearest);
+		float right_distance = intersect_ray(_tree[tree_node.first + 1].bounds, ray.origin, inv_direction, nearest);
+		if (left_distance >= 0.0f && right_distance >= 0.0f) {
+			bool left_first = left_distance <= right_distance;
+			tree_stack.push_back(left_first ? tree_node.first + 1 : tree_node.first);
+			tree_stack.push_back(left_first ? tree_node.first : tree_node.first + 1);
+		}
+		else if (left_distance >= 0.0f)
+			tree_stack.push_back(tree_node.first);
+		else if (right_distance >= 0.0f)
+			tree_stack.push_back(tree_node.first + 1);
+	}
+
+	if (nearest_item == nullptr)
+		return false;
+
+	hit.node = nearest_item->node;
+	hit.distance = nearest;
+	return true;
+}
+
+const AABB& SceneBVH::bounds() const {
+	static const AABB empty_bounds{};
+	return _tree.empty() ? empty_bounds : _tree[0].bounds;
+}
@@ -0,0 +1,88 @@
+#include "sceneGeometry.h"
+
+#include <stack>
+
+namespace scenegeometry {
+
+	void gather(const Scene& scene, const GeometryOutputs& outputs, std::unordered_map<uint32_t, GeometryRange>& registry, std::vector<InstanceBatch>& batches,
+		const NodeVisitor& visit_node, const PrimitiveVisitor& visit_primitive) {
+		registry.clear();
+		batches.clear();
+		uint32_t index_cursor = 0;
+		int32_t vertex_cursor = 0;
+		uint32_t meshlet_cursor = 0;
+
+		//Add all root nodes in the scene to Stack
+		std::stack<std::shared_ptr<Node>> dfs_node_stack;
+		for (const std::shared_ptr<Node>& root_node : scene.root_nodes) {
+			dfs_node_stack.push(root_node);
+		}
+		//Perform DFS, traverse all Nodes
+		while (!dfs_node_stack.empty()) {
+			std::shared_ptr<Node> node = std::move(dfs_node_stack.top());
+			dfs_node_stack.pop();
+
+			//Add currentNode's children to Stack
+			for (const std::shared_ptr<Node>& child_node : node->child_nodes) {
+				dfs_node_stack.push(child_node);
+			}
+
+			if (visit_node)
+				visit_node(node);
+
+			//Check if Node represents Mesh
+			if (node->mesh == nullptr)
+				continue;
+
+			const std::shared_ptr<Mesh>& currentMesh = node->mesh;
+			for (size_t primitive_index = 0; primitive_index < currentMesh->primitives.size(); primitive_index++) {
+				const Mesh::Primitive& primitive = currentMesh->primitives[primitive_index];
+
+				//Register the Primitive's geometry the first time it's reached. Later Nodes sharing the Mesh reuse its range instead of adding the geometry again
+				auto [geometry_it, first_use] = registry.try_emplace(primitive.getID());
+				if (first_use) {
+					geometry_it->second = { .firstIndex = index_cursor, .indexCount = static_cast<uint32_t>(primitive.index_count()), .vertexOffset = vertex_cursor, .batchIndex = static_cast<uint32_t>(batches.size()),
+						.firstMeshlet = meshlet_cursor, .meshletCount = static_cast<uint32_t>(primitive.meshlets.size()) };
+					batches.push_back({ .primitive_id = primitive.getID() });
+					index_cursor += static_cast<uint32_t>(primitive.index_count());
+					vertex_cursor += static_cast<int32_t>(primitive.vertex_count());
+					meshlet_cursor += static_cast<uint32_t>(primitive.meshlets.size());
+
+					//Vertex's Position and other Vertex Attributes. Already in GPU layout when it has GPU ready geometry, so copy it over in bulk
+					if (outputs.positions && primitive.has_gpu_geometry())
+						outputs.positions->insert(outputs.positions->end(), primitive.gpu_geometry.positions.begin(), primitive.gpu_geometry.positions.end());
+					else if (outputs.positions)
+						outputs.positions->insert(outputs.positions->end(), primitive.vertices.positions.begin(), primitive.vertices.positions.end());
+
+					if (outputs.attributes && primitive.has_gpu_geometry())
+						outputs.attributes->insert(outputs.attributes->end(), primitive.gpu_geometry.attributes.begin(), primitive.gpu_geometry.attributes.end());
+					else if (outputs.attributes)
+						primitive.append_vertex_attributes(*outputs.attributes);
+
+					//Indices
+					if (outputs.indices && primitive.has_gpu_geometry())
+						outputs.indices->insert(outputs.indices->end(), primitive.gpu_geometry.indices.begin(), primitive.gpu_geometry.indices.end());
+					else if (outputs.indices)
+						outputs.indices->insert(outputs.indices->end(), primitive.indices.begin(), primitive.indices.end());
+
+					//Meshlets. Their offsets are relative to the Primitive, so rebase them onto the global buffers
+					if (outputs.meshlets) {
+						uint32_t data_base = static_cast<uint32_t>(outputs.meshlet_data->size());
+						for (MeshShader::Meshlet meshlet : primitive.meshlets) {
+							meshlet.data_offset += data_base;
+							meshlet.vertex_offset = static_cast<uint32_t>(geometry_it->second.vertexOffset);
+							outputs.meshlets->push_back(meshlet);
+						}
+						outputs.meshlet_data->insert(outputs.meshlet_data->end(), primitive.meshlet_data.begin(), primitive.meshlet_data.end());
+					}
+
+					if (visit_primitive)
+						visit_primitive(node, primitive_index);
+				}
+
+				//Add this Node as another instance of the Primitive's batch
+				batches[geometry_it->second.batchIndex].model_matrix_ids.push_back(node->getID());
+			}
+		}
+	}
+}
@@ -0,0 +1,105 @@
+#include "streamingPolicy.h"
+#include "textureCompression.h"
+
+#include <algorithm>
+
+namespace streamingpolicy {
+
+	uint64_t resident_bytes(const ImageState& image, uint32_t level) {
+		return texcompress::chain_size(image.format, std::max(image.extent.width >> level, 1u), std::max(image.extent.height >> level, 1u), image.levelCount - level);
+	}
+
+	uint64_t plan_budget(uint64_t deviceBudget, uint64_t deviceUsage, uint64_t residentBytes, uint32_t budgetMB) {
+		uint64_t headroom = static_cast<uint64_t>(deviceBudget * BUDGET_HEADROOM);
+		uint64_t freeBytes = deviceUsage + headroom < deviceBudget ? deviceBudget - deviceUsage - headroom : 0;
+		uint64_t budget = residentBytes + freeBytes;
+		if (budgetMB != 0)
+			budget = std::min(budget, static_cast<uint64_t>(budgetMB) << 20);
+		return budget;
+	}
+
+	//Trims first, as dropping unwanted levels frees room for the rest. Then evicts if still over budget, and streams in what fits with what's left of the frame's uploads.
+	//Every change re-uploads the Image's whole resident range, which is what counts against the upload cap
+	std::vector<size_t> plan_residency(std::span<ImageState> images, uint64_t& residentBytes, uint64_t budgetBytes) {
+		std::vector<size_t> changed;
+		std::vector<bool> isChanged(images.size(), false);
+		uint64_t uploadBytes = 0;
+		auto can_upload = [&](uint64_t bytes) { return uploadBytes == 0 || uploadBytes + bytes <= UPLOAD_BYTES_PER_FRAME; };
+		auto set_level = [&](size_t i, uint32_t level) {
+			ImageState& image = images[i];
+			uint64_t levelsBytes = resident_bytes(image, level);
+			residentBytes = residentBytes - resident_bytes(image, image.residentLevel) + levelsBytes;
+			uploadBytes += levelsBytes;
+			image.residentLevel = level;
+			if (!isChanged[i]) {
+				isChanged[i] = true;
+				changed.push_back(i);
+			}
+		};
+
+		//Drop the levels no longer wanted
+		for (size_t i = 0; i < images.size(); i++) {
+			uint32_t level = images[i].wantedLevel;
+			if (level <= images[i].residentLevel || !can_upload(resident_bytes(images[i], level)))
+				continue;
+
+			set_level(i, level);
+		}
+
+		//Over budget, so the least recently sampled Images lose levels until it fits, larger ones first among equally recent. Not held to the upload cap, as it only shrinks what's resident
+		if (residentBytes > budgetBytes) {
+			std::vector<size_t> candidates;
+			for (size_t i = 0; i < images.size(); i++) {
+				if (images[i].residentLevel < images[i].tailLevel)
+					candidates.push_back(i);
+			}
+			std::sort(candidates.begin(), candidates.end(), [&](size_t a, size_t b) {
+				if (images[a].lastSampledFrame != images[b].lastSampledFrame)
+					return images[a].lastSampledFrame < images[b].lastSampledFrame;
+				return resident_bytes(images[a], images[a].residentLevel) > resident_bytes(images[b], images[b].residentLevel);
+			});
+
+			for (size_t i : candidates) {
+				if (residentBytes <= budgetBytes)
+					break;
+
+				ImageState& image = images[i];
+				uint32_t level = image.residentLevel;
+				uint64_t projectedBytes = residentBytes;
+				while (projectedBytes > budgetBytes && level < image.tailLevel) {
+					projectedBytes -= resident_bytes(image, level) - resident_bytes(image, level + 1);
+					level++;
+				}
+
+				set_level(i, level);
+
+				//Not streamed back in this frame. Later frames only stream it in while it fits
+				image.wantedLevel = std::max(image.wantedLevel, level);
+			}
+		}
+
+		//Stream in one level at a time, the Images furthest from what they want first, so everything on screen sharpens together
+		std::vector<size_t> requests;
+		for (size_t i = 0; i < images.size(); i++) {
+			if (images[i].wantedLevel < images[i].residentLevel)
+				requests.push_back(i);
+		}
+		std::sort(requests.begin(), requests.end(), [&](size_t a, size_t b) {
+			return images[a].residentLevel - images[a].wantedLevel > images[b].residentLevel - images[b].wantedLevel;
+		});
+
+		for (size_t i : requests) {
+			ImageState& image = images[i];
+			uint32_t level = image.residentLevel - 1;
+			uint64_t bytes = resident_bytes(image, level);
+			if (residentBytes + bytes - resident_bytes(image, image.residentLevel) > budgetBytes)
+				continue;
+			if (!can_upload(bytes))
+				break;
+
+			set_level(i, level);
+		}
+
+		return changed;
+	}
+}
@@ -0,0 +1,286 @@
+#include "textureCompression.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+namespace {
+	//Bytes per 4x4 block, or per texel for uncompressed formats. 0 if Textures can't use the format
+	uint32_t block_bytes(VkFormat format) {
+		switch (format) {
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		case VK_FORMAT_BC4_UNORM_BLOCK:
+			return 8;
+		case VK_FORMAT_BC3_UNORM_BLOCK:
+		case VK_FORMAT_BC3_SRGB_BLOCK:
+		case VK_FORMAT_BC5_UNORM_BLOCK:
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+		case VK_FORMAT_BC7_SRGB_BLOCK:
+			return 16;
+		case VK_FORMAT_R8G8B8A8_UNORM:
+		case VK_FORMAT_R8G8B8A8_SRGB:
+			return 4;
+		default:
+			return 0;
+		}
+	}
+
+	//Texels of a block, row by row. Blocks past the image's edge repeat its last row and column
+	struct Block {
+		unsigned char texels[16][4];
+
+		Block(const unsigned char* rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY) {
+			for (uint32_t y = 0; y < 4; y++) {
+				uint32_t srcY = std::min(blockY * 4 + y, height - 1);
+				for (uint32_t x = 0; x < 4; x++) {
+					uint32_t srcX = std::min(blockX * 4 + x, width - 1);
+					memcpy(texels[y * 4 + x], rgba + (static_cast<size_t>(srcY) * width + srcX) * 4, 4);
+				}
+			}
+		}
+	};
+
+	uint16_t pack_565(const float color[3]) {
+		uint32_t r = static_cast<uint32_t>(std::clamp(color[0], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+		uint32_t g = static_cast<uint32_t>(std::clamp(color[1], 0.0f, 255.0f) * 63.0f / 255.0f + 0.5f);
+		uint32_t b = static_cast<uint32_t>(std::clamp(color[2], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	void unpack_565(uint16_t packed, int color[3]) {
+		int r = (packed >> 11) & 31;
+		int g = (packed >> 5) & 63;
+		int b = packed & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	//Endpoints are the texels furthest apart along the colors' principal axis. Always 4 color mode, which BC3's color block requires
+	void encode_bc1_block(const Block& block, unsigned char* dst) {
+		float mean[3] = { 0.0f, 0.0f, 0.0f };
+		for (const auto& texel : block.texels) {
+			for (int c = 0; c < 3; c++)
+				mean[c] += texel[c] / 16.0f;
+		}
+
+		float covariance[3][3] = {};
+		for (const auto& texel : block.texels) {
+			float centered[3] = { texel[0] - mean[0], texel[1] - mean[1], texel[2] - mean[2] };
+			for (int row = 0; row < 3; row++) {
+				for (int column = 0; column < 3; column++)
+					covariance[row][column] += centered[row] * centered[column];
+			}
+		}
+
+		//Power Iteration for the principal axis, starting from the covariance row of the channel varying most so it can't start orthogonal to the axis
+		int widest = 0;
+		for (int c = 1; c < 3; c++) {
+			if (covariance[c][c] > covariance[widest][widest])
+				widest = c;
+		}
+		float axis[3] = { covariance[widest][0], covariance[widest][1], covariance[widest][2] };
+		for (int i = 0; i < 8; i++) {
+			float next[3] = {};
+			for (int row = 0; row < 3; row++) {
+				for (int column = 0; column < 3; column++)
+					next[row] += covariance[row][column] * axis[column];
+			}
+			float length = std::max({ std::abs(next[0]), std::abs(next[1]), std::abs(next[2]) });
+			if (length == 0.0f)
+				break;
+			for (int c = 0; c < 3; c++)
+				axis[c] = next[c] / length;
+		}
+
+		int minIndex = 0, maxIndex = 0;
+		float minProjection = 0.0f, maxProjection = 0.0f;
+		for (int i = 0; i < 16; i++) {
+			float projection = block.texels[i][0] * axis[0] + block.texels[i][1] * axis[1] + block.texels[i][2] * axis[2];
+			if (i == 0 || projection < minProjection) {
+				minProjection = projection;
+				minIndex = i;
+			}
+			if (i == 0 || projection > maxProjection) {
+				maxProjection = projection;
+				maxIndex = i;
+			}
+		}
+
+		float maxColor[3] = { float(block.texels[maxIndex][0]), float(block.texels[maxIndex][1]), float(block.texels[maxIndex][2]) };
+		float minColor[3] = { float(block.texels[minIndex][0]), float(block.texels[minIndex][1]), float(block.texels[minIndex][2]) };
+		uint16_t color0 = pack_565(maxColor);
+		uint16_t color1 = pack_565(minColor);
+		if (color0 < color1)
+			std::swap(color0, color1);
+
+		uint32_t indices = 0;
+		if (color0 != color1) {
+			int palette[4][3];
+			unpack_565(color0, palette[0]);
+			unpack_565(color1, palette[1]);
+			for (int c = 0; c < 3; c++) {
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+
+			for (int i = 0; i < 16; i++) {
+				uint32_t best = 0;
+				int bestDistance = INT32_MAX;
+				for (uint32_t p = 0; p < 4; p++) {
+					int distance = 0;
+					for (int c = 0; c < 3; c++) {
+						int difference = block.texels[i][c] - palette[p][c];
+						distance += difference * difference;
+					}
+					if (distance < bestDistance) {
+						bestDistance = distance;
+						best = p;
+					}
+				}
+				indices |= best << (i * 2);
+			}
+		}
+
+		memcpy(dst, &color0, 2);
+		memcpy(dst + 2, &color1, 2);
+		memcpy(dst + 4, &indices, 4);
+	}
+
+	//8 value mode between the channel's extremes. Used for BC4, both halves of BC5 and BC3's alpha
+	void encode_bc4_block(const Block& block, int channel, unsigned char* dst) {
+		int minValue = 255, maxValue = 0;
+		for (const auto& texel : block.texels) {
+			minValue = std::min<int>(minValue, texel[channel]);
+			maxValue = std::max<int>(maxValue, texel[channel]);
+		}
+
+		uint64_t indices = 0;
+		if (maxValue != minValue) {
+			int palette[8];
+			palette[0] = maxValue;
+			palette[1] = minValue;
+			for (int k = 1; k < 7; k++)
+				palette[k + 1] = ((7 - k) * maxValue + k * minValue + 3) / 7;
+
+			for (int i = 0; i < 16; i++) {
+				uint64_t best = 0;
+				int bestDistance = INT32_MAX;
+				for (uint64_t p = 0; p < 8; p++) {
+					int distance = std::abs(block.texels[i][channel] - palette[p]);
+					if (distance < bestDistance) {
+						bestDistance = distance;
+						best = p;
+					}
+				}
+				indices |= best << (i * 3);
+			}
+		}
+
+		dst[0] = static_cast<unsigned char>(maxValue);
+		dst[1] = static_cast<unsigned char>(minValue);
+		for (int b = 0; b < 6; b++)
+			dst[2 + b] = static_cast<unsigned char>(indices >> (b * 8));
+	}
+}
+
+namespace texcompress {
+
+	bool is_supported(VkFormat format) {
+		return block_bytes(format) != 0;
+	}
+
+	bool is_block_compressed(VkFormat format) {
+		return is_supported(format) && format != VK_FORMAT_R8G8B8A8_UNORM && format != VK_FORMAT_R8G8B8A8_SRGB;
+	}
+
+	VkFormat srgb_format(VkFormat format) {
+		switch (format) {
+		case VK_FORMAT_R8G8B8A8_UNORM:
+			return VK_FORMAT_R8G8B8A8_SRGB;
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+			return VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+			return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+		case VK_FORMAT_BC3_UNORM_BLOCK:
+			return VK_FORMAT_BC3_SRGB_BLOCK;
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+			return VK_FORMAT_BC7_SRGB_BLOCK;
+		default:
+			return format;
+		}
+	}
+
+	uint64_t level_size(VkFormat format, uint32_t width, uint32_t height) {
+		if (!is_block_compressed(format))
+			return static_cast<uint64_t>(width) * height * block_bytes(format);
+		return static_cast<uint64_t>((width + BLOCK_DIM - 1) / BLOCK_DIM) * ((height + BLOCK_DIM - 1) / BLOCK_DIM) * block_bytes(format);
+	}
+
+	uint64_t chain_size(VkFormat format, uint32_t width, uint32_t height, uint32_t levelCount) {
+		uint64_t size = 0;
+		for (uint32_t level = 0; level < levelCount; level++)
+			size += level_size(format, std::max(width >> level, 1u), std::max(height >> level, 1u));
+		return size;
+	}
+
+	VkFormat choose_format(uint32_t roles, bool hasAlpha) {
+		VkFormat format;
+		if (roles == IMAGE_ROLE_NORMAL)
+			format = VK_FORMAT_BC5_UNORM_BLOCK;
+		else if (roles == IMAGE_ROLE_OCCLUSION)
+			format = VK_FORMAT_BC4_UNORM_BLOCK;
+		else if (roles == 0 || (roles & IMAGE_ROLE_NORMAL))
+			format = VK_FORMAT_R8G8B8A8_UNORM;
+		else
+			format = hasAlpha ? VK_FORMAT_BC3_UNORM_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+
+		return (roles & IMAGE_ROLE_COLOR) ? srgb_format(format) : format;
+	}
+
+	bool has_alpha(const unsigned char* rgba, size_t texelCount) {
+		for (size_t i = 0; i < texelCount; i++) {
+			if (rgba[i * 4 + 3] != 255)
+				return true;
+		}
+		return false;
+	}
+
+	void encode_rows(VkFormat format, const unsigned char* rgba, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t rowCount, unsigned char* dst) {
+		uint32_t blocksWide = (width + BLOCK_DIM - 1) / BLOCK_DIM;
+		uint32_t bytes = block_bytes(format);
+
+		for (uint32_t blockY = firstRow; blockY < firstRow + rowCount; blockY++) {
+			for (uint32_t blockX = 0; blockX < blocksWide; blockX++) {
+				Block block(rgba, width, height, blockX, blockY);
+				unsigned char* out = dst + (static_cast<size_t>(blockY) * blocksWide + blockX) * bytes;
+
+				switch (format) {
+				case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+				case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+				case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+				case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+					encode_bc1_block(block, out);
+					break;
+				case VK_FORMAT_BC3_UNORM_BLOCK:
+				case VK_FORMAT_BC3_SRGB_BLOCK:
+					encode_bc4_block(block, 3, out);
+					encode_bc1_block(block, out + 8);
+					break;
+				case VK_FORMAT_BC4_UNORM_BLOCK:
+					encode_bc4_block(block, 0, out);
+					break;
+				case VK_FORMAT_BC5_UNORM_BLOCK:
+					encode_bc4_block(block, 0, out);
+					encode_bc4_block(block, 1, out + 8);
+					break;
+				default:
+					break;
+				}
+			}
+		}
+	}
+}
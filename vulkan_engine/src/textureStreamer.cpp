@@ -0,0 +1,125 @@
+#include "textureStreamer.h"
+#include "renderSystem.h"
+#include "textureCompression.h"
+#include "loader.h"
+
+#include <algorithm>
+#include <format>
+
+bool TextureStreamer::is_streamed(VkExtent3D extent) {
+	return std::max(extent.width, extent.height) > TAIL_SIZE;
+}
+
+uint32_t TextureStreamer::tail_level(VkExtent3D extent) {
+	uint32_t level = 0;
+	while (std::max(extent.width >> level, extent.height >> level) > TAIL_SIZE)
+		level++;
+	return level;
+}
+
+void TextureStreamer::update(GraphicsDataPayload& payload, RenderSystem& renderSys, uint32_t budgetMB) {
+	int frameNumber = renderSys.get_frameNumber();
+
+	destroy_retired(frameNumber);
+	register_images(payload, frameNumber);
+	read_feedback(renderSys.get_textureFeedback(), frameNumber);
+	_budgetBytes = compute_budget(budgetMB, frameNumber);
+
+	for (size_t index : streamingpolicy::plan_residency(_images, _residentBytes, _budgetBytes))
+		make_resident(index, payload, renderSys);
+}
+
+void TextureStreamer::shutdown() {
+	for (RetiredImage& retired : _retired)
+		_vkContext.destroy_image(retired.image);
+	_retired.clear();
+}
+
+//The payload only appends streamed Images, so only the new ones are registered. They keep what they were loaded with until the feedback says otherwise
+void TextureStreamer::register_images(const GraphicsDataPayload& payload, int frameNumber) {
+	for (size_t i = _sources.size(); i < payload.streamedImages.size(); i++) {
+		const StreamedImageSource& source = payload.streamedImages[i];
+		_sources.push_back(source);
+
+		streamingpolicy::ImageState image{};
+		image.image_index = source.image_index;
+		image.extent = source.extent;
+		image.format = source.format;
+		image.levelCount = source.levelCount;
+		image.residentLevel = source.residentLevel;
+		image.tailLevel = tail_level(source.extent);
+		image.wantedLevel = source.residentLevel;
+		image.wantedFrame = frameNumber;
+		image.lastSampledFrame = frameNumber;
+		_images.push_back(image);
+
+		_residentBytes += streamingpolicy::resident_bytes(image, image.residentLevel);
+	}
+}
+
+//A detail of d wants 2^(d - 1) texels per UV unit, which level (levelCount - d) provides. Finer requests apply at once, coarser ones only after UNUSED_FRAMES without a finer one, so Images at the edge of a level don't thrash
+void TextureStreamer::read_feedback(std::span<const uint8_t> feedback, int frameNumber) {
+	for (streamingpolicy::ImageState& image : _images) {
+		uint8_t detail = image.image_index < feedback.size() ? feedback[image.image_index] : TEXTURE_FEEDBACK_NONE;
+
+		if (detail != TEXTURE_FEEDBACK_NONE) {
+			image.lastSampledFrame = frameNumber;
+
+			uint32_t level = std::min(detail < image.levelCount ? image.levelCount - detail : 0, image.tailLevel);
+			if (level <= image.wantedLevel || frameNumber - image.wantedFrame > UNUSED_FRAMES) {
+				image.wantedLevel = level;
+				image.wantedFrame = frameNumber;
+			}
+		}
+		else if (frameNumber - image.lastSampledFrame > UNUSED_FRAMES) {
+			image.wantedLevel = image.tailLevel;
+		}
+	}
+}
+
+//Sums the device local heaps' budgets and usage, refreshed from VK_EXT_memory_budget where supported
+uint64_t TextureStreamer::compute_budget(uint32_t budgetMB, int frameNumber) {
+	vmaSetCurrentFrameIndex(_vkContext.allocator, static_cast<uint32_t>(frameNumber)); //VMA refreshes the heap budgets from VK_EXT_memory_budget per frame index
+
+	const VkPhysicalDeviceMemoryProperties* memoryProperties;
+	vmaGetMemoryProperties(_vkContext.allocator, &memoryProperties);
+	VmaBudget heapBudgets[VK_MAX_MEMORY_HEAPS];
+	vmaGetHeapBudgets(_vkContext.allocator, heapBudgets);
+
+	uint64_t deviceBudget = 0;
+	uint64_t deviceUsage = 0;
+	for (uint32_t heap = 0; heap < memoryProperties->memoryHeapCount; heap++) {
+		if (memoryProperties->memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+			deviceBudget += heapBudgets[heap].budget;
+			deviceUsage += heapBudgets[heap].usage;
+		}
+	}
+
+	return streamingpolicy::plan_budget(deviceBudget, deviceUsage, _residentBytes, budgetMB);
+}
+
+//Textures move to the new image with the next Texture buffer update, and the old one stays bound in its retired slot until the frames that may read it are done
+void TextureStreamer::make_resident(size_t index, GraphicsDataPayload& payload, RenderSystem& renderSys) {
+	const StreamedImageSource& source = _sources[index];
+	uint32_t level = _images[index].residentLevel;
+	VkExtent3D extent{ .width = std::max(source.extent.width >> level, 1u), .height = std::max(source.extent.height >> level, 1u), .depth = 1 };
+	uint64_t levelsOffset = texcompress::chain_size(source.format, source.extent.width, source.extent.height, level);
+	uint64_t levelsSize = streamingpolicy::resident_bytes(_images[index], level);
+
+	AllocatedImage image = _vkContext.create_image(std::format("Streamed Image {}", source.image_index).c_str(), extent, source.format, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, true);
+	_vkContext.update_image(image, source.mapping->data() + source.dataOffset + levelsOffset, levelsSize, mip_copy_regions(source.format, extent, source.levelCount - level));
+
+	_retired.push_back({ .image = payload.images[source.image_index], .lastReadingFrame = renderSys.rebind_image(source.image_index, image) });
+	payload.images[source.image_index] = image;
+}
+
+//The last draw waited on the fence of frame (frameNumber - FRAMES_TOTAL - 1), so every frame up to it has completed
+void TextureStreamer::destroy_retired(int frameNumber) {
+	std::erase_if(_retired, [&](const RetiredImage& retired) {
+		if (retired.lastReadingFrame + FRAMES_TOTAL >= static_cast<uint64_t>(frameNumber))
+			return false;
+
+		_vkContext.destroy_image(retired.image);
+		return true;
+	});
+}
@@ -0,0 +1,140 @@
+#include "threadPool.h"
+
+#include <algorithm>
+#include <exception>
+
+ThreadPool::ThreadPool(uint32_t threadCount) {
+	//hardware_concurrency() may return 0 when it can't tell, so clamp before leaving a core to the caller
+	if (threadCount == 0) {
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	_queues.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; i++) {
+		_queues.push_back(std::make_unique<WorkerQueue>());
+	}
+
+	_workers.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; i++) {
+		_workers.emplace_back(&ThreadPool::worker_loop, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+		_stopping = true;
+	}
+	_taskAvailable.notify_all();
+
+	for (std::thread& worker : _workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+	//Workers push onto their own queue so the task stays local, everyone else spreads tasks across the queues
+	uint32_t queueIndex;
+	if (_workerIndex >= 0 && static_cast<size_t>(_workerIndex) < _queues.size())
+		queueIndex = static_cast<uint32_t>(_workerIndex);
+	else
+		queueIndex = _nextQueue++ % _queues.size();
+
+	//Count the task before it becomes visible so the count never drops below zero when it is taken immediately
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+		_queuedTasks++;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_queues[queueIndex]->mutex);
+		_queues[queueIndex]->tasks.push_back(std::move(task));
+	}
+	_taskAvailable.notify_one();
+}
+
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)>& func) {
+	if (count == 0)
+		return;
+
+	size_t remaining = count;
+	std::exception_ptr firstException;
+	std::mutex doneMutex;
+	std::condition_variable done;
+
+	//A throwing task still counts as done, so the caller never waits on it forever
+	for (size_t i = 0; i < count; i++) {
+		submit([&, i]() {
+			std::exception_ptr exception;
+			try {
+				func(i);
+			}
+			catch (...) {
+				exception = std::current_exception();
+			}
+
+			std::lock_guard<std::mutex> lock(doneMutex);
+			if (exception && !firstException)
+				firstException = exception;
+			if (--remaining == 0)
+				done.notify_all();
+		});
+	}
+
+	//Help run tasks instead of idling. Tasks of other callers may also be run here
+	std::function<void()> task;
+	uint32_t startIndex = _workerIndex >= 0 ? static_cast<uint32_t>(_workerIndex) : 0;
+	while (try_take(startIndex, task)) {
+		task();
+	}
+
+	//Every queue was empty, so each of this call's tasks has been taken and the rest are running on other threads
+	std::unique_lock<std::mutex> lock(doneMutex);
+	done.wait(lock, [&]() { return remaining == 0; });
+
+	if (firstException)
+		std::rethrow_exception(firstException);
+}
+
+void ThreadPool::worker_loop(uint32_t index) {
+	_workerIndex = static_cast<int32_t>(index);
+
+	std::function<void()> task;
+	while (true) {
+		if (try_take(index, task)) {
+			task();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(_sleepMutex);
+		_taskAvailable.wait(lock, [&]() { return _stopping || _queuedTasks > 0; });
+		if (_stopping && _queuedTasks == 0)
+			return;
+	}
+}
+
+//Takes a task from the back of the queue at startIndex, otherwise steals from the front of the other queues
+bool ThreadPool::try_take(uint32_t startIndex, std::function<void()>& task) {
+	for (size_t offset = 0; offset < _queues.size(); offset++) {
+		size_t queueIndex = (startIndex + offset) % _queues.size();
+		WorkerQueue& queue = *_queues[queueIndex];
+
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty())
+			continue;
+
+		if (offset == 0) {
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		}
+		else {
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		}
+		_queuedTasks--;
+		return true;
+	}
+
+	return false;
+}
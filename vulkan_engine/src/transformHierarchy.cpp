@@ -0,0 +1,125 @@
+#include "transformHierarchy.h"
+
+#include "graphic_data_types.h"
+#include "threadPool.h"
+#include "transformKernels.h"
+
+#include <stack>
+#include <algorithm>
+
+std::shared_ptr<TransformHierarchy> TransformHierarchy::create(const Scene& scene) {
+	std::shared_ptr<TransformHierarchy> hierarchy = std::make_shared<TransformHierarchy>();
+
+	//Depth first, pushing children in reverse so they keep their order
+	std::vector<std::shared_ptr<Node>> nodes;
+	std::stack<std::pair<std::shared_ptr<Node>, uint32_t>> dfs_node_stack; //Node and its parent's index
+	for (auto it = scene.root_nodes.rbegin(); it != scene.root_nodes.rend(); it++)
+		dfs_node_stack.push({ *it, NO_PARENT });
+
+	while (!dfs_node_stack.empty()) {
+		auto [node, parent_index] = dfs_node_stack.top();
+		dfs_node_stack.pop();
+
+		uint32_t index = static_cast<uint32_t>(nodes.size());
+		hierarchy->_parents.push_back(parent_index);
+		hierarchy->_locals.push_back(node->get_LocalTransform());
+		hierarchy->_worlds.push_back(node->get_WorldTransform());
+		hierarchy->_nodeIDs.push_back(node->getID());
+		nodes.push_back(node);
+
+		for (auto it = node->child_nodes.rbegin(); it != node->child_nodes.rend(); it++)
+			dfs_node_stack.push({ *it, index });
+	}
+
+	hierarchy->_dirty.resize(nodes.size(), 0);
+
+	//Descendants directly follow their ancestors, so a subtree ends where its last descendant's does
+	hierarchy->_subtreeEnds.resize(nodes.size());
+	for (uint32_t i = static_cast<uint32_t>(nodes.size()); i-- > 0;) {
+		hierarchy->_subtreeEnds[i] = std::max(hierarchy->_subtreeEnds[i], i + 1);
+		uint32_t parent_index = hierarchy->_parents[i];
+		if (parent_index != NO_PARENT)
+			hierarchy->_subtreeEnds[parent_index] = std::max(hierarchy->_subtreeEnds[parent_index], hierarchy->_subtreeEnds[i]);
+	}
+
+	for (uint32_t i = 0; i < nodes.size(); i++)
+		nodes[i]->attach_transform(hierarchy, i);
+
+	return hierarchy;
+}
+
+void TransformHierarchy::update(ThreadPool* pool) {
+	if (!_hasDirty)
+		return;
+	_hasDirty = false;
+
+	//Dirty subtrees. Subtrees of dirty Nodes are skipped since they're updated along with them
+	std::vector<Range> dirty_ranges;
+	uint32_t dirty_count = 0;
+	for (uint32_t i = 0; i < _parents.size();) {
+		if (_dirty[i]) {
+			dirty_ranges.push_back({ i, _subtreeEnds[i] });
+			dirty_count += _subtreeEnds[i] - i;
+			i = _subtreeEnds[i];
+		}
+		else {
+			i++;
+		}
+	}
+
+	if (pool == nullptr || dirty_count < MIN_TASK_SIZE * 2) {
+		for (const Range& range : dirty_ranges)
+			update_range(range);
+		return;
+	}
+
+	std::vector<Range> tasks;
+	for (const Range& range : dirty_ranges)
+		split_range(range, tasks);
+
+	pool->parallel_for(tasks.size(), [&](size_t i) {
+		update_range(tasks[i]);
+	});
+}
+
+//Splits a subtree into tasks. A large subtree's root is updated here so its child subtrees can then be updated independently. Adjacent small child subtrees are grouped into one task
+void TransformHierarchy::split_range(Range range, std::vector<Range>& tasks) {
+	if (range.end - range.first <= MIN_TASK_SIZE) {
+		tasks.push_back(range);
+		return;
+	}
+
+	update_range({ range.first, range.first + 1 });
+
+	Range group{ range.first + 1, range.first + 1 };
+	for (uint32_t child = range.first + 1; child < range.end; child = _subtreeEnds[child]) {
+		Range child_range{ child, _subtreeEnds[child] };
+		if (child_range.end - child_range.first > MIN_TASK_SIZE) {
+			if (group.end > group.first)
+				tasks.push_back(group);
+			group = { child_range.end, child_range.end };
+			split_range(child_range, tasks);
+			continue;
+		}
+
+		group.end = child_range.end;
+		if (group.end - group.first >= MIN_TASK_SIZE) {
+			tasks.push_back(group);
+			group = { group.end, group.end };
+		}
+	}
+
+	if (group.end > group.first)
+		tasks.push_back(group);
+}
+
+//Updates Nodes in order. Every Node's parent is either earlier in the range or already up to date
+void TransformHierarchy::update_range(Range range) {
+	transformkernels::compose_worlds(_parents.data(), _locals.data(), _worlds.data(), range.first, range.end, NO_PARENT);
+	std::fill(_dirty.begin() + range.first, _dirty.begin() + range.end, 0);
+
+	std::span<const uint32_t> changed_ids(_nodeIDs.data() + range.first, range.end - range.first);
+	Node::change_journal.record(changed_ids);
+	Node::bounds_journal.record(changed_ids);
+}
+
@@ -0,0 +1,197 @@
+#include "transformKernels.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define TRANSFORMKERNELS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2 //MSVC allows the intrinsics of any ISA without changing the architecture of the whole build
+#else
+#include <cpuid.h>
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+namespace {
+	using transformkernels::ISA;
+
+	void multiply_scalar(const glm::mat4* parents, const glm::mat4* locals, glm::mat4* results, size_t count) {
+		for (size_t i = 0; i < count; i++)
+			results[i] = parents[i] * locals[i];
+	}
+
+	void compose_worlds_scalar(const uint32_t* parents, const glm::mat4* locals, glm::mat4* worlds, uint32_t first, uint32_t end, uint32_t no_parent) {
+		for (uint32_t i = first; i < end; i++)
+			worlds[i] = parents[i] != no_parent ? worlds[parents[i]] * locals[i] : locals[i];
+	}
+
+#ifdef TRANSFORMKERNELS_X86
+	//Each result column is the parent's columns weighted by the local column's elements. Columns are read before the result is written, so the result may alias the local
+	inline void multiply_sse(const float* parent, const float* local, float* result) {
+		__m128 p0 = _mm_loadu_ps(parent);
+		__m128 p1 = _mm_loadu_ps(parent + 4);
+		__m128 p2 = _mm_loadu_ps(parent + 8);
+		__m128 p3 = _mm_loadu_ps(parent + 12);
+
+		for (int j = 0; j < 4; j++) {
+			__m128 l = _mm_loadu_ps(local + j * 4);
+			__m128 r = _mm_mul_ps(p0, _mm_shuffle_ps(l, l, 0x00));
+			r = _mm_add_ps(r, _mm_mul_ps(p1, _mm_shuffle_ps(l, l, 0x55)));
+			r = _mm_add_ps(r, _mm_mul_ps(p2, _mm_shuffle_ps(l, l, 0xAA)));
+			r = _mm_add_ps(r, _mm_mul_ps(p3, _mm_shuffle_ps(l, l, 0xFF)));
+			_mm_storeu_ps(result + j * 4, r);
+		}
+	}
+
+	//Same as the SSE version, but two result columns at a time. Each parent column is in both 128 bit lanes, and each lane broadcasts the element of its own local column
+	TARGET_AVX2 inline void multiply_avx2(const float* parent, const float* local, float* result) {
+		__m256 p0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(parent));
+		__m256 p1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(parent + 4));
+		__m256 p2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(parent + 8));
+		__m256 p3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(parent + 12));
+
+		for (int j = 0; j < 4; j += 2) {
+			__m256 l = _mm256_loadu_ps(local + j * 4);
+			__m256 r = _mm256_mul_ps(p0, _mm256_permute_ps(l, 0x00));
+			r = _mm256_fmadd_ps(p1, _mm256_permute_ps(l, 0x55), r);
+			r = _mm256_fmadd_ps(p2, _mm256_permute_ps(l, 0xAA), r);
+			r = _mm256_fmadd_ps(p3, _mm256_permute_ps(l, 0xFF), r);
+			_mm256_storeu_ps(result + j * 4, r);
+		}
+	}
+
+	void multiply_sse(const glm::mat4* parents, const glm::mat4* locals, glm::mat4* results, size_t count) {
+		for (size_t i = 0; i < count; i++)
+			multiply_sse(reinterpret_cast<const float*>(&parents[i]), reinterpret_cast<const float*>(&locals[i]), reinterpret_cast<float*>(&results[i]));
+	}
+
+	void compose_worlds_sse(const uint32_t* parents, const glm::mat4* locals, glm::mat4* worlds, uint32_t first, uint32_t end, uint32_t no_parent) {
+		for (uint32_t i = first; i < end; i++) {
+			if (parents[i] != no_parent)
+				multiply_sse(reinterpret_cast<const float*>(&worlds[parents[i]]), reinterpret_cast<const float*>(&locals[i]), reinterpret_cast<float*>(&worlds[i]));
+			else
+				worlds[i] = locals[i];
+		}
+	}
+
+	TARGET_AVX2 void multiply_avx2(const glm::mat4* parents, const glm::mat4* locals, glm::mat4* results, size_t count) {
+		for (size_t i = 0; i < count; i++)
+			multiply_avx2(reinterpret_cast<const float*>(&parents[i]), reinterpret_cast<const float*>(&locals[i]), reinterpret_cast<float*>(&results[i]));
+	}
+
+	TARGET_AVX2 void compose_worlds_avx2(const uint32_t* parents, const glm::mat4* locals, glm::mat4* worlds, uint32_t first, uint32_t end, uint32_t no_parent) {
+		for (uint32_t i = first; i < end; i++) {
+			if (parents[i] != no_parent)
+				multiply_avx2(reinterpret_cast<const float*>(&worlds[parents[i]]), reinterpret_cast<const float*>(&locals[i]), reinterpret_cast<float*>(&worlds[i]));
+			else
+				worlds[i] = locals[i];
+		}
+	}
+
+	void cpuid(int info[4], int leaf, int subleaf) {
+#ifdef _MSC_VER
+		__cpuidex(info, leaf, subleaf);
+#else
+		__cpuid_count(leaf, subleaf, info[0], info[1], info[2], info[3]);
+#endif
+	}
+
+	uint64_t xgetbv(uint32_t index) {
+#ifdef _MSC_VER
+		return _xgetbv(index);
+#else
+		uint32_t low, high;
+		__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(index));
+		return (static_cast<uint64_t>(high) << 32) | low;
+#endif
+	}
+#endif
+
+	ISA detect_isa() {
+#ifdef TRANSFORMKERNELS_X86
+		int info[4];
+		cpuid(info, 0, 0);
+		int max_leaf = info[0];
+
+		cpuid(info, 1, 0);
+		bool sse2 = (info[3] & (1 << 26)) != 0;
+		bool fma = (info[2] & (1 << 12)) != 0;
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+
+		//AVX registers are only usable if the OS saves them on context switches
+		bool ymm_enabled = osxsave && avx && (xgetbv(0) & 0x6) == 0x6;
+
+		bool avx2 = false;
+		if (max_leaf >= 7) {
+			cpuid(info, 7, 0);
+			avx2 = (info[1] & (1 << 5)) != 0;
+		}
+
+		if (ymm_enabled && avx2 && fma)
+			return ISA::AVX2;
+		if (sse2)
+			return ISA::SSE;
+#endif
+		return ISA::Scalar;
+	}
+}
+
+namespace transformkernels {
+
+	ISA active_isa() {
+		static const ISA isa = detect_isa();
+		return isa;
+	}
+
+	const char* isa_name(ISA isa) {
+		switch (isa) {
+			case ISA::AVX2:
+				return "AVX2";
+			case ISA::SSE:
+				return "SSE";
+			default:
+				return "Scalar";
+		}
+	}
+
+	void multiply(const glm::mat4* parents, const glm::mat4* locals, glm::mat4* results, size_t count) {
+		multiply(active_isa(), parents, locals, results, count);
+	}
+
+	void compose_worlds(const uint32_t* parents, const glm::mat4* locals, glm::mat4* worlds, uint32_t first, uint32_t end, uint32_t no_parent) {
+		compose_worlds(active_isa(), parents, locals, worlds, first, end, no_parent);
+	}
+
+	void multiply(ISA isa, const glm::mat4* parents, const glm::mat4* locals, glm::mat4* results, size_t count) {
+		switch (isa) {
+#ifdef TRANSFORMKERNELS_X86
+			case ISA::AVX2:
+				multiply_avx2(parents, locals, results, count);
+				return;
+			case ISA::SSE:
+				multiply_sse(parents, locals, results, count);
+				return;
+#endif
+			default:
+				multiply_scalar(parents, locals, results, count);
+				return;
+		}
+	}
+
+	void compose_worlds(ISA isa, const uint32_t* parents, const glm::mat4* locals, glm::mat4* worlds, uint32_t first, uint32_t end, uint32_t no_parent) {
+		switch (isa) {
+#ifdef TRANSFORMKERNELS_X86
+			case ISA::AVX2:
+				compose_worlds_avx2(parents, locals, worlds, first, end, no_parent);
+				return;
+			case ISA::SSE:
+				compose_worlds_sse(parents, locals, worlds, first, end, no_parent);
+				return;
+#endif
+			default:
+				compose_worlds_scalar(parents, locals, worlds, first, end, no_parent);
+				return;
+		}
+	}
+}
@@ -1,4 +1,6 @@
 #include "vulkanContext.h"
+#include "glm.hpp"
+#include "shader_types.h"
 
 void VulkanContext::init(SDL_Window* window) {
 	//Create Instance
@@ -29,8 +31,14 @@ void VulkanContext::init(SDL_Window* window) {
 
 	features2.scalarBlockLayout = true;
 
+	features2.timelineSemaphore = true;
+
 	features2.bufferDeviceAddress = true;
 
+	features2.drawIndirectCount = true; //Draw count of the culled Indirect Draw Buffer is written on the device
+
+	features2.samplerFilterMinmax = true; //Hi-Z is built and sampled with a min reduction sampler
+
 	features2.descriptorIndexing = true;
 	features2.shaderUniformBufferArrayNonUniformIndexing = true;
 	features2.shaderStorageBufferArrayNonUniformIndexing = true;
@@ -54,6 +62,9 @@ void VulkanContext::init(SDL_Window* window) {
 
 	VkPhysicalDeviceFeatures features{};
 	features.multiDrawIndirect = true;
+	features.drawIndirectFirstInstance = true; //Instanced indirect draws start at their own offset in the Instances Buffer
+	features.shaderStorageImageWriteWithoutFormat = true; //Compute Mip Generation writes levels of any format
+	features.fragmentStoresAndAtomics = true; //Fragment Shading writes the Texture Streaming Feedback
 
 	vkb::PhysicalDeviceSelector selector{ vkb_inst };
 	selector.set_minimum_version(1, 3);
@@ -72,15 +83,89 @@ void VulkanContext::init(SDL_Window* window) {
 
 	vkb::PhysicalDevice vkbPhysicalDevice = physical_device_selector_return.value();
 
+	//Optional Mesh Shading. Without it the Render System keeps to its Vertex Shader paths
+	VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures{};
+	meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+	meshShaderFeatures.taskShader = true;
+	meshShaderFeatures.meshShader = true;
+	meshShaderSupported = vkbPhysicalDevice.is_extension_present(VK_EXT_MESH_SHADER_EXTENSION_NAME) && vkbPhysicalDevice.enable_extension_features_if_present(meshShaderFeatures);
+	if (meshShaderSupported)
+		vkbPhysicalDevice.enable_extension_if_present(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+
+	//Optional BC Texture Compression. Without it Textures are uploaded uncompressed
+	VkPhysicalDeviceFeatures bcFeatures{};
+	bcFeatures.textureCompressionBC = true;
+	bcTextureSupported = vkbPhysicalDevice.enable_features_if_present(bcFeatures);
+
+	//Optional Memory Budget. Without it VMA estimates the heap budgets from its own allocations, missing other processes' usage
+	memoryBudgetSupported = vkbPhysicalDevice.enable_extension_if_present(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+	//Choose Queue Families. The Primary Queue is the first Graphics Family. Uploads prefer a dedicated Transfer Family, then any non-graphics Family (Compute implies Transfer), then a second Queue of the Graphics Family, and otherwise share the Primary Queue
+	std::vector<VkQueueFamilyProperties> queueFamilyProperties = vkbPhysicalDevice.get_queue_families();
+	uint32_t graphicsFamily = UINT32_MAX;
+	uint32_t dedicatedTransferFamily = UINT32_MAX;
+	uint32_t nonGraphicsTransferFamily = UINT32_MAX;
+	for (uint32_t family = 0; family < queueFamilyProperties.size(); family++) {
+		VkQueueFlags flags = queueFamilyProperties[family].queueFlags;
+		if ((flags & VK_QUEUE_GRAPHICS_BIT) && graphicsFamily == UINT32_MAX)
+			graphicsFamily = family;
+		else if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) && dedicatedTransferFamily == UINT32_MAX)
+			dedicatedTransferFamily = family;
+		else if ((flags & (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_COMPUTE_BIT)) && !(flags & VK_QUEUE_GRAPHICS_BIT) && nonGraphicsTransferFamily == UINT32_MAX)
+			nonGraphicsTransferFamily = family;
+	}
+
+	if (graphicsFamily == UINT32_MAX)
+		throw std::runtime_error("Failed to find a Graphics Queue Family");
+
+	uint32_t transferQueueIndex = 0;
+	if (dedicatedTransferFamily != UINT32_MAX) {
+		transferQueueFamily = dedicatedTransferFamily;
+	}
+	else if (nonGraphicsTransferFamily != UINT32_MAX) {
+		transferQueueFamily = nonGraphicsTransferFamily;
+	}
+	else {
+		transferQueueFamily = graphicsFamily;
+		transferQueueIndex = queueFamilyProperties[graphicsFamily].queueCount > 1 ? 1 : 0;
+	}
+
 	//Create Logical Device
 	vkb::DeviceBuilder deviceBuilder{ vkbPhysicalDevice };
 
+	std::vector<vkb::CustomQueueDescription> queueDescriptions;
+	if (transferQueueFamily == graphicsFamily) {
+		queueDescriptions.push_back(vkb::CustomQueueDescription(graphicsFamily, std::vector<float>(transferQueueIndex + 1, 1.0f)));
+	}
+	else {
+		queueDescriptions.push_back(vkb::CustomQueueDescription(graphicsFamily, std::vector<float>(1, 1.0f)));
+		queueDescriptions.push_back(vkb::CustomQueueDescription(transferQueueFamily, std::vector<float>(1, 1.0f)));
+	}
+	deviceBuilder.custom_queue_setup(queueDescriptions);
+
 	vkb::Device vkbDevice = deviceBuilder.build().value();
 
 	device = vkbDevice.device;
 	physicalDevice = vkbPhysicalDevice.physical_device;
-	primaryQueue = vkbDevice.get_queue(vkb::QueueType::graphics).value();
-	primaryQueueFamily = vkbDevice.get_queue_index(vkb::QueueType::graphics).value();
+	primaryQueueFamily = graphicsFamily;
+	vkGetDeviceQueue(device, primaryQueueFamily, 0, &primaryQueue);
+	vkGetDeviceQueue(device, transferQueueFamily, transferQueueIndex, &transferQueue);
+
+	//Extension commands aren't exported by the loader
+	if (meshShaderSupported)
+		cmdDrawMeshTasksIndirectCount = reinterpret_cast<PFN_vkCmdDrawMeshTasksIndirectCountEXT>(vkGetDeviceProcAddr(device, "vkCmdDrawMeshTasksIndirectCountEXT"));
+	std::cout << std::format("Vulkan Context: Mesh Shaders {}", meshShaderSupported ? "supported" : "unsupported") << std::endl;
+	std::cout << std::format("Vulkan Context: BC Textures {}", bcTextureSupported ? "supported" : "unsupported") << std::endl;
+
+	if (transferQueue == primaryQueue)
+		std::cout << "Vulkan Context: No separate Transfer Queue available, uploads share the Primary Queue" << std::endl;
+	else
+		std::cout << std::format("Vulkan Context: Uploads use Queue {} of Queue Family {}", transferQueueIndex, transferQueueFamily) << std::endl;
+
+	//Resources written by the Transfer Queue and read by the Primary Queue are shared concurrently when the families differ
+	_queueFamilyIndices.push_back(primaryQueueFamily);
+	if (transferQueueFamily != primaryQueueFamily)
+		_queueFamilyIndices.push_back(transferQueueFamily);
 
 	size_t i = 0;
 	for (auto queueFamily : vkbDevice.queue_families) {
@@ -110,7 +195,10 @@ void VulkanContext::init(SDL_Window* window) {
 	allocatorInfo.physicalDevice = physicalDevice;
 	allocatorInfo.device = device;
 	allocatorInfo.instance = instance;
+	allocatorInfo.vulkanApiVersion = VK_API_VERSION_1_3;
 	allocatorInfo.flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+	if (memoryBudgetSupported)
+		allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
 	vmaCreateAllocator(&allocatorInfo, &allocator);
 
 	//Immediate Command
@@ -138,10 +226,57 @@ void VulkanContext::init(SDL_Window* window) {
 	fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
 	VK_CHECK(vkCreateFence(device, &fenceCreateInfo, nullptr, &immFence));
+
+	//Transfer Commands
+	cmdPoolInfo.queueFamilyIndex = transferQueueFamily;
+	VK_CHECK(vkCreateCommandPool(device, &cmdPoolInfo, nullptr, &transferCommandPool));
+
+	//Staged Uploads
+	//-Staging Ring
+	_stagingRing = create_buffer("Staging Ring", STAGING_RING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST, VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+
+	//-Upload Timeline Semaphore
+	VkSemaphoreTypeCreateInfo timelineCreateInfo{};
+	timelineCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	timelineCreateInfo.pNext = nullptr;
+	timelineCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	timelineCreateInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreCreateInfo{};
+	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreCreateInfo.pNext = &timelineCreateInfo;
+	semaphoreCreateInfo.flags = 0;
+
+	VK_CHECK(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &uploadTimeline));
 }
 
 void VulkanContext::shutdown() {
+	//Cleanup Staged Uploads
+	for (StagingRegion& region : _inFlightStagingRegions) {
+		if (region.dedicated)
+			destroy_buffer(region.dedicatedStager);
+	}
+	_inFlightStagingRegions.clear();
+	for (AllocatedBuffer& stager : _pendingDedicatedStagers) {
+		destroy_buffer(stager);
+	}
+	_pendingDedicatedStagers.clear();
+	destroy_buffer(_stagingRing);
+	vkDestroySemaphore(device, uploadTimeline, nullptr);
+
+	//Cleanup Compute Mip Generation
+	for (auto& [cmd, resources] : _mipmapResources)
+		destroy_mipmap_resources(resources);
+	_mipmapResources.clear();
+	if (_mipmapPipeline != VK_NULL_HANDLE) {
+		vkDestroyPipeline(device, _mipmapPipeline, nullptr);
+		vkDestroyPipelineLayout(device, _mipmapPipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(device, _mipmapDescriptorSetLayout, nullptr);
+	}
+
 	//Cleanup Commands and Sync Structures
+	vkDestroyCommandPool(device, transferCommandPool, nullptr);
+	_transferCommands.clear();
 	vkDestroyCommandPool(device, immCommandPool, nullptr);
 	vkDestroyFence(device, immFence, nullptr);
 
@@ -153,7 +288,10 @@ void VulkanContext::shutdown() {
 	vkDestroyInstance(instance, nullptr);
 }
 
+//The Immediate Command Buffer and Fence are shared by the render thread and background loads, so each recording holds them until its submission completes
 VkCommandBuffer VulkanContext::start_immediate_recording() {
+	_immediateMutex.lock();
+
 	VK_CHECK(vkResetFences(device, 1, &immFence));
 	VK_CHECK(vkResetCommandBuffer(immCommandBuffer, 0));
 
@@ -163,6 +301,8 @@ VkCommandBuffer VulkanContext::start_immediate_recording() {
 	cmdBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
 	VK_CHECK(vkBeginCommandBuffer(immCommandBuffer, &cmdBeginInfo));
+
+	_immUploadWaitValue = submit_staged_uploads();
 	return immCommandBuffer;
 }
 
@@ -170,11 +310,214 @@ void VulkanContext::submit_immediate_commands() {
 	VK_CHECK(vkEndCommandBuffer(immCommandBuffer));
 
 	VkCommandBufferSubmitInfo cmdInfo = vkutil::command_buffer_submit_info(immCommandBuffer);
-	VkSubmitInfo2 submit = vkutil::submit_info(&cmdInfo, nullptr, nullptr);
+	VkSemaphoreSubmitInfo uploadWaitInfo = vkutil::semaphore_submit_info(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, uploadTimeline);
+	uploadWaitInfo.value = _immUploadWaitValue;
+	VkSubmitInfo2 submit = vkutil::submit_info(&cmdInfo, nullptr, &uploadWaitInfo);
 
-	VK_CHECK(vkQueueSubmit2(primaryQueue, 1, &submit, immFence));
+	{
+		std::lock_guard<std::mutex> queueLock(queueSubmitMutex);
+		VK_CHECK(vkQueueSubmit2(primaryQueue, 1, &submit, immFence));
+	}
 
 	VK_CHECK(vkWaitForFences(device, 1, &immFence, true, 9999999999));
+
+	release_mipmap_resources(immCommandBuffer);
+	reclaim_staging();
+
+	_immediateMutex.unlock();
+}
+
+//Records every pending staged upload into a Transfer Command Buffer and submits it on the Transfer Queue, signaling the Upload Timeline when done
+uint64_t VulkanContext::submit_staged_uploads() {
+	std::lock_guard<std::recursive_mutex> lock(_uploadMutex);
+	if (!has_staged_uploads())
+		return _uploadTimelineValue;
+
+	//Reuse a Transfer Command Buffer whose submission has completed, or allocate a new one
+	uint64_t completedValue;
+	VK_CHECK(vkGetSemaphoreCounterValue(device, uploadTimeline, &completedValue));
+
+	TransferCommand* transferCommand = nullptr;
+	for (TransferCommand& command : _transferCommands) {
+		if (command.timelineValue <= completedValue) {
+			transferCommand = &command;
+			break;
+		}
+	}
+	if (transferCommand == nullptr) {
+		VkCommandBufferAllocateInfo cmdAllocInfo{};
+		cmdAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		cmdAllocInfo.pNext = nullptr;
+		cmdAllocInfo.commandPool = transferCommandPool;
+		cmdAllocInfo.commandBufferCount = 1;
+		cmdAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+
+		TransferCommand newCommand{};
+		VK_CHECK(vkAllocateCommandBuffers(device, &cmdAllocInfo, &newCommand.cmd));
+		_transferCommands.push_back(newCommand);
+		transferCommand = &_transferCommands.back();
+	}
+
+	VkCommandBuffer cmd = transferCommand->cmd;
+	VK_CHECK(vkResetCommandBuffer(cmd, 0));
+
+	VkCommandBufferBeginInfo cmdBeginInfo{};
+	cmdBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	cmdBeginInfo.pNext = nullptr;
+	cmdBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
+	uint64_t signalValue = record_staged_uploads(cmd);
+	VK_CHECK(vkEndCommandBuffer(cmd));
+
+	transferCommand->timelineValue = signalValue;
+
+	VkCommandBufferSubmitInfo cmdInfo = vkutil::command_buffer_submit_info(cmd);
+	VkSemaphoreSubmitInfo signalInfo = vkutil::semaphore_submit_info(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, uploadTimeline);
+	signalInfo.value = signalValue;
+	VkSubmitInfo2 submit = vkutil::submit_info(&cmdInfo, &signalInfo, nullptr);
+
+	{
+		std::lock_guard<std::mutex> queueLock(queueSubmitMutex);
+		VK_CHECK(vkQueueSubmit2(transferQueue, 1, &submit, nullptr));
+	}
+
+	return signalValue;
+}
+
+//Records all pending staged uploads into the command buffer. Returns the Upload Timeline value the submission of cmd must signal
+uint64_t VulkanContext::record_staged_uploads(VkCommandBuffer cmd) {
+	uint64_t signalValue = ++_uploadTimelineValue;
+
+	//Wait for any previous reads of the destinations before overwriting them. Reads on the Primary Queue are already ordered by the Frame Fences
+	VkMemoryBarrier2 memoryBarrier{};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+	memoryBarrier.pNext = nullptr;
+	memoryBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	memoryBarrier.srcAccessMask = 0;
+	memoryBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+
+	VkDependencyInfo depInfo{};
+	depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	depInfo.pNext = nullptr;
+	depInfo.memoryBarrierCount = 1;
+	depInfo.pMemoryBarriers = &memoryBarrier;
+
+	vkCmdPipelineBarrier2(cmd, &depInfo);
+
+	//Buffer Copies. Consecutive copies between the same pair of buffers are batched into one command
+	std::vector<VkBufferCopy> batchedCopies;
+	for (size_t i = 0; i < _pendingBufferCopies.size(); i++) {
+		const PendingBufferCopy& pendingCopy = _pendingBufferCopies[i];
+		batchedCopies.push_back(pendingCopy.copyInfo);
+
+		bool lastOfBatch = (i + 1 == _pendingBufferCopies.size()) || _pendingBufferCopies[i + 1].srcBuffer != pendingCopy.srcBuffer || _pendingBufferCopies[i + 1].dstBuffer != pendingCopy.dstBuffer;
+		if (lastOfBatch) {
+			vkCmdCopyBuffer(cmd, pendingCopy.srcBuffer, pendingCopy.dstBuffer, static_cast<uint32_t>(batchedCopies.size()), batchedCopies.data());
+			batchedCopies.clear();
+		}
+	}
+
+	//Image Copies
+	for (PendingImageCopy& pendingCopy : _pendingImageCopies) {
+		vkutil::transition_image(cmd, pendingCopy.dstImage, pendingCopy.oldLayout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+		vkCmdCopyBufferToImage(cmd, pendingCopy.srcBuffer, pendingCopy.dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(pendingCopy.copyInfos.size()), pendingCopy.copyInfos.data());
+		vkutil::transition_image(cmd, pendingCopy.dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, pendingCopy.finalLayout);
+	}
+
+	_pendingBufferCopies.clear();
+	_pendingImageCopies.clear();
+
+	//The staging memory used by the recorded uploads is in flight until the submission signals signalValue
+	if (_stagingRingPendingSize > 0) {
+		_inFlightStagingRegions.push_back({ .size = _stagingRingPendingSize, .timelineValue = signalValue });
+		_stagingRingPendingSize = 0;
+	}
+	for (AllocatedBuffer& stager : _pendingDedicatedStagers) {
+		_inFlightStagingRegions.push_back({ .size = 0, .timelineValue = signalValue, .dedicatedStager = stager, .dedicated = true });
+	}
+	_pendingDedicatedStagers.clear();
+
+	return signalValue;
+}
+
+void VulkanContext::flush_staged_uploads() {
+	//Also waits on uploads that were already submitted
+	wait_for_uploads(submit_staged_uploads());
+	reclaim_staging();
+}
+
+void VulkanContext::wait_for_uploads(uint64_t timelineValue) {
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.pNext = nullptr;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &uploadTimeline;
+	waitInfo.pValues = &timelineValue;
+
+	VK_CHECK(vkWaitSemaphores(device, &waitInfo, 9999999999));
+}
+
+//Suballocates staging memory from the Staging Ring, waiting for in flight uploads to retire if the Ring is full.
+//The caller's lock is released while waiting so other threads' uploads aren't held up by a full Ring, and is held again when this returns
+VulkanContext::StagingAllocation VulkanContext::allocate_staging(size_t size, std::unique_lock<std::recursive_mutex>& lock) {
+	reclaim_staging();
+
+	//Align to 16 bytes, which covers buffer copy offsets and the texel block size of every uploaded format
+	size = (size + 15) & ~static_cast<size_t>(15);
+
+	//Too large for the Ring, so use a dedicated Stager that is destroyed once its upload retires
+	if (size > STAGING_RING_SIZE) {
+		AllocatedBuffer stager = create_buffer("Dedicated Upload Stager", size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST, VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+		_pendingDedicatedStagers.push_back(stager);
+		return { .buffer = stager.buffer, .offset = 0, .mappedData = stager.info.pMappedData };
+	}
+
+	while (true) {
+		//Allocations never straddle the end of the Ring. The skipped tail counts as used until the allocation retires
+		bool wrap = _stagingRingHead + size > STAGING_RING_SIZE;
+		size_t padding = wrap ? STAGING_RING_SIZE - _stagingRingHead : 0;
+
+		if (_stagingRingUsed + padding + size <= STAGING_RING_SIZE) {
+			size_t offset = wrap ? 0 : _stagingRingHead;
+			_stagingRingHead = offset + size;
+			_stagingRingUsed += padding + size;
+			_stagingRingPendingSize += padding + size;
+			return { .buffer = _stagingRing.buffer, .offset = offset, .mappedData = static_cast<unsigned char*>(_stagingRing.info.pMappedData) + offset };
+		}
+
+		//Ring is full. Wait for the oldest in flight upload, or submit the pending uploads if they are what fills it. Other threads may allocate while unlocked, so try again from the start
+		if (!_inFlightStagingRegions.empty()) {
+			uint64_t waitValue = _inFlightStagingRegions.front().timelineValue;
+			lock.unlock();
+			wait_for_uploads(waitValue);
+			lock.lock();
+			reclaim_staging();
+		}
+		else {
+			submit_staged_uploads();
+		}
+	}
+}
+
+//Frees the staging memory of every upload whose submission has completed
+void VulkanContext::reclaim_staging() {
+	std::lock_guard<std::recursive_mutex> lock(_uploadMutex);
+	uint64_t completedValue;
+	VK_CHECK(vkGetSemaphoreCounterValue(device, uploadTimeline, &completedValue));
+
+	while (!_inFlightStagingRegions.empty() && _inFlightStagingRegions.front().timelineValue <= completedValue) {
+		StagingRegion& region = _inFlightStagingRegions.front();
+		if (region.dedicated)
+			destroy_buffer(region.dedicatedStager);
+		else
+			_stagingRingUsed -= region.size;
+		_inFlightStagingRegions.pop_front();
+	}
+
+	if (_stagingRingUsed == 0)
+		_stagingRingHead = 0;
 }
 
 /*
@@ -193,6 +536,7 @@ AllocatedBuffer VulkanContext::create_buffer(const char* name, size_t allocSize,
 		bufferInfo.usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
 	else
 		bufferInfo.usage = usage;
+	set_upload_sharing(bufferInfo.usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT, bufferInfo.sharingMode, bufferInfo.queueFamilyIndexCount, bufferInfo.pQueueFamilyIndices);
 
 	VmaAllocationCreateInfo vmaAllocInfo = {};
 	vmaAllocInfo.usage = memoryUsage;
@@ -206,6 +550,9 @@ AllocatedBuffer VulkanContext::create_buffer(const char* name, size_t allocSize,
 }
 
 AllocatedBuffer VulkanContext::create_buffer(const char* name, VkBufferCreateInfo bufferInfo, VmaAllocationCreateInfo allocInfo) {
+	if (bufferInfo.sharingMode == VK_SHARING_MODE_EXCLUSIVE)
+		set_upload_sharing(bufferInfo.usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT, bufferInfo.sharingMode, bufferInfo.queueFamilyIndexCount, bufferInfo.pQueueFamilyIndices);
+
 	AllocatedBuffer newBuffer;
 	VK_CHECK(vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &newBuffer.buffer, &newBuffer.allocation, &newBuffer.info));
 	vmaSetAllocationName(allocator, newBuffer.allocation, name);
@@ -213,6 +560,16 @@ AllocatedBuffer VulkanContext::create_buffer(const char* name, VkBufferCreateInf
 	return newBuffer;
 }
 
+//Resources that can be written by the Transfer Queue are shared concurrently with the Primary Queue when the Queue Families differ, so no Queue Family Ownership Transfers are needed
+void VulkanContext::set_upload_sharing(bool transferDst, VkSharingMode& sharingMode, uint32_t& queueFamilyIndexCount, const uint32_t*& pQueueFamilyIndices) {
+	if (!transferDst || _queueFamilyIndices.size() < 2)
+		return;
+
+	sharingMode = VK_SHARING_MODE_CONCURRENT;
+	queueFamilyIndexCount = static_cast<uint32_t>(_queueFamilyIndices.size());
+	pQueueFamilyIndices = _queueFamilyIndices.data();
+}
+
 void VulkanContext::destroy_buffer(const AllocatedBuffer& buffer) {
 	vmaDestroyBuffer(allocator, buffer.buffer, buffer.allocation);
 }
@@ -229,14 +586,15 @@ void VulkanContext::update_buffer(const AllocatedBuffer& buffer, void* srcData,
 		memcpy(dstPointer, srcPointer, copyInfo.size);
 	}
 	else if (buffer_memProperties & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) {
-		AllocatedBuffer stagingBuffer = create_buffer("Buffer Update Stager", srcDataSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST, VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-		memcpy(stagingBuffer.info.pMappedData, srcData, srcDataSize);
+		std::unique_lock<std::recursive_mutex> lock(_uploadMutex);
 
-		VkCommandBuffer cmd = start_immediate_recording();
-		vkCmdCopyBuffer(cmd, stagingBuffer.buffer, buffer.buffer, 1, &copyInfo);
-		submit_immediate_commands();
+		//Only stage the bytes the copy reads
+		StagingAllocation staging = allocate_staging(copyInfo.size, lock);
+		memcpy(staging.mappedData, static_cast<unsigned char*>(srcData) + copyInfo.srcOffset, copyInfo.size);
 
-		destroy_buffer(stagingBuffer);
+		VkBufferCopy stagedCopy = copyInfo;
+		stagedCopy.srcOffset = staging.offset;
+		_pendingBufferCopies.push_back({ .srcBuffer = staging.buffer, .dstBuffer = buffer.buffer, .copyInfo = stagedCopy });
 	}
 	else {
 		throw std::runtime_error("Buffer Memory Property not a MyDevice Local or Host Visible");
@@ -257,14 +615,18 @@ void VulkanContext::update_buffer(const AllocatedBuffer& buffer, void* srcData,
 		}
 	}
 	else if (buffer_memProperties & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) {
-		AllocatedBuffer stagingBuffer = create_buffer("Buffer Update Stager", srcDataSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST, VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-		memcpy(stagingBuffer.info.pMappedData, srcData, srcDataSize);
+		if (srcDataSize == 0 || copyInfos.empty())
+			return;
 
-		VkCommandBuffer cmd = start_immediate_recording();
-		vkCmdCopyBuffer(cmd, stagingBuffer.buffer, buffer.buffer, copyInfos.size(), copyInfos.data());
-		submit_immediate_commands();
+		std::unique_lock<std::recursive_mutex> lock(_uploadMutex);
+		StagingAllocation staging = allocate_staging(srcDataSize, lock);
+		memcpy(staging.mappedData, srcData, srcDataSize);
 
-		destroy_buffer(stagingBuffer);
+		for (VkBufferCopy& copyInfo : copyInfos) {
+			VkBufferCopy stagedCopy = copyInfo;
+			stagedCopy.srcOffset += staging.offset;
+			_pendingBufferCopies.push_back({ .srcBuffer = staging.buffer, .dstBuffer = buffer.buffer, .copyInfo = stagedCopy });
+		}
 	}
 	else {
 		throw std::runtime_error("Buffer Memory Property not a Device Local or Host Visible");
@@ -280,6 +642,7 @@ AllocatedImage VulkanContext::create_image(const char* name, VkExtent3D size, Vk
 
 	if (mipmapped)
 		img_info.mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(size.width, size.height)))) + 1;
+	set_upload_sharing(img_info.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT, img_info.sharingMode, img_info.queueFamilyIndexCount, img_info.pQueueFamilyIndices);
 
 	VmaAllocationCreateInfo alloc_info{};
 	alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
@@ -306,6 +669,9 @@ AllocatedImage VulkanContext::create_image(const char* name, VkImageCreateInfo i
 	newImage.format = imageInfo.format;
 	newImage.extent = imageInfo.extent;
 
+	if (imageInfo.sharingMode == VK_SHARING_MODE_EXCLUSIVE)
+		set_upload_sharing(imageInfo.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT, imageInfo.sharingMode, imageInfo.queueFamilyIndexCount, imageInfo.pQueueFamilyIndices);
+
 	VK_CHECK(vmaCreateImage(allocator, &imageInfo, &allocInfo, &newImage.image, &newImage.allocation, nullptr));
 	vmaSetAllocationName(allocator, newImage.allocation, name);
 
@@ -326,36 +692,40 @@ void VulkanContext::destroy_image(const AllocatedImage& image) {
 }
 
 void VulkanContext::update_image(AllocatedImage& image, void* srcData, size_t dataSize) {
+	VkBufferImageCopy copyRegion{};
+	copyRegion.bufferOffset = 0;
+	copyRegion.bufferRowLength = 0;
+	copyRegion.bufferImageHeight = 0;
+
+	copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	copyRegion.imageSubresource.mipLevel = 0;
+	copyRegion.imageSubresource.baseArrayLayer = 0;
+	copyRegion.imageSubresource.layerCount = 1;
+	copyRegion.imageExtent = image.extent;
+
+	update_image(image, srcData, dataSize, std::vector<VkBufferImageCopy>{ copyRegion });
+}
 
+void VulkanContext::update_image(AllocatedImage& image, const void* srcData, size_t dataSize, const std::vector<VkBufferImageCopy>& copyRegions) {
 	VkMemoryPropertyFlags image_memProperties;
 	vmaGetAllocationMemoryProperties(allocator, image.allocation, &image_memProperties);
 
-	if (image_memProperties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+	if ((image_memProperties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && copyRegions.size() == 1) {
 		memcpy(image.info.pMappedData, srcData, dataSize);
 	}
 	else if (image_memProperties & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) {
-		AllocatedBuffer stagingBuffer = create_buffer("Image Update Stager", dataSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST, VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-		memcpy(stagingBuffer.info.pMappedData, srcData, dataSize);
+		std::unique_lock<std::recursive_mutex> lock(_uploadMutex);
+		StagingAllocation staging = allocate_staging(dataSize, lock);
+		memcpy(staging.mappedData, srcData, dataSize);
 
-		VkCommandBuffer cmd = start_immediate_recording();
-		transition_image(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-		VkBufferImageCopy copyRegion{};
-		copyRegion.bufferOffset = 0;
-		copyRegion.bufferRowLength = 0;
-		copyRegion.bufferImageHeight = 0;
-
-		copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		copyRegion.imageSubresource.mipLevel = 0;
-		copyRegion.imageSubresource.baseArrayLayer = 0;
-		copyRegion.imageSubresource.layerCount = 1;
-		copyRegion.imageExtent = image.extent;
-
-		vkCmdCopyBufferToImage(cmd, stagingBuffer.buffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
-
-		transition_image(cmd, image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL); //!!!Might Delete. Maybe dont want to have all Image updates to transition the image the shader read only optimal. Might want to try keep image transition to only go to how it was before updating
-		submit_immediate_commands();
+		std::vector<VkBufferImageCopy> stagedRegions = copyRegions;
+		for (VkBufferImageCopy& region : stagedRegions) {
+			region.bufferOffset += staging.offset;
+		}
 
-		destroy_buffer(stagingBuffer);
+		//The upload is recorded later, but any commands recorded after it will see the image in its final layout
+		_pendingImageCopies.push_back({ .srcBuffer = staging.buffer, .dstImage = image.image, .oldLayout = image.layout, .finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, .copyInfos = std::move(stagedRegions) }); //!!!Might Delete. Maybe dont want to have all Image updates to transition the image the shader read only optimal. Might want to try keep image transition to only go to how it was before updating
+		image.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 	}
 	else {
 		throw std::runtime_error("Buffer Memory Property not a MyDevice Local or Host Visible");
@@ -373,92 +743,269 @@ void VulkanContext::update_image(AllocatedImage& dstImage, AllocatedImage& srcIm
 	submit_immediate_commands();
 }
 
+//Leaves the Image in Transfer Src Layout. The copy is made visible to the host, so the buffer only needs invalidating before it's read
+AllocatedBuffer VulkanContext::read_image(VkCommandBuffer cmd, AllocatedImage& image, size_t dataSize, const std::vector<VkBufferImageCopy>& copyRegions) {
+	AllocatedBuffer readback = create_buffer("Image Readback", dataSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST, VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT);
+
+	transition_image(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+	vkCmdCopyImageToBuffer(cmd, image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback.buffer, static_cast<uint32_t>(copyRegions.size()), copyRegions.data());
+	vkutil::memory_barrier(cmd, VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+
+	return readback;
+}
+
 //Transitions the Image from its current Layout to the Target Layout
 void VulkanContext::transition_image(VkCommandBuffer cmd, Image& image, VkImageLayout targetLayout) {
 	vkutil::transition_image(cmd, image.image, image.layout, targetLayout);
 	image.layout = targetLayout;
 }
 
-//Generate levelCount - 1 mipmaps for the Image.
-void VulkanContext::generate_mipmaps(VkCommandBuffer cmd, AllocatedImage& image, uint32_t levelCount, uint32_t layerCount) { 
-	//Check if Image Format supports Linear Blittering
+VkImageUsageFlags VulkanContext::mipmap_usage(VkFormat format) {
+	if (supports_blit_mipmaps(format))
+		return VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	return VK_IMAGE_USAGE_STORAGE_BIT;
+}
+
+//Generate the mipmaps from firstLevel to levelCount - 1 for the Image. Levels before firstLevel must already hold data. Blits where the format supports Linear Blits, otherwise downsamples in a Compute Shader
+void VulkanContext::generate_mipmaps(VkCommandBuffer cmd, AllocatedImage& image, uint32_t levelCount, uint32_t layerCount, uint32_t firstLevel) { 
+	if (firstLevel == 0 || firstLevel >= levelCount)
+		return;
+
+	if (supports_blit_mipmaps(image.format))
+		generate_mipmaps_blit(cmd, image, levelCount, layerCount, firstLevel);
+	else
+		generate_mipmaps_compute(cmd, image, levelCount, layerCount, firstLevel);
+}
+
+void VulkanContext::release_mipmap_resources(VkCommandBuffer cmd) {
+	std::lock_guard<std::mutex> lock(_mipmapMutex);
+	auto resources = _mipmapResources.find(cmd);
+	if (resources == _mipmapResources.end())
+		return;
+
+	destroy_mipmap_resources(resources->second);
+	_mipmapResources.erase(resources);
+}
+
+void VulkanContext::destroy_mipmap_resources(const MipmapResources& resources) {
+	for (VkDescriptorPool pool : resources.descriptorPools)
+		vkDestroyDescriptorPool(device, pool, nullptr);
+	for (VkImageView view : resources.levelViews)
+		vkDestroyImageView(device, view, nullptr);
+}
+
+bool VulkanContext::supports_blit_mipmaps(VkFormat format) {
 	VkFormatProperties formatProperties;
-	vkGetPhysicalDeviceFormatProperties(this->physicalDevice, image.format, &formatProperties);
+	vkGetPhysicalDeviceFormatProperties(this->physicalDevice, format, &formatProperties);
+
+	VkFormatFeatureFlags flags = VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+	return (formatProperties.optimalTilingFeatures & flags) == flags;
+}
 
-	VkFormatFeatureFlagBits flags = (VkFormatFeatureFlagBits) (VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT);
-	if ((formatProperties.optimalTilingFeatures & flags) != flags) {
-		throw std::runtime_error(std::format("Vulkan Context: Image {} has a format that does not support all the Format Properties needed for Generating Mipmaps with Blittering, do something else", image.info.pName));
-		//Need another method to generate mipmaps instead of using blittering
-		//Probably use Compute Shader to generate
+void VulkanContext::generate_mipmaps_blit(VkCommandBuffer cmd, AllocatedImage& image, uint32_t levelCount, uint32_t layerCount, uint32_t firstLevel) {
+	transition_image(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+	//-Define Manual Image Layout Transition Resources for Each Mip Level Layout Transition
+	VkImageMemoryBarrier2 imageBarrier{};
+	imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+	imageBarrier.pNext = nullptr;
+	imageBarrier.srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	imageBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	imageBarrier.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	imageBarrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+	imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	imageBarrier.image = image.image;
+	imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT; //Might want to give an option to specify if color or depth aspect is needed, or just have Image struct track the aspect or some way to check if uses depth format
+	imageBarrier.subresourceRange.baseArrayLayer = 0;
+	imageBarrier.subresourceRange.layerCount = layerCount;
+	imageBarrier.subresourceRange.levelCount = 1;
+
+	VkDependencyInfo depInfo{};
+	depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	depInfo.imageMemoryBarrierCount = 1;
+	depInfo.pImageMemoryBarriers = &imageBarrier;
+
+	//-Width and Height of initial/previous Mip Image
+	int32_t mipWidth = std::max(image.extent.width >> (firstLevel - 1), 1u);
+	int32_t mipHeight = std::max(image.extent.height >> (firstLevel - 1), 1u);
+
+	for (uint32_t i = firstLevel; i < levelCount; i++) {
+		//Manually Layout Transition the first/prev mip level to Transfer SRC
+		imageBarrier.subresourceRange.baseMipLevel = i - 1; 
+		vkCmdPipelineBarrier2(cmd, &depInfo);
+
+		//Define Blit Info
+		VkImageBlit blit{};
+		blit.srcOffsets[0] = { 0, 0, 0 };
+		blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.srcSubresource.mipLevel = i - 1;
+		blit.srcSubresource.baseArrayLayer = 0;
+		blit.srcSubresource.layerCount = layerCount;
+		blit.dstOffsets[0] = { 0, 0, 0 };
+		blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 };
+		blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.dstSubresource.mipLevel = i;
+		blit.dstSubresource.baseArrayLayer = 0;
+		blit.dstSubresource.layerCount = layerCount;
+
+		//Blit Mip Images
+		vkCmdBlitImage(cmd, image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+		//Setup mip Width and Height for next iteration
+		if (mipWidth > 1)
+			mipWidth /= 2;
+		if (mipHeight > 1)
+			mipHeight /= 2;
 	}
-	else {
-		//Blit
-		transition_image(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-
-		//-Define Manual Image Layout Transition Resources for Each Mip Level Layout Transition
-		VkImageMemoryBarrier2 imageBarrier{};
-		imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
-		imageBarrier.pNext = nullptr;
-		imageBarrier.srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		imageBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
-		imageBarrier.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		imageBarrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
-		imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-		imageBarrier.image = image.image;
-		imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT; //Might want to give an option to specify if color or depth aspect is needed, or just have Image struct track the aspect or some way to check if uses depth format
-		imageBarrier.subresourceRange.baseArrayLayer = 0;
-		imageBarrier.subresourceRange.layerCount = layerCount;
-		imageBarrier.subresourceRange.levelCount = 1;
-
-		VkDependencyInfo depInfo{};
-		depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
-		depInfo.imageMemoryBarrierCount = 1;
-		depInfo.pImageMemoryBarriers = &imageBarrier;
-
-		//-Width and Height of initial/previous Mip Image
-		int32_t mipWidth = image.extent.width;
-		int32_t mipHeight = image.extent.height;
-
-		for (uint32_t i = 1; i < levelCount; i++) {
-			//Manually Layout Transition the first/prev mip level to Transfer SRC
-			imageBarrier.subresourceRange.baseMipLevel = i - 1; 
-			vkCmdPipelineBarrier2(cmd, &depInfo);
-
-			//Define Blit Info
-			VkImageBlit blit{};
-			blit.srcOffsets[0] = { 0, 0, 0 };
-			blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
-			blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			blit.srcSubresource.mipLevel = i - 1;
-			blit.srcSubresource.baseArrayLayer = 0;
-			blit.srcSubresource.layerCount = layerCount;
-			blit.dstOffsets[0] = { 0, 0, 0 };
-			blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 };
-			blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			blit.dstSubresource.mipLevel = i;
-			blit.dstSubresource.baseArrayLayer = 0;
-			blit.dstSubresource.layerCount = layerCount;
-
-			//Blit Mip Images
-			vkCmdBlitImage(cmd, image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
-
-			//Setup mip Width and Height for next iteration
-			if (mipWidth > 1)
-				mipWidth /= 2;
-			if (mipHeight > 1)
-				mipHeight /= 2;
-		}
 
-		//Transition last Mip Image Layout to have the image layout be fully Transfer SRC
-		imageBarrier.subresourceRange.baseMipLevel = levelCount - 1;
+	//Transition last Mip Image Layout to have the image layout be fully Transfer SRC
+	imageBarrier.subresourceRange.baseMipLevel = levelCount - 1;
+	vkCmdPipelineBarrier2(cmd, &depInfo);
+
+	//-Along with the levels before the first source level, which were never blitted from
+	if (firstLevel > 1) {
+		imageBarrier.subresourceRange.baseMipLevel = 0;
+		imageBarrier.subresourceRange.levelCount = firstLevel - 1;
 		vkCmdPipelineBarrier2(cmd, &depInfo);
+	}
+
+	//After Transitioning all the subresource layouts to Transfer SRC, correct the Image Structure's info to specify that the image layout is now fully Transfer SRC (It's jank)
+	image.layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+}
+
+//Downsamples each level in a dispatch that reads the level above it. The image stays in General, as levels are both read and written
+void VulkanContext::generate_mipmaps_compute(VkCommandBuffer cmd, AllocatedImage& image, uint32_t levelCount, uint32_t layerCount, uint32_t firstLevel) {
+	constexpr uint32_t MIPMAP_WORKGROUP_SIZE = 8; //Matches local_size_x and local_size_y of the Mipmap shader
+
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(this->physicalDevice, image.format, &formatProperties);
+	if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT))
+		throw std::runtime_error(std::format("Vulkan Context: Image Format {} supports neither Linear Blits nor Storage, so its Mipmaps can't be generated", static_cast<int>(image.format)));
+
+	std::lock_guard<std::mutex> lock(_mipmapMutex);
+	if (_mipmapPipeline == VK_NULL_HANDLE)
+		init_mipmapPipeline();
+
+	//Views of every level taking part, as 2D Arrays so plain images and cubemaps share the shader
+	uint32_t viewCount = levelCount - firstLevel + 1;
+	std::vector<VkImageView> levelViews(viewCount);
+	for (uint32_t v = 0; v < viewCount; v++) {
+		VkImageViewCreateInfo view_info = vkutil::imageview_create_info(image.format, image.image, VK_IMAGE_ASPECT_COLOR_BIT);
+		view_info.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+		view_info.subresourceRange.baseMipLevel = firstLevel - 1 + v;
+		view_info.subresourceRange.levelCount = 1;
+		view_info.subresourceRange.baseArrayLayer = 0;
+		view_info.subresourceRange.layerCount = layerCount;
+		VK_CHECK(vkCreateImageView(device, &view_info, nullptr, &levelViews[v]));
+	}
+	MipmapResources& cmdResources = _mipmapResources[cmd];
+	cmdResources.levelViews.insert(cmdResources.levelViews.end(), levelViews.begin(), levelViews.end());
+
+	//A Descriptor Set per generated level, reading the view before it and writing its own
+	uint32_t setCount = levelCount - firstLevel;
+	std::vector<VkDescriptorPoolSize> poolSizes = {
+		{.type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, .descriptorCount = setCount },
+		{.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = setCount }
+	};
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = setCount;
+
+	VkDescriptorPool descriptorPool;
+	VK_CHECK(vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool));
+	cmdResources.descriptorPools.push_back(descriptorPool);
+
+	std::vector<VkDescriptorSetLayout> setLayouts(setCount, _mipmapDescriptorSetLayout);
+	std::vector<VkDescriptorSet> sets(setCount);
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = setCount;
+	allocInfo.pSetLayouts = setLayouts.data();
+
+	VK_CHECK(vkAllocateDescriptorSets(device, &allocInfo, sets.data()));
+
+	std::vector<VkDescriptorImageInfo> imageInfos(viewCount);
+	for (uint32_t v = 0; v < viewCount; v++)
+		imageInfos[v] = { .sampler = VK_NULL_HANDLE, .imageView = levelViews[v], .imageLayout = VK_IMAGE_LAYOUT_GENERAL };
+
+	std::vector<VkWriteDescriptorSet> descriptorWrites;
+	descriptorWrites.reserve(setCount * 2);
+	for (uint32_t s = 0; s < setCount; s++) {
+		descriptorWrites.push_back({ .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = sets[s], .dstBinding = 0, .dstArrayElement = 0, .descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, .pImageInfo = &imageInfos[s] });
+		descriptorWrites.push_back({ .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = sets[s], .dstBinding = 1, .dstArrayElement = 0, .descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .pImageInfo = &imageInfos[s + 1] });
+	}
+	vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+
+	//Dispatch each level once the level above it is written
+	transition_image(cmd, image, VK_IMAGE_LAYOUT_GENERAL);
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _mipmapPipeline);
+
+	for (uint32_t level = firstLevel; level < levelCount; level++) {
+		MipmapShader::PushConstants pushconstants{};
+		pushconstants.sourceSize = glm::uvec2(std::max(image.extent.width >> (level - 1), 1u), std::max(image.extent.height >> (level - 1), 1u));
+		pushconstants.levelSize = glm::uvec2(std::max(image.extent.width >> level, 1u), std::max(image.extent.height >> level, 1u));
+
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _mipmapPipelineLayout, 0, 1, &sets[level - firstLevel], 0, nullptr);
+		vkCmdPushConstants(cmd, _mipmapPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(MipmapShader::PushConstants), &pushconstants);
+		vkCmdDispatch(cmd, (pushconstants.levelSize.x + MIPMAP_WORKGROUP_SIZE - 1) / MIPMAP_WORKGROUP_SIZE, (pushconstants.levelSize.y + MIPMAP_WORKGROUP_SIZE - 1) / MIPMAP_WORKGROUP_SIZE, layerCount);
 
-		//After Transitioning all the subresource layouts to Transfer SRC, correct the Image Structure's info to specify that the image layout is now fully Transfer SRC (It's jank)
-		image.layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		vkutil::memory_barrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
 	}
 }
 
+void VulkanContext::init_mipmapPipeline() {
+	std::vector<VkDescriptorSetLayoutBinding> layout_bindings = {
+		{.binding = 0, .descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .pImmutableSamplers = nullptr },
+		{.binding = 1, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = 1, .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .pImmutableSamplers = nullptr }
+	};
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(layout_bindings.size());
+	layoutInfo.pBindings = layout_bindings.data();
+
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &_mipmapDescriptorSetLayout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create Mipmap Descriptor Set Layout");
+
+	VkShaderModule mipmapShader;
+	if (!vkutil::load_shader_module("shaders/generateMipmap_comp.spv", device, &mipmapShader))
+		throw std::runtime_error("Error trying to create Mipmap Shader Module");
+	else
+		std::cout << "Mipmap Shader successfully loaded" << std::endl;
+
+	VkPushConstantRange range{};
+	range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	range.offset = 0;
+	range.size = sizeof(MipmapShader::PushConstants);
+
+	VkPipelineLayoutCreateInfo pipeline_layout_info = vkutil::pipeline_layout_create_info();
+	pipeline_layout_info.setLayoutCount = 1;
+	pipeline_layout_info.pSetLayouts = &_mipmapDescriptorSetLayout;
+	pipeline_layout_info.pushConstantRangeCount = 1;
+	pipeline_layout_info.pPushConstantRanges = &range;
+
+	VK_CHECK(vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &_mipmapPipelineLayout));
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = vkutil::pipeline_shader_stage_create_info(VK_SHADER_STAGE_COMPUTE_BIT, mipmapShader);
+	pipelineInfo.layout = _mipmapPipelineLayout;
+
+	if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_mipmapPipeline) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create Mipmap Pipeline");
+
+	vkDestroyShaderModule(device, mipmapShader, nullptr);
+}
+
 VkSampler VulkanContext::create_sampler(VkSamplerCreateInfo& samplerCreateInfo) {
 	VkSampler sampler;
 	vkCreateSampler(device, &samplerCreateInfo, nullptr, &sampler);
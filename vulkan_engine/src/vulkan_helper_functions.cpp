@@ -19,7 +19,7 @@ void vkutil::transition_image(VkCommandBuffer cmd, VkImage image, VkImageLayout
 	imageBarrier.oldLayout = currentLayout;
 	imageBarrier.newLayout = newLayout;
 
-	VkImageAspectFlags aspectMask = (newLayout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+	VkImageAspectFlags aspectMask = (newLayout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL || newLayout == VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
 	imageBarrier.subresourceRange = vkutil::image_subresource_range(aspectMask);
 	imageBarrier.image = image;
 
@@ -33,6 +33,25 @@ void vkutil::transition_image(VkCommandBuffer cmd, VkImage image, VkImageLayout
 	vkCmdPipelineBarrier2(cmd, &depInfo);
 }
 
+//Global Memory Barrier, for resources that don't change layout like buffers
+void vkutil::memory_barrier(VkCommandBuffer cmd, VkPipelineStageFlags2 srcStageMask, VkAccessFlags2 srcAccessMask, VkPipelineStageFlags2 dstStageMask, VkAccessFlags2 dstAccessMask) {
+	VkMemoryBarrier2 memoryBarrier{};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+	memoryBarrier.pNext = nullptr;
+	memoryBarrier.srcStageMask = srcStageMask;
+	memoryBarrier.srcAccessMask = srcAccessMask;
+	memoryBarrier.dstStageMask = dstStageMask;
+	memoryBarrier.dstAccessMask = dstAccessMask;
+
+	VkDependencyInfo depInfo{};
+	depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	depInfo.pNext = nullptr;
+	depInfo.memoryBarrierCount = 1;
+	depInfo.pMemoryBarriers = &memoryBarrier;
+
+	vkCmdPipelineBarrier2(cmd, &depInfo);
+}
+
 void vkutil::copy_image_to_image(VkCommandBuffer cmd, VkImage source, VkImage destination, VkExtent2D srcSize, VkExtent2D dstSize) {
 	VkImageBlit2 blitRegion{};
 	blitRegion.sType = VK_STRUCTURE_TYPE_IMAGE_BLIT_2;
@@ -235,7 +254,7 @@ VkRenderingInfo vkutil::rendering_info(VkExtent2D renderExtent, VkRenderingAttac
 	renderInfo.pNext = nullptr;
 	renderInfo.renderArea = VkRect2D{ VkOffset2D {0,0}, renderExtent };
 	renderInfo.layerCount = 1;
-	renderInfo.colorAttachmentCount = 1;
+	renderInfo.colorAttachmentCount = colorAttachment != nullptr ? 1 : 0; //No Color Attachment for depth only passes
 	renderInfo.pColorAttachments = colorAttachment;
 	renderInfo.pDepthAttachment = depthAttachment;
 	renderInfo.pStencilAttachment = nullptr;
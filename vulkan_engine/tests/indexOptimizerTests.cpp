@@ -0,0 +1,184 @@
+#include "test.h"
+
+#include "indexOptimizer.h"
+
+#include <vector>
+#include <array>
+#include <random>
+#include <algorithm>
+
+namespace {
+	using Triangle = std::array<uint32_t, 3>;
+
+	struct TestMesh {
+		std::vector<glm::vec3> positions;
+		std::vector<uint32_t> indices;
+	};
+
+	//Closed box of 6 grids of size x size quads, with its triangles in random order so the vertex cache gets no help from the input
+	TestMesh shuffled_box(uint32_t size, std::mt19937& rng) {
+		TestMesh mesh;
+		const glm::vec3 axes[3] = { glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f) };
+
+		std::vector<Triangle> triangles;
+		for (int face = 0; face < 6; face++) {
+			const glm::vec3& normal = axes[face % 3];
+			const glm::vec3& u = axes[(face + 1) % 3];
+			const glm::vec3& v = axes[(face + 2) % 3];
+			float side = face < 3 ? 1.0f : -1.0f;
+
+			uint32_t first = static_cast<uint32_t>(mesh.positions.size());
+			for (uint32_t y = 0; y <= size; y++) {
+				for (uint32_t x = 0; x <= size; x++)
+					mesh.positions.push_back(normal * side + u * (2.0f * x / size - 1.0f) + v * (2.0f * y / size - 1.0f));
+			}
+
+			for (uint32_t y = 0; y < size; y++) {
+				for (uint32_t x = 0; x < size; x++) {
+					uint32_t corner = first + y * (size + 1) + x;
+					triangles.push_back({ corner, corner + 1, corner + size + 1 });
+					triangles.push_back({ corner + 1, corner + size + 2, corner + size + 1 });
+				}
+			}
+		}
+
+		std::shuffle(triangles.begin(), triangles.end(), rng);
+		for (const Triangle& triangle : triangles)
+			mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+		return mesh;
+	}
+
+	//Triangles as unordered vertex triples, sorted so two index buffers drawing the same triangles compare equal
+	std::vector<Triangle> triangle_set(const std::vector<uint32_t>& indices) {
+		std::vector<Triangle> triangles;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+			Triangle triangle = { indices[i], indices[i + 1], indices[i + 2] };
+			std::sort(triangle.begin(), triangle.end());
+			triangles.push_back(triangle);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+}
+
+//FIFO of 3 over 0 1 2 | 2 1 3 | 0 4 5: the first triangle misses thrice, the second only on 3 (evicting 0), and the third misses on 0, 4 and 5
+TEST(analyze_vertex_cache_hand_computed) {
+	std::vector<uint32_t> indices = { 0, 1, 2, 2, 1, 3, 0, 4, 5 };
+
+	indexoptimizer::CacheStats small = indexoptimizer::analyze_vertex_cache(indices, 7, 3);
+	CHECK(small.triangles == 3);
+	CHECK(small.vertices == 6);
+	CHECK(small.transforms == 7);
+	CHECK(small.acmr() == 7.0f / 3.0f);
+	CHECK(small.atvr() == 7.0f / 6.0f);
+
+	//Everything fits in the default cache, so each vertex is transformed once
+	indexoptimizer::CacheStats large = indexoptimizer::analyze_vertex_cache(indices, 7);
+	CHECK(large.transforms == 6);
+	CHECK(large.atvr() == 1.0f);
+}
+
+TEST(vertex_cache_lowers_acmr) {
+	std::mt19937 rng(20);
+	TestMesh mesh = shuffled_box(16, rng);
+	std::vector<Triangle> triangles = triangle_set(mesh.indices);
+
+	float before = indexoptimizer::analyze_vertex_cache(mesh.indices, mesh.positions.size()).acmr();
+
+	std::vector<uint32_t> clusterStarts;
+	indexoptimizer::optimize_vertex_cache(mesh.indices, mesh.positions.size(), clusterStarts);
+	float after = indexoptimizer::analyze_vertex_cache(mesh.indices, mesh.positions.size()).acmr();
+
+	//A shuffled grid misses on nearly every vertex, while Tipsify gets a grid well under one transform per triangle
+	CHECK(before > 2.0f);
+	CHECK(after < 0.8f);
+	CHECK(triangle_set(mesh.indices) == triangles);
+	CHECK(!clusterStarts.empty() && clusterStarts[0] == 0);
+	CHECK(std::is_sorted(clusterStarts.begin(), clusterStarts.end()));
+}
+
+TEST(overdraw_keeps_triangles) {
+	std::mt19937 rng(21);
+	TestMesh mesh = shuffled_box(16, rng);
+
+	std::vector<uint32_t> clusterStarts;
+	indexoptimizer::optimize_vertex_cache(mesh.indices, mesh.positions.size(), clusterStarts);
+	std::vector<Triangle> triangles = triangle_set(mesh.indices);
+	CHECK(clusterStarts.size() > 1);
+
+	indexoptimizer::optimize_overdraw(mesh.indices, clusterStarts, mesh.positions);
+	CHECK(triangle_set(mesh.indices) == triangles);
+}
+
+TEST(vertex_fetch_remap_is_permutation) {
+	std::mt19937 rng(22);
+	TestMesh mesh = shuffled_box(8, rng);
+
+	//Vertices no triangle uses, which the remap drops
+	size_t vertexCount = mesh.positions.size() + 5;
+	std::vector<uint32_t> original = mesh.indices;
+
+	std::vector<uint32_t> remap;
+	size_t newCount = indexoptimizer::optimize_vertex_fetch(mesh.indices, vertexCount, remap);
+	CHECK(newCount == mesh.positions.size());
+	CHECK(remap.size() == vertexCount);
+
+	//Every referenced vertex gets its own new index below newCount, and the unreferenced ones get none
+	std::vector<uint32_t> uses(newCount, 0);
+	for (size_t v = 0; v < vertexCount; v++) {
+		if (v < mesh.positions.size()) {
+			CHECK(remap[v] < newCount);
+			if (remap[v] < newCount)
+				uses[remap[v]]++;
+		}
+		else {
+			CHECK(remap[v] == indexoptimizer::UNUSED);
+		}
+	}
+	CHECK(std::all_of(uses.begin(), uses.end(), [](uint32_t count) { return count == 1; }));
+
+	//Same triangles through the remap, and the new indices first appear in increasing order
+	std::vector<uint32_t> remapped;
+	for (uint32_t index : original)
+		remapped.push_back(remap[index]);
+	CHECK(triangle_set(mesh.indices) == triangle_set(remapped));
+
+	uint32_t nextNew = 0;
+	bool inFirstUseOrder = true;
+	for (uint32_t index : mesh.indices) {
+		if (index == nextNew)
+			nextNew++;
+		else if (index > nextNew)
+			inFirstUseOrder = false;
+	}
+	CHECK(inFirstUseOrder);
+}
+
+//All passes together, with the streams moved along, draw the same triangles at the same positions
+TEST(optimize_keeps_positions) {
+	std::mt19937 rng(23);
+	TestMesh mesh = shuffled_box(12, rng);
+
+	auto triangle_positions = [](const TestMesh& mesh) {
+		std::vector<std::array<float, 9>> triangles;
+		for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+			std::array<std::array<float, 3>, 3> corners;
+			for (int k = 0; k < 3; k++) {
+				const glm::vec3& p = mesh.positions[mesh.indices[i + k]];
+				corners[k] = { p.x, p.y, p.z };
+			}
+			std::sort(corners.begin(), corners.end());
+			triangles.push_back({ corners[0][0], corners[0][1], corners[0][2], corners[1][0], corners[1][1], corners[1][2], corners[2][0], corners[2][1], corners[2][2] });
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	};
+	std::vector<std::array<float, 9>> before = triangle_positions(mesh);
+
+	std::vector<uint32_t> remap;
+	size_t newCount = indexoptimizer::optimize(mesh.indices, mesh.positions, remap);
+	indexoptimizer::remap_stream(mesh.positions, remap, newCount);
+
+	CHECK(indexoptimizer::is_triangle_list(mesh.indices, mesh.positions.size()));
+	CHECK(triangle_positions(mesh) == before);
+}
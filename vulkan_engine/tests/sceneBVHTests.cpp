@@ -0,0 +1,205 @@
+#include "test.h"
+
+#include "sceneBVH.h"
+
+#include <vector>
+#include <memory>
+#include <random>
+#include <algorithm>
+
+namespace {
+	constexpr uint32_t NODE_COUNT = 2000;
+
+	glm::mat4 translation(const glm::vec3& offset) {
+		glm::mat4 matrix(1.0f);
+		matrix[3] = glm::vec4(offset, 1.0f);
+		return matrix;
+	}
+
+	glm::mat4 transform(const glm::vec3& offset, float scale) {
+		glm::mat4 matrix(scale);
+		matrix[3] = glm::vec4(offset, 1.0f);
+		return matrix;
+	}
+
+	//Random Nodes, some without a Mesh, some as children of earlier Nodes, each Mesh with a random box
+	struct RandomScene {
+		Scene scene;
+		std::vector<std::shared_ptr<Node>> nodes;
+		std::vector<std::shared_ptr<Mesh>> meshes;
+
+		RandomScene(std::mt19937& rng) {
+			std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+			std::uniform_real_distribution<float> offset(-10.0f, 10.0f);
+			std::uniform_real_distribution<float> size(0.1f, 4.0f);
+			std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+
+			for (int i = 0; i < 16; i++) {
+				std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+				Mesh::Primitive primitive;
+				primitive.bounds_min = -glm::vec3(size(rng), size(rng), size(rng));
+				primitive.bounds_max = glm::vec3(size(rng), size(rng), size(rng));
+				mesh->primitives.push_back(std::move(primitive));
+				meshes.push_back(mesh);
+			}
+
+			for (uint32_t i = 0; i < NODE_COUNT; i++) {
+				std::shared_ptr<Node> node = std::make_shared<Node>();
+				node->mesh = i % 5 == 0 ? nullptr : meshes[rng() % meshes.size()];
+
+				if (i > 0 && rng() % 3 == 0) {
+					std::shared_ptr<Node>& parent = nodes[rng() % nodes.size()];
+					node->parent_node = parent;
+					parent->child_nodes.push_back(node);
+					node->updateLocalTransform(transform(glm::vec3(offset(rng), offset(rng), offset(rng)), scale(rng)));
+				}
+				else {
+					scene.root_nodes.push_back(node);
+					node->updateLocalTransform(transform(glm::vec3(position(rng), position(rng), position(rng)), scale(rng)));
+				}
+				nodes.push_back(node);
+			}
+		}
+
+		AABB world_bounds(Node& node) const {
+			return SceneBVH::local_bounds(node).transformed(node.get_WorldTransform());
+		}
+	};
+
+	std::vector<uint32_t> sorted_ids(const std::vector<std::shared_ptr<Node>>& nodes) {
+		std::vector<uint32_t> ids;
+		for (const std::shared_ptr<Node>& node : nodes)
+			ids.push_back(node->getID());
+		std::sort(ids.begin(), ids.end());
+		return ids;
+	}
+
+	//Slab test, returning the distance the ray enters the box or a negative value if it misses
+	float ray_distance(const AABB& box, const Ray& ray) {
+		glm::vec3 inv_direction = 1.0f / ray.direction;
+		glm::vec3 t0 = (box.min - ray.origin) * inv_direction;
+		glm::vec3 t1 = (box.max - ray.origin) * inv_direction;
+		glm::vec3 t_near = glm::min(t0, t1);
+		glm::vec3 t_far = glm::max(t0, t1);
+
+		float enter = std::max(std::max(t_near.x, t_near.y), std::max(t_near.z, 0.0f));
+		float exit = std::min(std::min(t_far.x, t_far.y), t_far.z);
+		return enter <= exit ? enter : -1.0f;
+	}
+
+	//Reverse-Z infinite perspective looking down -z from eye, like the Render System's
+	glm::mat4 viewproj(const glm::vec3& eye, float focal) {
+		glm::mat4 proj(0.0f);
+		proj[0][0] = focal;
+		proj[1][1] = focal;
+		proj[2][3] = -1.0f;
+		proj[3][2] = 0.1f;
+		return proj * translation(-eye);
+	}
+
+	//Compares every query against a linear scan of the Scene's Nodes
+	void check_queries(SceneBVH& bvh, RandomScene& random, std::mt19937& rng) {
+		std::uniform_real_distribution<float> position(-120.0f, 120.0f);
+		std::uniform_real_distribution<float> extent(1.0f, 40.0f);
+		std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> focal(0.5f, 3.0f);
+
+		size_t meshNodes = 0;
+		for (const std::shared_ptr<Node>& node : random.nodes)
+			meshNodes += node->mesh != nullptr;
+		CHECK(bvh.node_count() == meshNodes);
+
+		size_t overlapMismatches = 0;
+		size_t frustumMismatches = 0;
+		size_t rayMismatches = 0;
+		for (int query = 0; query < 100; query++) {
+			//Overlap
+			AABB box{};
+			box.expand(glm::vec3(position(rng), position(rng), position(rng)));
+			box.max = box.min + glm::vec3(extent(rng), extent(rng), extent(rng));
+
+			std::vector<std::shared_ptr<Node>> results;
+			bvh.query_overlap(box, results);
+
+			std::vector<std::shared_ptr<Node>> expected;
+			for (const std::shared_ptr<Node>& node : random.nodes) {
+				if (node->mesh != nullptr && random.world_bounds(*node).overlaps(box))
+					expected.push_back(node);
+			}
+			overlapMismatches += sorted_ids(results) != sorted_ids(expected);
+
+			//Frustum
+			Frustum frustum = Frustum::from_viewproj(viewproj(glm::vec3(position(rng), position(rng), 150.0f), focal(rng)));
+
+			results.clear();
+			bvh.query_frustum(frustum, results);
+
+			expected.clear();
+			for (const std::shared_ptr<Node>& node : random.nodes) {
+				if (node->mesh != nullptr && frustum.classify(random.world_bounds(*node)) != Frustum::Result::Outside)
+					expected.push_back(node);
+			}
+			frustumMismatches += sorted_ids(results) != sorted_ids(expected);
+
+			//Ray. Ties between Nodes are allowed, so only the distance has to match
+			Ray ray{ .origin = glm::vec3(position(rng), position(rng), position(rng)), .direction = glm::vec3(direction(rng), direction(rng), direction(rng)) };
+
+			SceneBVH::RayHit hit{};
+			bool hitAny = bvh.query_ray(ray, hit);
+
+			bool expectedHit = false;
+			float expectedDistance = FLT_MAX;
+			for (const std::shared_ptr<Node>& node : random.nodes) {
+				if (node->mesh == nullptr)
+					continue;
+				float distance = ray_distance(random.world_bounds(*node), ray);
+				if (distance >= 0.0f && distance < expectedDistance) {
+					expectedHit = true;
+					expectedDistance = distance;
+				}
+			}
+
+			if (hitAny != expectedHit)
+				rayMismatches++;
+			else if (hitAny && (hit.distance != expectedDistance || ray_distance(random.world_bounds(*hit.node), ray) != hit.distance))
+				rayMismatches++;
+		}
+
+		CHECK(overlapMismatches == 0);
+		CHECK(frustumMismatches == 0);
+		CHECK(rayMismatches == 0);
+	}
+}
+
+TEST(bvh_queries_match_brute_force) {
+	std::mt19937 rng(13);
+	RandomScene random(rng);
+
+	SceneBVH bvh;
+	bvh.build(random.scene);
+	check_queries(bvh, random, rng);
+}
+
+//Moving a Node moves its whole subtree. Refitting with the IDs the Nodes recorded must leave the queries as correct as a rebuild
+TEST(bvh_refit_after_subtree_move) {
+	std::mt19937 rng(14);
+	RandomScene random(rng);
+
+	SceneBVH bvh;
+	bvh.build(random.scene);
+	Node::bounds_journal.consume();
+
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	for (int move = 0; move < 20; move++) {
+		std::shared_ptr<Node>& node = random.nodes[rng() % random.nodes.size()];
+		node->updateLocalTransform(translation(glm::vec3(position(rng), position(rng), position(rng))));
+	}
+	bvh.refit(Node::bounds_journal.consume());
+	check_queries(bvh, random, rng);
+
+	//Enough Nodes that the refit updates the whole tree instead of walking up from each leaf
+	for (const std::shared_ptr<Node>& root : random.scene.root_nodes)
+		root->updateLocalTransform(translation(glm::vec3(position(rng), position(rng), position(rng))));
+	bvh.refit(Node::bounds_journal.consume());
+	check_queries(bvh, random, rng);
+}
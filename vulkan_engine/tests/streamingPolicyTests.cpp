@@ -0,0 +1,146 @@
+#include "test.h"
+
+#include "streamingPolicy.h"
+
+#include <vector>
+#include <algorithm>
+
+namespace {
+	using streamingpolicy::ImageState;
+
+	constexpr uint64_t MB = 1ull << 20;
+
+	//Square RGBA8 Image with its full Mip Chain, whose tail is its levels no larger than 256
+	ImageState make_image(uint32_t size, uint32_t residentLevel, int lastSampledFrame) {
+		uint32_t levelCount = 1;
+		while ((size >> levelCount) > 0)
+			levelCount++;
+		uint32_t tailLevel = 0;
+		while ((size >> tailLevel) > 256)
+			tailLevel++;
+
+		ImageState image{};
+		image.extent = { .width = size, .height = size, .depth = 1 };
+		image.format = VK_FORMAT_R8G8B8A8_UNORM;
+		image.levelCount = levelCount;
+		image.residentLevel = residentLevel;
+		image.tailLevel = tailLevel;
+		image.wantedLevel = residentLevel;
+		image.lastSampledFrame = lastSampledFrame;
+		return image;
+	}
+
+	uint64_t total_resident_bytes(const std::vector<ImageState>& images) {
+		uint64_t total = 0;
+		for (const ImageState& image : images)
+			total += streamingpolicy::resident_bytes(image, image.residentLevel);
+		return total;
+	}
+}
+
+TEST(budget_takes_free_device_memory_short_of_headroom) {
+	//10% of 1000 MB is held back, leaving 500 MB of the 600 MB free on top of the 200 MB already resident
+	uint64_t automatic = streamingpolicy::plan_budget(1000 * MB, 400 * MB, 200 * MB, 0);
+	CHECK(automatic <= 700 * MB && automatic + 64 >= 700 * MB);
+
+	CHECK(streamingpolicy::plan_budget(1000 * MB, 400 * MB, 200 * MB, 300) == 300 * MB);
+	CHECK(streamingpolicy::plan_budget(1000 * MB, 400 * MB, 200 * MB, 5000) == automatic);
+
+	//Usage already past the headroom leaves the streamed Images what they hold
+	CHECK(streamingpolicy::plan_budget(1000 * MB, 950 * MB, 200 * MB, 0) == 200 * MB);
+	CHECK(streamingpolicy::plan_budget(1000 * MB, 1200 * MB, 200 * MB, 0) == 200 * MB);
+}
+
+TEST(residency_trims_unwanted_levels) {
+	std::vector<ImageState> images = { make_image(2048, 0, 0), make_image(2048, 0, 0) };
+	images[0].wantedLevel = 2;
+	uint64_t residentBytes = total_resident_bytes(images);
+
+	std::vector<size_t> changed = streamingpolicy::plan_residency(images, residentBytes, UINT64_MAX);
+
+	CHECK(changed == std::vector<size_t>{ 0 });
+	CHECK(images[0].residentLevel == 2);
+	CHECK(images[1].residentLevel == 0);
+	CHECK(residentBytes == total_resident_bytes(images));
+}
+
+TEST(residency_evicts_least_recently_sampled_first) {
+	std::vector<ImageState> images = { make_image(2048, 0, 20), make_image(2048, 0, 10) };
+	uint64_t residentBytes = total_resident_bytes(images);
+	uint64_t budget = streamingpolicy::resident_bytes(images[0], 0) + streamingpolicy::resident_bytes(images[1], 1);
+
+	std::vector<size_t> changed = streamingpolicy::plan_residency(images, residentBytes, budget);
+
+	//Only the older Image loses its finest level, and doesn't want it back this frame
+	CHECK(changed == std::vector<size_t>{ 1 });
+	CHECK(images[0].residentLevel == 0);
+	CHECK(images[1].residentLevel == 1);
+	CHECK(images[1].wantedLevel == 1);
+	CHECK(residentBytes == total_resident_bytes(images));
+	CHECK(residentBytes <= budget);
+}
+
+TEST(residency_evicts_larger_first_among_equally_recent) {
+	std::vector<ImageState> images = { make_image(1024, 0, 10), make_image(2048, 0, 10) };
+	uint64_t residentBytes = total_resident_bytes(images);
+
+	std::vector<size_t> changed = streamingpolicy::plan_residency(images, residentBytes, residentBytes - 1);
+
+	CHECK(changed == std::vector<size_t>{ 1 });
+	CHECK(images[0].residentLevel == 0);
+	CHECK(images[1].residentLevel == 1);
+	CHECK(residentBytes == total_resident_bytes(images));
+}
+
+TEST(residency_never_evicts_the_tail) {
+	std::vector<ImageState> images = { make_image(2048, 0, 0), make_image(4096, 1, 5), make_image(512, 0, 3) };
+	uint64_t residentBytes = total_resident_bytes(images);
+
+	std::vector<size_t> changed = streamingpolicy::plan_residency(images, residentBytes, 0);
+
+	CHECK(changed.size() == 3);
+	for (const ImageState& image : images)
+		CHECK(image.residentLevel == image.tailLevel);
+	CHECK(residentBytes == total_resident_bytes(images));
+}
+
+TEST(residency_streams_in_one_level_at_a_time_within_budget) {
+	std::vector<ImageState> images = { make_image(2048, 3, 0) };
+	images[0].wantedLevel = 0;
+	uint64_t residentBytes = total_resident_bytes(images);
+	uint64_t budget = streamingpolicy::resident_bytes(images[0], 2);
+
+	CHECK(streamingpolicy::plan_residency(images, residentBytes, budget) == std::vector<size_t>{ 0 });
+	CHECK(images[0].residentLevel == 2);
+
+	//Level 1 doesn't fit, so it stays until the budget grows
+	CHECK(streamingpolicy::plan_residency(images, residentBytes, budget).empty());
+	CHECK(images[0].residentLevel == 2);
+
+	CHECK(streamingpolicy::plan_residency(images, residentBytes, UINT64_MAX) == std::vector<size_t>{ 0 });
+	CHECK(images[0].residentLevel == 1);
+	CHECK(images[0].wantedLevel == 0);
+	CHECK(residentBytes == total_resident_bytes(images));
+}
+
+TEST(residency_holds_stream_ins_to_the_upload_cap) {
+	//Level 0 of a 2048 Image is over half the cap, so only the first of these fits in a frame
+	std::vector<ImageState> images = { make_image(2048, 1, 0), make_image(2048, 1, 0), make_image(2048, 1, 0) };
+	for (ImageState& image : images)
+		image.wantedLevel = 0;
+	CHECK(streamingpolicy::resident_bytes(images[0], 0) * 2 > streamingpolicy::UPLOAD_BYTES_PER_FRAME);
+	uint64_t residentBytes = total_resident_bytes(images);
+
+	CHECK(streamingpolicy::plan_residency(images, residentBytes, UINT64_MAX).size() == 1);
+	CHECK(std::ranges::count_if(images, [](const ImageState& image) { return image.residentLevel == 0; }) == 1);
+
+	//The Image furthest from what it wants goes first, even if it's listed last
+	images.push_back(make_image(2048, 3, 0));
+	images.back().wantedLevel = 0;
+	residentBytes = total_resident_bytes(images);
+
+	std::vector<size_t> changed = streamingpolicy::plan_residency(images, residentBytes, UINT64_MAX);
+	CHECK(!changed.empty() && changed[0] == 3);
+	CHECK(images[3].residentLevel == 2);
+	CHECK(residentBytes == total_resident_bytes(images));
+}
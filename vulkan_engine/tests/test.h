@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+/*
+	Minimal headless test harness. TEST defines a test case that registers itself, and CHECK records a failed expression without stopping the test.
+	testMain runs every registered test and exits with a failure if any check failed, so the tests can run from the command line or a build step.
+*/
+namespace test {
+
+	using TestFunction = void (*)();
+
+	struct TestCase {
+		const char* name;
+		TestFunction function;
+	};
+
+	std::vector<TestCase>& registry();
+	void report_failure(const char* expression, const char* file, int line);
+
+	struct Registrar {
+		Registrar(const char* name, TestFunction function) {
+			registry().push_back({ .name = name, .function = function });
+		}
+	};
+}
+
+#define TEST(name) \
+	static void name(); \
+	static test::Registrar name##_registrar(#name, name); \
+	static void name()
+
+#define CHECK(expression) \
+	do { \
+		if (!(expression)) \
+			test::report_failure(#expression, __FILE__, __LINE__); \
+	} while (false)
@@ -0,0 +1,38 @@
+#include "test.h"
+
+#include <iostream>
+#include <format>
+#include <cstdlib>
+
+namespace {
+	int failedChecks = 0;
+}
+
+namespace test {
+
+	std::vector<TestCase>& registry() {
+		static std::vector<TestCase> tests;
+		return tests;
+	}
+
+	void report_failure(const char* expression, const char* file, int line) {
+		failedChecks++;
+		std::cerr << std::format("{}({}): CHECK({}) failed", file, line, expression) << std::endl;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	int failedTests = 0;
+	for (const test::TestCase& testCase : test::registry()) {
+		int failedBefore = failedChecks;
+		testCase.function();
+
+		bool passed = failedChecks == failedBefore;
+		if (!passed)
+			failedTests++;
+		std::cout << std::format("[{}] {}", passed ? "PASS" : "FAIL", testCase.name) << std::endl;
+	}
+
+	std::cout << std::format("{} of {} tests passed", test::registry().size() - failedTests, test::registry().size()) << std::endl;
+	return failedTests == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
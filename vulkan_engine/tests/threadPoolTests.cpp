@@ -0,0 +1,44 @@
+#include "test.h"
+
+#include "threadPool.h"
+
+#include <vector>
+#include <atomic>
+#include <stdexcept>
+
+TEST(parallel_for_runs_every_index_once) {
+	ThreadPool pool(4);
+	std::vector<std::atomic<int>> runs(1000);
+
+	pool.parallel_for(runs.size(), [&](size_t i) { runs[i]++; });
+
+	bool once = true;
+	for (const std::atomic<int>& run : runs)
+		once &= run == 1;
+	CHECK(once);
+}
+
+TEST(parallel_for_rethrows_after_every_task_finishes) {
+	ThreadPool pool(4);
+	std::atomic<size_t> finished = 0;
+
+	bool thrown = false;
+	try {
+		pool.parallel_for(200, [&](size_t i) {
+			if (i % 50 == 7)
+				throw std::runtime_error("Task failed");
+			finished++;
+		});
+	}
+	catch (const std::runtime_error&) {
+		thrown = true;
+	}
+
+	CHECK(thrown);
+	CHECK(finished == 196);
+
+	//The pool is still usable afterwards
+	std::atomic<size_t> count = 0;
+	pool.parallel_for(100, [&](size_t) { count++; });
+	CHECK(count == 100);
+}
@@ -0,0 +1,153 @@
+#include "test.h"
+
+#include "transformKernels.h"
+
+#include <vector>
+#include <random>
+#include <cmath>
+#include <algorithm>
+
+using transformkernels::ISA;
+
+namespace {
+	//Every ISA the CPU runs. Each one implies the narrower ones
+	std::vector<ISA> supported_isas() {
+		std::vector<ISA> isas = { ISA::Scalar };
+		if (transformkernels::active_isa() == ISA::SSE || transformkernels::active_isa() == ISA::AVX2)
+			isas.push_back(ISA::SSE);
+		if (transformkernels::active_isa() == ISA::AVX2)
+			isas.push_back(ISA::AVX2);
+		return isas;
+	}
+
+	glm::mat4 random_matrix(std::mt19937& rng) {
+		std::uniform_real_distribution<float> element(-10.0f, 10.0f);
+		glm::mat4 matrix;
+		for (int column = 0; column < 4; column++) {
+			for (int row = 0; row < 4; row++)
+				matrix[column][row] = element(rng);
+		}
+		return matrix;
+	}
+
+	//The SIMD kernels may fuse multiplies and adds, so they're compared relative to the magnitude of the terms summed
+	bool nearly_equal(const glm::mat4& a, const glm::mat4& b, float scale) {
+		for (int column = 0; column < 4; column++) {
+			for (int row = 0; row < 4; row++) {
+				if (std::abs(a[column][row] - b[column][row]) > 1e-5f * scale)
+					return false;
+			}
+		}
+		return true;
+	}
+
+	glm::mat4 translation(float x, float y, float z) {
+		glm::mat4 matrix(1.0f);
+		matrix[3] = glm::vec4(x, y, z, 1.0f);
+		return matrix;
+	}
+
+	glm::mat4 scaling(float s) {
+		glm::mat4 matrix(s);
+		matrix[3][3] = 1.0f;
+		return matrix;
+	}
+}
+
+TEST(multiply_matches_glm) {
+	std::mt19937 rng(15);
+	const size_t count = 1000;
+
+	std::vector<glm::mat4> parents(count);
+	std::vector<glm::mat4> locals(count);
+	for (size_t i = 0; i < count; i++) {
+		parents[i] = random_matrix(rng);
+		locals[i] = random_matrix(rng);
+	}
+
+	for (ISA isa : supported_isas()) {
+		std::vector<glm::mat4> results(count);
+		transformkernels::multiply(isa, parents.data(), locals.data(), results.data(), count);
+
+		size_t mismatches = 0;
+		for (size_t i = 0; i < count; i++) {
+			if (!nearly_equal(results[i], parents[i] * locals[i], 400.0f))
+				mismatches++;
+		}
+		CHECK(mismatches == 0);
+	}
+}
+
+//Results may alias the locals, which compose_worlds relies on when a hierarchy updates in place
+TEST(multiply_in_place) {
+	std::mt19937 rng(16);
+	const size_t count = 64;
+
+	std::vector<glm::mat4> parents(count);
+	std::vector<glm::mat4> locals(count);
+	for (size_t i = 0; i < count; i++) {
+		parents[i] = random_matrix(rng);
+		locals[i] = random_matrix(rng);
+	}
+
+	for (ISA isa : supported_isas()) {
+		std::vector<glm::mat4> results = locals;
+		transformkernels::multiply(isa, parents.data(), results.data(), results.data(), count);
+
+		size_t mismatches = 0;
+		for (size_t i = 0; i < count; i++) {
+			if (!nearly_equal(results[i], parents[i] * locals[i], 400.0f))
+				mismatches++;
+		}
+		CHECK(mismatches == 0);
+	}
+}
+
+//A Node translated by its parent and scaled by itself stays at the parent's origin. The old local * parent order scaled the parent's translation instead
+TEST(multiply_order_is_parent_times_local) {
+	glm::mat4 parent = translation(1.0f, 2.0f, 3.0f);
+	glm::mat4 local = scaling(2.0f);
+	glm::mat4 expected = translation(1.0f, 2.0f, 3.0f);
+	expected[0][0] = expected[1][1] = expected[2][2] = 2.0f;
+
+	for (ISA isa : supported_isas()) {
+		glm::mat4 result;
+		transformkernels::multiply(isa, &parent, &local, &result, 1);
+
+		CHECK(nearly_equal(result, expected, 1.0f));
+		CHECK(!nearly_equal(result, local * parent, 1.0f));
+	}
+}
+
+TEST(compose_worlds_matches_glm) {
+	std::mt19937 rng(17);
+	const uint32_t count = 500;
+	const uint32_t noParent = UINT32_MAX;
+
+	//Small transforms, so chains of them don't grow past what the tolerance covers
+	std::vector<glm::mat4> locals(count);
+	std::vector<uint32_t> parents(count);
+	std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+	for (uint32_t i = 0; i < count; i++) {
+		locals[i] = translation(offset(rng), offset(rng), offset(rng));
+		locals[i][0][1] = offset(rng) * 0.2f;
+		locals[i][1][0] = offset(rng) * 0.2f;
+		parents[i] = i % 7 == 0 ? noParent : static_cast<uint32_t>(rng() % i);
+	}
+
+	std::vector<glm::mat4> expected(count);
+	for (uint32_t i = 0; i < count; i++)
+		expected[i] = parents[i] != noParent ? expected[parents[i]] * locals[i] : locals[i];
+
+	for (ISA isa : supported_isas()) {
+		std::vector<glm::mat4> worlds(count);
+		transformkernels::compose_worlds(isa, parents.data(), locals.data(), worlds.data(), 0, count, noParent);
+
+		size_t mismatches = 0;
+		for (uint32_t i = 0; i < count; i++) {
+			if (!nearly_equal(worlds[i], expected[i], 100.0f))
+				mismatches++;
+		}
+		CHECK(mismatches == 0);
+	}
+}